@@ -0,0 +1,302 @@
+/**
+ * DOSA OTA patch generator
+ *
+ * Builds a delta patch between two firmware images, for devices to apply against their running flash (see
+ * lib/ota/src/ota_patch.h). Published beside the images in the OTA bucket:
+ *   ROOT/<app>/build-N.bin            Firmware image
+ *   ROOT/<app>/build-N-from-M.patch   Patch building image N from image M
+ *
+ * Matching follows bsdiff: an exact seed match of the new image is found in the old one, then extended forward while
+ * more bytes match than not. Moved code with shifted addresses is left as a diff that is mostly zero, which the patch
+ * run-length encodes. Every patch is applied back to the old image and checked before it is written.
+ */
+
+#include <crc32.h>
+#include <ota_patch.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr size_t seed_size = 8;       // Bytes that must match exactly to start a block
+constexpr size_t max_candidates = 8;  // Old image positions kept per seed
+constexpr size_t max_mismatch = 64;   // Bytes scanned past the best extension before giving up on it
+
+using Image = std::vector<uint8_t>;
+
+struct Block
+{
+    uint32_t diff_old = 0;  // Old image position the diff applies from
+    uint32_t diff_new = 0;  // New image position the diff produces
+    uint32_t diff_len = 0;
+    uint32_t extra_len = 0;
+    int32_t seek = 0;
+};
+
+bool readFile(std::string const& filename, Image& data)
+{
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+uint64_t seedAt(Image const& data, size_t pos)
+{
+    uint64_t seed;
+    memcpy(&seed, data.data() + pos, seed_size);
+    return seed;
+}
+
+class Differ
+{
+   public:
+    Differ(Image const& old_image, Image const& new_image) : old_image(old_image), new_image(new_image)
+    {
+        for (size_t i = 0; i + seed_size <= old_image.size(); ++i) {
+            auto& positions = seeds[seedAt(old_image, i)];
+            if (positions.size() < max_candidates) {
+                positions.push_back(uint32_t(i));
+            }
+        }
+    }
+
+    std::vector<Block> diff()
+    {
+        std::vector<Block> blocks;
+        Block current;
+        size_t pos = 0;
+
+        while (pos + seed_size <= new_image.size()) {
+            // Prefer carrying on from where the last block left off in the old image, as bsdiff does
+            size_t predicted = current.diff_old + (pos - current.diff_new);
+            size_t old_pos;
+            if (!findMatch(pos, predicted, old_pos)) {
+                ++pos;
+                continue;
+            }
+
+            // Bytes since the last block's diff become its extra
+            current.extra_len = uint32_t(pos - current.diff_new - current.diff_len);
+            current.seek = int32_t(int64_t(old_pos) - (current.diff_old + current.diff_len));
+            blocks.push_back(current);
+
+            current = Block();
+            current.diff_old = uint32_t(old_pos);
+            current.diff_new = uint32_t(pos);
+            current.diff_len = uint32_t(extend(old_pos, pos));
+            pos += current.diff_len;
+        }
+
+        current.extra_len = uint32_t(new_image.size() - current.diff_new - current.diff_len);
+        blocks.push_back(current);
+
+        return blocks;
+    }
+
+   private:
+    Image const& old_image;
+    Image const& new_image;
+    std::unordered_map<uint64_t, std::vector<uint32_t>> seeds;
+
+    size_t matchLength(size_t old_pos, size_t new_pos) const
+    {
+        size_t n = 0;
+        while (old_pos + n < old_image.size() && new_pos + n < new_image.size() &&
+               old_image[old_pos + n] == new_image[new_pos + n]) {
+            ++n;
+        }
+
+        return n;
+    }
+
+    /**
+     * Find the old image position with the longest exact match for the new image at `new_pos`.
+     */
+    bool findMatch(size_t new_pos, size_t predicted, size_t& old_pos) const
+    {
+        size_t best = 0;
+
+        if (predicted < old_image.size()) {
+            best = matchLength(predicted, new_pos);
+            old_pos = predicted;
+        }
+
+        auto it = seeds.find(seedAt(new_image, new_pos));
+        if (it != seeds.end()) {
+            for (auto candidate : it->second) {
+                auto n = matchLength(candidate, new_pos);
+                if (n > best) {
+                    best = n;
+                    old_pos = candidate;
+                }
+            }
+        }
+
+        return best >= seed_size;
+    }
+
+    /**
+     * Length of the diff from a seed match, extended while more bytes match than not.
+     */
+    size_t extend(size_t old_pos, size_t new_pos) const
+    {
+        int64_t score = 0;
+        int64_t best_score = 0;
+        size_t best_len = 0;
+
+        for (size_t i = 0; old_pos + i < old_image.size() && new_pos + i < new_image.size(); ++i) {
+            score += old_image[old_pos + i] == new_image[new_pos + i] ? 1 : -1;
+            if (score > best_score) {
+                best_score = score;
+                best_len = i + 1;
+            } else if (i + 1 - best_len > max_mismatch) {
+                break;
+            }
+        }
+
+        return best_len;
+    }
+};
+
+template <class T>
+void append(Image& out, T value)
+{
+    auto const* ptr = reinterpret_cast<uint8_t const*>(&value);
+    out.insert(out.end(), ptr, ptr + sizeof(T));
+}
+
+/**
+ * Run-length encode the diff bytes of a block.
+ */
+void appendDiff(Image& out, Image const& old_image, Image const& new_image, Block const& block)
+{
+    size_t i = 0;
+    while (i < block.diff_len) {
+        auto diff = [&](size_t n) { return uint8_t(new_image[block.diff_new + n] - old_image[block.diff_old + n]); };
+
+        if (diff(i) == 0) {
+            size_t run = 0;
+            while (i + run < block.diff_len && diff(i + run) == 0 && run < 0xFF - (DOSA_OTA_PATCH_ZERO_RUN - 1)) {
+                ++run;
+            }
+            out.push_back(uint8_t(run + DOSA_OTA_PATCH_ZERO_RUN - 1));
+            i += run;
+        } else {
+            // A literal run carries on through zeros too short to be worth a token of their own
+            size_t run = 0;
+            while (i + run < block.diff_len && run < DOSA_OTA_PATCH_ZERO_RUN) {
+                if (diff(i + run) == 0 && (i + run + 1 >= block.diff_len || diff(i + run + 1) == 0)) {
+                    break;
+                }
+                ++run;
+            }
+            out.push_back(uint8_t(run - 1));
+            for (size_t n = 0; n < run; ++n) {
+                out.push_back(diff(i + n));
+            }
+            i += run;
+        }
+    }
+}
+
+Image buildPatch(Image const& old_image, Image const& new_image, std::vector<Block> const& blocks)
+{
+    Image patch;
+    patch.insert(patch.end(), DOSA_OTA_PATCH_MAGIC, DOSA_OTA_PATCH_MAGIC + 4);
+    append(patch, uint32_t(old_image.size()));
+    append(patch, dosa::Crc32::of(old_image.data(), old_image.size()));
+    append(patch, uint32_t(new_image.size()));
+    append(patch, dosa::Crc32::of(new_image.data(), new_image.size()));
+
+    for (auto const& block : blocks) {
+        if (block.diff_len == 0 && block.extra_len == 0 && block.seek == 0) {
+            continue;
+        }
+
+        append(patch, block.diff_len);
+        append(patch, block.extra_len);
+        append(patch, block.seek);
+        appendDiff(patch, old_image, new_image, block);
+
+        auto extra = new_image.begin() + block.diff_new + block.diff_len;
+        patch.insert(patch.end(), extra, extra + block.extra_len);
+    }
+
+    return patch;
+}
+
+struct ImageSink
+{
+    Image data;
+
+    void write(uint8_t const* src, size_t size)
+    {
+        data.insert(data.end(), src, src + size);
+    }
+};
+
+void usage(char const* name)
+{
+    fprintf(stderr, "Usage: %s OLD.bin NEW.bin PATCH\n", name);
+    fprintf(stderr, "Writes a delta patch building NEW.bin from OLD.bin.\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc != 4) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Image old_image;
+    Image new_image;
+    if (!readFile(argv[1], old_image)) {
+        fprintf(stderr, "Unable to read '%s'\n", argv[1]);
+        return 1;
+    } else if (!readFile(argv[2], new_image)) {
+        fprintf(stderr, "Unable to read '%s'\n", argv[2]);
+        return 1;
+    }
+
+    auto blocks = Differ(old_image, new_image).diff();
+    auto patch = buildPatch(old_image, new_image, blocks);
+
+    // Apply it as a device would before publishing it
+    ImageSink sink;
+    dosa::OtaPatcher<ImageSink> patcher(old_image.data(), uint32_t(old_image.size()), sink);
+    patcher.write(patch.data(), patch.size());
+    if (!patcher.isComplete() || sink.data != new_image) {
+        fprintf(stderr, "Patch failed verification (error %d)\n", int(patcher.getError()));
+        return 2;
+    }
+
+    std::ofstream out(argv[3], std::ios::binary);
+    out.write(reinterpret_cast<char const*>(patch.data()), std::streamsize(patch.size()));
+    if (!out) {
+        fprintf(stderr, "Unable to write '%s'\n", argv[3]);
+        return 1;
+    }
+
+    printf(
+        "%zu -> %zu bytes, patch %zu bytes (%.1f%%) in %zu blocks\n",
+        old_image.size(),
+        new_image.size(),
+        patch.size(),
+        100.0 * patch.size() / (new_image.size() > 0 ? new_image.size() : 1),
+        blocks.size());
+
+    return 0;
+}
@@ -0,0 +1,465 @@
+/**
+ * DOSA LAN OTA server
+ *
+ * Serves OTA assets from a local directory, so that a site's devices update at LAN speed without a round trip to
+ * cloud storage for each device. The directory mirrors the OTA bucket:
+ *   ROOT/<app>/version                Latest DOSA version for the app
+ *   ROOT/<app>/build-N.bin            Firmware image
+ *   ROOT/<app>/build-N.crc32          CRC-32 of the image, checked by the device before applying it
+ *   ROOT/<app>/build-N-from-M.patch   Optional delta patch from build M, see host/ota_patch
+ *
+ * Point devices at it with the OTA_SERVER config item (dosa-net -c, option 11). Responses carry a strong ETag, so that
+ * If-None-Match requests are answered with 304, and single byte-range requests are honoured so that a device can
+ * resume an interrupted download. Each connection is served on its own thread, as a fleet update downloads in
+ * parallel.
+ */
+
+#include <arpa/inet.h>
+#include <crc32.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace {
+
+constexpr size_t max_request_size = 8192;
+constexpr size_t send_chunk_size = 16384;
+constexpr int socket_timeout = 10;  // seconds
+
+struct Options
+{
+    std::string root;
+    std::string prefix = "/dosa-ota/";
+    uint16_t port = 8080;
+    bool verbose = false;
+};
+
+struct Request
+{
+    std::string method;
+    std::string path;
+    std::map<std::string, std::string> headers;  // names lower-cased
+};
+
+/**
+ * A requested byte range, resolved against the file size.
+ */
+struct Range
+{
+    bool present = false;
+    bool satisfiable = true;
+    uint64_t first = 0;
+    uint64_t last = 0;
+};
+
+/**
+ * ETags are the CRC-32 and size of the file, cached against its size and modification time.
+ */
+class EtagCache
+{
+   public:
+    std::string get(std::string const& filename, struct stat const& st)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it = entries.find(filename);
+        if (it != entries.end() && it->second.size == st.st_size && it->second.mtime == st.st_mtime) {
+            return it->second.etag;
+        }
+
+        std::ifstream in(filename, std::ios::binary);
+        dosa::Crc32 crc;
+        char buffer[send_chunk_size];
+        while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0) {
+            crc.update(buffer, in.gcount());
+        }
+
+        char etag[40];
+        snprintf(etag, sizeof(etag), "\"%08x-%llx\"", crc.getValue(), (unsigned long long)st.st_size);
+        entries[filename] = {st.st_size, st.st_mtime, etag};
+
+        return etag;
+    }
+
+   private:
+    struct Entry
+    {
+        off_t size;
+        time_t mtime;
+        std::string etag;
+    };
+
+    std::mutex mutex;
+    std::map<std::string, Entry> entries;
+};
+
+EtagCache etag_cache;
+std::mutex log_mutex;
+
+void syntax()
+{
+    fprintf(stderr, "Usage: ota_server [options] ROOT\n\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --port N        Listen port (default 8080)\n");
+    fprintf(stderr, "  --prefix PATH   URL path the OTA assets are served under (default /dosa-ota/)\n");
+    fprintf(stderr, "  -v, --verbose   Log request headers\n");
+}
+
+std::string toLower(std::string s)
+{
+    for (auto& c : s) {
+        c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    }
+
+    return s;
+}
+
+std::string trim(std::string const& s)
+{
+    auto first = s.find_first_not_of(" \t\r");
+    if (first == std::string::npos) {
+        return "";
+    }
+
+    return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+}
+
+/**
+ * Read the request line and headers. The OTA client never sends a body.
+ */
+bool readRequest(int fd, Request& req)
+{
+    std::string data;
+    char buffer[1024];
+
+    while (data.find("\r\n\r\n") == std::string::npos) {
+        auto n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0 || data.size() + n > max_request_size) {
+            return false;
+        }
+        data.append(buffer, n);
+    }
+
+    std::istringstream in(data.substr(0, data.find("\r\n\r\n")));
+    std::string line;
+    std::getline(in, line);
+
+    std::istringstream request_line(line);
+    std::string version;
+    request_line >> req.method >> req.path >> version;
+    if (req.method.empty() || req.path.empty()) {
+        return false;
+    }
+
+    // Drop any query string, the device adds one to defeat caching of the version file
+    auto query = req.path.find('?');
+    if (query != std::string::npos) {
+        req.path.resize(query);
+    }
+
+    while (std::getline(in, line)) {
+        auto colon = line.find(':');
+        if (colon != std::string::npos) {
+            req.headers[toLower(trim(line.substr(0, colon)))] = trim(line.substr(colon + 1));
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Resolve a "bytes=" Range header against a file of `size` bytes. Only a single range is supported, as the OTA client
+ * never asks for more; a multi-range request is served the whole file.
+ */
+Range parseRange(std::string const& header, uint64_t size)
+{
+    Range range;
+    if (header.compare(0, 6, "bytes=") != 0 || header.find(',') != std::string::npos) {
+        return range;
+    }
+
+    auto spec = header.substr(6);
+    auto dash = spec.find('-');
+    if (dash == std::string::npos) {
+        return range;
+    }
+
+    auto first = trim(spec.substr(0, dash));
+    auto last = trim(spec.substr(dash + 1));
+    char* end = nullptr;
+    range.present = true;
+
+    if (first.empty()) {
+        // Suffix range, the final N bytes
+        uint64_t n = strtoull(last.c_str(), &end, 10);
+        if (last.empty() || *end != 0 || n == 0 || size == 0) {
+            range.satisfiable = false;
+            return range;
+        }
+        range.first = n >= size ? 0 : size - n;
+        range.last = size - 1;
+        return range;
+    }
+
+    range.first = strtoull(first.c_str(), &end, 10);
+    if (*end != 0 || range.first >= size) {
+        range.satisfiable = false;
+        return range;
+    }
+
+    range.last = size - 1;
+    if (!last.empty()) {
+        uint64_t l = strtoull(last.c_str(), &end, 10);
+        if (*end != 0 || l < range.first) {
+            range.satisfiable = false;
+            return range;
+        }
+        range.last = l < size ? l : size - 1;
+    }
+
+    return range;
+}
+
+/**
+ * Map a URL path to a file under the root, rejecting anything outside the prefix or escaping the root.
+ */
+bool resolvePath(Options const& opts, std::string const& path, std::string& filename)
+{
+    if (path.compare(0, opts.prefix.size(), opts.prefix) != 0) {
+        return false;
+    }
+
+    auto rel = path.substr(opts.prefix.size());
+    if (rel.empty() || rel.find("..") != std::string::npos || rel.find('\\') != std::string::npos) {
+        return false;
+    }
+
+    filename = opts.root + "/" + rel;
+    return true;
+}
+
+char const* getContentType(std::string const& filename)
+{
+    auto slash = filename.rfind('/');
+    auto base = filename.substr(slash == std::string::npos ? 0 : slash + 1);
+    if (base == "version" || (base.size() > 6 && base.compare(base.size() - 6, 6, ".crc32") == 0)) {
+        return "text/plain";
+    }
+
+    return "application/octet-stream";
+}
+
+bool sendAll(int fd, char const* data, size_t size)
+{
+    while (size > 0) {
+        auto n = send(fd, data, size, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+
+    return true;
+}
+
+bool sendHeaders(int fd, int status, char const* reason, std::string const& extra)
+{
+    std::string head = "HTTP/1.1 " + std::to_string(status) + " " + reason + "\r\n" +
+                       "Server: DOSA OTA\r\n"
+                       "Connection: close\r\n"
+                       "Cache-Control: no-cache\r\n" +
+                       extra + "\r\n";
+    return sendAll(fd, head.data(), head.size());
+}
+
+/**
+ * Serve a single request, returning the status and the number of body bytes sent.
+ */
+int serve(Options const& opts, int fd, Request const& req, uint64_t& sent)
+{
+    sent = 0;
+    if (req.method != "GET" && req.method != "HEAD") {
+        sendHeaders(fd, 405, "Method Not Allowed", "Allow: GET, HEAD\r\nContent-Length: 0\r\n");
+        return 405;
+    }
+
+    std::string filename;
+    struct stat st {};
+    if (!resolvePath(opts, req.path, filename) || stat(filename.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        sendHeaders(fd, 404, "Not Found", "Content-Length: 0\r\n");
+        return 404;
+    }
+
+    uint64_t size = st.st_size;
+    auto etag = etag_cache.get(filename, st);
+    std::string common = "ETag: " + etag + "\r\nAccept-Ranges: bytes\r\n";
+
+    auto inm = req.headers.find("if-none-match");
+    if (inm != req.headers.end() && (inm->second == etag || inm->second == "*")) {
+        sendHeaders(fd, 304, "Not Modified", common);
+        return 304;
+    }
+
+    Range range;
+    auto rh = req.headers.find("range");
+    auto ir = req.headers.find("if-range");
+    if (rh != req.headers.end() && (ir == req.headers.end() || ir->second == etag)) {
+        range = parseRange(rh->second, size);
+    }
+
+    if (range.present && !range.satisfiable) {
+        sendHeaders(
+            fd,
+            416,
+            "Range Not Satisfiable",
+            common + "Content-Range: bytes */" + std::to_string(size) + "\r\nContent-Length: 0\r\n");
+        return 416;
+    }
+
+    uint64_t first = range.present ? range.first : 0;
+    uint64_t length = range.present ? range.last - range.first + 1 : size;
+    int status = range.present ? 206 : 200;
+
+    std::string headers = common + "Content-Type: " + getContentType(filename) + "\r\n" +
+                          "Content-Length: " + std::to_string(length) + "\r\n";
+    if (range.present) {
+        headers += "Content-Range: bytes " + std::to_string(range.first) + "-" + std::to_string(range.last) + "/" +
+                   std::to_string(size) + "\r\n";
+    }
+
+    if (!sendHeaders(fd, status, range.present ? "Partial Content" : "OK", headers) || req.method == "HEAD") {
+        return status;
+    }
+
+    std::ifstream in(filename, std::ios::binary);
+    in.seekg(static_cast<std::streamoff>(first));
+
+    char buffer[send_chunk_size];
+    while (sent < length && in) {
+        auto want = std::min<uint64_t>(sizeof(buffer), length - sent);
+        in.read(buffer, static_cast<std::streamsize>(want));
+        if (in.gcount() <= 0 || !sendAll(fd, buffer, in.gcount())) {
+            break;
+        }
+        sent += in.gcount();
+    }
+
+    return status;
+}
+
+void handleConnection(Options const& opts, int fd, std::string const& client)
+{
+    timeval tv{socket_timeout, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    Request req;
+    if (readRequest(fd, req)) {
+        uint64_t sent = 0;
+        int status = serve(opts, fd, req, sent);
+
+        std::lock_guard<std::mutex> lock(log_mutex);
+        auto range = req.headers.find("range");
+        printf(
+            "%-16s %s %s %d %llu%s\n",
+            client.c_str(),
+            req.method.c_str(),
+            req.path.c_str(),
+            status,
+            (unsigned long long)sent,
+            range == req.headers.end() ? "" : (" [" + range->second + "]").c_str());
+        if (opts.verbose) {
+            for (auto const& h : req.headers) {
+                printf("    %s: %s\n", h.first.c_str(), h.second.c_str());
+            }
+        }
+        fflush(stdout);
+    }
+
+    close(fd);
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    Options opts;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--port" && has_value) {
+            opts.port = static_cast<uint16_t>(atoi(argv[++i]));
+        } else if (arg == "--prefix" && has_value) {
+            opts.prefix = argv[++i];
+        } else if (arg == "-v" || arg == "--verbose") {
+            opts.verbose = true;
+        } else if (arg == "-h" || arg == "--help" || arg[0] == '-') {
+            syntax();
+            return 1;
+        } else {
+            opts.root = arg;
+        }
+    }
+
+    if (opts.root.empty()) {
+        syntax();
+        return 1;
+    }
+
+    if (opts.prefix.empty() || opts.prefix.front() != '/') {
+        opts.prefix = "/" + opts.prefix;
+    }
+    if (opts.prefix.back() != '/') {
+        opts.prefix += "/";
+    }
+
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(opts.port);
+
+    if (bind(server, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(server, 32) != 0) {
+        fprintf(stderr, "Cannot listen on port %d: %s\n", opts.port, strerror(errno));
+        return 2;
+    }
+
+    printf("-- DOSA OTA Server --\n");
+    printf("Serving %s at http://0.0.0.0:%d%s\n\n", opts.root.c_str(), opts.port, opts.prefix.c_str());
+    fflush(stdout);
+
+    while (true) {
+        sockaddr_in peer{};
+        socklen_t peer_size = sizeof(peer);
+        int fd = accept(server, reinterpret_cast<sockaddr*>(&peer), &peer_size);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            fprintf(stderr, "Accept failed: %s\n", strerror(errno));
+            return 3;
+        }
+
+        char client[INET_ADDRSTRLEN] = {0};
+        inet_ntop(AF_INET, &peer.sin_addr, client, sizeof(client));
+        std::thread(handleConnection, std::cref(opts), fd, std::string(client)).detach();
+    }
+}
@@ -0,0 +1,295 @@
+/**
+ * DOSA PIR replay harness
+ *
+ * Replays recorded IR grid frame corpora through the PIR detector on a host machine, reporting detections against
+ * labelled ground truth and the cost of the detector per frame.
+ *
+ * Corpus format (CSV, one frame per line, '#' for comments):
+ *   timestamp_ms,label,p0,p1,...,p63
+ *
+ * `label` is 1 if a subject is moving in front of the sensor for that frame, else 0. A contiguous run of labelled
+ * frames is considered a single motion event.
+ */
+
+#include <defaults.h>
+#include <pir_detector.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Frame
+{
+    uint32_t timestamp;
+    bool label;
+    float pixels[PIR_FRAME_PIXELS];
+};
+
+/**
+ * Frame source that walks a loaded corpus.
+ */
+class CorpusFrameSource : public dosa::FrameSource
+{
+   public:
+    explicit CorpusFrameSource(std::vector<Frame> const& frames) : frames(frames) {}
+
+    bool readFrame(float* frame) override
+    {
+        if (pos >= frames.size()) {
+            return false;
+        }
+
+        memcpy(frame, frames[pos].pixels, sizeof(float) * PIR_FRAME_PIXELS);
+        ++pos;
+        return true;
+    }
+
+    void rewind()
+    {
+        pos = 0;
+    }
+
+   private:
+    std::vector<Frame> const& frames;
+    size_t pos = 0;
+};
+
+struct Results
+{
+    size_t frames = 0;
+    size_t events = 0;
+    size_t detections = 0;
+    size_t true_positives = 0;     // events with at least one detection
+    size_t repeat_detections = 0;  // additional detections within an already-detected event
+    size_t false_positives = 0;    // detections on unlabelled frames
+    double ns_per_frame = 0;
+};
+
+void syntax()
+{
+    fprintf(stderr, "Usage: pir_replay [options] CORPUS [CORPUS..]\n\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --min-pixels N     Min changed pixels (default %d)\n", default_pir_min_pixels);
+    fprintf(stderr, "  --pixel-delta F    Per-pixel delta (default %.2f)\n", default_pir_pixel_delta);
+    fprintf(stderr, "  --total-delta F    Aggregate delta (default %.2f)\n", default_pir_total_delta);
+    fprintf(stderr, "  --refire MS        Refire delay (default %d)\n", REFIRE_DELAY);
+    fprintf(stderr, "  --iterations N     Benchmark passes over each corpus (default 100)\n");
+    fprintf(stderr, "  -v, --verbose      Print every detection\n");
+}
+
+bool loadCorpus(std::string const& filename, std::vector<Frame>& frames)
+{
+    std::ifstream in(filename);
+    if (!in) {
+        fprintf(stderr, "Cannot open corpus: %s\n", filename.c_str());
+        return false;
+    }
+
+    std::string line;
+    size_t line_no = 0;
+    while (std::getline(in, line)) {
+        ++line_no;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::stringstream ss(line);
+        std::string cell;
+        std::vector<std::string> cells;
+        while (std::getline(ss, cell, ',')) {
+            cells.push_back(cell);
+        }
+
+        if (cells.size() != PIR_FRAME_PIXELS + 2) {
+            fprintf(
+                stderr,
+                "%s:%zu: expected %d columns, got %zu\n",
+                filename.c_str(),
+                line_no,
+                PIR_FRAME_PIXELS + 2,
+                cells.size());
+            return false;
+        }
+
+        Frame f{};
+        f.timestamp = strtoul(cells[0].c_str(), nullptr, 10);
+        f.label = strtol(cells[1].c_str(), nullptr, 10) != 0;
+        for (unsigned i = 0; i < PIR_FRAME_PIXELS; ++i) {
+            f.pixels[i] = strtof(cells[i + 2].c_str(), nullptr);
+        }
+
+        frames.push_back(f);
+    }
+
+    return true;
+}
+
+/**
+ * Single pass for accuracy, scored against the frame labels.
+ */
+void score(
+    std::vector<Frame> const& frames,
+    dosa::PirCalibration const& cal,
+    uint32_t refire,
+    bool verbose,
+    Results& r)
+{
+    CorpusFrameSource source(frames);
+    dosa::PirDetector detector(refire);
+    bool in_event = false;
+    bool event_detected = false;
+
+    for (auto const& frame : frames) {
+        if (frame.label && !in_event) {
+            ++r.events;
+            event_detected = false;
+        }
+        in_event = frame.label;
+
+        if (!detector.process(source, frame.timestamp, cal)) {
+            continue;
+        }
+
+        ++r.detections;
+        if (!frame.label) {
+            ++r.false_positives;
+        } else if (event_detected) {
+            ++r.repeat_detections;
+        } else {
+            ++r.true_positives;
+            event_detected = true;
+        }
+
+        if (verbose) {
+            printf(
+                "  %10u ms  %-5s  pixels: %2d  delta: %.1f\n",
+                frame.timestamp,
+                frame.label ? "TP" : "FP",
+                detector.getPixelsChanged(),
+                detector.getTotalDelta());
+        }
+    }
+
+    r.frames += frames.size();
+}
+
+/**
+ * Repeated passes over the corpus, timing only the detector.
+ */
+double benchmark(std::vector<Frame> const& frames, dosa::PirCalibration const& cal, uint32_t refire, int iterations)
+{
+    CorpusFrameSource source(frames);
+    dosa::PirDetector detector(refire);
+    volatile size_t detections = 0;  // consumed so the detector can't be optimised away
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        source.rewind();
+        detector.reset();
+        for (auto const& frame : frames) {
+            detections = detections + detector.process(source, frame.timestamp, cal);
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    auto total_frames = static_cast<double>(frames.size()) * iterations;
+    return total_frames > 0 ? std::chrono::duration<double, std::nano>(elapsed).count() / total_frames : 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    dosa::PirCalibration cal{default_pir_min_pixels, default_pir_pixel_delta, default_pir_total_delta};
+    uint32_t refire = REFIRE_DELAY;
+    int iterations = 100;
+    bool verbose = false;
+    std::vector<std::string> corpora;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--min-pixels" && has_value) {
+            cal.min_pixels = static_cast<uint8_t>(atoi(argv[++i]));
+        } else if (arg == "--pixel-delta" && has_value) {
+            cal.pixel_delta = strtof(argv[++i], nullptr);
+        } else if (arg == "--total-delta" && has_value) {
+            cal.total_delta = strtof(argv[++i], nullptr);
+        } else if (arg == "--refire" && has_value) {
+            refire = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--iterations" && has_value) {
+            iterations = atoi(argv[++i]);
+        } else if (arg == "-v" || arg == "--verbose") {
+            verbose = true;
+        } else if (arg == "-h" || arg == "--help" || arg[0] == '-') {
+            syntax();
+            return 1;
+        } else {
+            corpora.push_back(arg);
+        }
+    }
+
+    if (corpora.empty()) {
+        syntax();
+        return 1;
+    }
+
+    printf("-- DOSA PIR Replay --\n");
+    printf(
+        "Calibration: min pixels %d, pixel delta %.2f, total delta %.2f, refire %u ms\n\n",
+        cal.min_pixels,
+        cal.pixel_delta,
+        cal.total_delta,
+        refire);
+
+    Results total;
+    double ns_weighted = 0;
+
+    for (auto const& filename : corpora) {
+        std::vector<Frame> frames;
+        if (!loadCorpus(filename, frames)) {
+            return 2;
+        }
+
+        printf("%s (%zu frames)\n", filename.c_str(), frames.size());
+
+        Results r;
+        score(frames, cal, refire, verbose, r);
+        r.ns_per_frame = benchmark(frames, cal, refire, iterations);
+
+        printf(
+            "  events: %zu  detected: %zu  missed: %zu  false positives: %zu  repeats: %zu  ns/frame: %.1f\n\n",
+            r.events,
+            r.true_positives,
+            r.events - r.true_positives,
+            r.false_positives,
+            r.repeat_detections,
+            r.ns_per_frame);
+
+        total.frames += r.frames;
+        total.events += r.events;
+        total.detections += r.detections;
+        total.true_positives += r.true_positives;
+        total.repeat_detections += r.repeat_detections;
+        total.false_positives += r.false_positives;
+        ns_weighted += r.ns_per_frame * r.frames;
+    }
+
+    double recall = total.events ? 100.0 * total.true_positives / total.events : 0;
+    double precision = total.detections ? 100.0 * (total.detections - total.false_positives) / total.detections : 0;
+
+    printf("Total: %zu frames, %zu events\n", total.frames, total.events);
+    printf("  detected:        %zu (%.1f%% recall)\n", total.true_positives, recall);
+    printf("  missed:          %zu\n", total.events - total.true_positives);
+    printf("  false positives: %zu (%.1f%% precision)\n", total.false_positives, precision);
+    printf("  ns/frame:        %.1f\n", total.frames ? ns_weighted / total.frames : 0);
+
+    return 0;
+}
@@ -4,6 +4,10 @@
 
 #define NTP_PACKET_SIZE 76
 #define DOSA_NTP_WAIT 1500
+#define DOSA_NTP_LOCAL_PORT 2390  // Local port NTP replies are received on by beginSync()
+#define DOSA_NTP_HOST "pool.ntp.org"
+#define DOSA_NTP_PORT 123
+#define DOSA_NTP_RESYNC 21600000  // Clock is re-synced after this long (ms)
 
 namespace dosa {
 namespace comms {
@@ -31,13 +35,7 @@ class TimeManager : public Loggable
 
                 byte packet[NTP_PACKET_SIZE] = {0};
                 udp.read(packet, NTP_PACKET_SIZE);
-
-                unsigned long timestamp;
-                timestamp = (unsigned long)packet[40] << 24;
-                timestamp |= (unsigned long)packet[41] << 16;
-                timestamp |= (unsigned long)packet[42] << 8;
-                timestamp |= (unsigned long)packet[43];
-                return timestamp - 2208988800UL + timezone * 3600;
+                return parseNtpPacket(packet) + timezone * 3600;
             } else {
                 logln("NTP: received incorrect packet size (" + String(udp.available()) + ")", LogLevel::DEBUG);
                 udp.flush();
@@ -48,10 +46,141 @@ class TimeManager : public Loggable
         return 0;
     }
 
+    /**
+     * Request the time from an NTP server without waiting on the reply, call pollSync() from the main loop to set the
+     * clock once it arrives.
+     *
+     * The server's address is looked up once and kept, it is only looked up again after a request goes unanswered.
+     */
+    bool beginSync(char const* host = DOSA_NTP_HOST)
+    {
+        if (!ntp_resolved) {
+            if (WiFi.hostByName(host, ntp_ip) != 1) {
+                logln("NTP: unable to resolve " + String(host), LogLevel::ERROR);
+                return false;
+            }
+            ntp_resolved = true;
+        }
+
+        // A socket of our own, so that the reply isn't taken by the DOSA comms
+        ntp_udp.stop();
+        if (ntp_udp.begin(DOSA_NTP_LOCAL_PORT) != 1) {
+            logln("NTP: unable to open socket", LogLevel::ERROR);
+            return false;
+        }
+
+        if (!sendNtpPacket(ntp_udp, comms::Node(ntp_ip, DOSA_NTP_PORT))) {
+            ntp_udp.stop();
+            return false;
+        }
+
+        sync_pending = true;
+        sync_requested = millis();
+        return true;
+    }
+
+    /**
+     * Check for the reply to beginSync(), returns true when it has set the clock. Gives up after DOSA_NTP_WAIT.
+     */
+    bool pollSync()
+    {
+        if (!sync_pending) {
+            return false;
+        }
+
+        if (ntp_udp.parsePacket()) {
+            if (ntp_udp.available() == NTP_PACKET_SIZE) {
+                byte packet[NTP_PACKET_SIZE] = {0};
+                ntp_udp.read(packet, NTP_PACKET_SIZE);
+
+                sync_epoch = parseNtpPacket(packet);
+                sync_time = millis();
+                endSync();
+                logln("Clock set from NTP", LogLevel::DEBUG);
+                return true;
+            }
+
+            logln("NTP: received incorrect packet size (" + String(ntp_udp.available()) + ")", LogLevel::DEBUG);
+            ntp_udp.flush();
+        }
+
+        if (millis() - sync_requested > DOSA_NTP_WAIT) {
+            logln("Did not receive NTP reply", LogLevel::ERROR);
+            ntp_resolved = false;
+            endSync();
+        }
+
+        return false;
+    }
+
+    /**
+     * True while waiting on the reply to beginSync().
+     */
+    [[nodiscard]] bool isSyncing() const
+    {
+        return sync_pending;
+    }
+
+    /**
+     * True once the clock has been set by beginSync().
+     */
+    [[nodiscard]] bool isSynced() const
+    {
+        return sync_epoch != 0;
+    }
+
+    /**
+     * True if the clock has never been set, or was last set longer than DOSA_NTP_RESYNC ago.
+     */
+    [[nodiscard]] bool needsSync() const
+    {
+        return !isSynced() || millis() - sync_time > DOSA_NTP_RESYNC;
+    }
+
+    /**
+     * Seconds since the epoch (UTC) as set by beginSync(). Zero if the clock has not been set.
+     */
+    [[nodiscard]] time_t getTime() const
+    {
+        return isSynced() ? sync_epoch + time_t((millis() - sync_time) / 1000) : 0;
+    }
+
    protected:
     Wifi& wifi;
+    time_t sync_epoch = 0;   // NTP time at the last sync
+    uint32_t sync_time = 0;  // millis() at the last sync
+
+    WiFiUDP ntp_udp;
+    IPAddress ntp_ip;
+    bool ntp_resolved = false;
+    bool sync_pending = false;
+    uint32_t sync_requested = 0;
 
-    void sendNtpPacket(Node const& ntp_server)
+    void endSync()
+    {
+        sync_pending = false;
+        ntp_udp.stop();
+    }
+
+    /**
+     * Seconds since the epoch (UTC) from the transmit timestamp of an NTP reply.
+     */
+    static time_t parseNtpPacket(byte const* packet)
+    {
+        unsigned long timestamp;
+        timestamp = (unsigned long)packet[40] << 24;
+        timestamp |= (unsigned long)packet[41] << 16;
+        timestamp |= (unsigned long)packet[42] << 8;
+        timestamp |= (unsigned long)packet[43];
+        return timestamp - 2208988800UL;
+    }
+
+    bool sendNtpPacket(Node const& ntp_server)
+    {
+        return sendNtpPacket(wifi.getUdp(), ntp_server);
+    }
+
+    bool sendNtpPacket(WiFiUDP& udp, Node const& ntp_server)
     {
         byte payload[NTP_PACKET_SIZE] = {0};
 
@@ -66,13 +195,16 @@ class TimeManager : public Loggable
         payload[14] = 49;
         payload[15] = 52;
 
-        sendRawPacket(ntp_server, payload, NTP_PACKET_SIZE);
+        return sendRawPacket(udp, ntp_server.ip, ntp_server.port, payload, NTP_PACKET_SIZE);
     }
 
     bool sendRawPacket(IPAddress const& ip, uint16_t port, uint8_t const* payload, uint32_t size)
     {
-        auto& udp = wifi.getUdp();
+        return sendRawPacket(wifi.getUdp(), ip, port, payload, size);
+    }
 
+    bool sendRawPacket(WiFiUDP& udp, IPAddress const& ip, uint16_t port, uint8_t const* payload, uint32_t size)
+    {
         if (udp.beginPacket(ip, port) != 1) {
             logln("ERROR: UDP begin failed", dosa::LogLevel::ERROR);
             return false;
@@ -89,6 +221,8 @@ class TimeManager : public Loggable
             logln("ERROR: UDP end failed", dosa::LogLevel::ERROR);
             return false;
         }
+
+        return true;
     }
 
     bool sendRawPacket(comms::Node const& target, uint8_t const* payload, uint32_t size)
@@ -19,6 +19,16 @@
 
 namespace dosa {
 
+/**
+ * Progress of a connection attempt begun with Wifi::beginConnect().
+ */
+enum class WifiAttempt : uint8_t
+{
+    PENDING,
+    CONNECTED,
+    FAILED,
+};
+
 class Wifi : public Loggable
 {
    public:
@@ -37,6 +47,58 @@ class Wifi : public Loggable
         return connectSequence(ssid, password, attempts);
     }
 
+    /**
+     * Begin an attempt to connect without waiting on it, poll its progress with pollConnect().
+     *
+     * The first attempt resets the driver as connect() does, a `retry` only restarts the radio.
+     */
+    void beginConnect(String const& ssid, String const& password, bool retry = false)
+    {
+        if (retry) {
+#ifdef ARDUINO_ARCH_SAMD
+            ctrl.end();
+#else
+            ctrl.disconnect(true, true);
+#endif
+        } else {
+            if (isConnected()) {
+                logln("Wifi online, disconnecting..");
+                disconnect();
+            }
+
+            reset();
+        }
+
+#ifdef ARDUINO_ARCH_SAMD
+        // A zero timeout has begin() return as soon as the request is made to the chip
+        ctrl.setTimeout(0);
+#endif
+        wifi_online = false;
+        attempt_started = millis();
+        ctrl.begin(ssid.c_str(), password.c_str());
+    }
+
+    /**
+     * Check on an attempt begun with beginConnect(), failing it if it has not connected within
+     * DOSA_WIFI_CONNECT_TIMEOUT.
+     */
+    WifiAttempt pollConnect()
+    {
+        int status = getControllerStatus();
+        if (status == WL_CONNECTED) {
+            wifi_online = true;
+            logln("Wifi connected");
+            logLocalIp();
+            return WifiAttempt::CONNECTED;
+        } else if (millis() - attempt_started > DOSA_WIFI_CONNECT_TIMEOUT) {
+            logStatusCode(status);
+            ctrl.disconnect();
+            return WifiAttempt::FAILED;
+        }
+
+        return WifiAttempt::PENDING;
+    }
+
     void disconnect()
     {
         ctrl.disconnect();
@@ -93,6 +155,7 @@ class Wifi : public Loggable
 
    protected:
     bool wifi_online = false;
+    uint32_t attempt_started = 0;
     WiFiClass& ctrl;
     WiFiUDP udp;
     String hostname = "dosa";
@@ -0,0 +1,130 @@
+/**
+ * Motor current tracking.
+ *
+ * Smooths blocks of current readings, tracks the peak and average current of each movement, and flags a sustained
+ * over-current.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Exponential smoothing of block readings, each update moves 1/2^N of the way to the new reading.
+ */
+#define CURRENT_FILTER_SHIFT 1
+
+namespace dosa {
+
+class CurrentMonitor
+{
+   public:
+    /**
+     * `limit` is the over-current threshold in mA, which must be exceeded for `hold` ms to trip. Readings in the first
+     * `blanking` ms of a movement are ignored for over-current and peak tracking, as the motor draws a start-up surge.
+     */
+    CurrentMonitor(uint32_t limit, uint32_t blanking, uint32_t hold) : limit(limit), blanking(blanking), hold(hold) {}
+
+    /**
+     * Begin tracking a new movement at `now` (ms).
+     */
+    void start(uint32_t now)
+    {
+        phase_start = now;
+        peak = 0;
+        sum = 0;
+        count = 0;
+        over = false;
+        tripped = false;
+    }
+
+    /**
+     * Add a block of readings: the `mean` current (mA) across the block, taken at `now` (ms).
+     */
+    void update(uint32_t mean, uint32_t now)
+    {
+        if (!initialised) {
+            filtered = mean;
+            initialised = true;
+        } else {
+            filtered = uint32_t(int32_t(filtered) + ((int32_t(mean) - int32_t(filtered)) >> CURRENT_FILTER_SHIFT));
+        }
+
+        sum += mean;
+        ++count;
+
+        if (now - phase_start < blanking) {
+            return;
+        }
+
+        if (filtered > peak) {
+            peak = filtered;
+        }
+
+        if (filtered >= limit) {
+            if (!over) {
+                over = true;
+                over_start = now;
+            }
+            if (now - over_start >= hold) {
+                tripped = true;
+            }
+        } else {
+            over = false;
+        }
+    }
+
+    /**
+     * Smoothed current in mA.
+     */
+    [[nodiscard]] uint32_t getCurrent() const
+    {
+        return filtered;
+    }
+
+    /**
+     * Highest smoothed current (mA) of this movement, excluding the start-up surge.
+     */
+    [[nodiscard]] uint32_t getPeak() const
+    {
+        return peak;
+    }
+
+    /**
+     * Mean current (mA) of this movement.
+     */
+    [[nodiscard]] uint32_t getAverage() const
+    {
+        return count == 0 ? 0 : uint32_t(sum / count);
+    }
+
+    /**
+     * True once the current has exceeded the limit for the hold time. Latched until start() is called.
+     */
+    [[nodiscard]] bool isOverCurrent() const
+    {
+        return tripped;
+    }
+
+    [[nodiscard]] uint32_t getLimit() const
+    {
+        return limit;
+    }
+
+   private:
+    uint32_t limit;
+    uint32_t blanking;
+    uint32_t hold;
+
+    bool initialised = false;
+    uint32_t filtered = 0;
+    uint32_t phase_start = 0;
+    uint32_t peak = 0;
+    uint64_t sum = 0;
+    uint32_t count = 0;
+    bool over = false;  // currently above the limit
+    uint32_t over_start = 0;
+    bool tripped = false;
+};
+
+}  // namespace dosa
@@ -4,6 +4,7 @@
 #include <dosa_ota.h>
 
 #include "door_container.h"
+#include "trigger_queue.h"
 
 #define DOSA_DOOR_ERR_UNKNOWN "Door unknown error"
 #define DOSA_DOOR_ERR_OPEN "Door OPEN timeout"
@@ -25,12 +26,15 @@ class DoorApp final : public dosa::OtaApplication
     {
         OtaApplication::init();
 
+        // Takes over the ADC, must follow any analogRead() in the base init
+        container.getDoorWinch().begin();
+
         container.getDoorLights().ready();
         container.getDoorSwitch().setCallback(&doorSwitchStateChangeForwarder, this);
         container.getRecoverySwitch().setCallback(&recoverySwitchStateChangeForwarder, this);
         container.getDoorWinch().setErrorCallback(&doorWinchErrorForwarder, this);
         container.getDoorWinch().setInterruptCallback(&doorInterruptForwarder, this);
-        container.getDoorWinch().setTickCallback(&doorTickForwarder, this);
+        container.getDoorWinch().setSequenceCompleteCallback(&doorSequenceCompleteForwarder, this);
         container.getDoorWinch().setNetLogCallback(&doorLoggerForwarder, this);
 
         container.getComms().newHandler<comms::StandardHandler<messages::Trigger>>(
@@ -46,37 +50,34 @@ class DoorApp final : public dosa::OtaApplication
 
     void loop() override
     {
-        OtaApplication::loop();
-
-        // Check the hardware switches
-        container.getDoorSwitch().process();
-        container.getRecoverySwitch().process();
+        auto& winch = container.getDoorWinch();
 
-        // Check if the wifi handler has picked up a trigger request
+        if (winch.isMoving()) {
+            // Keep the loop tight while the motor is under control, only service inbound traffic
+            if (isWifiConnected()) {
+                getContainer().getComms().processInbound();
+            }
+        } else {
+            OtaApplication::loop();
+        }
 
-        if (door_fire_from_udp) {
-            // Check for primary trigger
-            if (!isErrorState()) {
-                // Don't do this in an error state
-                doorSequence();
+        winch.process();
+        processTriggers();
 
-                // Clear out any pending trigger messages
-                while (getContainer().getComms().processInbound()) {
-                }
-            }
-            door_fire_from_udp = false;
-        } else if (rewind_request > 0) {
-            // Check for rewind request (close by fractional amount + recalibrate)
-            // Rewind requests are allowed to be used to recover from an error state
-            rewindSequence();
+        if (!winch.isBusy()) {
+            // Check the hardware switches
+            container.getDoorSwitch().process();
+            container.getRecoverySwitch().process();
 
-            while (getContainer().getComms().processInbound()) {
+            if (rewind_request > 0) {
+                // Check for rewind request (close by fractional amount + recalibrate)
+                // Rewind requests are allowed to be used to recover from an error state
+                rewindSequence();
             }
-            rewind_request = 0;
         }
 
         /**
-         * Important: we need to keep reading from the serial interface so that we don't get stale data when the door
+         * Important: we need to keep draining the serial interface so that we don't get stale data when the door
          *            sequence is triggered.
          */
         container.getSonar().process();
@@ -84,8 +85,17 @@ class DoorApp final : public dosa::OtaApplication
 
    private:
     DoorContainer container;
-    bool door_fire_from_udp = false;   // Wifi request to open the door, sets a flag for the next loop
+    TriggerQueue triggers;             // Network requests to open the door, actioned by the main loop
     unsigned long rewind_request = 0;  // Alt-trigger to close door and recalibrate
+    unsigned long sequence_start = 0;  // Time the running door sequence started
+
+    /**
+     * New rigging, the learned travel no longer applies.
+     */
+    void onDoorCalibration() override
+    {
+        container.getDoorWinch().resetTravelModel();
+    }
 
     void onDebugRequest(messages::GenericMessage const& msg, comms::Node const& sender) override
     {
@@ -98,7 +108,69 @@ class DoorApp final : public dosa::OtaApplication
         netLog("Open-wait: " + String(getContainer().getSettings().getDoorOpenWait()), sender);
         netLog("Close ticks: " + String(getContainer().getSettings().getDoorCloseTicks()), sender);
         netLog("Cool-down: " + String(getContainer().getSettings().getDoorCoolDown()), sender);
-        netLog("Sonar distance: " + String(container.getSonar().getDistance()), sender);
+        netLog("Winch state: " + String(static_cast<uint8_t>(container.getDoorWinch().getState())), sender);
+        netLog(
+            "Triggers coalesced: " + String(triggers.getCoalescedCount()) +
+                "; expired: " + String(triggers.getExpiredCount()),
+            sender);
+
+        auto const& current = container.getDoorWinch().getCurrentMonitor();
+        netLog(
+            "Motor current: " + String(container.getDoorWinch().getMotorCurrent()) + " mA; last movement peak " +
+                String(current.getPeak()) + " mA, average " + String(current.getAverage()) + " mA; limit " +
+                String(current.getLimit()) + " mA",
+            sender);
+
+        auto const& settings = getContainer().getSettings();
+        if (settings.getDoorMaxSpeed() > 0) {
+            netLog(
+                "Winch profile: " + String(settings.getDoorMaxSpeed()) + " ticks/s; accel " +
+                    String(settings.getDoorAccel()) + "; shape " + String(settings.getDoorProfile()) + "; PID " +
+                    String(settings.getDoorPidKp(), 4) + " / " + String(settings.getDoorPidKi(), 4) + " / " +
+                    String(settings.getDoorPidKd(), 4),
+                sender);
+        } else {
+            netLog("Winch profile: open-loop", sender);
+        }
+
+        auto const& travel = container.getDoorWinch().getTravelModel();
+        if (travel.isReady()) {
+            netLog(
+                "Travel model: " + String(travel.getSampleCount()) + " samples; gain " + String(travel.getGain(), 4) +
+                    "; offset " + String(travel.getOffset()),
+                sender);
+        } else {
+            netLog("Travel model: learning (" + String(travel.getSampleCount()) + " samples)", sender);
+        }
+
+        auto& sonar = container.getSonar();
+        netLog(
+            "Sonar distance: " + String(sonar.getDistance()) + "; age: " + String(sonar.getReadingAge()) + " ms",
+            sender);
+        netLog(
+            "Sonar frames: " + String(sonar.getFrameCount()) + " (" + String(sonar.getFrameRate()) +
+                "/s); checksum errors: " + String(sonar.getChecksumErrors()) +
+                "; resyncs: " + String(sonar.getResyncs()),
+            sender);
+    }
+
+    /**
+     * Broadcast the recording of the last sequence, one status message per chunk.
+     */
+    void sendTelemetry()
+    {
+        auto const& telemetry = container.getDoorWinch().getTelemetry();
+        auto state = static_cast<uint8_t>(getDeviceState());
+        uint8_t chunk[WINCH_TELEMETRY_CHUNK_SIZE];
+
+        for (uint8_t i = 0; i < telemetry.getChunkCount(); ++i) {
+            auto size = telemetry.pack(i, state, chunk);
+            dispatchMessage(messages::StatusMessage(
+                static_cast<uint16_t>(messages::StatusFormat::WINCH_TELEMETRY),
+                reinterpret_cast<char const*>(chunk),
+                size,
+                getDeviceNameBytes()));
+        }
     }
 
     /**
@@ -110,10 +182,39 @@ class DoorApp final : public dosa::OtaApplication
             return;
         }
 
-        // Set a flag that informs the main loop to open the door
+        // Queue the trigger for the main loop to action
         if (canTrigger(trigger, sender)) {
             netLog("Trigger by network", NetLogLevel::INFO);
-            door_fire_from_udp = true;
+            triggers.push(millis());
+        }
+    }
+
+    /**
+     * Action any queued network trigger against the state of the winch.
+     */
+    void processTriggers()
+    {
+        auto& winch = container.getDoorWinch();
+
+        switch (triggers.next(winch.getState(), winch.isRewinding(), millis())) {
+            case TriggerAction::NONE:
+            case TriggerAction::COALESCE:
+                break;
+            case TriggerAction::START:
+                // Don't do this in an error state
+                if (!isErrorState()) {
+                    doorSequence();
+                }
+                break;
+            case TriggerAction::EXTEND:
+                winch.extend();
+                break;
+            case TriggerAction::REVERSE:
+                if (winch.reverse()) {
+                    netLog("Door close reversed by trigger", NetLogLevel::INFO);
+                    container.getDoorLights().activity();
+                }
+                break;
         }
     }
 
@@ -141,7 +242,7 @@ class DoorApp final : public dosa::OtaApplication
     }
 
     /**
-     * Open and close the door, adjust lights in turn.
+     * Start the door open and close sequence, adjust lights in turn.
      */
     void doorSequence()
     {
@@ -150,26 +251,15 @@ class DoorApp final : public dosa::OtaApplication
             return;
         }
 
-        setDeviceState(messages::DeviceState::WORKING);
-        getStats().count(stats::begin);
-        auto start = millis();
-        dispatchGenericMessage(DOSA_COMMS_MSG_BEGIN, true);
-
-        container.getDoorLights().activity();
-        container.getDoorWinch().trigger();
-
-        if (!isWarnState()) {
-            container.getDoorLights().ready();
-            setDeviceState(messages::DeviceState::OK);
+        if (!container.getDoorWinch().trigger()) {
+            return;
         }
 
-        getStats().timing(stats::sequence, millis() - start);
-        getStats().count(stats::end);
-        dispatchGenericMessage(DOSA_COMMS_MSG_END, true);
+        beginSequence();
     }
 
     /**
-     * Fractional door close and recalibrate.
+     * Start a fractional door close and recalibrate.
      *
      * `rewind_request` property must first be set. If set to zero, the normal close value will be used.
      */
@@ -179,23 +269,43 @@ class DoorApp final : public dosa::OtaApplication
             rewind_request = getSettings().getDoorCloseTicks();
         }
 
+        if (!container.getDoorWinch().rewind(rewind_request)) {
+            return;
+        }
+
+        // Triggers held through the recalibration must not open the door once it completes
+        triggers.clear();
+        rewind_request = 0;
+        beginSequence();
+    }
+
+    void beginSequence()
+    {
         setDeviceState(messages::DeviceState::WORKING);
         getStats().count(stats::begin);
-        auto start = millis();
+        sequence_start = millis();
         dispatchGenericMessage(DOSA_COMMS_MSG_BEGIN, true);
 
         container.getDoorLights().activity();
-        container.getDoorWinch().rewind(rewind_request);
-        rewind_request = 0;
+    }
 
+    /**
+     * Winch has completed a door or rewind sequence.
+     */
+    void onSequenceComplete()
+    {
         if (!isWarnState()) {
             container.getDoorLights().ready();
             setDeviceState(messages::DeviceState::OK);
         }
 
-        getStats().timing(stats::alt, millis() - start);
+        char const* metric = container.getDoorWinch().isRewinding() ? stats::alt : stats::sequence;
+        getStats().timing(metric, millis() - sequence_start);
         getStats().count(stats::end);
+        getStats().gauge(stats::winch_current_peak, container.getDoorWinch().getSequencePeakCurrent());
         dispatchGenericMessage(DOSA_COMMS_MSG_END, true);
+
+        sendTelemetry();
     }
 
     Container& getContainer() override
@@ -290,6 +400,9 @@ class DoorApp final : public dosa::OtaApplication
      */
     void setDoorErrorCondition(DoorErrorCode error)
     {
+        journal(JournalEvent::FAULT, static_cast<uint8_t>(error));
+        triggers.clear();
+
         auto& lights = container.getDoorLights();
         switch (error) {
             default:
@@ -343,18 +456,7 @@ class DoorApp final : public dosa::OtaApplication
      */
     bool doorInterruptCheck()
     {
-        // Check for UDP 'trg' packets - we'll disable the open-door-request flag and instead return an interrupt
-        // to the active winch loop.
-        if (isWifiConnected()) {
-            getContainer().getComms().processInbound();
-
-            if (door_fire_from_udp) {
-                door_fire_from_udp = false;
-                return true;
-            }
-        }
-
-        // else check the door switch
+        // Network triggers are actioned through the trigger queue, only the door switch is checked here
         return container.getDoorSwitch().getStatePassiveProcess();
     }
 
@@ -364,26 +466,11 @@ class DoorApp final : public dosa::OtaApplication
     }
 
     /**
-     * Run continuously while the door is operating. This allows us to process inbound traffic, return acks, etc.
-     */
-    void doorTick()
-    {
-        if (isWifiConnected()) {
-            getContainer().getComms().processInbound();
-
-            // Door is already active, don't attempt to start the open sequence.
-            if (door_fire_from_udp) {
-                door_fire_from_udp = false;
-            }
-        }
-    }
-
-    /**
-     * Context forwarder for winch tick callback.
+     * Context forwarder for winch sequence complete callback.
      */
-    static void doorTickForwarder(void* context)
+    static void doorSequenceCompleteForwarder(void* context)
     {
-        static_cast<DoorApp*>(context)->doorTick();
+        static_cast<DoorApp*>(context)->onSequenceComplete();
     }
 
     /**
@@ -16,7 +16,7 @@ class DoorContainer : public Container
    public:
     DoorContainer()
         : Container(),
-          door_winch(&serial, settings, sonar),
+          door_winch(&serial, settings, store, sonar),
           door_switch(PIN_SWITCH_DOOR, true),
           recovery_switch(PIN_SWITCH_ALT, true)
     {}
@@ -10,6 +10,14 @@
 
 #include <utility>
 
+#include "current_monitor.h"
+#include "motion_control.h"
+#include "motor_current.h"
+#include "pulse_ring.h"
+#include "travel_model.h"
+#include "winch_state.h"
+#include "winch_telemetry.h"
+
 #define PIN_MOTOR_A 4    // Motor output fwd
 #define PIN_MOTOR_B 5    // Motor output reverse
 #define PIN_MOTOR_PWM 6  // Motor speed
@@ -21,20 +29,38 @@
 #define MOTOR_CPR_WARMUP 100     // Grace we give the motor to report CPR pulses before declaring a stall
 #define SONAR_MAX_WAIT 100       // Max time we wait for the sonar to report before declaring an error
 
-// If defined, we allow the door to be interrupted during the close sequence
-// #define DOOR_CLOSE_ALLOW_INTERRUPT
+// When a close is reversed, the motor is stopped for this long before winding back in (ms)
+#define WINCH_REVERSE_PAUSE 150
 
 // Calibration thresholds
 #define WINCH_FALLBACK_OPEN_COEFFICIENT 0.9
 #define WINCH_FALLBACK_CLOSE_COEFFICIENT 1.1
-#define WINCH_STALL_COEFFICIENT 0.2
+#define WINCH_STALL_PERCENT 20  // Speed, as a percentage of peak, below which the motor is considered stalled
 #define WINCH_CALIBRATE_TIMEOUT 3000
-#define WINCH_CALIBRATE_TENSION_COEFFICIENT 0.75
+#define WINCH_CALIBRATE_TENSION_PERCENT 75  // Speed, as a percentage of peak, that indicates tension on the line
 #define WINCH_CALIBRATE_ROLLBACK_TICKS 800
 #define WINCH_CALIBRATE_PRE_DELAY 500
+#define WINCH_CALIBRATE_PAUSE 100
+
+// Minimum time between state machine updates
+#define WINCH_PROCESS_INTERVAL 2
+
+// Motor current limits, an obstruction shows as a current surge well before the encoder reports a stall
+#ifndef WINCH_CURRENT_LIMIT
+#define WINCH_CURRENT_LIMIT 4000  // mA
+#endif
+#define WINCH_CURRENT_BLANKING 150  // Start-up surge ignored for this long after the motor starts (ms)
+#define WINCH_CURRENT_HOLD 4        // Limit must be exceeded for this long before cutting the motor (ms)
 
 // Door power (0-255)
 #define WINCH_MAX_POWER 200
+#define WINCH_MIN_POWER 40  // Lowest power the speed loop will drive while moving
+
+// Calibrate phases run at this percentage of the cruise speed
+#define WINCH_CALIBRATE_SPEED_PERCENT 50
+
+// Store key holding the learned travel model
+#define WINCH_TRAVEL_MODEL_KEY "door.travel"
 
 // Forced fallback mode (use if sonar absent)
 #define DOOR_SONAR_FALLBACK 1
@@ -43,14 +69,14 @@ namespace dosa {
 
 namespace {
 
-volatile unsigned long int_cpr_ticks;
+PulseRing cpr_pulses;
 
 /**
  * Called by hardware interrupt when CPR pulses.
  */
 void intCprTick()
 {
-    ++int_cpr_ticks;
+    cpr_pulses.push(micros());
 }
 
 }  // end anonymous namespace
@@ -65,15 +91,28 @@ enum class DoorErrorCode : byte
     CALIBRATE_TIMEOUT = 5
 };
 
-typedef void (*tickCallback)(void*);
+typedef void (*sequenceCompleteCallback)(void*);
 typedef void (*winchErrorCallback)(DoorErrorCode, void*);
 typedef bool (*doorInterruptCallback)(void*);
 typedef void (*netLogCallback)(String const&, NetLogLevel, void*);
 
+/**
+ * Door winch, driven as a state machine.
+ *
+ * trigger() and rewind() only start a sequence, process() must be called from the main loop to advance it. The main
+ * loop should be kept light while isMoving() is true.
+ *
+ * If a cruise speed is configured, each movement follows a motion profile with the motor power set by a closed speed
+ * loop on the encoder; otherwise the motor is driven at a fixed power.
+ */
 class DoorWinch : public Loggable
 {
    public:
-    explicit DoorWinch(SerialComms* s, Settings& settings, Sonar& sonar) : Loggable(s), settings(settings), sonar(sonar)
+    explicit DoorWinch(SerialComms* s, Settings& settings, Store& store, Sonar& sonar)
+        : Loggable(s),
+          settings(settings),
+          store(store),
+          sonar(sonar)
     {
         pinMode(PIN_MOTOR_A, OUTPUT);
         pinMode(PIN_MOTOR_B, OUTPUT);
@@ -85,14 +124,26 @@ class DoorWinch : public Loggable
     }
 
     /**
-     * Called every cycle to allow the main application to do some processing.
-     *
-     * SHOULD NOT BLOCK. QUICK OPERATIONS ONLY.
+     * Start motor current sampling and restore the learned travel model. Call once the application has finished any
+     * use of analogRead(), and the store has been mounted.
+     */
+    void begin()
+    {
+        current_sensor.begin();
+
+        uint8_t model_state[TRAVEL_MODEL_STATE_SIZE];
+        if (store.get(WINCH_TRAVEL_MODEL_KEY, model_state, TRAVEL_MODEL_STATE_SIZE) == TRAVEL_MODEL_STATE_SIZE) {
+            travel_model.load(model_state);
+        }
+    }
+
+    /**
+     * Callback to be run when a trigger or rewind sequence has finished and the winch is idle again.
      */
-    void setTickCallback(tickCallback cb, void* context = nullptr)
+    void setSequenceCompleteCallback(sequenceCompleteCallback cb, void* context = nullptr)
     {
-        tick_cb = cb;
-        tick_cb_ctx = context;
+        complete_cb = cb;
+        complete_cb_ctx = context;
     }
 
     /**
@@ -105,10 +156,10 @@ class DoorWinch : public Loggable
     }
 
     /**
-     * If set, this callback will be continuously called during the open-wait and closing states of the door sequence.
+     * If set, this callback will be continuously called during the open-wait and cool-down states of the door
+     * sequence.
      *
-     * If this function returns true, the door will either reset its wait timer or halt closing and re-open, depending
-     * on the state of the door.
+     * If this function returns true, the door will reset its wait timer.
      */
     void setInterruptCallback(doorInterruptCallback cb, void* context = nullptr)
     {
@@ -133,159 +184,495 @@ class DoorWinch : public Loggable
     }
 
     /**
-     * Trigger the door open/close sequence.
+     * Start the door open/close sequence.
+     *
+     * Returns false if a sequence is already running.
      */
-    void trigger()
+    bool trigger()
     {
-        auto open_ticks = open();
-        // If the sensor believes the door is already fully open, it will return 0 ticks (and have done nothing).
-        if (open_ticks > 0) {
-            netLog("Opened in " + String(open_ticks) + " ticks", NetLogLevel::DEBUG);
+        if (isBusy()) {
+            return false;
         }
 
-        // Open-wait
-        auto openWaitTimer = millis();
-        while (millis() - openWaitTimer < settings.getDoorOpenWait()) {
-            runTickCallback();
-            if (interrupt_cb != nullptr && interrupt_cb(interrupt_cb_ctx)) {
-                // Callback has asked us to reset open-wait timer (activity near door)
-                openWaitTimer = millis();
-            }
-            delay(10);
+        rewinding = false;
+        resetSequenceCurrent();
+        telemetry.begin(millis(), 0);
+        beginOpen();
+        return true;
+    }
+
+    /**
+     * Start a manual request to close the door by a fractional amount.
+     *
+     * Returns false if a sequence is already running.
+     */
+    bool rewind(unsigned long rewind_ticks)
+    {
+        if (isBusy()) {
+            return false;
         }
 
-        // Request the door close to the same degree as it was last opened + a coefficient to ensure the pulley is slack
-        auto close_spread = static_cast<unsigned long>(
-            fallback_mode ? settings.getDoorCloseTicks() * WINCH_FALLBACK_CLOSE_COEFFICIENT
-                          : settings.getDoorCloseTicks());
+        rewinding = true;
+        learn_travel = false;
+        resetSequenceCurrent();
+        telemetry.begin(millis(), WINCH_TELEMETRY_FLAG_REWIND);
+        beginClose(rewind_ticks);
+        return true;
+    }
 
-        if (require_extended_close) {
-            // Normally because of a door jam, we need to undo the damage from opening too far
-            close_spread *= static_cast<unsigned long>(1.5);
+    /**
+     * Restart the open-wait timer, as the interrupt callback does for local sensors.
+     *
+     * Returns false if the door is not being held open.
+     */
+    bool extend()
+    {
+        if (state != WinchState::OPEN_WAIT) {
+            return false;
         }
 
-        auto close_ticks = close(close_spread);
-        netLog("Closed in " + String(close_ticks) + " ticks", NetLogLevel::DEBUG);
-
-        // Remove slack on the line, cooldown
-        delay(WINCH_CALIBRATE_PRE_DELAY);
-        calibrate();
-        cooldown();
+        state_start_time = millis();
+        return true;
     }
 
     /**
-     * Manual request to close the door by a fractional amount.
+     * Stop a running close and open the door again.
+     *
+     * The motor is stopped and given a moment to spin down before it is driven the other way. The door opens to the
+     * sonar apex, or in fallback mode winds back in what the close had released, then holds open as normal.
+     *
+     * Returns false if the door is not closing, or if the close is part of a rewind.
      */
-    void rewind(unsigned long rewind_ticks)
+    bool reverse()
     {
-        // Request the door close to specified ticks
-        auto close_ticks = close(rewind_ticks);
-        netLog("Rewound by " + String(close_ticks) + " ticks", NetLogLevel::DEBUG);
+        if (state != WinchState::CLOSING || rewinding) {
+            return false;
+        }
 
-        // Remove slack on the line, cooldown
-        delay(WINCH_CALIBRATE_PRE_DELAY);
-        calibrate();
-        cooldown();
+        stopMotor();
+        close_ticks = getCprTicks();
+        learn_travel = false;
+        netLog("Close reversed after " + String(close_ticks) + " ticks", NetLogLevel::DEBUG);
+        logCurrent("Close");
+        setState(WinchState::REVERSING);
+        return true;
     }
 
     /**
-     * Wait time after a sequence, to prevent an immediate secondary sequence while subjects clear the sensor zones.
+     * Advance the current sequence. Should be run in main loop.
      */
-    void cooldown()
+    void process()
     {
-        // Close-wait after a sequence has been executed
-        uint32_t max_delay = settings.getDoorCoolDown() * 2;
-        auto seq_complete_time = millis();
-        while (millis() - seq_complete_time < max_delay) {
-            runTickCallback();
-            if ((interrupt_cb == nullptr || !interrupt_cb(interrupt_cb_ctx)) &&
-                (millis() - seq_complete_time > settings.getDoorCoolDown())) {
-                // Sensors clear & min delay exceeded - allow exit
+        if (state == WinchState::IDLE || millis() - last_process < WINCH_PROCESS_INTERVAL) {
+            return;
+        }
+
+        last_process = millis();
+
+        if (isMoving()) {
+            current.update(current_sensor.read(), last_process);
+            recordTelemetry();
+        }
+
+        switch (state) {
+            case WinchState::IDLE:
+                break;
+            case WinchState::SONAR_WAIT:
+                processSonarWait();
+                break;
+            case WinchState::OPENING:
+                processOpen();
+                break;
+            case WinchState::OPEN_WAIT:
+                processOpenWait();
+                break;
+            case WinchState::CLOSING:
+                processClose();
+                break;
+            case WinchState::SETTLE:
+                if (getStateTime() >= WINCH_CALIBRATE_PRE_DELAY) {
+                    beginCalibrate();
+                }
+                break;
+            case WinchState::CALIBRATE_TENSION:
+                processCalibrateTension();
+                break;
+            case WinchState::CALIBRATE_PAUSE:
+                processCalibratePause();
+                break;
+            case WinchState::CALIBRATE_ROLLBACK:
+                processCalibrateRollback();
+                break;
+            case WinchState::COOLDOWN:
+                processCooldown();
+                break;
+            case WinchState::REVERSING:
+                processReverse();
                 break;
-            }
-            delay(10);
         }
     }
 
+    [[nodiscard]] WinchState getState() const
+    {
+        return state;
+    }
+
     /**
-     * Start door open sequence.
-     *
-     * Returns the number of CPR pulses throughout the sequence.
+     * True while a sequence is running.
+     */
+    [[nodiscard]] bool isBusy() const
+    {
+        return state != WinchState::IDLE;
+    }
+
+    /**
+     * True while the sequence is in a motor-controlled phase, where process() must be called as often as possible.
+     */
+    [[nodiscard]] bool isMoving() const
+    {
+        return isBusy() && state != WinchState::OPEN_WAIT && state != WinchState::COOLDOWN;
+    }
+
+    /**
+     * True if the current sequence is a rewind rather than a full trigger sequence.
+     */
+    [[nodiscard]] bool isRewinding() const
+    {
+        return rewinding;
+    }
+
+    /**
+     * Halt the motor and abandon any running sequence. The sequence complete callback is not called.
+     */
+    void abort()
+    {
+        stopMotor();
+        setState(WinchState::IDLE);
+    }
+
+    void stopMotor()
+    {
+        digitalWrite(PIN_MOTOR_A, LOW);
+        digitalWrite(PIN_MOTOR_B, LOW);
+        digitalWrite(PIN_MOTOR_PWM, 0);
+    }
+
+    void setMotor(bool forward, int power)
+    {
+        if (forward) {
+            digitalWrite(PIN_MOTOR_A, HIGH);
+            digitalWrite(PIN_MOTOR_B, LOW);
+        } else {
+            digitalWrite(PIN_MOTOR_A, LOW);
+            digitalWrite(PIN_MOTOR_B, HIGH);
+        }
+
+        analogWrite(PIN_MOTOR_PWM, power);
+    }
+
+    /**
+     * Motor current in mA, read directly from the sensor.
+     */
+    [[nodiscard]] uint32_t getMotorCurrent() const
+    {
+        return current_sensor.read();
+    }
+
+    /**
+     * Current tracking for the last movement.
+     */
+    [[nodiscard]] CurrentMonitor const& getCurrentMonitor() const
+    {
+        return current;
+    }
+
+    /**
+     * Recording of the current or last sequence.
+     */
+    [[nodiscard]] WinchTelemetry const& getTelemetry() const
+    {
+        return telemetry;
+    }
+
+    /**
+     * Travel learned from previous sequences.
+     */
+    [[nodiscard]] TravelModel const& getTravelModel() const
+    {
+        return travel_model;
+    }
+
+    /**
+     * Forget the learned travel, the door has been re-rigged.
+     */
+    void resetTravelModel()
+    {
+        travel_model.reset();
+        settings.reInitRam();
+        store.remove(WINCH_TRAVEL_MODEL_KEY);
+    }
+
+    /**
+     * Highest motor current (mA) of the current or last sequence, excluding start-up surges.
+     */
+    [[nodiscard]] uint32_t getSequencePeakCurrent() const
+    {
+        return sequence_peak_current > current.getPeak() ? sequence_peak_current : current.getPeak();
+    }
+
+   protected:
+    Settings& settings;
+    Store& store;
+    Sonar& sonar;
+
+    WinchState state = WinchState::IDLE;
+    unsigned long state_start_time = 0;  // Time that the current state was entered
+    unsigned long last_process = 0;      // Time process() last advanced the state machine
+    unsigned long seq_start_time = 0;    // Time that an open/close sequence started
+    uint32_t tps_peak = 0;
+
+    MotionProfile profile;
+    SpeedPid speed_pid{WINCH_MIN_POWER, WINCH_MAX_POWER};
+    bool closed_loop = false;
+    unsigned long motion_start_time = 0;  // Time the current movement started
+    unsigned long last_control_time = 0;  // Time the speed loop was last updated
+    uint32_t speed_setpoint = 0;
+
+    MotorCurrentSensor current_sensor{PIN_MOTOR_CS};
+    CurrentMonitor current{WINCH_CURRENT_LIMIT, WINCH_CURRENT_BLANKING, WINCH_CURRENT_HOLD};
+    uint32_t sequence_peak_current = 0;
+
+    WinchTelemetry telemetry;
+
+    winchErrorCallback error_cb = nullptr;
+    void* error_cb_ctx = nullptr;
+
+    doorInterruptCallback interrupt_cb = nullptr;
+    void* interrupt_cb_ctx = nullptr;
+
+    sequenceCompleteCallback complete_cb = nullptr;
+    void* complete_cb_ctx = nullptr;
+
+    netLogCallback net_log_cb = nullptr;
+    void* net_log_cb_ctx = nullptr;
+
+    bool fallback_mode = false;
+    bool require_extended_close = false;
+    bool rewinding = false;
+
+    unsigned long open_ticks_target = 0;   // Fallback mode tick count to halt the open phase
+    unsigned long close_ticks_target = 0;  // Tick count to halt the close phase
+    unsigned long calibrate_ticks = 0;     // Ticks wound in during the calibrate tension phase
+    bool calibrate_no_tension = false;     // Calibrate tension phase timed out
+
+    TravelModel travel_model;
+    unsigned long open_ticks = 0;   // Ticks wound in by the last open phase
+    unsigned long close_ticks = 0;  // Ticks released by the last close phase
+    bool learn_travel = false;      // Sequence so far is clean enough to learn travel from
+    bool reopening = false;         // Open phase follows a reversed close
+
+    void setState(WinchState s)
+    {
+        state = s;
+        state_start_time = millis();
+    }
+
+    /**
+     * Time in ms since the current state was entered.
+     */
+    [[nodiscard]] unsigned long getStateTime() const
+    {
+        return millis() - state_start_time;
+    }
+
+    /**
+     * Begin the open phase of a trigger sequence, waiting for the sonar first if required.
      */
-    uint32_t open()
+    void beginOpen()
     {
         netLog("Door: OPEN", NetLogLevel::DEBUG);
-        seq_start_time = millis();
-        resetCprTimer();
-        resetMaxTps();
-        uint32_t open_distance = settings.getDoorOpenDistance();
         require_extended_close = false;  // used if there is jam during open (probably caused by bad calibration)
 
 #ifndef DOOR_SONAR_FALLBACK
-        // if the sonar fails, we'll use the door close ticks as a time-based open sequence
-        fallback_mode = !waitForSonarReady();
+        // Use the last reading if the main loop has kept the sonar fresh, otherwise wait for one
+        sonar.process();
+        if (sonar.getLastReadingTime() == 0 || sonar.getReadingAge() >= SONAR_MAX_WAIT) {
+            setState(WinchState::SONAR_WAIT);
+            return;
+        }
+        fallback_mode = false;
 #else
         // sonar disabled, use fallback mode
         fallback_mode = true;
 #endif
-        auto open_ticks = settings.getDoorCloseTicks() * WINCH_FALLBACK_OPEN_COEFFICIENT;
 
-        if (!fallback_mode && (sonar.getDistance() > 0 && sonar.getDistance() < open_distance)) {
+        startOpen();
+    }
+
+    void processSonarWait()
+    {
+        // The main loop also drains the sonar, so look for any reading since we started waiting
+        sonar.process();
+        if (sonar.getLastReadingTime() > 0 && sonar.getReadingAge() <= getStateTime()) {
+            fallback_mode = false;
+            startOpen();
+        } else if (getStateTime() >= SONAR_MAX_WAIT) {
+            // if the sonar fails, we'll use the door close ticks as a time-based open sequence
+            netLog("Sonar not reporting data!", NetLogLevel ::ERROR);
+
+            if (error_cb != nullptr) {
+                error_cb(DoorErrorCode::SONAR_ERROR, error_cb_ctx);
+            }
+
+            fallback_mode = true;
+            startOpen();
+        }
+    }
+
+    void startOpen()
+    {
+        open_ticks = 0;
+        learn_travel = false;
+        reopening = false;
+        seq_start_time = millis();
+        resetCprTimer();
+        resetMaxTps();
+        open_ticks_target = settings.getDoorCloseTicks() * WINCH_FALLBACK_OPEN_COEFFICIENT;
+
+        if (!fallback_mode && (sonar.getDistance() > 0 && sonar.getDistance() < settings.getDoorOpenDistance())) {
+            // If the sensor believes the door is already fully open, skip straight to open-wait
             netLog("Door open-jam detected, skipping open sequence", NetLogLevel ::WARNING);
-            return 0;
+            setState(WinchState::OPEN_WAIT);
+            return;
         }
 
-        setMotor(true, WINCH_MAX_POWER);
-        delay(10);
+        startMotion(true, 100, open_ticks_target);
+        setState(WinchState::OPENING);
+    }
 
-        while (true) {
-            runTickCallback();
-            calcMaxTps();
-            if (fallback_mode) {
-                // Legacy/fallback mode
-                if (checkForOpenKill() || (int_cpr_ticks > open_ticks)) {
-                    netLog("Open halted at " + String(int_cpr_ticks) + " ticks", NetLogLevel::DEBUG);
-                    break;
-                }
-            } else {
-                // Sonar apex detection
-                sonar.process();
-                if (checkForOpenKill() || (sonar.getDistance() > 0 && sonar.getDistance() < open_distance)) {
-                    netLog("Open halted at " + String(sonar.getDistance()) + "mm", NetLogLevel::DEBUG);
-                    break;
-                }
+    void processOpen()
+    {
+        calcMaxTps();
+        driveMotion();
+
+        if (fallback_mode) {
+            // Legacy/fallback mode
+            bool killed = checkForOpenKill();
+            if (!killed && (getCprTicks() <= open_ticks_target)) {
+                return;
+            }
+            // The open length was set by the target rather than measured, so the travel model has nothing to learn
+            netLog("Open halted at " + String(getCprTicks()) + " ticks", NetLogLevel::DEBUG);
+        } else {
+            // Sonar apex detection
+            sonar.process();
+            bool killed = checkForOpenKill();
+            if (!killed && !(sonar.getDistance() > 0 && sonar.getDistance() < settings.getDoorOpenDistance())) {
+                return;
             }
+            learn_travel = !killed && !reopening;
+            netLog("Open halted at " + String(sonar.getDistance()) + "mm", NetLogLevel::DEBUG);
         }
 
         netLog("Open max TPS: " + String(getMaxTps()), NetLogLevel::INFO);
+        logCurrent("Open");
         stopMotor();
-        return int_cpr_ticks;
+        if (reopening) {
+            // The door is back where the first open left it, keep that open for the close prediction
+            netLog("Reopened in " + String(getCprTicks()) + " ticks", NetLogLevel::DEBUG);
+            reopening = false;
+        } else {
+            open_ticks = getCprTicks();
+            netLog("Opened in " + String(open_ticks) + " ticks", NetLogLevel::DEBUG);
+        }
+        setState(WinchState::OPEN_WAIT);
+    }
+
+    /**
+     * Pause after a reversed close, then open the door again.
+     */
+    void processReverse()
+    {
+        if (getStateTime() < WINCH_REVERSE_PAUSE) {
+            return;
+        }
+
+        netLog("Door: REOPEN", NetLogLevel::DEBUG);
+        reopening = true;
+        seq_start_time = millis();
+        resetCprTimer();
+        resetMaxTps();
+        open_ticks_target = close_ticks;
+
+        startMotion(true, 100, open_ticks_target);
+        setState(WinchState::OPENING);
+    }
+
+    void processOpenWait()
+    {
+        if (interrupt_cb != nullptr && interrupt_cb(interrupt_cb_ctx)) {
+            // Callback has asked us to reset open-wait timer (activity near door)
+            state_start_time = millis();
+        }
+
+        if (getStateTime() < settings.getDoorOpenWait()) {
+            return;
+        }
+
+        // Request the door close to the same degree as it was last opened + a coefficient to ensure the pulley is slack
+        auto close_spread = static_cast<unsigned long>(
+            fallback_mode ? settings.getDoorCloseTicks() * WINCH_FALLBACK_CLOSE_COEFFICIENT
+                          : settings.getDoorCloseTicks());
+
+        if (require_extended_close) {
+            // Normally because of a door jam, we need to undo the damage from opening too far
+            close_spread = close_spread * 3 / 2;
+        } else if (open_ticks > 0 && travel_model.isReady()) {
+            // Release only as far as previous sequences show this open needs
+            close_spread = travel_model.predict(open_ticks, settings.getDoorCloseTicks());
+            netLog(
+                "Close ticks predicted: " + String(close_spread) + " for " + String(open_ticks) + " open ticks",
+                NetLogLevel::DEBUG);
+        }
+
+        beginClose(close_spread);
     }
 
     /**
      * Release the door for `ticks` number of CPR pulses. Should be a little above what is required to fully close
      * the door from it's maximum draw angle.
-     *
-     * Returns number of CPR pulses during the process.
      */
-    unsigned long close(unsigned long ticks)
+    void beginClose(unsigned long ticks)
     {
         logln("Door: CLOSE");
         seq_start_time = millis();
         resetCprTimer();
         resetMaxTps();
+        close_ticks_target = ticks;
 
-        setMotor(false, WINCH_MAX_POWER);
-        delay(10);
+        startMotion(false, 100, close_ticks_target);
+        setState(WinchState::CLOSING);
+    }
 
-        while (!checkForCloseKill(ticks)) {
-            delay(10);
-            runTickCallback();
+    void processClose()
+    {
+        if (!checkForCloseKill(close_ticks_target)) {
             calcMaxTps();
+            driveMotion();
+            return;
         }
 
         stopMotor();
-        return int_cpr_ticks;
+        close_ticks = getCprTicks();
+        if (close_ticks <= close_ticks_target) {
+            // Jammed or timed out, we don't know how far the door really closed
+            learn_travel = false;
+        }
+        netLog((rewinding ? "Rewound by " : "Closed in ") + String(close_ticks) + " ticks", NetLogLevel::DEBUG);
+        logCurrent(rewinding ? "Rewind" : "Close");
+
+        // Remove slack on the line
+        setState(WinchState::SETTLE);
     }
 
     /**
@@ -293,143 +680,279 @@ class DoorWinch : public Loggable
      *
      * The purpose of this is to remove slack on the line, which allows the next open sequence to be consistent.
      */
-    void calibrate()
+    void beginCalibrate()
     {
         netLog("Door: CALIBRATE", NetLogLevel::DEBUG);
-        auto start_time = millis();
         resetCprTimer();
         resetMaxTps();
+        calibrate_no_tension = false;
 
-        setMotor(true, WINCH_MAX_POWER);
-        bool noTension = false;
-
-        /**
-         * Primary phase.
-         *
-         * Wind the winch in, note the max speed and when the speed drops, assume that speed drop is caused by tension
-         * on the line. Halt primary phase when either tension is detected, or we time out.
-         */
-        while (true) {
-            delay(10);
-            auto max_tps = calcMaxTps();
-            if (max_tps > 0 && (getTicksPerSecond() < (max_tps * WINCH_CALIBRATE_TENSION_COEFFICIENT))) {
-                // Tension detected, drop out
-                break;
-            } else if (millis() - start_time > WINCH_CALIBRATE_TIMEOUT) {
-                // Tension never detected, alert and drop out
-                netLog("Calibrate timeout detected, aborting calibration", NetLogLevel::WARNING);
-                noTension = true;
-                stopMotor();
-
-                if (error_cb != nullptr) {
-                    error_cb(DoorErrorCode::CALIBRATE_TIMEOUT, error_cb_ctx);
-                }
+        startMotion(true, WINCH_CALIBRATE_SPEED_PERCENT);
+        setState(WinchState::CALIBRATE_TENSION);
+    }
 
-                break;
+    /**
+     * Primary phase.
+     *
+     * Wind the winch in, note the max speed and when the speed drops, assume that speed drop is caused by tension
+     * on the line. Halt primary phase when either tension is detected, or we time out.
+     */
+    void processCalibrateTension()
+    {
+        calcMaxTps();
+        driveMotion();
+
+        auto reference_tps = getReferenceTps();
+        if (current.isOverCurrent() ||
+            (reference_tps > 0 && (getTicksPerSecond() < reference_tps * WINCH_CALIBRATE_TENSION_PERCENT / 100))) {
+            // Tension detected, drop out
+        } else if (getStateTime() > WINCH_CALIBRATE_TIMEOUT) {
+            // Tension never detected, alert and drop out
+            netLog("Calibrate timeout detected, aborting calibration", NetLogLevel::WARNING);
+            calibrate_no_tension = true;
+            stopMotor();
+
+            if (error_cb != nullptr) {
+                error_cb(DoorErrorCode::CALIBRATE_TIMEOUT, error_cb_ctx);
             }
+        } else {
+            return;
         }
 
         // Prep for secondary phase
-        auto calibrateTicks = int_cpr_ticks;
+        calibrate_ticks = getCprTicks();
         stopMotor();
-        delay(100);
-        resetCprTimer();
-        setMotor(false, WINCH_MAX_POWER);
-        start_time = millis();
-
-        /**
-         * Secondary phase.
-         *
-         * In this phase we will roll-back just a tad, as detecting the tension will likely pull the door open a little
-         * bit.
-         *
-         * If a timeout occurred, it was probably because the door was already under tension and this calibration
-         * attempt has just made it worse. So if this has happened, we'll roll-back 150% to undo damage instead of
-         * making it worse.
-         */
-        unsigned long thresholdTicks = noTension ? calibrateTicks * 1.5 : WINCH_CALIBRATE_ROLLBACK_TICKS;
-        while (int_cpr_ticks < thresholdTicks) {
-            delay(10);
 
-            // This is unlikely, but always have a timeout just in case
-            if (millis() - start_time > WINCH_CALIBRATE_TIMEOUT) {
-                netLog("Calibrate rollback timeout detected", NetLogLevel::ERROR);
-                stopMotor();
+        if (!calibrate_no_tension) {
+            learnTravel();
+        }
 
-                if (error_cb != nullptr) {
-                    error_cb(DoorErrorCode::CALIBRATE_TIMEOUT, error_cb_ctx);
-                }
+        setState(WinchState::CALIBRATE_PAUSE);
+    }
+
+    void processCalibratePause()
+    {
+        if (getStateTime() < WINCH_CALIBRATE_PAUSE) {
+            return;
+        }
+
+        resetCprTimer();
+        resetMaxTps();
+        startMotion(false, WINCH_CALIBRATE_SPEED_PERCENT, getRollbackTicks());
+        setState(WinchState::CALIBRATE_ROLLBACK);
+    }
+
+    /**
+     * Secondary phase.
+     *
+     * In this phase we will roll-back just a tad, as detecting the tension will likely pull the door open a little
+     * bit.
+     *
+     * If a timeout occurred, it was probably because the door was already under tension and this calibration
+     * attempt has just made it worse. So if this has happened, we'll roll-back 150% to undo damage instead of
+     * making it worse.
+     */
+    void processCalibrateRollback()
+    {
+        if (getCprTicks() < getRollbackTicks()) {
+            driveMotion();
 
+            // This is unlikely, but always have a timeout just in case
+            if (getStateTime() <= WINCH_CALIBRATE_TIMEOUT) {
                 return;
             }
+
+            netLog("Calibrate rollback timeout detected", NetLogLevel::ERROR);
+            if (error_cb != nullptr) {
+                error_cb(DoorErrorCode::CALIBRATE_TIMEOUT, error_cb_ctx);
+            }
         }
 
         stopMotor();
+        setState(WinchState::COOLDOWN);
     }
 
-    void stopMotor()
+    /**
+     * Teach the travel model from a clean sequence: the calibrate phase wound in the slack that the close
+     * over-released, so the close actually required the close ticks less the calibrate ticks. Only sequences that
+     * opened to the sonar apex are learned from, a fallback open always runs to the same target.
+     *
+     * The model alone is written to the store, the motor is stopped so the FRAM write won't hold up motor control.
+     */
+    void learnTravel()
     {
-        digitalWrite(PIN_MOTOR_A, LOW);
-        digitalWrite(PIN_MOTOR_B, LOW);
-        digitalWrite(PIN_MOTOR_PWM, 0);
+        if (!learn_travel || open_ticks == 0 || calibrate_ticks >= close_ticks) {
+            return;
+        }
+
+        travel_model.learn(open_ticks, close_ticks - calibrate_ticks);
+
+        uint8_t model_state[TRAVEL_MODEL_STATE_SIZE];
+        travel_model.save(model_state);
+        settings.reInitRam();
+        store.set(WINCH_TRAVEL_MODEL_KEY, model_state, TRAVEL_MODEL_STATE_SIZE);
+
+        netLog(
+            "Travel learned: " + String(open_ticks) + " open, " + String(close_ticks - calibrate_ticks) +
+                " close; gain " + String(travel_model.getGain(), 4) + ", offset " + String(travel_model.getOffset()),
+            NetLogLevel::DEBUG);
     }
 
-    void setMotor(bool forward, int power)
+    [[nodiscard]] unsigned long getRollbackTicks() const
     {
-        if (forward) {
-            digitalWrite(PIN_MOTOR_A, HIGH);
-            digitalWrite(PIN_MOTOR_B, LOW);
-        } else {
-            digitalWrite(PIN_MOTOR_A, LOW);
-            digitalWrite(PIN_MOTOR_B, HIGH);
+        return calibrate_no_tension ? calibrate_ticks * 1.5 : WINCH_CALIBRATE_ROLLBACK_TICKS;
+    }
+
+    /**
+     * Start the motor on a movement of `distance` ticks (zero if not known) at `speed_percent` of the cruise speed.
+     *
+     * Under closed-loop control the speed is then set by driveMotion(), otherwise the motor runs at fixed power.
+     */
+    void startMotion(bool forward, uint8_t speed_percent, uint32_t distance = 0)
+    {
+        motion_start_time = last_control_time = millis();
+        trackPeakCurrent();
+        current.start(motion_start_time);
+        closed_loop = settings.getDoorMaxSpeed() > 0;
+        speed_setpoint = 0;
+
+        if (!closed_loop) {
+            setMotor(forward, WINCH_MAX_POWER);
+            return;
         }
 
-        analogWrite(PIN_MOTOR_PWM, power);
+        telemetry.setFlag(WINCH_TELEMETRY_FLAG_CLOSED_LOOP);
+
+        auto shape = settings.getDoorProfile() == uint8_t(MotionProfileShape::S_CURVE)
+                         ? MotionProfileShape::S_CURVE
+                         : MotionProfileShape::TRAPEZOIDAL;
+
+        auto cruise = uint32_t(settings.getDoorMaxSpeed()) * speed_percent / 100;
+        profile.start(cruise, settings.getDoorAccel(), shape, distance);
+        speed_pid.reset();
+        setMotor(forward, WINCH_MIN_POWER);
     }
 
     /**
-     * Check the motor current from analogue pin.
+     * Update the motor power to follow the motion profile. Call on every state machine update while moving.
      */
-    [[maybe_unused]] int getMotorCurrent()
+    void driveMotion()
     {
-        return analogRead(PIN_MOTOR_CS);
+        if (!closed_loop) {
+            return;
+        }
+
+        auto now = millis();
+        float dt = float(now - last_control_time) / 1000.0f;
+        last_control_time = now;
+
+        speed_setpoint = profile.getSetpoint(now - motion_start_time, getCprTicks());
+        auto power = speed_pid.update(
+            float(speed_setpoint),
+            float(getTicksPerSecond()),
+            dt,
+            settings.getDoorPidKp(),
+            settings.getDoorPidKi(),
+            settings.getDoorPidKd());
+
+        analogWrite(PIN_MOTOR_PWM, int(power + 0.5f));
     }
 
-   protected:
-    Settings& settings;
-    Sonar& sonar;
+    /**
+     * The speed the winch is expected to hold, stalls and line tension are measured against this.
+     *
+     * Under closed-loop control this is the profile setpoint, so that a planned slow-down isn't mistaken for a stall,
+     * but never more than the peak speed seen as the motor may lag the profile while accelerating.
+     */
+    [[nodiscard]] uint32_t getReferenceTps() const
+    {
+        if (closed_loop && speed_setpoint < getMaxTps()) {
+            return speed_setpoint;
+        }
 
-    unsigned long seq_start_time = 0;  // Time that an open/close sequence started
-    unsigned long cpr_last_time = 0;   // For calculating motor speed
-    unsigned long cpr_last_ticks = 0;
-    double tps_peak = 0;
+        return getMaxTps();
+    }
 
-    winchErrorCallback error_cb = nullptr;
-    void* error_cb_ctx = nullptr;
+    /**
+     * Sample the winch into the telemetry recording, if due. Only the motor phases are recorded.
+     */
+    void recordTelemetry()
+    {
+        if (state != WinchState::OPENING && state != WinchState::CLOSING && state != WinchState::CALIBRATE_TENSION &&
+            state != WinchState::CALIBRATE_ROLLBACK) {
+            return;
+        }
 
-    doorInterruptCallback interrupt_cb = nullptr;
-    void* interrupt_cb_ctx = nullptr;
+        if (telemetry.isDue(last_process)) {
+            telemetry.record(
+                last_process,
+                static_cast<uint8_t>(state),
+                getCprTicks(),
+                getTicksPerSecond(),
+                sonar.getDistance(),
+                current.getCurrent());
+        }
+    }
 
-    tickCallback tick_cb = nullptr;
-    void* tick_cb_ctx = nullptr;
+    void resetSequenceCurrent()
+    {
+        sequence_peak_current = 0;
+        current.start(millis());
+    }
 
-    netLogCallback net_log_cb = nullptr;
-    void* net_log_cb_ctx = nullptr;
+    /**
+     * Fold the last movement's peak current into the sequence peak.
+     */
+    void trackPeakCurrent()
+    {
+        if (current.getPeak() > sequence_peak_current) {
+            sequence_peak_current = current.getPeak();
+        }
+    }
 
-    bool fallback_mode = false;
-    bool require_extended_close = false;
+    void logCurrent(String const& phase)
+    {
+        netLog(
+            phase + " current: peak " + String(current.getPeak()) + " mA; average " + String(current.getAverage()) +
+                " mA",
+            NetLogLevel::INFO);
+    }
 
     /**
-     * Resets and initialises tick-data so that ticksPerSecond may be accurately called.
+     * Wait time after a sequence, to prevent an immediate secondary sequence while subjects clear the sensor zones.
+     */
+    void processCooldown()
+    {
+        auto elapsed = getStateTime();
+        bool clear = interrupt_cb == nullptr || !interrupt_cb(interrupt_cb_ctx);
+
+        // Sensors clear & min delay exceeded, or max delay exceeded - allow exit
+        if ((clear && elapsed > settings.getDoorCoolDown()) || elapsed >= settings.getDoorCoolDown() * 2) {
+            setState(WinchState::IDLE);
+
+            if (complete_cb != nullptr) {
+                complete_cb(complete_cb_ctx);
+            }
+        }
+    }
+
+    /**
+     * Restarts the tick count, and discards pulses from before now when calculating speed.
      */
     void resetCprTimer()
     {
-        int_cpr_ticks = 0;
-        cpr_last_ticks = 0;
-        cpr_last_time = millis();
+        cpr_pulses.reset();
     }
 
-    double calcMaxTps()
+    /**
+     * CPR pulses since resetCprTimer().
+     */
+    [[nodiscard]] static unsigned long getCprTicks()
+    {
+        return cpr_pulses.getTicks();
+    }
+
+    uint32_t calcMaxTps()
     {
         auto tps = getTicksPerSecond();
         if (tps > tps_peak) {
@@ -439,7 +962,7 @@ class DoorWinch : public Loggable
         return tps_peak;
     }
 
-    [[nodiscard]] double getMaxTps() const
+    [[nodiscard]] uint32_t getMaxTps() const
     {
         return tps_peak;
     }
@@ -452,26 +975,13 @@ class DoorWinch : public Loggable
     /**
      * Returns the number of CPR ticks per second.
      *
-     * Calculated by determining the number of ticks since this function was last called. Call resetCprTimer() before
-     * recording tick-rate.
+     * Calculated from the periods between the most recent pulses recorded by the ISR, so it may be called as often
+     * as required. If the motor stalls, the speed falls as soon as the time since the last pulse exceeds the recent
+     * period. Call resetCprTimer() before recording tick-rate.
      */
-    double getTicksPerSecond()
+    [[nodiscard]] static uint32_t getTicksPerSecond()
     {
-        static double last_tps = 0;
-
-        auto now = millis();
-        if (now - cpr_last_time < 5) {
-            // div by zero & micro-timing safe guard
-            return last_tps;
-        }
-
-        double coefficient = (double)1000 / (double)(now - cpr_last_time);
-        last_tps = (double)(int_cpr_ticks - cpr_last_ticks) * coefficient;
-
-        cpr_last_time = now;
-        cpr_last_ticks = int_cpr_ticks;
-
-        return last_tps;
+        return cpr_pulses.getPulsesPerSecond(micros());
     }
 
     /**
@@ -496,9 +1006,17 @@ class DoorWinch : public Loggable
             return true;
         }
 
+        // Obstruction, caught by the current surge before the motor slows
+        if (current.isOverCurrent()) {
+            netLog("Door over-current while opening: " + String(current.getCurrent()) + " mA", NetLogLevel::WARNING);
+            stopMotor();
+            require_extended_close = true;
+            return true;
+        }
+
         // Check for motor stall
-        if (run_time > MOTOR_CPR_WARMUP && (getMaxTps() > 0) &&
-            (getTicksPerSecond() < (getMaxTps() * WINCH_STALL_COEFFICIENT))) {
+        if (run_time > MOTOR_CPR_WARMUP && (getReferenceTps() > 0) &&
+            (getTicksPerSecond() < getReferenceTps() * WINCH_STALL_PERCENT / 100)) {
             netLog("Door blocked while opening", NetLogLevel::WARNING);
             stopMotor();
             require_extended_close = true;
@@ -513,13 +1031,24 @@ class DoorWinch : public Loggable
         auto run_time = millis() - seq_start_time;
 
         // Correct way for close sequence to end: matched the same CPR pulses as open sequence
-        if (int_cpr_ticks > ticks) {
+        if (getCprTicks() > ticks) {
+            return true;
+        }
+
+        // Obstruction, or motor stall
+        if (current.isOverCurrent()) {
+            netLog(
+                "Winch over-current (close sequence!): " + String(current.getCurrent()) + " mA",
+                NetLogLevel::WARNING);
+            stopMotor();
+            if (error_cb != nullptr) {
+                error_cb(DoorErrorCode::JAMMED, error_cb_ctx);
+            }
             return true;
         }
 
-        // Motor stall
-        if (run_time > MOTOR_CPR_WARMUP && (getMaxTps() > 0) &&
-            (getTicksPerSecond() < (getMaxTps() * WINCH_STALL_COEFFICIENT))) {
+        if (run_time > MOTOR_CPR_WARMUP && (getReferenceTps() > 0) &&
+            (getTicksPerSecond() < getReferenceTps() * WINCH_STALL_PERCENT / 100)) {
             netLog("Winch jammed (close sequence!)", NetLogLevel ::WARNING);
             stopMotor();
             if (error_cb != nullptr) {
@@ -540,36 +1069,6 @@ class DoorWinch : public Loggable
 
         return false;
     }
-
-    /**
-     * Wait until we've had a distance report from the sonar.
-     *
-     * This should be called before trying to read the sonar distance for the first time to ensure the value is valid.
-     */
-    bool waitForSonarReady()
-    {
-        auto start_time = millis();
-        while (millis() - start_time < SONAR_MAX_WAIT) {
-            if (sonar.process()) {
-                return true;
-            }
-        }
-
-        netLog("Sonar not reporting data!", NetLogLevel ::ERROR);
-
-        if (error_cb != nullptr) {
-            error_cb(DoorErrorCode::SONAR_ERROR, error_cb_ctx);
-        }
-
-        return false;
-    }
-
-    void runTickCallback()
-    {
-        if (tick_cb != nullptr) {
-            tick_cb(tick_cb_ctx);
-        }
-    }
 };
 
 }  // namespace dosa
@@ -0,0 +1,184 @@
+/**
+ * Winch motion profiles and closed-loop speed control.
+ *
+ * A profile produces a speed setpoint (encoder ticks per second) that ramps up from rest, cruises and ramps down ahead
+ * of a known travel distance; a PID loop then drives the motor PWM to follow it.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+/**
+ * Lowest setpoint a running profile will request, as a percentage of the cruise speed, so that a profile always
+ * reaches its target.
+ */
+#define MOTION_MIN_SPEED_PERCENT 10
+
+namespace dosa {
+
+enum class MotionProfileShape : uint8_t
+{
+    TRAPEZOIDAL = 0,  // Constant acceleration
+    S_CURVE = 1,      // Acceleration eases in and out, limiting jerk
+};
+
+class MotionProfile
+{
+   public:
+    /**
+     * Begin a new movement.
+     *
+     * `distance` is the expected travel in ticks, used to ramp down before the end. Zero if the end is not known, in
+     * which case the profile will cruise until stopped.
+     */
+    void start(uint32_t cruise_speed, uint32_t accel, MotionProfileShape profile_shape, uint32_t distance = 0)
+    {
+        cruise = cruise_speed;
+        acceleration = accel > 0 ? accel : 1;
+        shape = profile_shape;
+        travel = distance;
+
+        // Smoothstep acceleration peaks at 1.5x its mean, so an S-curve takes 1.5x as long for the same peak
+        ramp_time = shape == MotionProfileShape::S_CURVE ? 1.5f * float(cruise) / float(acceleration)
+                                                         : float(cruise) / float(acceleration);
+    }
+
+    /**
+     * Speed setpoint in ticks/s, `elapsed` ms into the movement having travelled `ticks`.
+     */
+    [[nodiscard]] uint32_t getSetpoint(uint32_t elapsed, uint32_t ticks) const
+    {
+        if (cruise == 0) {
+            return 0;
+        }
+
+        float speed = getRampUp(float(elapsed) / 1000.0f);
+
+        if (travel > 0) {
+            float down = getRampDown(ticks >= travel ? 0 : travel - ticks);
+            if (down < speed) {
+                speed = down;
+            }
+        }
+
+        float floor = float(cruise) * MOTION_MIN_SPEED_PERCENT / 100.0f;
+        if (speed < floor) {
+            speed = floor;
+        }
+
+        return uint32_t(speed + 0.5f);
+    }
+
+    [[nodiscard]] uint32_t getCruiseSpeed() const
+    {
+        return cruise;
+    }
+
+    [[nodiscard]] uint32_t getDistance() const
+    {
+        return travel;
+    }
+
+   private:
+    uint32_t cruise = 0;
+    uint32_t acceleration = 1;
+    uint32_t travel = 0;
+    float ramp_time = 0;  // seconds from rest to cruise
+    MotionProfileShape shape = MotionProfileShape::TRAPEZOIDAL;
+
+    [[nodiscard]] float getRampUp(float t) const
+    {
+        if (t >= ramp_time) {
+            return float(cruise);
+        }
+
+        float x = t / ramp_time;
+        if (shape == MotionProfileShape::S_CURVE) {
+            x = x * x * (3 - 2 * x);
+        }
+
+        return float(cruise) * x;
+    }
+
+    /**
+     * Highest speed from which we can still stop within `remaining` ticks.
+     *
+     * The S-curve is approximated by a constant deceleration equal to its mean.
+     */
+    [[nodiscard]] float getRampDown(uint32_t remaining) const
+    {
+        float decel = shape == MotionProfileShape::S_CURVE ? float(acceleration) * 2 / 3 : float(acceleration);
+        float speed = std::sqrt(2 * decel * float(remaining));
+        return speed > float(cruise) ? float(cruise) : speed;
+    }
+};
+
+/**
+ * PID loop from speed error to motor power.
+ *
+ * The integral is held while the output is saturated in the direction of the error, so that a stalled or
+ * slow-starting motor does not wind up a large correction.
+ */
+class SpeedPid
+{
+   public:
+    SpeedPid(float min_output, float max_output) : min_out(min_output), max_out(max_output) {}
+
+    /**
+     * Returns the new output given a `setpoint` and `measured` speed, `dt` seconds after the last update.
+     */
+    float update(float setpoint, float measured, float dt, float kp, float ki, float kd)
+    {
+        float error = setpoint - measured;
+        float derivative = 0;
+
+        if (initialised && dt > 0) {
+            // Derivative on measurement, so that setpoint ramps don't kick the output
+            derivative = -(measured - last_measured) / dt;
+        }
+
+        float step = ki * error * dt;
+        float unclamped = kp * error + integral + step + kd * derivative;
+
+        if (!(unclamped > max_out && step > 0) && !(unclamped < min_out && step < 0)) {
+            integral += step;
+        }
+
+        output = unclamped > max_out ? max_out : (unclamped < min_out ? min_out : unclamped);
+
+        last_measured = measured;
+        initialised = true;
+
+        return output;
+    }
+
+    void reset()
+    {
+        integral = 0;
+        output = min_out;
+        last_measured = 0;
+        initialised = false;
+    }
+
+    [[nodiscard]] float getOutput() const
+    {
+        return output;
+    }
+
+    [[nodiscard]] float getIntegral() const
+    {
+        return integral;
+    }
+
+   private:
+    float min_out;
+    float max_out;
+    float integral = 0;
+    float output = 0;
+    float last_measured = 0;
+    bool initialised = false;
+};
+
+}  // namespace dosa
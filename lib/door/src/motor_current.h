@@ -0,0 +1,141 @@
+/**
+ * Motor current sense sampling.
+ *
+ * The motor driver reports current as a voltage on PIN_MOTOR_CS. On the SAMD21 the ADC is run free, with the DMA
+ * controller copying every conversion into a circular buffer, so that the buffer always holds the most recent few ms of
+ * samples at no CPU cost. Once begin() has been called the sensor owns the ADC, analogRead() must not be used.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <wiring_private.h>
+
+// Current sense scale of the VNH5019 carrier
+#define MOTOR_CS_MV_PER_AMP 140
+#define MOTOR_CS_VREF_MV 3300
+
+/**
+ * Samples in the DMA ring. The ADC converts at roughly 60 kHz, so this covers about 2 ms, several PWM periods.
+ */
+#define MOTOR_CS_BUFFER_SIZE 128
+
+/**
+ * DMA channel used for current sampling.
+ */
+#ifndef MOTOR_CS_DMA_CHANNEL
+#define MOTOR_CS_DMA_CHANNEL 0
+#endif
+
+namespace dosa {
+
+namespace {
+
+#ifdef __SAMD21G18A__
+// Descriptor and write-back sections must be 16-byte aligned, and cover every channel up to the one we use
+__attribute__((aligned(16))) DmacDescriptor cs_dma_descriptors[MOTOR_CS_DMA_CHANNEL + 1];
+__attribute__((aligned(16))) DmacDescriptor cs_dma_writeback[MOTOR_CS_DMA_CHANNEL + 1];
+#endif
+
+volatile uint16_t cs_samples[MOTOR_CS_BUFFER_SIZE];
+
+}  // namespace
+
+class MotorCurrentSensor
+{
+   public:
+    explicit MotorCurrentSensor(uint8_t pin) : pin(pin) {}
+
+    /**
+     * Start continuous sampling. Must be called after any use of analogRead().
+     */
+    void begin()
+    {
+#ifdef __SAMD21G18A__
+        pinPeripheral(pin, PIO_ANALOG);
+
+        // ADC, clocked and calibrated by the core: single-ended against the core's default reference, free-running
+        ADC->CTRLA.bit.ENABLE = 0;
+        syncAdc();
+        ADC->INPUTCTRL.reg = ADC_INPUTCTRL_MUXPOS(g_APinDescription[pin].ulADCChannelNumber) |
+                             ADC_INPUTCTRL_MUXNEG_GND | ADC_INPUTCTRL_GAIN_DIV2;
+        syncAdc();
+        ADC->AVGCTRL.reg = ADC_AVGCTRL_SAMPLENUM_1 | ADC_AVGCTRL_ADJRES(0);
+        ADC->SAMPCTRL.reg = ADC_SAMPCTRL_SAMPLEN(2);
+        ADC->CTRLB.reg = ADC_CTRLB_PRESCALER_DIV64 | ADC_CTRLB_RESSEL_12BIT | ADC_CTRLB_FREERUN;
+        syncAdc();
+
+        // DMA: one beat per conversion into a ring, the descriptor links to itself so the transfer never ends
+        PM->AHBMASK.reg |= PM_AHBMASK_DMAC;
+        PM->APBBMASK.reg |= PM_APBBMASK_DMAC;
+
+        DMAC->CTRL.reg = 0;
+        DMAC->BASEADDR.reg = uint32_t(cs_dma_descriptors);
+        DMAC->WRBADDR.reg = uint32_t(cs_dma_writeback);
+        DMAC->CTRL.reg = DMAC_CTRL_DMAENABLE | DMAC_CTRL_LVLEN(0xF);
+
+        auto& desc = cs_dma_descriptors[MOTOR_CS_DMA_CHANNEL];
+        desc.BTCTRL.reg = DMAC_BTCTRL_VALID | DMAC_BTCTRL_BEATSIZE_HWORD | DMAC_BTCTRL_DSTINC;
+        desc.BTCNT.reg = MOTOR_CS_BUFFER_SIZE;
+        desc.SRCADDR.reg = uint32_t(&ADC->RESULT.reg);
+        desc.DSTADDR.reg = uint32_t(cs_samples + MOTOR_CS_BUFFER_SIZE);  // incrementing address is the block end
+        desc.DESCADDR.reg = uint32_t(&desc);
+
+        DMAC->CHID.reg = DMAC_CHID_ID(MOTOR_CS_DMA_CHANNEL);
+        DMAC->CHCTRLA.reg = 0;
+        DMAC->CHCTRLA.reg = DMAC_CHCTRLA_SWRST;
+        DMAC->CHCTRLB.reg = DMAC_CHCTRLB_LVL(0) | DMAC_CHCTRLB_TRIGSRC(ADC_DMAC_ID_RESRDY) |
+                            DMAC_CHCTRLB_TRIGACT_BEAT;
+        DMAC->CHCTRLA.reg = DMAC_CHCTRLA_ENABLE;
+
+        ADC->CTRLA.bit.ENABLE = 1;
+        syncAdc();
+        ADC->SWTRIG.bit.START = 1;
+#endif
+
+        running = true;
+    }
+
+    /**
+     * Mean current in mA across the sample buffer.
+     */
+    [[nodiscard]] uint32_t read() const
+    {
+        if (!running) {
+            return 0;
+        }
+
+#ifdef __SAMD21G18A__
+        uint32_t sum = 0;
+        for (auto const& sample : cs_samples) {
+            sum += sample;
+        }
+
+        return toMilliamps(sum / MOTOR_CS_BUFFER_SIZE);
+#else
+        return toMilliamps(analogRead(pin) << 2);
+#endif
+    }
+
+   private:
+    uint8_t pin;
+    bool running = false;
+
+    /**
+     * Convert a 12-bit reading to mA.
+     */
+    static uint32_t toMilliamps(uint32_t raw)
+    {
+        return raw * (MOTOR_CS_VREF_MV * 1000 / MOTOR_CS_MV_PER_AMP) / 4096;
+    }
+
+#ifdef __SAMD21G18A__
+    static void syncAdc()
+    {
+        while (ADC->STATUS.bit.SYNCBUSY) {
+        }
+    }
+#endif
+};
+
+}  // namespace dosa
@@ -0,0 +1,114 @@
+/**
+ * Encoder pulse timestamps.
+ *
+ * A lock-free, single-producer ring of pulse times: the encoder ISR is the only writer, the main loop only reads. Speed
+ * is derived from the periods between recent pulses.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Pulse timestamps kept, must be a power of two.
+ */
+#define PULSE_RING_SIZE 32
+
+/**
+ * Number of pulse periods averaged when calculating speed.
+ */
+#define PULSE_SPEED_PERIODS 4
+
+namespace dosa {
+
+class PulseRing
+{
+   public:
+    /**
+     * Record a pulse at `time` (us). Call only from the ISR.
+     */
+    void push(uint32_t time)
+    {
+        auto h = head;
+        ring[h & mask] = time;
+        head = h + 1;
+    }
+
+    /**
+     * Total pulses ever recorded. Wraps, only the difference between two values is meaningful.
+     */
+    [[nodiscard]] uint32_t getHead() const
+    {
+        return head;
+    }
+
+    /**
+     * Pulses recorded since the last call to reset().
+     */
+    [[nodiscard]] uint32_t getTicks() const
+    {
+        return head - origin;
+    }
+
+    /**
+     * Start counting ticks from zero. Does not disturb the producer.
+     */
+    void reset()
+    {
+        origin = head;
+    }
+
+    /**
+     * Pulses per second at `now` (us), zero if there have not been enough pulses since reset().
+     *
+     * Averages the last PULSE_SPEED_PERIODS pulse periods. If the time since the last pulse is already longer than
+     * that average, the motor has slowed and the speed is bounded by that time instead, so a stall shows within a few
+     * periods rather than waiting for the next pulse. A pulse newer than `now` counts as arriving at `now`.
+     */
+    [[nodiscard]] uint32_t getPulsesPerSecond(uint32_t now) const
+    {
+        uint32_t h = head;
+        uint32_t pulses = h - origin;
+        if (pulses < 2) {
+            return 0;
+        }
+
+        uint32_t periods = pulses - 1;
+        if (periods > PULSE_SPEED_PERIODS) {
+            periods = PULSE_SPEED_PERIODS;
+        }
+
+        uint32_t last = ring[(h - 1) & mask];
+        uint32_t first = ring[(h - 1 - periods) & mask];
+        uint32_t span = last - first;
+
+        // `now` may have been sampled before the ISR pushed the last pulse
+        uint32_t since = int32_t(now - last) > 0 ? now - last : 0;
+
+        if (uint64_t(since) * periods > span) {
+            return since == 0 ? 0 : 1000000 / since;
+        }
+
+        return span == 0 ? 0 : (1000000 * periods) / span;
+    }
+
+    /**
+     * Time (us) of the most recent pulse since reset(), zero if none.
+     */
+    [[nodiscard]] uint32_t getLastPulseTime() const
+    {
+        uint32_t h = head;
+        return h == origin ? 0 : ring[(h - 1) & mask];
+    }
+
+   private:
+    static constexpr uint32_t mask = PULSE_RING_SIZE - 1;
+    static_assert((PULSE_RING_SIZE & mask) == 0, "Pulse ring size must be a power of two");
+    static_assert(PULSE_SPEED_PERIODS < PULSE_RING_SIZE, "Pulse ring too small for speed periods");
+
+    volatile uint32_t ring[PULSE_RING_SIZE] = {0};
+    volatile uint32_t head = 0;
+    uint32_t origin = 0;
+};
+
+}  // namespace dosa
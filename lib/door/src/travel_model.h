@@ -0,0 +1,188 @@
+/**
+ * Learned door travel model.
+ *
+ * Predicts how far the line must be released to close the door, from how far the winch wound in to open it. Each clean
+ * sequence provides a sample: the calibrate phase that follows a close winds in the slack that was over-released, so
+ * the ticks actually required were the close ticks less the calibrate ticks.
+ *
+ * The model is an exponentially weighted least-squares line (required = gain * open + offset), so it follows the line
+ * as it stretches. While the open ticks have been too consistent to fit a slope, it falls back to a plain ratio.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Weight kept by previous samples each time a new sample is learned.
+ */
+#define TRAVEL_MODEL_FORGET 0.8f
+
+/**
+ * Samples required before predictions are used.
+ */
+#define TRAVEL_MODEL_MIN_SAMPLES 3
+
+/**
+ * Spread (standard deviation) of open ticks, below which a slope is not fitted.
+ */
+#define TRAVEL_MODEL_MIN_SPREAD 100
+
+/**
+ * Release this much beyond the predicted requirement, so the calibrate phase always finds slack to take in.
+ */
+#define TRAVEL_MODEL_MARGIN_PERCENT 5
+
+/**
+ * Predictions are kept within this percentage either side of the configured close ticks.
+ */
+#define TRAVEL_MODEL_LIMIT_PERCENT 50
+
+/**
+ * Size of the serialised model state.
+ */
+#define TRAVEL_MODEL_STATE_SIZE 24
+
+namespace dosa {
+
+class TravelModel
+{
+   public:
+    /**
+     * Add a sample: the door was opened by `open_ticks` and required `close_ticks` to close.
+     */
+    void learn(uint32_t open_ticks, uint32_t close_ticks)
+    {
+        auto x = float(open_ticks);
+        auto y = float(close_ticks);
+
+        sw = sw * TRAVEL_MODEL_FORGET + 1;
+        sx = sx * TRAVEL_MODEL_FORGET + x;
+        sy = sy * TRAVEL_MODEL_FORGET + y;
+        sxx = sxx * TRAVEL_MODEL_FORGET + x * x;
+        sxy = sxy * TRAVEL_MODEL_FORGET + x * y;
+
+        if (samples < UINT16_MAX) {
+            ++samples;
+        }
+    }
+
+    /**
+     * Close ticks for a door opened by `open_ticks`. Returns `configured` until the model has enough samples.
+     */
+    [[nodiscard]] uint32_t predict(uint32_t open_ticks, uint32_t configured) const
+    {
+        if (!isReady() || configured == 0) {
+            return configured;
+        }
+
+        float required = getGain() * float(open_ticks) + getOffset();
+        float ticks = required * (100 + TRAVEL_MODEL_MARGIN_PERCENT) / 100;
+
+        float low = float(configured) * (100 - TRAVEL_MODEL_LIMIT_PERCENT) / 100;
+        float high = float(configured) * (100 + TRAVEL_MODEL_LIMIT_PERCENT) / 100;
+
+        if (ticks < low) {
+            ticks = low;
+        } else if (ticks > high) {
+            ticks = high;
+        }
+
+        return uint32_t(ticks + 0.5f);
+    }
+
+    [[nodiscard]] bool isReady() const
+    {
+        return samples >= TRAVEL_MODEL_MIN_SAMPLES && sx > 0;
+    }
+
+    /**
+     * Close ticks required per open tick.
+     */
+    [[nodiscard]] float getGain() const
+    {
+        if (!hasSlope()) {
+            return sx > 0 ? sy / sx : 0;
+        }
+
+        return (sw * sxy - sx * sy) / (sw * sxx - sx * sx);
+    }
+
+    [[nodiscard]] float getOffset() const
+    {
+        if (!hasSlope() || sw <= 0) {
+            return 0;
+        }
+
+        return (sy - getGain() * sx) / sw;
+    }
+
+    [[nodiscard]] uint16_t getSampleCount() const
+    {
+        return samples;
+    }
+
+    void reset()
+    {
+        sw = sx = sy = sxx = sxy = 0;
+        samples = 0;
+    }
+
+    /**
+     * Write the model to `buffer`, of TRAVEL_MODEL_STATE_SIZE bytes.
+     */
+    void save(uint8_t* buffer) const
+    {
+        memset(buffer, 0, TRAVEL_MODEL_STATE_SIZE);
+        memcpy(buffer, &sw, 4);
+        memcpy(buffer + 4, &sx, 4);
+        memcpy(buffer + 8, &sy, 4);
+        memcpy(buffer + 12, &sxx, 4);
+        memcpy(buffer + 16, &sxy, 4);
+        memcpy(buffer + 20, &samples, 2);
+    }
+
+    /**
+     * Restore the model from `buffer`, as written by save(). An all-zero buffer is an empty model.
+     */
+    void load(uint8_t const* buffer)
+    {
+        memcpy(&sw, buffer, 4);
+        memcpy(&sx, buffer + 4, 4);
+        memcpy(&sy, buffer + 8, 4);
+        memcpy(&sxx, buffer + 12, 4);
+        memcpy(&sxy, buffer + 16, 4);
+        memcpy(&samples, buffer + 20, 2);
+
+        // Guard against a corrupt or foreign block
+        if (!(sw >= 0) || !(sx >= 0) || !(sy >= 0)) {
+            reset();
+        }
+    }
+
+   private:
+    // Exponentially weighted sums
+    float sw = 0;
+    float sx = 0;
+    float sy = 0;
+    float sxx = 0;
+    float sxy = 0;
+    uint16_t samples = 0;
+
+    /**
+     * True if the open ticks have varied enough to fit a slope.
+     */
+    [[nodiscard]] bool hasSlope() const
+    {
+        if (sw <= 0) {
+            return false;
+        }
+
+        float mean = sx / sw;
+        float variance = sxx / sw - mean * mean;
+        return variance >= float(TRAVEL_MODEL_MIN_SPREAD) * TRAVEL_MODEL_MIN_SPREAD;
+    }
+};
+
+}  // namespace dosa
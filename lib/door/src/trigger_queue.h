@@ -0,0 +1,132 @@
+/**
+ * Trigger queue for the door.
+ *
+ * Holds network triggers that arrive while a sequence is running and decides what each should do given the winch state,
+ * rather than discarding them. Triggers during open-wait extend the hold, a trigger during a close reverses the door,
+ * and any number of triggers while the door can't act on them are coalesced into a single pending trigger that starts a
+ * new sequence once the winch is idle.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "winch_state.h"
+
+/**
+ * A pending trigger is dropped if no further trigger arrives within this time (ms), so that a trigger held through a
+ * long sequence never opens the door for someone who has since left.
+ */
+#define TRIGGER_QUEUE_MAX_AGE 15000
+
+namespace dosa {
+
+enum class TriggerAction : uint8_t
+{
+    NONE,      // Nothing pending, or the trigger is held until the winch can act on it
+    START,     // Start a new sequence
+    EXTEND,    // Restart the open-wait timer
+    REVERSE,   // Stop the close and open the door again
+    COALESCE,  // Door is already opening, the trigger is satisfied by the running sequence
+};
+
+class TriggerQueue
+{
+   public:
+    /**
+     * Queue a trigger received at `now` (ms).
+     */
+    void push(uint32_t now)
+    {
+        if (pending) {
+            ++coalesced;
+        }
+
+        pending = true;
+        last_trigger = now;
+    }
+
+    /**
+     * Action the pending trigger given the winch `state` at `now`. Returns the action to take, the trigger is
+     * consumed unless the action is NONE.
+     */
+    TriggerAction next(WinchState state, bool rewinding, uint32_t now)
+    {
+        if (!pending) {
+            return TriggerAction::NONE;
+        }
+
+        if (now - last_trigger > TRIGGER_QUEUE_MAX_AGE) {
+            pending = false;
+            ++expired;
+            return TriggerAction::NONE;
+        }
+
+        TriggerAction action;
+        switch (state) {
+            case WinchState::IDLE:
+                action = TriggerAction::START;
+                break;
+            case WinchState::SONAR_WAIT:
+            case WinchState::OPENING:
+            case WinchState::REVERSING:
+                action = TriggerAction::COALESCE;
+                ++coalesced;
+                break;
+            case WinchState::OPEN_WAIT:
+                action = TriggerAction::EXTEND;
+                break;
+            case WinchState::CLOSING:
+                // A rewind is a recovery action, it is never reversed
+                action = rewinding ? TriggerAction::NONE : TriggerAction::REVERSE;
+                break;
+            default:
+                // Calibrating or cooling down, hold until idle
+                action = TriggerAction::NONE;
+                break;
+        }
+
+        if (action != TriggerAction::NONE) {
+            pending = false;
+        }
+
+        return action;
+    }
+
+    /**
+     * Drop any pending trigger, when entering an error state or starting a recalibration.
+     */
+    void clear()
+    {
+        pending = false;
+    }
+
+    [[nodiscard]] bool isPending() const
+    {
+        return pending;
+    }
+
+    /**
+     * Triggers that were merged into another, either pending or already running.
+     */
+    [[nodiscard]] uint32_t getCoalescedCount() const
+    {
+        return coalesced;
+    }
+
+    /**
+     * Pending triggers dropped for being too old.
+     */
+    [[nodiscard]] uint32_t getExpiredCount() const
+    {
+        return expired;
+    }
+
+   private:
+    bool pending = false;
+    uint32_t last_trigger = 0;
+    uint32_t coalesced = 0;
+    uint32_t expired = 0;
+};
+
+}  // namespace dosa
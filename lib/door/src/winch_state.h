@@ -0,0 +1,31 @@
+/**
+ * Door winch sequence states.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace dosa {
+
+/**
+ * Door winch sequence states, in the order a full trigger sequence moves through them.
+ *
+ * Values are reported in telemetry, new states must be added to the end.
+ */
+enum class WinchState : uint8_t
+{
+    IDLE,
+    SONAR_WAIT,          // Waiting for a fresh sonar reading before opening
+    OPENING,             // Winding in until the sonar apex, tick count or a kill condition
+    OPEN_WAIT,           // Holding the door open
+    CLOSING,             // Releasing the door for a fixed number of ticks
+    SETTLE,              // Pause before calibration
+    CALIBRATE_TENSION,   // Winding in until tension is detected on the line
+    CALIBRATE_PAUSE,     // Pause before rolling back
+    CALIBRATE_ROLLBACK,  // Releasing a little to leave the line just taut
+    COOLDOWN,            // Waiting for subjects to clear the sensors
+    REVERSING,           // Close was interrupted by a trigger, pausing before opening again
+};
+
+}  // namespace dosa
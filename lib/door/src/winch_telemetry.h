@@ -0,0 +1,195 @@
+/**
+ * Door sequence telemetry.
+ *
+ * Records the winch at a fixed rate through each motor phase of a sequence, into a fixed-size buffer which is sent as a
+ * set of WINCH_TELEMETRY status messages once the sequence completes. If the buffer fills, every other sample is
+ * dropped and the sample interval doubled, so that the whole sequence is always covered.
+ *
+ * Status message layout (little-endian), one message per chunk:
+ *   Offset  Size  Type      Detail
+ *   ----------------------------------
+ *   0       1     uint8     Device state
+ *   1       1     uint8     Telemetry format version
+ *   2       2     uint16    Sequence number
+ *   4       1     uint8     Flags, see WINCH_TELEMETRY_FLAG_*
+ *   5       1     uint8     Chunk index
+ *   6       1     uint8     Chunk count
+ *   7       2     uint16    Sample interval, ms
+ *   9       2     uint16    Total samples in the sequence
+ *   11      2     uint16    Index of the first sample in this chunk
+ *   13      1     uint8     Samples in this chunk (N)
+ *   14      11x   ...       N samples: uint16 time since sequence start (10 ms units), uint8 phase (WinchState),
+ *                           uint16 encoder ticks since the phase began, uint16 speed (ticks/s), uint16 sonar distance
+ *                           (mm), uint16 motor current (mA)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#define WINCH_TELEMETRY_VERSION 1
+#define WINCH_TELEMETRY_MAX_SAMPLES 200
+#define WINCH_TELEMETRY_INTERVAL 20  // Initial sample interval, ms
+#define WINCH_TELEMETRY_TIME_UNIT 10
+#define WINCH_TELEMETRY_HEADER_SIZE 14
+#define WINCH_TELEMETRY_SAMPLE_SIZE 11
+
+/**
+ * Samples per status message, keeps each message within a single unfragmented UDP datagram.
+ */
+#define WINCH_TELEMETRY_CHUNK_SAMPLES 80
+#define WINCH_TELEMETRY_CHUNK_SIZE \
+    (WINCH_TELEMETRY_HEADER_SIZE + WINCH_TELEMETRY_CHUNK_SAMPLES * WINCH_TELEMETRY_SAMPLE_SIZE)
+
+#define WINCH_TELEMETRY_FLAG_REWIND 0x01
+#define WINCH_TELEMETRY_FLAG_CLOSED_LOOP 0x02
+#define WINCH_TELEMETRY_FLAG_DECIMATED 0x04
+
+namespace dosa {
+
+class WinchTelemetry
+{
+   public:
+    /**
+     * Start recording a new sequence at `now` (ms).
+     */
+    void begin(uint32_t now, uint8_t sequence_flags)
+    {
+        ++sequence;
+        start_time = now;
+        flags = sequence_flags;
+        interval = WINCH_TELEMETRY_INTERVAL;
+        count = 0;
+    }
+
+    /**
+     * Flags may change as the sequence progresses, eg closed-loop control is decided per movement.
+     */
+    void setFlag(uint8_t flag)
+    {
+        flags |= flag;
+    }
+
+    /**
+     * True if a sample should be recorded at `now`.
+     */
+    [[nodiscard]] bool isDue(uint32_t now) const
+    {
+        return count == 0 || now - last_sample >= interval;
+    }
+
+    void record(uint32_t now, uint8_t phase, uint32_t ticks, uint32_t speed, uint32_t distance, uint32_t current)
+    {
+        if (count == WINCH_TELEMETRY_MAX_SAMPLES) {
+            decimate();
+            if (!isDue(now)) {
+                return;
+            }
+        }
+
+        uint32_t time = (now - start_time) / WINCH_TELEMETRY_TIME_UNIT;
+        samples[count++] = {clamp16(time), phase, clamp16(ticks), clamp16(speed), clamp16(distance), clamp16(current)};
+        last_sample = now;
+    }
+
+    [[nodiscard]] uint16_t getSampleCount() const
+    {
+        return count;
+    }
+
+    [[nodiscard]] uint16_t getInterval() const
+    {
+        return interval;
+    }
+
+    [[nodiscard]] uint16_t getSequence() const
+    {
+        return sequence;
+    }
+
+    [[nodiscard]] uint8_t getChunkCount() const
+    {
+        return count == 0 ? 1 : (count + WINCH_TELEMETRY_CHUNK_SAMPLES - 1) / WINCH_TELEMETRY_CHUNK_SAMPLES;
+    }
+
+    /**
+     * Pack chunk `index` into `buffer`, which must hold WINCH_TELEMETRY_CHUNK_SIZE bytes. Returns the packed size.
+     */
+    uint16_t pack(uint8_t index, uint8_t device_state, uint8_t* buffer) const
+    {
+        uint16_t first = index * WINCH_TELEMETRY_CHUNK_SAMPLES;
+        uint8_t n = first >= count ? 0
+                                   : (count - first > WINCH_TELEMETRY_CHUNK_SAMPLES ? WINCH_TELEMETRY_CHUNK_SAMPLES
+                                                                                     : count - first);
+        uint8_t version = WINCH_TELEMETRY_VERSION;
+        uint8_t chunks = getChunkCount();
+
+        memcpy(buffer, &device_state, 1);
+        memcpy(buffer + 1, &version, 1);
+        memcpy(buffer + 2, &sequence, 2);
+        memcpy(buffer + 4, &flags, 1);
+        memcpy(buffer + 5, &index, 1);
+        memcpy(buffer + 6, &chunks, 1);
+        memcpy(buffer + 7, &interval, 2);
+        memcpy(buffer + 9, &count, 2);
+        memcpy(buffer + 11, &first, 2);
+        memcpy(buffer + 13, &n, 1);
+
+        uint8_t* ptr = buffer + WINCH_TELEMETRY_HEADER_SIZE;
+        for (uint16_t i = first; i < first + n; ++i) {
+            auto const& s = samples[i];
+            memcpy(ptr, &s.time, 2);
+            memcpy(ptr + 2, &s.phase, 1);
+            memcpy(ptr + 3, &s.ticks, 2);
+            memcpy(ptr + 5, &s.speed, 2);
+            memcpy(ptr + 7, &s.distance, 2);
+            memcpy(ptr + 9, &s.current, 2);
+            ptr += WINCH_TELEMETRY_SAMPLE_SIZE;
+        }
+
+        return ptr - buffer;
+    }
+
+   private:
+    struct Sample
+    {
+        uint16_t time;
+        uint8_t phase;
+        uint16_t ticks;
+        uint16_t speed;
+        uint16_t distance;
+        uint16_t current;
+    };
+
+    Sample samples[WINCH_TELEMETRY_MAX_SAMPLES] = {};
+    uint16_t count = 0;
+    uint16_t sequence = 0;
+    uint16_t interval = WINCH_TELEMETRY_INTERVAL;
+    uint8_t flags = 0;
+    uint32_t start_time = 0;
+    uint32_t last_sample = 0;
+
+    /**
+     * Halve the resolution of the recording to make room.
+     */
+    void decimate()
+    {
+        uint16_t kept = 0;
+        for (uint16_t i = 0; i < count; i += 2) {
+            samples[kept++] = samples[i];
+        }
+
+        count = kept;
+        interval *= 2;
+        flags |= WINCH_TELEMETRY_FLAG_DECIMATED;
+        last_sample = start_time + uint32_t(samples[count - 1].time) * WINCH_TELEMETRY_TIME_UNIT;
+    }
+
+    static uint16_t clamp16(uint32_t value)
+    {
+        return value > UINT16_MAX ? UINT16_MAX : uint16_t(value);
+    }
+};
+
+}  // namespace dosa
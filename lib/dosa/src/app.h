@@ -31,16 +31,31 @@ using NetLogLevel = messages::LogMessageLevel;
 /**
  * Wifi settings.
  *
- * While it makes sense to have a reasonably low WIFI_RECONNECT_WAIT time - this will also disconnect the BT which
- * will hide the device from someone trying to connect to update config.
+ * Each failed round of connection attempts doubles the wait before the next, from WIFI_BACKOFF_MIN up to
+ * WIFI_BACKOFF_MAX. Retrying also disconnects the BT, which will hide the device from someone trying to connect to
+ * update config, so a device that can't find its AP spends most of its time visible over BT.
  *
  * If a user connects via BT, we will NOT attempt to reconnect wifi until they disconnect.
  */
 #define WIFI_CON_CHECK 500         // Time between checking health of wifi connection (ms)
-#define WIFI_RECONNECT_WAIT 15000  // Time before reattempting to connect wifi (ms)
+#define WIFI_BACKOFF_MIN 5000      // Wait before reattempting to connect wifi after the first failure (ms)
+#define WIFI_BACKOFF_MAX 120000    // Longest wait between attempts to connect wifi (ms)
 #define WIFI_INITIAL_ATTEMPTS 3    // Default number of attempts to connect wifi (first-run uses default)
 #define WIFI_RETRY_ATTEMPTS 1      // Number of attempts to connect wifi after init
 
+/**
+ * Stages of bringing up the wifi, see App::checkWifi().
+ */
+enum class WifiState : uint8_t
+{
+    IDLE,        // No AP configured, or dropped into Bluetooth mode for configuration
+    SWITCHING,   // Waiting for the NINA chip to come off Bluetooth before connecting
+    CONNECTING,  // Waiting on a connection attempt
+    CONNECTED,   // Online
+    FALLBACK,    // All attempts failed, waiting for the NINA chip before bringing up Bluetooth
+    BACKOFF,     // Waiting before the next round of attempts
+};
+
 /**
  * Abstract App class that all devices should inherit.
  *
@@ -91,20 +106,30 @@ class App : public virtual Loggable, public StatefulApplication
 
         // Load settings from FRAM
         auto& settings = getSettings();
-        if (!settings.load(false)) {
+        bool settings_loaded = settings.load(false);
+        if (!settings_loaded) {
             // FRAM didn't contain valid settings, write default values to chip -
             settings.save(false);
         }
         logln("Device name: " + settings.getDeviceName());
 
+        getStore().mount();
+        getStore().get("dosa.boots", boot_count);
+        getStore().set("dosa.boots", ++boot_count);
+
+        getJournal().mount();
+        journal(JournalEvent::BOOT, settings_loaded ? 1 : 0);
+
         IPAddress addr;
         addr.fromString(getSettings().getStatsServerAddr());
         getStats().setStatsServer({addr, getSettings().getStatsServerPort()});
         getStats().setTags("app:" + settings.getDeviceName());
 
-        // Bring BT online only if the wifi failed to connect
-        if (settings.getWifiSsid().length() == 0 || !connectWifi()) {
+        // Wifi comes up from the main loop, BT is brought online if it fails to connect
+        if (settings.getWifiSsid().length() == 0) {
             enableBluetooth();
+        } else {
+            beginWifi();
         }
 
         // Handler for requests to drop back into Bluetooth mode for manual configuration
@@ -143,8 +168,13 @@ class App : public virtual Loggable, public StatefulApplication
             &reqMessageForwarder,
             this);
 
+        // Event journal replay
+        getContainer().getComms().newHandler<comms::StandardHandler<messages::GenericMessage>>(
+            DOSA_COMMS_MSG_JOURNAL,
+            &journalMessageForwarder,
+            this);
+
         wifi_last_checked = millis();
-        wifi_last_reconnected = millis();
 
         // Init completed
         logln("Init complete\n");
@@ -180,7 +210,7 @@ class App : public virtual Loggable, public StatefulApplication
     {
         if (getContainer().getComms().bindMulticast(comms::multicastAddr)) {
             logln("Listening for multicast packets", LogLevel::DEBUG);
-            dispatchGenericMessage(DOSA_COMMS_MSG_ONLINE);
+            dispatchOnline();
             getStats().count(stats::online);
         } else {
             logln("Failed to bind multicast", LogLevel::ERROR);
@@ -192,6 +222,16 @@ class App : public virtual Loggable, public StatefulApplication
         logln("Wifi connection lost", LogLevel::WARNING);
     }
 
+    /**
+     * Door settings were changed by a config request, the door has likely been re-rigged.
+     */
+    virtual void onDoorCalibration() {}
+
+    /**
+     * Relay settings were changed by a config request, apps driving relays should re-apply them.
+     */
+    virtual void onRelayCalibration() {}
+
     /**
      * Check if device is locked.
      */
@@ -228,6 +268,31 @@ class App : public virtual Loggable, public StatefulApplication
         return getContainer().getStats();
     }
 
+    Store& getStore()
+    {
+        return getContainer().getStore();
+    }
+
+    Store const& getStore() const
+    {
+        return getContainer().getStore();
+    }
+
+    EventJournal& getJournal()
+    {
+        return getContainer().getJournal();
+    }
+
+    /**
+     * Record an event in the FRAM journal, so that it survives the network being down.
+     */
+    void journal(JournalEvent event, uint32_t detail = 0)
+    {
+        // The wifi may have disturbed the SPI bus
+        getSettings().reInitRam();
+        getJournal().append(event, detail, millis(), static_cast<uint16_t>(boot_count));
+    }
+
     /**
      * Dispatch a generic message on the UDP multicast address.
      */
@@ -239,6 +304,21 @@ class App : public virtual Loggable, public StatefulApplication
             wait_for_ack);
     }
 
+    /**
+     * Announce the device is online with its version and state, which also serves as its health report after an OTA
+     * update.
+     */
+    bool dispatchOnline()
+    {
+        uint8_t data[5];
+        uint32_t version = DOSA_VERSION;
+        memcpy(data, &version, 4);
+        data[4] = static_cast<uint8_t>(getDeviceState());
+
+        return dispatchMessage(
+            messages::GenericMessage(DOSA_COMMS_MSG_ONLINE, data, sizeof(data), getDeviceNameBytes()));
+    }
+
     /**
      * Dispatch a specific message on the UDP multicast address.
      */
@@ -285,6 +365,7 @@ class App : public virtual Loggable, public StatefulApplication
 
     void secAlert(SecurityLevel level)
     {
+        journal(JournalEvent::SECURITY, static_cast<uint8_t>(level));
         dispatchMessage(messages::Security(level, getDeviceNameBytes()), true);
     }
 
@@ -323,6 +404,7 @@ class App : public virtual Loggable, public StatefulApplication
 
             } else {
                 logln("Accepting trigger from " + sender_str);
+                journal(JournalEvent::TRIGGER, 0);
             }
         }
 
@@ -432,37 +514,73 @@ class App : public virtual Loggable, public StatefulApplication
     }
 
     /**
-     * Run a health-check on the wifi connection.
+     * Drive the wifi connection; run a health-check when online, else move the connection along.
      *
-     * Will periodically attempt to reconnect a broken wifi connection.
+     * Nothing here blocks the main loop. Each connection attempt is polled until it connects or times out. When all
+     * attempts fail, BT is brought up so that the device may be reconfigured, and the wifi is tried again after a
+     * backoff that doubles with each failure.
      */
     void checkWifi()
     {
-        if (getSettings().getWifiSsid().length() == 0) {
+        if (wifi_suspended || getSettings().getWifiSsid().length() == 0) {
             return;
         }
 
         auto& wifi = getContainer().getWiFi();
 
-        // We probe the wifi chip every WIFI_CON_CHECK ms..
-        if (millis() - wifi_last_checked > WIFI_CON_CHECK) {
-            wifi_last_checked = millis();
-
-            if (!wifi_connected || !wifi.isConnected()) {
-                // Wifi is offline
-                if (wifi_connected) {
-                    // it was online, mark is as a disconnect
-                    wifi.disconnect();
-                    wifi_connected = false;
-                    onWifiDisconnect();
+        switch (wifi_state) {
+            case WifiState::IDLE:
+                break;
+            case WifiState::SWITCHING:
+                if (millis() - wifi_state_changed > NINA_CHIP_SWITCH_DELAY) {
+                    beginWifiAttempt(false);
                 }
-
-                // Attempt to reconnect
-                if (millis() - wifi_last_reconnected > WIFI_RECONNECT_WAIT) {
-                    connectWifiOrBluetooth(WIFI_RETRY_ATTEMPTS);
-                    wifi_last_reconnected = millis();
+                break;
+            case WifiState::CONNECTING:
+                switch (wifi.pollConnect()) {
+                    case WifiAttempt::PENDING:
+                        break;
+                    case WifiAttempt::CONNECTED:
+                        onWifiAttemptConnected();
+                        break;
+                    case WifiAttempt::FAILED:
+                        if (--wifi_attempts > 0) {
+                            logln("Retrying wifi, " + String(wifi_attempts) + " attempts left..");
+                            beginWifiAttempt(true);
+                        } else {
+                            setWifiState(WifiState::FALLBACK);
+                        }
+                        break;
                 }
-            }
+                break;
+            case WifiState::FALLBACK:
+                if (millis() - wifi_state_changed > NINA_CHIP_SWITCH_DELAY) {
+                    enableBluetooth();
+                    logln("Wifi unavailable, retrying in " + String(wifi_backoff / 1000) + "s");
+                    setWifiState(WifiState::BACKOFF);
+                }
+                break;
+            case WifiState::BACKOFF:
+                if (millis() - wifi_state_changed > wifi_backoff) {
+                    wifi_backoff = wifi_backoff * 2 > WIFI_BACKOFF_MAX ? WIFI_BACKOFF_MAX : wifi_backoff * 2;
+                    beginWifi(WIFI_RETRY_ATTEMPTS);
+                }
+                break;
+            case WifiState::CONNECTED:
+                // We probe the wifi chip every WIFI_CON_CHECK ms..
+                if (millis() - wifi_last_checked > WIFI_CON_CHECK) {
+                    wifi_last_checked = millis();
+
+                    if (!wifi.isConnected()) {
+                        // it was online, mark is as a disconnect
+                        wifi.disconnect();
+                        wifi_connected = false;
+                        onWifiLost();
+                        onWifiDisconnect();
+                        beginWifi(WIFI_RETRY_ATTEMPTS);
+                    }
+                }
+                break;
         }
     }
 
@@ -499,51 +617,38 @@ class App : public virtual Loggable, public StatefulApplication
     /**
      * Update wifi settings and write to FRAM.
      */
-    void setWifi(String const& ssid, String const& password)
+    bool setWifi(String const& ssid, String const& password)
     {
         auto& settings = getSettings();
 
+        if (!settings.setWifi(ssid, password)) {
+            logln("Wifi AP or password too long", LogLevel::ERROR);
+            return false;
+        }
+
         logln("Updating wifi AP to '" + ssid + "'");
-        settings.setWifiSsid(ssid);
-        settings.setWifiPassword(password);
         settings.save();
+        return true;
     }
 
     /**
-     * Attempt to connect wifi, if it fails, enable Bluetooth.
+     * Begin bringing up the wifi, making up to `attempts` connection attempts before falling back to Bluetooth.
      *
-     * This is normally the way you should try to connect the wifi. If wifi fails, we need BLE enabled so that the
-     * wifi can be reconfigured.
+     * This is normally the way you should connect the wifi. Progress is made by checkWifi() from the main loop; if the
+     * wifi fails, we need BLE enabled so that the wifi can be reconfigured.
      */
-    void connectWifiOrBluetooth(uint8_t attempts = WIFI_INITIAL_ATTEMPTS)
+    void beginWifi(uint8_t attempts = WIFI_INITIAL_ATTEMPTS)
     {
-        if (!connectWifi(attempts)) {
-            delay(NINA_CHIP_SWITCH_DELAY);
-            enableBluetooth();
-        }
-    }
-
-    /**
-     * Attempt to connect to the wifi AP.
-     */
-    bool connectWifi(uint8_t attempts = WIFI_INITIAL_ATTEMPTS)
-    {
-        auto& settings = getSettings();
+        wifi_suspended = false;
+        wifi_attempts = attempts;
+        getContainer().getSerial().writeln("Connecting to wifi (" + getSettings().getWifiSsid() + ")..");
 
         if (getContainer().getBluetooth().isEnabled()) {
             getContainer().getBluetooth().setEnabled(false);
             central_connected = false;
-            delay(NINA_CHIP_SWITCH_DELAY);
-        }
-
-        getContainer().getSerial().writeln("Connecting to wifi (" + settings.getWifiSsid() + ")..");
-        if (getContainer().getWiFi().connect(settings.getWifiSsid(), settings.getWifiPassword(), attempts)) {
-            wifi_connected = true;
-            onWifiConnect();
-            return true;
+            setWifiState(WifiState::SWITCHING);
         } else {
-            wifi_connected = false;
-            return false;
+            beginWifiAttempt(false);
         }
     }
 
@@ -596,6 +701,13 @@ class App : public virtual Loggable, public StatefulApplication
             netLog("Stats server: none", sender);
         }
 
+        if (settings.getOtaServerAddr().length() > 0) {
+            netLog(
+                "OTA server: " + settings.getOtaServerAddr() + ":" + settings.getOtaServerPort() +
+                    settings.getOtaServerPath(),
+                sender);
+        }
+
         auto const& listen_devices = settings.getListenDevices();
         if (listen_devices.length() == 0) {
             netLog("Listening to: <all devices>", sender);
@@ -608,6 +720,15 @@ class App : public virtual Loggable, public StatefulApplication
             }
             netLog(listen_msg, sender);
         }
+
+        netLog(
+            "Boot count: " + String(boot_count) + "; store: " + String(getStore().size()) + " keys, " +
+                String(getStore().getFree()) + " bytes free",
+            sender);
+        netLog(
+            "Journal: " + String(getJournal().getNext() - getJournal().getOldest()) + " of " +
+                String(getJournal().getCapacity()) + " records, next " + String(getJournal().getNext()),
+            sender);
     }
 
     /**
@@ -641,14 +762,104 @@ class App : public virtual Loggable, public StatefulApplication
                 getSettings().getDeviceNameBytes()));
     }
 
+    /**
+     * JNL message received, return a page of the event journal.
+     *
+     * The request may carry the uint32 sequence number to page from, the reply gives the number to request next.
+     */
+    void onJournalRequest(messages::GenericMessage const& msg, comms::Node const& sender)
+    {
+        getStats().count("dosa.request.journal");
+
+        uint32_t from = 0;
+        if (msg.getMessageSize() >= 4) {
+            memcpy(&from, msg.getMessage(), 4);
+        }
+
+        uint8_t page[JOURNAL_PAGE_SIZE];
+        getSettings().reInitRam();
+        auto size = getJournal().packPage(from, static_cast<uint8_t>(getDeviceState()), page);
+        logln(
+            "Journal request from '" + Comms::getDeviceName(msg) + "' (" + comms::nodeToString(sender) + "), " +
+                String(page[14]) + " records from " + String(from));
+
+        getContainer().getComms().dispatch(
+            sender,
+            messages::StatusMessage(
+                static_cast<uint16_t>(messages::StatusFormat::JOURNAL),
+                reinterpret_cast<char const*>(page),
+                size,
+                getSettings().getDeviceNameBytes()));
+    }
+
    private:
     bool central_connected = false;
     bool wifi_connected = false;
+    bool wifi_reconfigured = false;
+    bool wifi_suspended = false;  // Config mode was requested, the wifi stays down until it is next brought up
     uint32_t config_last_checked = 0;
     uint32_t wifi_last_checked = 0;
-    uint32_t wifi_last_reconnected = 0;
+    WifiState wifi_state = WifiState::IDLE;
+    uint32_t wifi_state_changed = 0;
+    uint32_t wifi_backoff = WIFI_BACKOFF_MIN;
+    uint8_t wifi_attempts = 0;
+    bool wifi_lost = false;
+    uint32_t wifi_lost_at = 0;
+    uint32_t wifi_lost_journal = 0;
+    uint32_t boot_count = 0;
     messages::DeviceType device_type = messages::DeviceType::UNSPECIFIED;
 
+    void setWifiState(WifiState state)
+    {
+        wifi_state = state;
+        wifi_state_changed = millis();
+    }
+
+    /**
+     * Make a connection attempt, either the first of a round or a `retry`.
+     */
+    void beginWifiAttempt(bool retry)
+    {
+        auto& settings = getSettings();
+        getContainer().getWiFi().beginConnect(settings.getWifiSsid(), settings.getWifiPassword(), retry);
+        setWifiState(WifiState::CONNECTING);
+    }
+
+    void onWifiAttemptConnected()
+    {
+        setWifiState(WifiState::CONNECTED);
+        wifi_connected = true;
+        wifi_backoff = WIFI_BACKOFF_MIN;
+        wifi_last_checked = millis();
+        onWifiConnect();
+
+        if (wifi_lost) {
+            wifi_lost = false;
+            journal(JournalEvent::LINK, 1);
+
+            // Detections carried on while offline, point the way to them in the journal
+            uint32_t missed = getJournal().getNext() - wifi_lost_journal - 1;
+            netLog(
+                "Wifi restored after " + String((millis() - wifi_lost_at) / 1000) + "s offline, " + String(missed) +
+                    " events journaled from #" + String(wifi_lost_journal),
+                missed > 0 ? NetLogLevel::WARNING : NetLogLevel::INFO);
+        }
+    }
+
+    /**
+     * Connection dropped, mark where in the journal the offline period begins.
+     */
+    void onWifiLost()
+    {
+        journal(JournalEvent::LINK, 0);
+
+        if (!wifi_lost) {
+            wifi_lost = true;
+            wifi_lost_at = millis();
+            wifi_lost_journal = getJournal().getNext();
+        }
+    }
+
     /**
      * Creates a serial log message for a NetLog message.
      */
@@ -812,10 +1023,9 @@ class App : public virtual Loggable, public StatefulApplication
             return;
         }
 
-        setWifi(data_wifi.substring(0, brk), data_wifi.substring(brk + 1));
-
-        if (data_wifi.substring(0, brk).length() > 0) {
-            connectWifi();
+        auto ssid = data_wifi.substring(0, brk);
+        if (setWifi(ssid, data_wifi.substring(brk + 1)) && ssid.length() > 0) {
+            beginWifi();
         }
     }
 
@@ -831,10 +1041,11 @@ class App : public virtual Loggable, public StatefulApplication
         // Send reply ack
         getContainer().getComms().dispatch(sender, messages::Ack(msg, getDeviceNameBytes()));
 
-        // Disconnect wifi and bring BT back online
-        getSettings().setWifiSsid("");  // to prevent reconnects (don't write to FRAM!)
+        // Disconnect wifi and bring BT back online, the saved AP is kept for the next boot
+        wifi_suspended = true;
         getContainer().getWiFi().disconnect();
         wifi_connected = false;
+        setWifiState(WifiState::IDLE);
         enableBluetooth();
     }
 
@@ -859,9 +1070,7 @@ class App : public virtual Loggable, public StatefulApplication
         auto& settings = getSettings();
         logln("SET PASSWORD: '" + value + "'");
 
-        if (settings.setPin(value)) {
-            settings.save();
-        } else {
+        if (!settings.setPin(value)) {
             logln("ERROR: failed to update device pin", LogLevel::ERROR);
         }
     }
@@ -874,7 +1083,6 @@ class App : public virtual Loggable, public StatefulApplication
         if (settings.setDeviceName(value)) {
             getStats().setTags("app:" + settings.getDeviceName());
             bt_device_name.writeValue(settings.getDeviceName());  // update BT value to new value
-            settings.save();
         } else {
             logln("ERROR: failed to update device name", LogLevel::ERROR);
         }
@@ -883,48 +1091,46 @@ class App : public virtual Loggable, public StatefulApplication
     void settingWifiAp(String const& value)
     {
         auto pos = value.indexOf("\n");
-        if (pos == -1) {
-            logln("ERROR: malformed wifi data", LogLevel::ERROR);
-            return;
-        } else if (pos == 0) {
-            logln("CLEAR WIFI AP");
+        auto& settings = getSettings();
 
-            auto& settings = getSettings();
+        if (pos == 0) {
+            logln("CLEAR WIFI AP");
             settings.setWifiSsid("");
             settings.setWifiPassword("");
-            settings.save();
-
-            // Wifi settings cleared, fallback into BT mode
-            getContainer().getWiFi().disconnect();
-            wifi_connected = false;
-            enableBluetooth();
-
         } else {
             String ap = value.substring(0, pos);
             String pw = value.substring(pos + 1);
 
             logln("SET WIFI AP: '" + ap + "' / '" + pw + "'");
+            if (!settings.setWifi(ap, pw)) {
+                logln("ERROR: wifi AP or password too long", LogLevel::ERROR);
+                return;
+            }
+        }
 
-            auto& settings = getSettings();
-            settings.setWifiSsid(ap);
-            settings.setWifiPassword(pw);
-            settings.save();
+        // Reconnect once the settings are saved, the rest of a batch must not wait on the wifi
+        wifi_reconfigured = true;
+    }
 
-            // Connect to new wifi
-            getContainer().getWiFi().disconnect();
-            wifi_connected = false;
-            connectWifiOrBluetooth(WIFI_RETRY_ATTEMPTS);
-            wifi_last_reconnected = millis();
+    /**
+     * Drop the wifi and reconnect with the saved AP, or fall back into Bluetooth mode if the AP was cleared.
+     */
+    void reconnectWifi()
+    {
+        getContainer().getWiFi().disconnect();
+        wifi_connected = false;
+        wifi_backoff = WIFI_BACKOFF_MIN;
+
+        if (getSettings().getWifiSsid().length() == 0) {
+            setWifiState(WifiState::IDLE);
+            enableBluetooth();
+        } else {
+            beginWifi(WIFI_RETRY_ATTEMPTS);
         }
     }
 
     void settingPirCalibration(uint8_t const* data, uint16_t size)
     {
-        if (size != 9) {
-            logln("ERROR: incorrect payload size for PIR calibration data", LogLevel::ERROR);
-            return;
-        }
-
         uint8_t min_pixels;
         float pixel_delta, total_delta;
 
@@ -941,7 +1147,6 @@ class App : public virtual Loggable, public StatefulApplication
         settings.setPirMinPixels(min_pixels);
         settings.setPirPixelDelta(pixel_delta);
         settings.setPirTotalDelta(total_delta);
-        settings.save();
     }
 
     void settingListenDevices(String const& value)
@@ -953,7 +1158,6 @@ class App : public virtual Loggable, public StatefulApplication
         logln("SET LISTEN DEVICES: '" + msg + "'");
 
         settings.setListenDevices(value);
-        settings.save();
     }
 
     void settingStatsServer(uint8_t const* data, uint16_t size)
@@ -966,22 +1170,47 @@ class App : public virtual Loggable, public StatefulApplication
 
         logln("SET STATS SERVER: " + server_addr + ":" + String(server_port));
 
-        settings.setStatsServerAddr(server_addr);
+        if (!settings.setStatsServerAddr(server_addr)) {
+            logln("ERROR: stats server address too long", LogLevel::ERROR);
+            return;
+        }
         settings.setStatsServerPort(server_port);
-        settings.save();
 
         IPAddress addr;
         addr.fromString(server_addr);
         getStats().setStatsServer({addr, server_port});
     }
 
-    void settingDoorCalibration(uint8_t const* data, uint16_t size)
+    void settingOtaServer(uint8_t const* data, uint16_t size)
     {
-        if (size != 14) {
-            logln("ERROR: incorrect payload size for door calibration data", LogLevel::ERROR);
+        auto& settings = getSettings();
+
+        uint16_t server_port;
+        memcpy(&server_port, data, 2);
+        String value = stringFromBytes(data + 2, size - 2);
+        String server_path;
+
+        auto pos = value.indexOf("\n");
+        if (pos != -1) {
+            server_path = value.substring(pos + 1);
+            value = value.substring(0, pos);
+        }
+
+        logln("SET OTA SERVER: " + value + ":" + String(server_port) + server_path);
+
+        if (!Settings::fits(SettingsField::OTA_SERVER_ADDR, value) ||
+            !Settings::fits(SettingsField::OTA_SERVER_PATH, server_path)) {
+            logln("ERROR: OTA server host or path too long", LogLevel::ERROR);
             return;
         }
 
+        settings.setOtaServerAddr(value);
+        settings.setOtaServerPort(server_port);
+        settings.setOtaServerPath(server_path);
+    }
+
+    void settingDoorCalibration(uint8_t const* data, uint16_t size)
+    {
         uint16_t open_distance;
         uint32_t open_wait, cool_down, close_ticks;
 
@@ -1001,16 +1230,38 @@ class App : public virtual Loggable, public StatefulApplication
         settings.setDoorOpenWait(open_wait);
         settings.setDoorCoolDown(cool_down);
         settings.setDoorCloseTicks(close_ticks);
-        settings.save();
+
+        if (size == 33) {
+            float kp, ki, kd;
+            uint16_t max_speed;
+            uint32_t accel;
+            uint8_t profile;
+
+            memcpy(&kp, data + 14, 4);
+            memcpy(&ki, data + 18, 4);
+            memcpy(&kd, data + 22, 4);
+            memcpy(&max_speed, data + 26, 2);
+            memcpy(&accel, data + 28, 4);
+            memcpy(&profile, data + 32, 1);
+
+            logln(" > PID gains:     " + String(kp, 4) + " / " + String(ki, 4) + " / " + String(kd, 4));
+            logln(" > max speed:     " + String(max_speed));
+            logln(" > acceleration:  " + String(accel));
+            logln(" > profile:       " + String(profile));
+
+            settings.setDoorPidKp(kp);
+            settings.setDoorPidKi(ki);
+            settings.setDoorPidKd(kd);
+            settings.setDoorMaxSpeed(max_speed);
+            settings.setDoorAccel(accel);
+            settings.setDoorProfile(profile);
+        }
+
+        onDoorCalibration();
     }
 
     void settingRangeCalibration(uint8_t const* data, uint16_t size)
     {
-        if (size != 8) {
-            logln("ERROR: incorrect payload size for range calibration data", LogLevel::ERROR);
-            return;
-        }
-
         uint16_t trigger_threshold, fixed_calibration;
         float trigger_coefficient;
 
@@ -1027,16 +1278,28 @@ class App : public virtual Loggable, public StatefulApplication
         settings.setRangeTriggerThreshold(trigger_threshold);
         settings.setRangeFixedCalibration(fixed_calibration);
         settings.setRangeTriggerCoefficient(trigger_coefficient);
-        settings.save();
+
+        if (size == 17) {
+            uint8_t median_window;
+            float process_noise, measurement_noise;
+
+            memcpy(&median_window, data + 8, 1);
+            memcpy(&process_noise, data + 9, 4);
+            memcpy(&measurement_noise, data + 13, 4);
+
+            logln(" > median window: " + String(median_window));
+            logln(" > process noise: " + String(process_noise));
+            logln(" > measurement noise: " + String(measurement_noise));
+
+            settings.setRangeMedianWindow(median_window);
+            settings.setRangeProcessNoise(process_noise);
+            settings.setRangeMeasurementNoise(measurement_noise);
+        }
     }
 
     void settingRelayCalibration(uint8_t const* data, uint16_t size)
     {
-        if (size != 4) {
-            logln("ERROR: incorrect payload size for relay calibration data", LogLevel::ERROR);
-            return;
-        }
-
+        uint8_t schedule_entries = size >= 7 ? data[6] : 0;
         uint32_t relay_delay;
         memcpy(&relay_delay, data, 4);
 
@@ -1045,16 +1308,34 @@ class App : public virtual Loggable, public StatefulApplication
 
         auto& settings = getSettings();
         settings.setRelayActivationTime(relay_delay);
-        settings.save();
-    }
 
-    void settingDeviceLock(uint8_t const* data, uint16_t size)
-    {
-        if (size != 1) {
-            logln("ERROR: incorrect payload size for lock configuration", LogLevel::ERROR);
-            return;
+        if (size > 4) {
+            uint8_t channels;
+            int8_t timezone;
+            memcpy(&channels, data + 4, 1);
+            memcpy(&timezone, data + 5, 1);
+
+            uint16_t map_offset = 7 + schedule_entries * 6;
+            String channel_map = stringFromBytes(data + map_offset, size - map_offset);
+
+            logln(" > channels: " + String(channels));
+            logln(" > timezone: " + String(timezone));
+            logln(" > schedule entries: " + String(schedule_entries));
+            logln(" > channel map: " + channel_map);
+
+            settings.setRelayChannels(channels);
+            settings.setRelayTimezone(timezone);
+            settings.setRelaySchedule(data + 7, schedule_entries * 6);
+            if (!settings.setRelayChannelMap(channel_map)) {
+                logln("ERROR: relay channel map too long", LogLevel::ERROR);
+            }
         }
 
+        onRelayCalibration();
+    }
+
+    void settingDeviceLock(uint8_t const* data)
+    {
         LockState lock_state;
         memcpy(&lock_state, data, 1);
 
@@ -1077,76 +1358,153 @@ class App : public virtual Loggable, public StatefulApplication
                 break;
         }
 
-        auto& settings = getSettings();
-        settings.setLockState(lock_state);
-        settings.save();
+        getSettings().setLockState(lock_state);
+        journal(JournalEvent::LOCK, static_cast<uint8_t>(lock_state));
     }
 
     /**
-     * Config setting packet received, update FRAM.
+     * Apply a single validated config item to the settings, without saving them.
      */
-    void onConfig(messages::Configuration const& msg, comms::Node const& sender)
+    void applyConfig(messages::Configuration::ConfigItem item, uint8_t const* data, uint16_t size)
     {
-        // Send reply ack even for retries, but we won't double-set the config for duplicate message
-        getContainer().getComms().dispatch(sender, messages::Ack(msg, getSettings().getDeviceNameBytes()));
-
-        if (msg_cache.validate(sender, msg.getMessageId())) {
-            return;
-        }
-
-        log("Config setting from '" + Comms::getDeviceName(msg) + "' (" + comms::nodeToString(sender) + ") // ");
-
-        String metric("dosa.request.config");
-        switch (msg.getConfigItem()) {
+        switch (item) {
             case messages::Configuration::ConfigItem::PASSWORD:
-                settingPassword(stringFromBytes(msg.getConfigData(), msg.getConfigSize()));
-                metric += ".password";
+                settingPassword(stringFromBytes(data, size));
                 break;
             case messages::Configuration::ConfigItem::DEVICE_NAME:
-                settingDeviceName(stringFromBytes(msg.getConfigData(), msg.getConfigSize()));
-                metric += ".device_name";
+                settingDeviceName(stringFromBytes(data, size));
                 break;
             case messages::Configuration::ConfigItem::WIFI_AP:
-                settingWifiAp(stringFromBytes(msg.getConfigData(), msg.getConfigSize()));
-                metric += ".wifi_ap";
+                settingWifiAp(stringFromBytes(data, size));
                 break;
             case messages::Configuration::ConfigItem::PIR_CALIBRATION:
-                settingPirCalibration(msg.getConfigData(), msg.getConfigSize());
-                metric += ".pir";
+                settingPirCalibration(data, size);
                 break;
             case messages::Configuration::ConfigItem::DOOR_CALIBRATION:
-                settingDoorCalibration(msg.getConfigData(), msg.getConfigSize());
-                metric += ".motor";
+                settingDoorCalibration(data, size);
                 break;
             case messages::Configuration::ConfigItem::RANGE_CALIBRATION:
-                settingRangeCalibration(msg.getConfigData(), msg.getConfigSize());
-                metric += ".range";
+                settingRangeCalibration(data, size);
                 break;
             case messages::Configuration::ConfigItem::RELAY_CALIBRATION:
-                settingRelayCalibration(msg.getConfigData(), msg.getConfigSize());
-                metric += ".relay";
+                settingRelayCalibration(data, size);
                 break;
             case messages::Configuration::ConfigItem::DEVICE_LOCK:
-                settingDeviceLock(msg.getConfigData(), msg.getConfigSize());
-                metric += ".lock";
+                settingDeviceLock(data);
                 break;
             case messages::Configuration::ConfigItem::LISTEN_DEVICES:
-                settingListenDevices(stringFromBytes(msg.getConfigData(), msg.getConfigSize()));
-                metric += ".listen_devices";
+                settingListenDevices(stringFromBytes(data, size));
                 break;
             case messages::Configuration::ConfigItem::STATS_SERVER:
-                settingStatsServer(msg.getConfigData(), msg.getConfigSize());
-                metric += ".stats_server";
+                settingStatsServer(data, size);
+                break;
+            case messages::Configuration::ConfigItem::OTA_SERVER:
+                settingOtaServer(data, size);
                 break;
             default:
-                logln("UNKNOWN SETTING");
-                metric += ".unknown";
                 break;
         }
+    }
+
+    /**
+     * Stats metric suffix for a config item.
+     */
+    static char const* getConfigMetric(messages::Configuration::ConfigItem item)
+    {
+        switch (item) {
+            case messages::Configuration::ConfigItem::PASSWORD:
+                return ".password";
+            case messages::Configuration::ConfigItem::DEVICE_NAME:
+                return ".device_name";
+            case messages::Configuration::ConfigItem::WIFI_AP:
+                return ".wifi_ap";
+            case messages::Configuration::ConfigItem::PIR_CALIBRATION:
+                return ".pir";
+            case messages::Configuration::ConfigItem::DOOR_CALIBRATION:
+                return ".motor";
+            case messages::Configuration::ConfigItem::RANGE_CALIBRATION:
+                return ".range";
+            case messages::Configuration::ConfigItem::RELAY_CALIBRATION:
+                return ".relay";
+            case messages::Configuration::ConfigItem::DEVICE_LOCK:
+                return ".lock";
+            case messages::Configuration::ConfigItem::LISTEN_DEVICES:
+                return ".listen_devices";
+            case messages::Configuration::ConfigItem::STATS_SERVER:
+                return ".stats_server";
+            case messages::Configuration::ConfigItem::OTA_SERVER:
+                return ".ota_server";
+            case messages::Configuration::ConfigItem::BATCH:
+                return ".batch";
+            default:
+                return ".unknown";
+        }
+    }
+
+    /**
+     * Config setting packet received, update FRAM.
+     *
+     * A BATCH is validated in full before any item is applied, then saved once, so that a device is never left with
+     * half of a configuration.
+     */
+    void onConfig(messages::Configuration const& msg, comms::Node const& sender)
+    {
+        // Send reply ack even for retries, but we won't double-set the config for duplicate message
+        getContainer().getComms().dispatch(sender, messages::Ack(msg, getSettings().getDeviceNameBytes()));
+
+        if (msg_cache.validate(sender, msg.getMessageId())) {
+            return;
+        }
 
+        log("Config setting from '" + Comms::getDeviceName(msg) + "' (" + comms::nodeToString(sender) + ") // ");
+
+        auto item = msg.getConfigItem();
+        String metric("dosa.request.config");
+        metric += getConfigMetric(item);
+
+        if (item == messages::Configuration::ConfigItem::BATCH) {
+            messages::ConfigBatch batch(msg.getConfigData(), msg.getConfigSize());
+            if (!batch.isValid()) {
+                logln("ERROR: malformed config batch, nothing applied", LogLevel::ERROR);
+                getStats().count(metric + ".invalid");
+                return;
+            }
+
+            logln("BATCH OF " + String(batch.getCount()) + " ITEMS");
+
+            uint16_t pos = 0;
+            messages::ConfigBatch::Item it{};
+            while (batch.read(pos, it)) {
+                applyConfig(it.item, it.data, it.size);
+                getStats().count(String("dosa.request.config") + getConfigMetric(it.item));
+            }
+        } else if (messages::Configuration::isValidItem(item, msg.getConfigData(), msg.getConfigSize())) {
+            applyConfig(item, msg.getConfigData(), msg.getConfigSize());
+        } else {
+            logln(
+                "ERROR: malformed or unknown setting (" + String(static_cast<uint8_t>(item)) + ")",
+                LogLevel::ERROR);
+            getStats().count(metric + ".invalid");
+            return;
+        }
+
+        commitConfig();
         getStats().count(metric);
     }
 
+    /**
+     * Save the settings after applying config, then act on anything that needed them saved first.
+     */
+    void commitConfig()
+    {
+        getSettings().save();
+
+        if (wifi_reconfigured) {
+            wifi_reconfigured = false;
+            reconnectWifi();
+        }
+    }
+
     /**
      * Context forwarder for Bluetooth config-mode request messages.
      */
@@ -1194,6 +1552,14 @@ class App : public virtual Loggable, public StatefulApplication
     {
         static_cast<App*>(context)->onRequestStat(msg, sender);
     }
+
+    /**
+     * Context forwarder for journal messages.
+     */
+    static void journalMessageForwarder(messages::GenericMessage const& msg, comms::Node const& sender, void* context)
+    {
+        static_cast<App*>(context)->onJournalRequest(msg, sender);
+    }
 };
 
 }  // namespace dosa
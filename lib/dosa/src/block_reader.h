@@ -0,0 +1,93 @@
+/**
+ * Block-buffered reader for byte-addressed storage, such as FRAM.
+ *
+ * Each SPI transaction carries a fixed overhead, so reading many small values one transaction at a time is far slower
+ * than reading the block that holds them. The reader fills a buffer with a block at a time and serves nearby reads from
+ * it. Reads as large as the buffer go straight to storage.
+ *
+ * `Storage` must provide `read(uint32_t addr, void* dest, size_t size)`.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace dosa {
+
+template <class Storage, uint16_t N = 64>
+class BlockReader
+{
+   public:
+    /**
+     * Reader of `storage`, never filling the buffer from at or beyond `limit`; buffered bytes past it read as zero.
+     */
+    BlockReader(Storage& storage, uint32_t limit) : storage(storage), limit(limit) {}
+
+    /**
+     * Read `size` bytes at `addr` into `dest`.
+     */
+    void read(uint32_t addr, void* dest, size_t size)
+    {
+        if (size >= N) {
+            storage.read(addr, dest, size);
+            ++storage_reads;
+            return;
+        }
+
+        if (addr < start || addr + size > start + filled) {
+            fill(addr);
+        }
+
+        memcpy(dest, buffer + (addr - start), size);
+    }
+
+    /**
+     * Byte at `addr`.
+     */
+    uint8_t read8(uint32_t addr)
+    {
+        uint8_t value;
+        read(addr, &value, 1);
+        return value;
+    }
+
+    /**
+     * Discard the buffer, required if the storage has been written since it was filled.
+     */
+    void invalidate()
+    {
+        filled = 0;
+    }
+
+    /**
+     * Number of reads issued to the storage.
+     */
+    [[nodiscard]] uint32_t getStorageReads() const
+    {
+        return storage_reads;
+    }
+
+   private:
+    Storage& storage;
+    uint32_t limit;
+    uint8_t buffer[N] = {0};
+    uint32_t start = 0;
+    uint16_t filled = 0;
+    uint32_t storage_reads = 0;
+
+    void fill(uint32_t addr)
+    {
+        start = addr;
+        filled = addr >= limit ? 0 : (limit - addr < N ? limit - addr : N);
+        if (filled > 0) {
+            storage.read(addr, buffer, filled);
+            ++storage_reads;
+        }
+
+        memset(buffer + filled, 0, N - filled);
+    }
+};
+
+}  // namespace dosa
@@ -23,6 +23,7 @@ constexpr char const* sec_panic = "dosa.security.panic";
 constexpr char const* net_ack_retries = "dosa.net.ack.retries";
 constexpr char const* net_ack_time = "dosa.net.ack.time";
 constexpr char const* net_unacked_triggers = "dosa.net.trigger.unacked";
+constexpr char const* winch_current_peak = "dosa.winch.current.peak";
 
 }  // namespace stats
 
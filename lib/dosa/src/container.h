@@ -4,12 +4,21 @@
 
 #include "bt.h"
 #include "fram.h"
+#include "journal.h"
+#include "kv_store.h"
 #include "lights.h"
 #include "settings.h"
 #include "stats.h"
 
 namespace dosa {
 
+static_assert(SettingsSlots::getAddress(SETTINGS_SLOT_COUNT) <= FRAM_STORE_ADDR, "Settings overlap the FRAM store");
+static_assert(FRAM_STORE_ADDR + FRAM_STORE_SIZE <= FRAM_JOURNAL_ADDR, "FRAM store overlaps the journal");
+static_assert(FRAM_JOURNAL_ADDR + FRAM_JOURNAL_SIZE <= FRAM_SIZE, "FRAM journal exceeds the FRAM");
+
+using Store = KvStore<Fram>;
+using EventJournal = Journal<Fram>;
+
 class Container
 {
    public:
@@ -19,7 +28,9 @@ class Container
           wifi(&serial),
           comms(wifi, &serial),
           stats(comms, &serial),
-          settings(ram, &serial)
+          settings(ram, &serial),
+          store(ram, FRAM_STORE_ADDR, FRAM_STORE_SIZE),
+          journal(ram, FRAM_JOURNAL_ADDR, FRAM_JOURNAL_SIZE)
     {}
 
     [[nodiscard]] SerialComms& getSerial()
@@ -92,6 +103,31 @@ class Container
         return settings;
     }
 
+    /**
+     * General-purpose persistent store, for app state that doesn't belong in the settings.
+     *
+     * As with the settings, the FRAM must be re-initialised before use if the wifi has been used.
+     */
+    [[nodiscard]] Store& getStore()
+    {
+        return store;
+    }
+
+    [[nodiscard]] Store const& getStore() const
+    {
+        return store;
+    }
+
+    [[nodiscard]] EventJournal& getJournal()
+    {
+        return journal;
+    }
+
+    [[nodiscard]] EventJournal const& getJournal() const
+    {
+        return journal;
+    }
+
    protected:
     SerialComms serial;
     Fram ram;
@@ -101,6 +137,8 @@ class Container
     Comms comms;
     Stats stats;
     Settings settings;
+    Store store;
+    EventJournal journal;
 };
 
 }  // namespace dosa
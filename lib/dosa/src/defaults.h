@@ -0,0 +1,140 @@
+/**
+ * Default values for device settings.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Default device Bluetooth password.
+ */
+constexpr static char const* default_pin = "dosa";
+
+/**
+ * Minimum number of pixels that are considered 'changed' before we accept a trigger. Increase this to eliminate
+ * single-pixel or edge anomalies.
+ */
+constexpr static uint8_t default_pir_min_pixels = 3;
+
+/**
+ * Temp change (in Celsius) before considering any single pixel as "changed". This is a de-noising threshold, increase
+ * this number to reduce the amount of noise the algorithm is sensitive to.
+ */
+constexpr static float default_pir_pixel_delta = 1.5;
+
+/**
+ * The total temperature delta across all pixels before firing a trigger. This is the primary sensitivity metric, it
+ * is also filtered against noise by SENSOR_SINGLE_DELTA_THRESHOLD so it won't show a true full-grid delta.
+ */
+constexpr static float default_pir_total_delta = 25.0;
+
+/**
+ * Distance in mm the sonar should be <= when halting the door open sequence. The sonar should be reading the door's
+ * distance from its apex/threshold.
+ */
+constexpr static uint16_t default_door_open_distance = 500;
+
+/**
+ * Time in milliseconds the door spends in then open-wait status, holding in an open position before closing again.
+ */
+constexpr static uint32_t default_door_open_wait = 3000;
+
+/**
+ * Time in milliseconds we wait before allowing further action after a trigger sequence.
+ */
+constexpr static uint32_t default_door_cool_down = 3000;
+
+/**
+ * Fixed number of ticks we close the door for. This will translate to an approximate distance, it should be a small
+ * amount greater than required.
+ */
+constexpr static uint32_t default_door_close_ticks = 15000;
+
+/**
+ * Proportional gain of the winch speed loop, in PWM steps per tick/s of speed error.
+ */
+constexpr static float default_door_pid_kp = 0.02;
+
+/**
+ * Integral gain of the winch speed loop, in PWM steps per tick of accumulated speed error.
+ */
+constexpr static float default_door_pid_ki = 0.2;
+
+/**
+ * Derivative gain of the winch speed loop, in PWM steps per tick/s^2.
+ */
+constexpr static float default_door_pid_kd = 0;
+
+/**
+ * Cruise speed of the winch in encoder ticks per second. Set to zero to disable closed-loop control and drive the motor
+ * at a fixed power, as older builds did.
+ *
+ * Should be comfortably below the speed the winch reaches at full power (logged as "max TPS" after each open).
+ */
+constexpr static uint16_t default_door_max_speed = 0;
+
+/**
+ * Peak acceleration of the winch motion profile, in ticks/s^2.
+ */
+constexpr static uint32_t default_door_accel = 20000;
+
+/**
+ * Motion profile shape, 0 for trapezoidal (constant acceleration), 1 for an S-curve.
+ */
+constexpr static uint8_t default_door_profile = 1;
+
+/**
+ * Number of consecutive reads with a reduced distance before firing the trigger.
+ *
+ * Increase to reduce noise.
+ */
+constexpr static uint16_t default_range_trigger_threshold = 3;
+
+/**
+ * Percentage of previous distance that's considered a trigger.
+ *
+ * Set to zero to derive the coefficient automatically from the noise of the resting distance.
+ */
+constexpr static float default_range_trigger_coefficient = 0;
+
+/**
+ * Fixed distance for the sonar resting state. Set to zero for automatic detection.
+ *
+ * Automatic detection learns the median resting distance, you may still wish to set this value for devices where the
+ * background is rarely clear.
+ */
+constexpr static uint16_t default_range_fixed_calibration = 0;
+
+/**
+ * Number of reads in the sliding median applied to the ranging sensor. Rejects spikes shorter than half the window, at
+ * the cost of adding half a window of latency. Set to 1 to disable.
+ */
+constexpr static uint8_t default_range_median_window = 3;
+
+/**
+ * Kalman process noise for the ranging filter, as an acceleration variance in (mm/s^2)^2. Increase to track fast
+ * movement more closely, decrease for a smoother distance.
+ */
+constexpr static float default_range_process_noise = 1000000.0;
+
+/**
+ * Kalman measurement noise for the ranging filter, as a variance in mm^2 of the sensor reading. Set to zero to disable
+ * the Kalman stage.
+ */
+constexpr static float default_range_measurement_noise = 100.0;
+
+/**
+ * Time the relay is active once triggered. If set to 0, the relay will be a toggle.
+ */
+constexpr static uint32_t default_relay_activation_time = 5000;
+
+/**
+ * Relay channels driven by the relay device, each on its own pin.
+ */
+constexpr static uint8_t default_relay_channels = 1;
+
+/**
+ * Hour offset from UTC that relay schedule windows are given in.
+ */
+constexpr static int8_t default_relay_timezone = 0;
@@ -7,6 +7,7 @@
 #include "config.h"
 #include "const.h"
 #include "container.h"
+#include "defaults.h"
 #include "fram.h"
 #include "grideye.h"
 #include "lights.h"
@@ -1,17 +1,29 @@
 /**
  * Adafruit FRAM via SPI.
+ *
+ * FRAM map:
+ *   0x0000  Settings slots, see settings_layout.h
+ *   0x0A00  Key/value store, see kv_store.h
+ *   0x1800  Event journal, see journal.h
  */
 
 #pragma once
 
 #include <Adafruit_FRAM_SPI.h>
 
+#include "block_reader.h"
 #include "loggable.h"
 
 #ifndef FRAM_CS_PIN
 #define FRAM_CS_PIN 10
 #endif
 
+#define FRAM_SIZE 8192
+#define FRAM_STORE_ADDR 0x0A00
+#define FRAM_STORE_SIZE 0x0E00
+#define FRAM_JOURNAL_ADDR 0x1800
+#define FRAM_JOURNAL_SIZE 0x0800
+
 namespace dosa {
 
 class Fram : public Loggable
@@ -69,19 +81,15 @@ class Fram : public Loggable
         }
 
         String v;
-        uint8_t c;
+        BlockReader<Fram> reader(*this, FRAM_SIZE);
 
-        while (true) {
-            c = ram.read8(addr);
+        while (addr < FRAM_SIZE) {
+            auto c = reader.read8(addr++);
             if (c == 0) {
                 break;
-            } else {
-                v += (char)c;
             }
 
-            if (++addr >= 8192) {
-                break;
-            }
+            v += (char)c;
         }
 
         return v;
@@ -11,8 +11,35 @@
 
 #include "loggable.h"
 
+/**
+ * Pin wired to the AMG8833 INT output (active low, open drain).
+ */
+#ifndef IR_GRID_INT_PIN
+#define IR_GRID_INT_PIN 3
+#endif
+
 namespace dosa {
 
+namespace {
+
+volatile bool int_ir_grid;
+
+/**
+ * Called by hardware interrupt when the IR grid asserts its INT pin.
+ */
+void intIrGrid()
+{
+    int_ir_grid = true;
+}
+
+}  // end anonymous namespace
+
+enum class IrInterruptMode : uint8_t
+{
+    DIFFERENCE = 0,  // Fire when any pixel changes between sensor frames by more than the thresholds
+    ABSOLUTE = 1,    // Fire when any pixel temperature is outside the thresholds
+};
+
 class IrGrid : public Loggable
 {
    public:
@@ -42,6 +69,72 @@ class IrGrid : public Loggable
         return ir.getDeviceTemperatureRaw();
     }
 
+    /**
+     * Program the interrupt thresholds and enable the INT pin.
+     *
+     * In DIFFERENCE mode the thresholds are the change in a pixel between sensor frames, in ABSOLUTE mode they are
+     * pixel temperatures. May be called again to re-program the thresholds.
+     */
+    void enableInterrupt(IrInterruptMode mode, float upper, float lower, float hysteresis)
+    {
+        ir.interruptPinDisable();
+
+        if (mode == IrInterruptMode::ABSOLUTE) {
+            ir.setInterruptModeAbsolute();
+        } else {
+            ir.setInterruptModeDifference();
+        }
+
+        ir.setUpperInterruptValue(upper);
+        ir.setLowerInterruptValue(lower);
+        ir.setInterruptHysteresis(hysteresis);
+
+        if (!interrupt_attached) {
+            pinMode(IR_GRID_INT_PIN, INPUT_PULLUP);
+            attachInterrupt(digitalPinToInterrupt(IR_GRID_INT_PIN), intIrGrid, FALLING);
+            interrupt_attached = true;
+        }
+
+        clearInterrupt();
+        ir.interruptPinEnable();
+    }
+
+    void disableInterrupt()
+    {
+        ir.interruptPinDisable();
+
+        if (interrupt_attached) {
+            detachInterrupt(digitalPinToInterrupt(IR_GRID_INT_PIN));
+            interrupt_attached = false;
+        }
+
+        int_ir_grid = false;
+    }
+
+    /**
+     * True if the INT pin has fired since the interrupt was last cleared.
+     *
+     * The pin is also read directly, the sensor holds it low while the interrupt condition persists.
+     */
+    [[nodiscard]] bool isInterruptPending() const
+    {
+        return interrupt_attached && (int_ir_grid || digitalRead(IR_GRID_INT_PIN) == LOW);
+    }
+
+    /**
+     * Release the INT pin, it will fire again on the next sensor frame that meets the interrupt condition.
+     */
+    void clearInterrupt()
+    {
+        int_ir_grid = false;
+        ir.clearInterruptFlag();
+    }
+
+    [[nodiscard]] bool isInterruptEnabled() const
+    {
+        return interrupt_attached;
+    }
+
     [[nodiscard]] GridEYE& getGridEye()
     {
         return ir;
@@ -49,6 +142,7 @@ class IrGrid : public Loggable
 
    protected:
     bool inited = false;
+    bool interrupt_attached = false;
     GridEYE ir{};
 };
 
@@ -0,0 +1,209 @@
+/**
+ * Event journal, a ring of fixed-size records in FRAM.
+ *
+ * Notable events (boots, triggers, security alerts, faults) are recorded as they happen, whether or not the network is
+ * up, so that a device's history can be recovered after an incident. Once the ring is full the oldest record is
+ * overwritten.
+ *
+ * Record layout (little-endian):
+ *   Offset  Size  Type      Detail
+ *   ----------------------------------
+ *   0       4     uint32    Sequence number, record N is held in slot N modulo the capacity
+ *   4       4     uint32    Uptime at the event, ms
+ *   8       2     uint16    Boot number, see App
+ *   10      1     uint8     Event, see JournalEvent
+ *   11      1     uint8     Check byte, the low byte of the CRC-32 of the other 15 bytes
+ *   12      4     uint32    Detail, specific to the event
+ *
+ * A torn record fails its check byte and is ignored, the sequence then continues from the last good record.
+ *
+ * Page layout, as sent in a JOURNAL status message:
+ *   Offset  Size  Type      Detail
+ *   ----------------------------------
+ *   0       1     uint8     Device state
+ *   1       1     uint8     Journal version
+ *   2       4     uint32    Sequence number of the oldest record held
+ *   6       4     uint32    Sequence number the next record will take
+ *   10      4     uint32    Sequence number to request the following page from
+ *   14      1     uint8     Number of records in the page
+ *   15      ...   ...       Records, in sequence order
+ *
+ * `Storage` must provide `read(uint32_t addr, void* dest, size_t size)` and
+ * `write(uint32_t addr, void const* src, size_t size)`.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "block_reader.h"
+#include "crc32.h"
+
+#define JOURNAL_VERSION 1
+#define JOURNAL_RECORD_SIZE 16
+#define JOURNAL_PAGE_HEADER_SIZE 15
+#define JOURNAL_PAGE_RECORDS 32
+#define JOURNAL_PAGE_SIZE (JOURNAL_PAGE_HEADER_SIZE + JOURNAL_PAGE_RECORDS * JOURNAL_RECORD_SIZE)
+
+namespace dosa {
+
+enum class JournalEvent : uint8_t
+{
+    BOOT = 1,      // Device started; detail is 1 if the settings loaded clean
+    TRIGGER = 2,   // Trigger sent (detail 1) or accepted (detail 0)
+    SECURITY = 3,  // Security alert sent; detail is the SecurityLevel
+    FAULT = 4,     // Device fault; detail is app specific, eg the DoorErrorCode
+    LOCK = 5,      // Lock state changed; detail is the new LockState
+    LINK = 6,      // Wifi lost (detail 0) or restored (detail 1)
+};
+
+struct JournalRecord
+{
+    uint32_t sequence;
+    uint32_t time;
+    uint16_t boot;
+    JournalEvent event;
+    uint8_t check;
+    uint32_t detail;
+
+    [[nodiscard]] uint8_t getCheck() const
+    {
+        Crc32 crc;
+        crc.update(this, 11);
+        crc.update(&detail, 4);
+        return crc.getValue() & 0xFF;
+    }
+};
+
+static_assert(sizeof(JournalRecord) == JOURNAL_RECORD_SIZE, "Journal record is not packed");
+
+template <class Storage>
+class Journal
+{
+   public:
+    /**
+     * Journal held in `size` bytes of `storage` from `base`.
+     */
+    Journal(Storage& storage, uint32_t base, uint32_t size)
+        : storage(storage),
+          base(base),
+          capacity(size / JOURNAL_RECORD_SIZE)
+    {}
+
+    /**
+     * Find the newest record, so that the sequence continues from it.
+     */
+    void mount()
+    {
+        BlockReader<Storage> reader(storage, base + capacity * JOURNAL_RECORD_SIZE);
+        bool found = false;
+
+        for (uint32_t i = 0; i < capacity; ++i) {
+            JournalRecord rec;
+            reader.read(base + i * JOURNAL_RECORD_SIZE, &rec, JOURNAL_RECORD_SIZE);
+            if (!isValid(rec, i)) {
+                continue;
+            }
+
+            if (!found || int32_t(rec.sequence - next) >= 0) {
+                next = rec.sequence + 1;
+                found = true;
+            }
+        }
+
+        if (!found) {
+            next = 0;
+        }
+
+        mounted = true;
+    }
+
+    /**
+     * Record an `event` at uptime `time` of boot number `boot`.
+     */
+    void append(JournalEvent event, uint32_t detail, uint32_t time, uint16_t boot)
+    {
+        if (!mounted) {
+            return;
+        }
+
+        JournalRecord rec{next, time, boot, event, 0, detail};
+        rec.check = rec.getCheck();
+        storage.write(getAddress(next), &rec, JOURNAL_RECORD_SIZE);
+        ++next;
+    }
+
+    /**
+     * Sequence number of the oldest record held.
+     */
+    [[nodiscard]] uint32_t getOldest() const
+    {
+        return next > capacity ? next - capacity : 0;
+    }
+
+    /**
+     * Sequence number the next record will take, also the total number of records written.
+     */
+    [[nodiscard]] uint32_t getNext() const
+    {
+        return next;
+    }
+
+    [[nodiscard]] uint32_t getCapacity() const
+    {
+        return capacity;
+    }
+
+    /**
+     * Pack a page of up to JOURNAL_PAGE_RECORDS records, from sequence number `from` (or the oldest held if that has
+     * since been overwritten), into `out` of JOURNAL_PAGE_SIZE bytes. Returns the size of the page.
+     */
+    uint16_t packPage(uint32_t from, uint8_t state, uint8_t* out)
+    {
+        uint32_t oldest = getOldest();
+        if (int32_t(from - oldest) < 0) {
+            from = oldest;
+        }
+
+        uint8_t count = 0;
+        uint32_t seq = from;
+        BlockReader<Storage> reader(storage, base + capacity * JOURNAL_RECORD_SIZE);
+        for (; int32_t(next - seq) > 0 && count < JOURNAL_PAGE_RECORDS; ++seq) {
+            JournalRecord rec;
+            reader.read(getAddress(seq), &rec, JOURNAL_RECORD_SIZE);
+            if (isValid(rec, seq % capacity) && rec.sequence == seq) {
+                memcpy(out + JOURNAL_PAGE_HEADER_SIZE + count * JOURNAL_RECORD_SIZE, &rec, JOURNAL_RECORD_SIZE);
+                ++count;
+            }
+        }
+
+        out[0] = state;
+        out[1] = JOURNAL_VERSION;
+        memcpy(out + 2, &oldest, 4);
+        memcpy(out + 6, &next, 4);
+        memcpy(out + 10, &seq, 4);
+        out[14] = count;
+
+        return JOURNAL_PAGE_HEADER_SIZE + count * JOURNAL_RECORD_SIZE;
+    }
+
+   private:
+    Storage& storage;
+    uint32_t base;
+    uint32_t capacity;
+    uint32_t next = 0;
+    bool mounted = false;
+
+    [[nodiscard]] uint32_t getAddress(uint32_t sequence) const
+    {
+        return base + (sequence % capacity) * JOURNAL_RECORD_SIZE;
+    }
+
+    [[nodiscard]] bool isValid(JournalRecord const& rec, uint32_t slot) const
+    {
+        return rec.check == rec.getCheck() && rec.sequence % capacity == slot && rec.event != JournalEvent(0);
+    }
+};
+
+}  // namespace dosa
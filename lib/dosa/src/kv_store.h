@@ -0,0 +1,511 @@
+/**
+ * Log-structured key/value store, for apps to persist their own state without changing the settings layout.
+ *
+ * The store's region is split into two halves, only one of which is live. Each half begins with a header:
+ *   Offset  Size  Type      Detail
+ *   ----------------------------------
+ *   0       4     char      Magic, "KV01"
+ *   4       4     uint32    Generation, incremented with each compaction
+ *
+ * followed by a log of records:
+ *   Offset  Size  Type      Detail
+ *   ----------------------------------
+ *   0       1     uint8     Record marker
+ *   1       1     uint8     Key length
+ *   2       2     uint16    Value length, KV_STORE_REMOVED for a removed key
+ *   4       4     uint32    CRC-32 of bytes 1-3, the key and the value
+ *   8       ?     char      Key
+ *   ?       ?     bytes     Value
+ *
+ * Setting or removing a key appends a record, and the newest record for a key wins. The byte after the last record is
+ * kept zero, and an append writes the zero following its record first and its marker last, so the log always ends at
+ * either the old or the new record however a power cut falls. The log ends at the first record that fails its checks.
+ * When a half fills, its live records are copied to the other half, whose header is written last to make it live.
+ *
+ * An index of key hashes to record offsets is kept in memory, so a lookup reads only the record it needs.
+ *
+ * `Storage` must provide `read(uint32_t addr, void* dest, size_t size)` and
+ * `write(uint32_t addr, void const* src, size_t size)`.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "block_reader.h"
+#include "crc32.h"
+
+#define KV_STORE_MAGIC "KV01"
+#define KV_STORE_HEADER_SIZE 8
+#define KV_STORE_RECORD_MARKER 0xA5
+#define KV_STORE_RECORD_HEADER_SIZE 8
+#define KV_STORE_REMOVED 0xFFFF
+#define KV_STORE_MAX_KEYS 32
+#define KV_STORE_MAX_KEY_SIZE 24
+#define KV_STORE_MAX_VALUE_SIZE 256
+
+namespace dosa {
+
+template <class Storage>
+class KvStore
+{
+   public:
+    /**
+     * Store held in `size` bytes of `storage` from `base`.
+     */
+    KvStore(Storage& storage, uint32_t base, uint32_t size) : storage(storage), base(base), half_size(size / 2) {}
+
+    /**
+     * Find the live half and index its records. Formats the store if neither half is valid.
+     */
+    void mount()
+    {
+        Header headers[2];
+        bool valid[2];
+        for (uint8_t i = 0; i < 2; ++i) {
+            storage.read(getHalfAddress(i), &headers[i], KV_STORE_HEADER_SIZE);
+            valid[i] = memcmp(headers[i].magic, KV_STORE_MAGIC, 4) == 0;
+        }
+
+        count = 0;
+
+        if (!valid[0] && !valid[1]) {
+            live = 0;
+            generation = 1;
+            end = KV_STORE_HEADER_SIZE;
+            terminate();
+            writeHeader(live);
+            mounted = true;
+            return;
+        }
+
+        if (valid[0] && valid[1]) {
+            live = int32_t(headers[1].generation - headers[0].generation) > 0 ? 1 : 0;
+        } else {
+            live = valid[0] ? 0 : 1;
+        }
+
+        generation = headers[live].generation;
+        scan();
+        mounted = true;
+    }
+
+    /**
+     * Read the value of `key` into `dest`, up to `max` bytes. Returns the size of the value, or -1 if not set.
+     */
+    int32_t get(char const* key, void* dest, uint16_t max)
+    {
+        auto entry = find(key);
+        if (entry == nullptr) {
+            return -1;
+        }
+
+        RecordHeader rec;
+        uint32_t addr = getHalfAddress(live) + entry->offset;
+        storage.read(addr, &rec, KV_STORE_RECORD_HEADER_SIZE);
+        uint16_t size = rec.value_size < max ? rec.value_size : max;
+        storage.read(addr + KV_STORE_RECORD_HEADER_SIZE + rec.key_size, dest, size);
+
+        return rec.value_size;
+    }
+
+    /**
+     * Typed read, returns false and leaves `value` untouched if `key` is not set or not the size of `T`.
+     */
+    template <class T>
+    bool get(char const* key, T& value)
+    {
+        T v;
+        if (get(key, &v, sizeof(T)) != sizeof(T)) {
+            return false;
+        }
+
+        value = v;
+        return true;
+    }
+
+    [[nodiscard]] bool has(char const* key)
+    {
+        return find(key) != nullptr;
+    }
+
+    /**
+     * Set `key` to `size` bytes of `value`. Nothing is written if the value is unchanged.
+     *
+     * Returns false if the key or value is too large, or the store is full.
+     */
+    bool set(char const* key, void const* value, uint16_t size)
+    {
+        size_t key_size = strlen(key);
+        if (!mounted || key_size == 0 || key_size > KV_STORE_MAX_KEY_SIZE || size > KV_STORE_MAX_VALUE_SIZE) {
+            return false;
+        }
+
+        auto entry = find(key);
+        if (entry != nullptr && matches(*entry, value, size)) {
+            return true;
+        }
+
+        if (entry == nullptr && count == KV_STORE_MAX_KEYS) {
+            return false;
+        }
+
+        uint32_t record_size = KV_STORE_RECORD_HEADER_SIZE + key_size + size;
+        if (end + record_size > half_size && (!compact() || end + record_size > half_size)) {
+            return false;
+        }
+
+        // Compaction moves records, find the entry again
+        entry = find(key);
+        uint16_t offset = end;
+        append(key, key_size, value, size);
+
+        if (entry == nullptr) {
+            entry = &index[count++];
+            entry->hash = hash(key, key_size);
+        }
+        entry->offset = offset;
+
+        return true;
+    }
+
+    template <class T>
+    bool set(char const* key, T const& value)
+    {
+        return set(key, &value, sizeof(T));
+    }
+
+    /**
+     * Remove `key`, returns false if a removal record could not be written.
+     */
+    bool remove(char const* key)
+    {
+        auto entry = find(key);
+        if (entry == nullptr) {
+            return true;
+        }
+
+        *entry = index[--count];
+
+        size_t key_size = strlen(key);
+        if (end + KV_STORE_RECORD_HEADER_SIZE + key_size > half_size) {
+            // No room for a removal record, compaction leaves the key behind instead
+            return compact();
+        }
+
+        append(key, key_size, nullptr, KV_STORE_REMOVED);
+        return true;
+    }
+
+    /**
+     * Copy the live records to the other half, dropping superseded and removed records.
+     */
+    bool compact()
+    {
+        if (!mounted) {
+            return false;
+        }
+
+        uint8_t target = live ^ 1;
+        uint32_t from = getHalfAddress(live);
+        uint32_t to = getHalfAddress(target);
+
+        // The target must not be mistaken for the live half until it is complete
+        uint8_t blank[4] = {0};
+        storage.write(to, blank, 4);
+
+        uint32_t pos = KV_STORE_HEADER_SIZE;
+        uint8_t buffer[32];
+        for (uint8_t i = 0; i < count; ++i) {
+            RecordHeader rec;
+            storage.read(from + index[i].offset, &rec, KV_STORE_RECORD_HEADER_SIZE);
+            uint32_t size = KV_STORE_RECORD_HEADER_SIZE + rec.key_size + rec.value_size;
+
+            for (uint32_t copied = 0; copied < size; copied += sizeof(buffer)) {
+                uint32_t chunk = size - copied < sizeof(buffer) ? size - copied : sizeof(buffer);
+                storage.read(from + index[i].offset + copied, buffer, chunk);
+                storage.write(to + pos + copied, buffer, chunk);
+            }
+
+            index[i].offset = pos;
+            pos += size;
+        }
+
+        live = target;
+        ++generation;
+        end = pos;
+        terminate();
+        writeHeader(live);
+        ++compactions;
+
+        return true;
+    }
+
+    /**
+     * Number of keys set.
+     */
+    [[nodiscard]] uint8_t size() const
+    {
+        return count;
+    }
+
+    /**
+     * Bytes left in the live half before a compaction is required.
+     */
+    [[nodiscard]] uint32_t getFree() const
+    {
+        return half_size - end;
+    }
+
+    /**
+     * Compactions since mounting.
+     */
+    [[nodiscard]] uint32_t getCompactions() const
+    {
+        return compactions;
+    }
+
+   private:
+    struct Header
+    {
+        char magic[4];
+        uint32_t generation;
+    };
+
+    struct RecordHeader
+    {
+        uint8_t marker;
+        uint8_t key_size;
+        uint16_t value_size;
+        uint32_t crc;
+    };
+
+    struct Entry
+    {
+        uint16_t hash;
+        uint16_t offset;  // Of the newest record, from the start of the live half
+    };
+
+    static_assert(sizeof(Header) == KV_STORE_HEADER_SIZE, "Store header is not packed");
+    static_assert(sizeof(RecordHeader) == KV_STORE_RECORD_HEADER_SIZE, "Record header is not packed");
+
+    Storage& storage;
+    uint32_t base;
+    uint32_t half_size;
+    bool mounted = false;
+    uint8_t live = 0;
+    uint32_t generation = 0;
+    uint32_t end = 0;  // Offset of the end of the log in the live half
+    uint32_t compactions = 0;
+    Entry index[KV_STORE_MAX_KEYS] = {};
+    uint8_t count = 0;
+
+    [[nodiscard]] uint32_t getHalfAddress(uint8_t half) const
+    {
+        return base + half * half_size;
+    }
+
+    /**
+     * 16-bit FNV-1a hash of a key, collisions are resolved by comparing the stored key.
+     */
+    static uint16_t hash(char const* key, size_t size)
+    {
+        uint32_t h = 2166136261;
+        for (size_t i = 0; i < size; ++i) {
+            h = (h ^ uint8_t(key[i])) * 16777619;
+        }
+
+        return uint16_t(h ^ (h >> 16));
+    }
+
+    Entry* find(char const* key)
+    {
+        size_t key_size = strlen(key);
+        if (key_size == 0 || key_size > KV_STORE_MAX_KEY_SIZE) {
+            return nullptr;
+        }
+
+        auto h = hash(key, key_size);
+        for (uint8_t i = 0; i < count; ++i) {
+            if (index[i].hash != h) {
+                continue;
+            }
+
+            RecordHeader rec;
+            char stored[KV_STORE_MAX_KEY_SIZE];
+            uint32_t addr = getHalfAddress(live) + index[i].offset;
+            storage.read(addr, &rec, KV_STORE_RECORD_HEADER_SIZE);
+            if (rec.key_size != key_size) {
+                continue;
+            }
+
+            storage.read(addr + KV_STORE_RECORD_HEADER_SIZE, stored, key_size);
+            if (memcmp(stored, key, key_size) == 0) {
+                return &index[i];
+            }
+        }
+
+        return nullptr;
+    }
+
+    /**
+     * True if the record for `entry` already holds `value`.
+     */
+    bool matches(Entry const& entry, void const* value, uint16_t size)
+    {
+        RecordHeader rec;
+        uint32_t addr = getHalfAddress(live) + entry.offset;
+        storage.read(addr, &rec, KV_STORE_RECORD_HEADER_SIZE);
+        if (rec.value_size != size) {
+            return false;
+        }
+
+        addr += KV_STORE_RECORD_HEADER_SIZE + rec.key_size;
+        auto const* ptr = static_cast<uint8_t const*>(value);
+        uint8_t buffer[32];
+        for (uint16_t pos = 0; pos < size; pos += sizeof(buffer)) {
+            uint16_t chunk = size - pos < uint16_t(sizeof(buffer)) ? size - pos : sizeof(buffer);
+            storage.read(addr + pos, buffer, chunk);
+            if (memcmp(buffer, ptr + pos, chunk) != 0) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Append a record to the live half, `size` being KV_STORE_REMOVED for a removal.
+     */
+    void append(char const* key, size_t key_size, void const* value, uint16_t size)
+    {
+        uint16_t value_size = size == KV_STORE_REMOVED ? 0 : size;
+
+        uint8_t head[KV_STORE_RECORD_HEADER_SIZE + KV_STORE_MAX_KEY_SIZE];
+        RecordHeader rec{KV_STORE_RECORD_MARKER, uint8_t(key_size), size, 0};
+
+        Crc32 crc;
+        crc.update(&rec.key_size, 3);
+        crc.update(key, key_size);
+        crc.update(value, value_size);
+        rec.crc = crc.getValue();
+
+        memcpy(head, &rec, KV_STORE_RECORD_HEADER_SIZE);
+        memcpy(head + KV_STORE_RECORD_HEADER_SIZE, key, key_size);
+
+        uint32_t addr = getHalfAddress(live) + end;
+        uint32_t head_size = KV_STORE_RECORD_HEADER_SIZE + key_size;
+
+        // Terminate first, so the log never runs on into stale records
+        end += head_size + value_size;
+        terminate();
+
+        // The marker replaces the old terminator last, until then the log ends before this record
+        storage.write(addr + 1, head + 1, head_size - 1);
+        if (value_size > 0) {
+            storage.write(addr + head_size, value, value_size);
+        }
+        storage.write(addr, head, 1);
+    }
+
+    /**
+     * Zero the byte following the log, if there is room for one.
+     */
+    void terminate()
+    {
+        if (end < half_size) {
+            uint8_t zero = 0;
+            storage.write(getHalfAddress(live) + end, &zero, 1);
+        }
+    }
+
+    void writeHeader(uint8_t half)
+    {
+        Header header;
+        memcpy(header.magic, KV_STORE_MAGIC, 4);
+        header.generation = generation;
+        storage.write(getHalfAddress(half), &header, KV_STORE_HEADER_SIZE);
+    }
+
+    /**
+     * Index the records of the live half, finding the end of the log.
+     */
+    void scan()
+    {
+        uint32_t half = getHalfAddress(live);
+        BlockReader<Storage> reader(storage, half + half_size);
+        end = KV_STORE_HEADER_SIZE;
+
+        while (end + KV_STORE_RECORD_HEADER_SIZE <= half_size) {
+            RecordHeader rec;
+            reader.read(half + end, &rec, KV_STORE_RECORD_HEADER_SIZE);
+
+            uint16_t value_size = rec.value_size == KV_STORE_REMOVED ? 0 : rec.value_size;
+            uint32_t size = KV_STORE_RECORD_HEADER_SIZE + rec.key_size + value_size;
+            if (rec.marker != KV_STORE_RECORD_MARKER || rec.key_size == 0 || rec.key_size > KV_STORE_MAX_KEY_SIZE ||
+                value_size > KV_STORE_MAX_VALUE_SIZE || end + size > half_size) {
+                break;
+            }
+
+            char key[KV_STORE_MAX_KEY_SIZE];
+            reader.read(half + end + KV_STORE_RECORD_HEADER_SIZE, key, rec.key_size);
+
+            Crc32 crc;
+            crc.update(&rec.key_size, 3);
+            crc.update(key, rec.key_size);
+            uint8_t buffer[32];
+            uint32_t value_addr = half + end + KV_STORE_RECORD_HEADER_SIZE + rec.key_size;
+            for (uint16_t pos = 0; pos < value_size; pos += sizeof(buffer)) {
+                uint16_t chunk = value_size - pos < uint16_t(sizeof(buffer)) ? value_size - pos : sizeof(buffer);
+                reader.read(value_addr + pos, buffer, chunk);
+                crc.update(buffer, chunk);
+            }
+
+            if (crc.getValue() != rec.crc) {
+                break;
+            }
+
+            indexRecord(key, rec.key_size, end, rec.value_size == KV_STORE_REMOVED);
+            end += size;
+        }
+    }
+
+    /**
+     * Point the index entry for `key` at the record at `offset`, or drop it for a removal.
+     */
+    void indexRecord(char const* key, uint8_t key_size, uint32_t offset, bool removed)
+    {
+        auto h = hash(key, key_size);
+        Entry* entry = nullptr;
+
+        for (uint8_t i = 0; i < count; ++i) {
+            if (index[i].hash != h) {
+                continue;
+            }
+
+            // Compare against the key of the indexed record
+            uint8_t stored_size;
+            char stored[KV_STORE_MAX_KEY_SIZE];
+            uint32_t addr = getHalfAddress(live) + index[i].offset;
+            storage.read(addr + 1, &stored_size, 1);
+            storage.read(addr + KV_STORE_RECORD_HEADER_SIZE, stored, stored_size);
+            if (stored_size == key_size && memcmp(stored, key, key_size) == 0) {
+                entry = &index[i];
+                break;
+            }
+        }
+
+        if (removed) {
+            if (entry != nullptr) {
+                *entry = index[--count];
+            }
+        } else if (entry != nullptr) {
+            entry->offset = offset;
+        } else if (count < KV_STORE_MAX_KEYS) {
+            index[count++] = {h, uint16_t(offset)};
+        }
+    }
+};
+
+}  // namespace dosa
@@ -3,80 +3,17 @@
 #include <Arduino.h>
 #include <dosa_comms.h>
 
+#include "block_reader.h"
 #include "const.h"
+#include "crc32.h"
+#include "defaults.h"
+#include "settings_layout.h"
 
-#define DOSA_SETTINGS_HEADER "DS23"
-
-/**
- * Default device Bluetooth password.
- */
-constexpr static char const* default_pin = "dosa";
-
-/**
- * Minimum number of pixels that are considered 'changed' before we accept a trigger. Increase this to eliminate
- * single-pixel or edge anomalies.
- */
-constexpr static uint8_t default_pir_min_pixels = 3;
-
-/**
- * Temp change (in Celsius) before considering any single pixel as "changed". This is a de-noising threshold, increase
- * this number to reduce the amount of noise the algorithm is sensitive to.
- */
-constexpr static float default_pir_pixel_delta = 1.5;
-
-/**
- * The total temperature delta across all pixels before firing a trigger. This is the primary sensitivity metric, it
- * is also filtered against noise by SENSOR_SINGLE_DELTA_THRESHOLD so it won't show a true full-grid delta.
- */
-constexpr static float default_pir_total_delta = 25.0;
-
-/**
- * Distance in mm the sonar should be <= when halting the door open sequence. The sonar should be reading the door's
- * distance from its apex/threshold.
- */
-constexpr static uint16_t default_door_open_distance = 500;
-
-/**
- * Time in milliseconds the door spends in then open-wait status, holding in an open position before closing again.
- */
-constexpr static uint32_t default_door_open_wait = 3000;
-
-/**
- * Time in milliseconds we wait before allowing further action after a trigger sequence.
- */
-constexpr static uint32_t default_door_cool_down = 3000;
-
-/**
- * Fixed number of ticks we close the door for. This will translate to an approximate distance, it should be a small
- * amount greater than required.
- */
-constexpr static uint32_t default_door_close_ticks = 15000;
-
-/**
- * Number of consecutive reads with a reduced distance before firing the trigger.
- *
- * Increase to reduce noise.
- */
-constexpr static uint16_t default_range_trigger_threshold = 3;
-
-/**
- * Percentage of previous distance that's considered a trigger.
- */
-constexpr static float default_range_trigger_coefficient = 0.9;
-
-/**
- * Fixed distance for the sonar resting state. Set to zero for automatic detection.
- *
- * Recommended you set this value for outdoor devices, or devices aiming at non-perpendicular or non-solid surfaces.
- */
-constexpr static uint16_t default_range_fixed_calibration = 0;
-
-/**
- * Time the relay is active once triggered. If set to 0, the relay will be a toggle.
- */
-constexpr static uint32_t default_relay_activation_time = 5000;
+#define DOSA_SETTINGS_HEADER "DS24"      // DS followed by SETTINGS_VERSION
+#define DOSA_SETTINGS_LEGACY_VERSION 23  // Last version stored as a sequential blob, see loadLegacy()
 
 #define DOSA_SETTINGS_OVERSIZE_READ "#ERR-OVERSIZE"
+#define DOSA_SETTINGS_RELAY_SCHEDULE_SIZE 48
 constexpr static char const* current_settings_header = DOSA_SETTINGS_HEADER;
 constexpr static char const* null_str = "";
 constexpr static uint8_t zero_8 = 0;
@@ -85,33 +22,13 @@ constexpr static uint16_t zero_16 = 0;
 namespace dosa {
 
 /**
- * Structure of settings:
- *   Size   Type      Detail
- *   ----------------------------------
- *   1      char      Header - validates we've got a DOSA settings stored (and correct version)
- *   1      uint8     Device lock state
- *   2      uint16    Size of device password
- *   ?      char      Device password (aka pin)
- *   2      uint16    Size of device name
- *   ?      char      Device name
- *   2      uint16    Size of wifi SSID
- *   ?      char      Wifi SSID
- *   2      uint16    Size of wifi password
- *   ?      char      Wifi password
- *   2      uint16    Size of log server address
- *   ?      char      Log server address
- *   2      uint16    Log server port
- *   1      uint8     PIR cfg: PIR_MIN_PIXELS_THRESHOLD
- *   4      float     PIR cfg: PIR_SINGLE_DELTA_THRESHOLD
- *   4      float     PIR cfg: PIR_TOTAL_DELTA_THRESHOLD
- *   2      uint16    Door cfg: DOOR_OPEN_DISTANCE
- *   4      uint32    Door cfg: DOOR_OPEN_WAIT_TIME
- *   4      uint32    Door cfg: DOOR_COOL_DOWN
- *   4      uint32    Door cfg: DOOR_CLOSE_TICKS
- *   2      uint16    Range cfg: RANGE_TRIGGER_THRESHOLD
- *   2      uint16    Range cfg: RANGE_FIXED_CALIBRATION
- *   4      float     Range cfg: RANGE_TRIGGER_COEFFICIENT
- *   4      float     Relay cfg: RELAY_ACTIVATION_TIME
+ * Device settings, persisted to FRAM.
+ *
+ * FRAM holds two slots, each with a header and a copy of the settings image as laid out by SettingsLayout. Each save
+ * goes to the older slot and is committed by writing its header last, so a power cut mid-save leaves the newer slot
+ * intact. Setters mark their field dirty, and save() writes only the fields the target slot is missing.
+ *
+ * Builds up to DS23 stored a sequential blob instead, which is upgraded on first load, see loadLegacy().
  */
 class Settings : public Loggable
 {
@@ -120,13 +37,17 @@ class Settings : public Loggable
     {
         // The floating-point values for sensor config are expected to be 32-bit
         static_assert(sizeof(float) == 4, "Float size is not 4");
+        static_assert(
+            SettingsLayout::getCapacity(SettingsField::RELAY_SCHEDULE) == DOSA_SETTINGS_RELAY_SCHEDULE_SIZE,
+            "Relay schedule does not fit the settings layout");
     }
 
     /**
      * Load values from FRAM.
      *
-     * If the header is a mismatch, or any data appears corrupt, default values will be loaded for everything.
-     * Returns true if settings were loaded clean, false if there are issues and defaults were used.
+     * The newest slot passing its CRC is loaded. If neither slot holds valid settings, default values will be loaded
+     * for everything. Returns true if settings were loaded clean, false if there are issues and defaults were used, or
+     * the settings were upgraded from an older build.
      *
      * If re_init is true, the FRAM will be re-initialised first. See reInitRam().
      */
@@ -136,130 +57,58 @@ class Settings : public Loggable
             reInitRam();
         }
 
-        String currentSettingsVersion = ram.readHeader();
-        auto c_ver = getSettingsVersion(currentSettingsVersion);
-        bool upgrading = false;
-
-        if (currentSettingsVersion != current_settings_header) {
-            // Settings missing or out-of-date
-            if (canUpgrade(currentSettingsVersion)) {
-                upgrading = true;
-                logln("Upgrading settings from previous build", dosa::LogLevel::WARNING);
-            } else {
-                logln("FRAM header incorrect, using default settings", dosa::LogLevel::WARNING);
-                setDefaults();
-                return false;
-            }
-        }
+        // Whatever is loaded, the first save must fill in the other slot
+        active_slot = 0;
+        generation = 0;
+        pending.markAll();
 
-        uint32_t ptr = 4;  // Size of header
-
-        auto read_block = [this, &ptr, c_ver](String& s, uint8_t req_ver = 0, char const* src = nullptr) -> bool {
-            if (req_ver > 0 && c_ver < req_ver) {
-                s = String(src);
-                return true;
-            }
+        SettingsSlotHeader headers[SETTINGS_SLOT_COUNT];
+        bool current[SETTINGS_SLOT_COUNT];
+        for (uint8_t i = 0; i < SETTINGS_SLOT_COUNT; ++i) {
+            ram.read(SettingsSlots::getAddress(i), &headers[i], SETTINGS_SLOT_HEADER_SIZE);
+            current[i] = SettingsSlots::isCurrent(headers[i]);
+        }
 
-            s = readVarChar(ptr);
-            if (s == DOSA_SETTINGS_OVERSIZE_READ) {
-                logln("Oversize read warning", LogLevel::ERROR);
-                return false;
+        auto first = SettingsSlots::select(current[0], headers[0].generation, current[1], headers[1].generation);
+        if (first >= 0) {
+            if (loadSlot(first, headers[first])) {
+                return validate();
             }
-            ptr += s.length() + 2;
-            return true;
-        };
 
-        auto read_var = [this, &ptr, c_ver](void* s, size_t size, uint8_t req_ver = 0, void* src = nullptr) -> void {
-            if (req_ver > 0 && c_ver < req_ver) {
-                memcpy(s, src, size);
-                return;
+            uint8_t second = first ^ 1;
+            if (current[second] && loadSlot(second, headers[second])) {
+                logln("Settings slot " + String(first) + " corrupt, using previous settings", LogLevel::WARNING);
+                return validate();
             }
 
-            ram.read(ptr, (uint8_t*)s, size);
-            ptr += size;
-        };
-
-        read_var(&locked, 1, 20, (void*)(&zero_8));
-
-        if (!read_block(pin)) {
-            logln("Bad read: PIN", LogLevel::ERROR);
-            setDefaults();
-            return false;
-        }
-
-        if (!read_block(device_name)) {
-            logln("Bad read: device name", LogLevel::ERROR);
-            setDefaults();
-            return false;
-        }
-
-        if (!read_block(wifi_ssid)) {
-            logln("Bad read: wifi SSID", LogLevel::ERROR);
-            setDefaults();
-            return false;
-        }
-
-        if (!read_block(wifi_password)) {
-            logln("Bad read: wifi password", LogLevel::ERROR);
+            logln("Settings corrupt, using default settings", LogLevel::ERROR);
             setDefaults();
             return false;
         }
 
-        if (!read_block(stats_server_addr, 23, null_str)) {
-            logln("Bad read: stats server", LogLevel::ERROR);
-            setDefaults();
-            return false;
-        }
-        read_var(&stats_server_port, 2, 23, (void*)(&zero_16));
-
-        read_var(&pir_min_pixels, 1);
-        read_var(&pir_pixel_delta, 4);
-        read_var(&pir_total_delta, 4);
-
-        read_var(&door_open_distance, 2);
-        read_var(&door_open_wait, 4);
-        read_var(&door_cool_down, 4);
-        read_var(&door_close_ticks, 4);
-
-        read_var(&range_trigger_threshold, 2);
-        read_var(&range_fixed_calibration, 2, 18, (void*)(&default_range_fixed_calibration));
-        read_var(&range_trigger_coefficient, 4, 19, (void*)(&default_range_trigger_coefficient));
-
-        read_var(&relay_activation_time, 4, 22, (void*)(&default_relay_activation_time));
-
-        if (!read_block(listen_devices, 21, null_str)) {
-            logln("Bad read: listen devices", LogLevel::ERROR);
+        // Settings missing or out-of-date
+        String currentSettingsVersion = ram.readHeader();
+        if (!canUpgrade(currentSettingsVersion)) {
+            logln("FRAM header incorrect, using default settings", dosa::LogLevel::WARNING);
             setDefaults();
             return false;
         }
 
-        // Validate values
-        bool valid = true;
+        logln("Upgrading settings from previous build", dosa::LogLevel::WARNING);
+        loadLegacy(getSettingsVersion(currentSettingsVersion));
 
-        if (pin == "") {
-            // Not allowed a blank pin
-            pin = default_pin;
-            logln("Device PIN invalid, resetting to default", LogLevel::ERROR);
-            valid = false;
-        }
-
-        if (device_name == "") {
-            // Device name cannot be blank
-            device_name = "DOSA " + String(random(1000, 9999));
-            logln("Device name invalid, creating new name", LogLevel::ERROR);
-            valid = false;
-        }
-
-        updateDeviceNameBytes();
-
-        // A save operation should be performed if validation failed, or we performed an upgrade
-        return valid && !upgrading;
+        // Both slots must be written in full, the first save goes to slot 1 leaving the old settings in place until
+        // it is committed
+        dirty.markAll();
+        return false;
     }
 
     /**
-     * Write currently set values to FRAM.
+     * Write changed values to FRAM.
      *
-     * If re_init is true, the FRAM will be re-initialised first. See reInitRam().
+     * Writes to the inactive slot the fields changed since the last save, plus those changed by the save before it
+     * which that slot never received. The CRC is built while the image is serialised, and the slot header written last
+     * commits the save. If re_init is true, the FRAM will be re-initialised first. See reInitRam().
      */
     void save(bool re_init = true)
     {
@@ -267,74 +116,34 @@ class Settings : public Loggable
             reInitRam();
         }
 
-        /**
-         * This is a safeguard to ensure we've correctly formatted the FRAM payload.
-         *
-         * Fixed length sizes:
-         *      4  Header
-         *   6x 2  Variable size markers
-         *      1  Locked state
-         *      2  Stats server port
-         *      9  PIR calibration
-         *     14  Door calibration
-         *      8  Range calibration
-         *      4  Relay calibration
-         * ---------------------------
-         *     54  Total fixed (not incl. string sizes)
-         */
-        size_t size = 54 + pin.length() + device_name.length() + wifi_ssid.length() + wifi_password.length() +
-                      stats_server_addr.length() + listen_devices.length();
-
-        uint8_t payload[size];
-        uint8_t* ptr = payload;
-
-        memcpy(ptr, current_settings_header, 4);
-        ptr += 4;
-
-        auto write_block = [&ptr](String const& s) {
-            size_t item_size = s.length();
-            memcpy(ptr, &item_size, 2);
-            memcpy(ptr + 2, s.c_str(), s.length());
-            ptr += item_size + 2;
-        };
-
-        auto write_var = [&ptr](void* value, size_t sz) {
-            memcpy(ptr, value, sz);
-            ptr += sz;
-        };
-
-        write_var(&locked, 1);
-        write_block(pin);
-        write_block(device_name);
-        write_block(wifi_ssid);
-        write_block(wifi_password);
-
-        write_block(stats_server_addr);
-        write_var(&stats_server_port, 2);
-
-        write_var(&pir_min_pixels, 1);
-        write_var(&pir_pixel_delta, 4);
-        write_var(&pir_total_delta, 4);
+        if (!dirty.any()) {
+            return;
+        }
 
-        write_var(&door_open_distance, 2);
-        write_var(&door_open_wait, 4);
-        write_var(&door_cool_down, 4);
-        write_var(&door_close_ticks, 4);
+        uint8_t target = active_slot ^ 1;
+        uint32_t image_addr = SettingsSlots::getAddress(target) + SETTINGS_SLOT_HEADER_SIZE;
+        SettingsDirty outdated = dirty;
+        outdated.merge(pending);
 
-        write_var(&range_trigger_threshold, 2);
-        write_var(&range_fixed_calibration, 2);
-        write_var(&range_trigger_coefficient, 4);
+        SettingsSlotHeader header;
+        memcpy(header.version, current_settings_header, 4);
+        header.generation = generation + 1;
 
-        write_var(&relay_activation_time, 4);
+        Crc32 crc;
+        crc.update(&header.generation, 4);
+        for (uint8_t i = 0; i < SettingsLayout::field_count; ++i) {
+            auto field = static_cast<SettingsField>(i);
+            writeField(field, image_addr, crc, outdated.isDirty(field));
+        }
+        header.crc = crc.getValue();
 
-        write_block(listen_devices);
+        ram.write(SettingsSlots::getAddress(target), &header, SETTINGS_SLOT_HEADER_SIZE);
 
-        if (size == (ptr - payload)) {
-            ram.write(0, payload, size);
-            logln("Settings written to FRAM", dosa::LogLevel::INFO);
-        } else {
-            logln("FRAM payload size mismatch", dosa::LogLevel::ERROR);
-        }
+        active_slot = target;
+        generation = header.generation;
+        pending = dirty;
+        dirty.clear();
+        logln("Settings written to FRAM slot " + String(target), dosa::LogLevel::INFO);
     }
 
     void setDefaults()
@@ -359,15 +168,34 @@ class Settings : public Loggable
         door_open_wait = default_door_open_wait;
         door_cool_down = default_door_cool_down;
         door_close_ticks = default_door_close_ticks;
+        door_pid_kp = default_door_pid_kp;
+        door_pid_ki = default_door_pid_ki;
+        door_pid_kd = default_door_pid_kd;
+        door_max_speed = default_door_max_speed;
+        door_accel = default_door_accel;
+        door_profile = default_door_profile;
 
         // Range-trip specific
         range_trigger_threshold = default_range_trigger_threshold;
         range_fixed_calibration = default_range_fixed_calibration;
         range_trigger_coefficient = default_range_trigger_coefficient;
+        range_median_window = default_range_median_window;
+        range_process_noise = default_range_process_noise;
+        range_measurement_noise = default_range_measurement_noise;
 
         // Relay specific
         relay_activation_time = default_relay_activation_time;
+        relay_channels = default_relay_channels;
+        relay_timezone = default_relay_timezone;
+        memset(relay_schedule, 0, DOSA_SETTINGS_RELAY_SCHEDULE_SIZE);
+        relay_channel_map = null_str;
+
+        // OTA specific
+        ota_server_addr = null_str;
+        ota_server_port = zero_16;
+        ota_server_path = null_str;
 
+        dirty.markAll();
         updateDeviceNameBytes();
     }
 
@@ -383,11 +211,12 @@ class Settings : public Loggable
 
     bool setDeviceName(String const& deviceName)
     {
-        if (deviceName.length() < 2 || deviceName.length() > 20) {
+        if (deviceName.length() < 2 || deviceName.length() > SettingsLayout::getCapacity(SettingsField::DEVICE_NAME)) {
             return false;
         }
 
         device_name = deviceName;
+        dirty.mark(SettingsField::DEVICE_NAME);
         updateDeviceNameBytes();
 
         return true;
@@ -400,11 +229,12 @@ class Settings : public Loggable
 
     bool setPin(String const& newPin)
     {
-        if (newPin.length() < 4 || newPin.length() > 50) {
+        if (newPin.length() < 4 || newPin.length() > SettingsLayout::getCapacity(SettingsField::PIN)) {
             return false;
         }
 
         pin = newPin;
+        dirty.mark(SettingsField::PIN);
 
         return true;
     }
@@ -414,9 +244,16 @@ class Settings : public Loggable
         return wifi_ssid;
     }
 
-    void setWifiSsid(String const& wifiSsid)
+    bool setWifiSsid(String const& wifiSsid)
     {
+        if (!fits(SettingsField::WIFI_SSID, wifiSsid)) {
+            return false;
+        }
+
         wifi_ssid = wifiSsid;
+        dirty.mark(SettingsField::WIFI_SSID);
+
+        return true;
     }
 
     [[nodiscard]] String const& getWifiPassword() const
@@ -424,9 +261,31 @@ class Settings : public Loggable
         return wifi_password;
     }
 
-    void setWifiPassword(String const& wifiPassword)
+    bool setWifiPassword(String const& wifiPassword)
     {
+        if (!fits(SettingsField::WIFI_PASSWORD, wifiPassword)) {
+            return false;
+        }
+
         wifi_password = wifiPassword;
+        dirty.mark(SettingsField::WIFI_PASSWORD);
+
+        return true;
+    }
+
+    /**
+     * Set the wifi AP and its password together, changing neither if either does not fit.
+     */
+    bool setWifi(String const& ssid, String const& password)
+    {
+        if (!fits(SettingsField::WIFI_SSID, ssid) || !fits(SettingsField::WIFI_PASSWORD, password)) {
+            return false;
+        }
+
+        setWifiSsid(ssid);
+        setWifiPassword(password);
+
+        return true;
     }
 
     [[nodiscard]] comms::Node getStatsServer() const
@@ -452,9 +311,16 @@ class Settings : public Loggable
         return stats_server_addr.length() > 0;
     }
 
-    void setStatsServerAddr(String const& statsServerAddr)
+    bool setStatsServerAddr(String const& statsServerAddr)
     {
+        if (!fits(SettingsField::STATS_SERVER_ADDR, statsServerAddr)) {
+            return false;
+        }
+
         stats_server_addr = statsServerAddr;
+        dirty.mark(SettingsField::STATS_SERVER_ADDR);
+
+        return true;
     }
 
     [[nodiscard]] uint16_t getStatsServerPort() const
@@ -465,6 +331,7 @@ class Settings : public Loggable
     void setStatsServerPort(uint16_t statsServerPort)
     {
         stats_server_port = statsServerPort;
+        dirty.mark(SettingsField::STATS_SERVER_PORT);
     }
 
     [[nodiscard]] uint8_t getPirMinPixels() const
@@ -475,6 +342,7 @@ class Settings : public Loggable
     void setPirMinPixels(uint8_t value)
     {
         pir_min_pixels = value;
+        dirty.mark(SettingsField::PIR_MIN_PIXELS);
     }
 
     [[nodiscard]] float getPirPixelDelta() const
@@ -485,6 +353,7 @@ class Settings : public Loggable
     void setPirPixelDelta(float value)
     {
         pir_pixel_delta = value;
+        dirty.mark(SettingsField::PIR_PIXEL_DELTA);
     }
 
     [[nodiscard]] float getPirTotalDelta() const
@@ -495,6 +364,7 @@ class Settings : public Loggable
     void setPirTotalDelta(float value)
     {
         pir_total_delta = value;
+        dirty.mark(SettingsField::PIR_TOTAL_DELTA);
     }
 
     [[nodiscard]] uint32_t getDoorOpenWait() const
@@ -505,6 +375,7 @@ class Settings : public Loggable
     void setDoorOpenWait(uint32_t doorOpenWait)
     {
         door_open_wait = doorOpenWait;
+        dirty.mark(SettingsField::DOOR_OPEN_WAIT);
     }
 
     [[nodiscard]] uint32_t getDoorCoolDown() const
@@ -515,6 +386,7 @@ class Settings : public Loggable
     void setDoorCoolDown(uint32_t doorCoolDown)
     {
         door_cool_down = doorCoolDown;
+        dirty.mark(SettingsField::DOOR_COOL_DOWN);
     }
 
     [[nodiscard]] uint16_t getDoorOpenDistance() const
@@ -525,6 +397,7 @@ class Settings : public Loggable
     void setDoorOpenDistance(uint16_t doorOpenDistance)
     {
         door_open_distance = doorOpenDistance;
+        dirty.mark(SettingsField::DOOR_OPEN_DISTANCE);
     }
 
     [[nodiscard]] uint32_t getDoorCloseTicks() const
@@ -535,6 +408,73 @@ class Settings : public Loggable
     void setDoorCloseTicks(uint32_t doorCloseTicks)
     {
         door_close_ticks = doorCloseTicks;
+        dirty.mark(SettingsField::DOOR_CLOSE_TICKS);
+    }
+
+    [[nodiscard]] float getDoorPidKp() const
+    {
+        return door_pid_kp;
+    }
+
+    void setDoorPidKp(float value)
+    {
+        door_pid_kp = value;
+        dirty.mark(SettingsField::DOOR_PID_KP);
+    }
+
+    [[nodiscard]] float getDoorPidKi() const
+    {
+        return door_pid_ki;
+    }
+
+    void setDoorPidKi(float value)
+    {
+        door_pid_ki = value;
+        dirty.mark(SettingsField::DOOR_PID_KI);
+    }
+
+    [[nodiscard]] float getDoorPidKd() const
+    {
+        return door_pid_kd;
+    }
+
+    void setDoorPidKd(float value)
+    {
+        door_pid_kd = value;
+        dirty.mark(SettingsField::DOOR_PID_KD);
+    }
+
+    [[nodiscard]] uint16_t getDoorMaxSpeed() const
+    {
+        return door_max_speed;
+    }
+
+    void setDoorMaxSpeed(uint16_t value)
+    {
+        door_max_speed = value;
+        dirty.mark(SettingsField::DOOR_MAX_SPEED);
+    }
+
+    [[nodiscard]] uint32_t getDoorAccel() const
+    {
+        return door_accel;
+    }
+
+    void setDoorAccel(uint32_t value)
+    {
+        door_accel = value;
+        dirty.mark(SettingsField::DOOR_ACCEL);
+    }
+
+    [[nodiscard]] uint8_t getDoorProfile() const
+    {
+        return door_profile;
+    }
+
+    void setDoorProfile(uint8_t value)
+    {
+        door_profile = value;
+        dirty.mark(SettingsField::DOOR_PROFILE);
     }
 
     [[nodiscard]] uint16_t getRangeTriggerThreshold() const
@@ -545,6 +485,7 @@ class Settings : public Loggable
     void setRangeTriggerThreshold(uint16_t value)
     {
         range_trigger_threshold = value;
+        dirty.mark(SettingsField::RANGE_TRIGGER_THRESHOLD);
     }
 
     [[nodiscard]] uint16_t getRangeFixedCalibration() const
@@ -555,6 +496,7 @@ class Settings : public Loggable
     void setRangeFixedCalibration(uint16_t value)
     {
         range_fixed_calibration = value;
+        dirty.mark(SettingsField::RANGE_FIXED_CALIBRATION);
     }
 
     [[nodiscard]] float getRangeTriggerCoefficient() const
@@ -565,6 +507,40 @@ class Settings : public Loggable
     void setRangeTriggerCoefficient(float value)
     {
         range_trigger_coefficient = value;
+        dirty.mark(SettingsField::RANGE_TRIGGER_COEFFICIENT);
+    }
+
+    [[nodiscard]] uint8_t getRangeMedianWindow() const
+    {
+        return range_median_window;
+    }
+
+    void setRangeMedianWindow(uint8_t value)
+    {
+        range_median_window = value;
+        dirty.mark(SettingsField::RANGE_MEDIAN_WINDOW);
+    }
+
+    [[nodiscard]] float getRangeProcessNoise() const
+    {
+        return range_process_noise;
+    }
+
+    void setRangeProcessNoise(float value)
+    {
+        range_process_noise = value;
+        dirty.mark(SettingsField::RANGE_PROCESS_NOISE);
+    }
+
+    [[nodiscard]] float getRangeMeasurementNoise() const
+    {
+        return range_measurement_noise;
+    }
+
+    void setRangeMeasurementNoise(float value)
+    {
+        range_measurement_noise = value;
+        dirty.mark(SettingsField::RANGE_MEASUREMENT_NOISE);
     }
 
     [[nodiscard]] LockState getLockState() const
@@ -575,6 +551,7 @@ class Settings : public Loggable
     void setLockState(LockState state)
     {
         locked = state;
+        dirty.mark(SettingsField::LOCKED);
     }
 
     [[nodiscard]] uint32_t getRelayActivationTime() const
@@ -585,18 +562,136 @@ class Settings : public Loggable
     void setRelayActivationTime(uint32_t t)
     {
         relay_activation_time = t;
+        dirty.mark(SettingsField::RELAY_ACTIVATION_TIME);
+    }
+
+    [[nodiscard]] uint8_t getRelayChannels() const
+    {
+        return relay_channels;
+    }
+
+    void setRelayChannels(uint8_t value)
+    {
+        relay_channels = value;
+        dirty.mark(SettingsField::RELAY_CHANNELS);
+    }
+
+    [[nodiscard]] int8_t getRelayTimezone() const
+    {
+        return relay_timezone;
+    }
+
+    void setRelayTimezone(int8_t value)
+    {
+        relay_timezone = value;
+        dirty.mark(SettingsField::RELAY_TIMEZONE);
+    }
+
+    /**
+     * Relay schedule table, DOSA_SETTINGS_RELAY_SCHEDULE_SIZE bytes.
+     */
+    [[nodiscard]] uint8_t const* getRelaySchedule() const
+    {
+        return relay_schedule;
+    }
+
+    /**
+     * Replace the schedule table with `size` bytes of `value`, the remainder of the table is cleared.
+     */
+    void setRelaySchedule(uint8_t const* value, size_t size)
+    {
+        if (size > DOSA_SETTINGS_RELAY_SCHEDULE_SIZE) {
+            size = DOSA_SETTINGS_RELAY_SCHEDULE_SIZE;
+        }
+
+        memset(relay_schedule, 0, DOSA_SETTINGS_RELAY_SCHEDULE_SIZE);
+        memcpy(relay_schedule, value, size);
+        dirty.mark(SettingsField::RELAY_SCHEDULE);
+    }
+
+    [[nodiscard]] String const& getRelayChannelMap() const
+    {
+        return relay_channel_map;
+    }
+
+    bool setRelayChannelMap(String const& value)
+    {
+        if (!fits(SettingsField::RELAY_CHANNEL_MAP, value)) {
+            return false;
+        }
+
+        relay_channel_map = value;
+        dirty.mark(SettingsField::RELAY_CHANNEL_MAP);
+
+        return true;
+    }
+
+    /**
+     * OTA server host, empty to use the build's default server.
+     */
+    [[nodiscard]] String const& getOtaServerAddr() const
+    {
+        return ota_server_addr;
+    }
+
+    bool setOtaServerAddr(String const& value)
+    {
+        if (!fits(SettingsField::OTA_SERVER_ADDR, value)) {
+            return false;
+        }
+
+        ota_server_addr = value;
+        dirty.mark(SettingsField::OTA_SERVER_ADDR);
+
+        return true;
+    }
+
+    /**
+     * OTA server port, 0 to use the build's default.
+     */
+    [[nodiscard]] uint16_t getOtaServerPort() const
+    {
+        return ota_server_port;
+    }
+
+    void setOtaServerPort(uint16_t value)
+    {
+        ota_server_port = value;
+        dirty.mark(SettingsField::OTA_SERVER_PORT);
+    }
+
+    /**
+     * Path on the OTA server holding the application directories, empty to use the build's default.
+     */
+    [[nodiscard]] String const& getOtaServerPath() const
+    {
+        return ota_server_path;
+    }
+
+    bool setOtaServerPath(String const& value)
+    {
+        if (!fits(SettingsField::OTA_SERVER_PATH, value)) {
+            return false;
+        }
+
+        ota_server_path = value;
+        dirty.mark(SettingsField::OTA_SERVER_PATH);
+
+        return true;
     }
 
     void addListenDevice(String const& v)
     {
         if (!hasListenDevice(v)) {
             listen_devices += v + '\n';
+            dirty.mark(SettingsField::LISTEN_DEVICES);
         }
     }
 
     void setListenDevices(String const& v)
     {
         listen_devices = v;
+        dirty.mark(SettingsField::LISTEN_DEVICES);
     }
 
     [[nodiscard]] String const& getListenDevices() const
@@ -630,8 +725,20 @@ class Settings : public Loggable
         ram.init();
     }
 
+    /**
+     * True if `value` fits the string `field`, longer values would be truncated when saved.
+     */
+    static bool fits(SettingsField field, String const& value)
+    {
+        return value.length() <= SettingsLayout::getCapacity(field);
+    }
+
    protected:
     Fram& ram;
+    SettingsDirty dirty;      // Fields changed since the last save
+    SettingsDirty pending;    // Fields the inactive slot is missing
+    uint8_t active_slot = 0;  // Slot holding the current settings
+    uint32_t generation = 0;  // Generation of the active slot
     String device_name;
     String listen_devices;
     char device_name_bytes[20] = {0};
@@ -648,10 +755,348 @@ class Settings : public Loggable
     uint32_t door_open_wait = 0;
     uint32_t door_cool_down = 0;
     uint32_t door_close_ticks = 0;
+    float door_pid_kp = 0;
+    float door_pid_ki = 0;
+    float door_pid_kd = 0;
+    uint16_t door_max_speed = 0;
+    uint32_t door_accel = 0;
+    uint8_t door_profile = 0;
     uint16_t range_trigger_threshold = 0;
     uint16_t range_fixed_calibration = 0;
     float range_trigger_coefficient = 0;
+    uint8_t range_median_window = 0;
+    float range_process_noise = 0;
+    float range_measurement_noise = 0;
     uint32_t relay_activation_time = 0;
+    uint8_t relay_channels = 0;
+    int8_t relay_timezone = 0;
+    uint8_t relay_schedule[DOSA_SETTINGS_RELAY_SCHEDULE_SIZE] = {0};
+    String relay_channel_map;
+    String ota_server_addr;
+    uint16_t ota_server_port = 0;
+    String ota_server_path;
+
+    /**
+     * Load the image in `slot`, verifying it against the CRC in its `header`.
+     */
+    bool loadSlot(uint8_t slot, SettingsSlotHeader const& header)
+    {
+        Crc32 crc;
+        crc.update(&header.generation, 4);
+
+        if (!readImage(SettingsSlots::getAddress(slot) + SETTINGS_SLOT_HEADER_SIZE, crc) ||
+            crc.getValue() != header.crc) {
+            logln("Settings slot " + String(slot) + " failed CRC check", LogLevel::ERROR);
+            return false;
+        }
+
+        active_slot = slot;
+        generation = header.generation;
+        dirty.clear();
+
+        return true;
+    }
+
+    /**
+     * Read the settings image at `addr`, adding it to `crc`. Returns false if a string field is oversize, in which case
+     * values may be partially read.
+     */
+    bool readImage(uint32_t addr, Crc32& crc)
+    {
+        // Strings are short, each slot is usually served by a single block read
+        BlockReader<Fram> reader(ram, addr + SettingsLayout::getImageSize());
+
+        uint8_t fixed[SettingsLayout::getFixedUsed()];
+        reader.read(addr, fixed, SettingsLayout::getFixedUsed());
+        crc.update(fixed, SettingsLayout::getFixedUsed());
+
+        for (uint8_t i = 0; i < SettingsLayout::field_count; ++i) {
+            auto field = static_cast<SettingsField>(i);
+            auto offset = SettingsLayout::getOffset(field);
+
+            if (!SettingsLayout::isString(field)) {
+                memcpy(fieldData(field), fixed + offset, SettingsLayout::getSize(field));
+                continue;
+            }
+
+            uint16_t size;
+            reader.read(addr + offset, &size, 2);
+            if (size > SettingsLayout::getCapacity(field)) {
+                logln("Bad read: string field " + String(i), LogLevel::ERROR);
+                return false;
+            }
+
+            char buffer[size + 1];
+            reader.read(addr + offset + 2, buffer, size);
+            buffer[size] = 0;
+            *stringField(field) = buffer;
+
+            crc.update(&size, 2);
+            crc.update(buffer, size);
+        }
+
+        return true;
+    }
+
+    /**
+     * Read settings stored by builds up to DS23, as a sequential blob:
+     *   Size   Type      Detail
+     *   ----------------------------------
+     *   4      char      Header
+     *   1      uint8     Device lock state (v20)
+     *   2+?    string    Device password (aka pin)
+     *   2+?    string    Device name
+     *   2+?    string    Wifi SSID
+     *   2+?    string    Wifi password
+     *   2+?    string    Stats server address (v23)
+     *   2      uint16    Stats server port (v23)
+     *   9      ...       PIR calibration
+     *   14     ...       Door calibration
+     *   2      uint16    Range trigger threshold
+     *   2      uint16    Range fixed calibration (v18)
+     *   4      float     Range trigger coefficient (v19)
+     *   4      uint32    Relay activation time (v22)
+     *   2+?    string    Listen devices (v21)
+     *
+     * Fields added after the stored version, and all those the blob never held, take their defaults.
+     */
+    bool loadLegacy(uint8_t c_ver)
+    {
+        uint32_t ptr = 4;  // Size of header
+        setDefaults();
+
+        auto read_block = [this, &ptr, c_ver](String& s, uint8_t req_ver = 0, char const* src = nullptr) -> bool {
+            if (req_ver > 0 && c_ver < req_ver) {
+                s = String(src);
+                return true;
+            }
+
+            s = readVarChar(ptr);
+            if (s == DOSA_SETTINGS_OVERSIZE_READ) {
+                logln("Oversize read warning", LogLevel::ERROR);
+                return false;
+            }
+            ptr += s.length() + 2;
+            return true;
+        };
+
+        auto read_var = [this, &ptr, c_ver](void* s, size_t size, uint8_t req_ver = 0, void* src = nullptr) -> void {
+            if (req_ver > 0 && c_ver < req_ver) {
+                memcpy(s, src, size);
+                return;
+            }
+
+            ram.read(ptr, (uint8_t*)s, size);
+            ptr += size;
+        };
+
+        read_var(&locked, 1, 20, (void*)(&zero_8));
+
+        if (!read_block(pin)) {
+            logln("Bad read: PIN", LogLevel::ERROR);
+            setDefaults();
+            return false;
+        }
+
+        if (!read_block(device_name)) {
+            logln("Bad read: device name", LogLevel::ERROR);
+            setDefaults();
+            return false;
+        }
+
+        if (!read_block(wifi_ssid)) {
+            logln("Bad read: wifi SSID", LogLevel::ERROR);
+            setDefaults();
+            return false;
+        }
+
+        if (!read_block(wifi_password)) {
+            logln("Bad read: wifi password", LogLevel::ERROR);
+            setDefaults();
+            return false;
+        }
+
+        if (!read_block(stats_server_addr, 23, null_str)) {
+            logln("Bad read: stats server", LogLevel::ERROR);
+            setDefaults();
+            return false;
+        }
+        read_var(&stats_server_port, 2, 23, (void*)(&zero_16));
+
+        read_var(&pir_min_pixels, 1);
+        read_var(&pir_pixel_delta, 4);
+        read_var(&pir_total_delta, 4);
+
+        read_var(&door_open_distance, 2);
+        read_var(&door_open_wait, 4);
+        read_var(&door_cool_down, 4);
+        read_var(&door_close_ticks, 4);
+
+        read_var(&range_trigger_threshold, 2);
+        read_var(&range_fixed_calibration, 2, 18, (void*)(&default_range_fixed_calibration));
+        read_var(&range_trigger_coefficient, 4, 19, (void*)(&default_range_trigger_coefficient));
+
+        read_var(&relay_activation_time, 4, 22, (void*)(&default_relay_activation_time));
+
+        if (!read_block(listen_devices, 21, null_str)) {
+            logln("Bad read: listen devices", LogLevel::ERROR);
+            setDefaults();
+            return false;
+        }
+
+        return validate();
+    }
+
+    /**
+     * Correct values that must not be blank. Returns false if anything was corrected.
+     */
+    bool validate()
+    {
+        bool valid = true;
+
+        if (pin == "") {
+            // Not allowed a blank pin
+            pin = default_pin;
+            dirty.mark(SettingsField::PIN);
+            logln("Device PIN invalid, resetting to default", LogLevel::ERROR);
+            valid = false;
+        }
+
+        if (device_name == "") {
+            // Device name cannot be blank
+            device_name = "DOSA " + String(random(1000, 9999));
+            dirty.mark(SettingsField::DEVICE_NAME);
+            logln("Device name invalid, creating new name", LogLevel::ERROR);
+            valid = false;
+        }
+
+        updateDeviceNameBytes();
+
+        return valid;
+    }
+
+    /**
+     * Serialise a single field of the image at `image_addr` into `crc`, writing it to FRAM if `write` is set.
+     */
+    void writeField(SettingsField field, uint32_t image_addr, Crc32& crc, bool write)
+    {
+        uint32_t addr = image_addr + SettingsLayout::getOffset(field);
+
+        if (!SettingsLayout::isString(field)) {
+            crc.update(fieldData(field), SettingsLayout::getSize(field));
+            if (write) {
+                ram.write(addr, fieldData(field), SettingsLayout::getSize(field));
+            }
+            return;
+        }
+
+        String const& value = *stringField(field);
+        uint16_t size = value.length();
+        if (size > SettingsLayout::getCapacity(field)) {
+            logln("String field " + String(static_cast<uint8_t>(field)) + " truncated", LogLevel::WARNING);
+            size = SettingsLayout::getCapacity(field);
+        }
+
+        uint8_t buffer[size + 2];
+        memcpy(buffer, &size, 2);
+        memcpy(buffer + 2, value.c_str(), size);
+        crc.update(buffer, size + 2);
+        if (write) {
+            ram.write(addr, buffer, size + 2);
+        }
+    }
+
+    /**
+     * Storage of a fixed-size field.
+     */
+    void* fieldData(SettingsField field)
+    {
+        switch (field) {
+            case SettingsField::LOCKED:
+                return &locked;
+            case SettingsField::STATS_SERVER_PORT:
+                return &stats_server_port;
+            case SettingsField::PIR_MIN_PIXELS:
+                return &pir_min_pixels;
+            case SettingsField::PIR_PIXEL_DELTA:
+                return &pir_pixel_delta;
+            case SettingsField::PIR_TOTAL_DELTA:
+                return &pir_total_delta;
+            case SettingsField::DOOR_OPEN_DISTANCE:
+                return &door_open_distance;
+            case SettingsField::DOOR_OPEN_WAIT:
+                return &door_open_wait;
+            case SettingsField::DOOR_COOL_DOWN:
+                return &door_cool_down;
+            case SettingsField::DOOR_CLOSE_TICKS:
+                return &door_close_ticks;
+            case SettingsField::DOOR_PID_KP:
+                return &door_pid_kp;
+            case SettingsField::DOOR_PID_KI:
+                return &door_pid_ki;
+            case SettingsField::DOOR_PID_KD:
+                return &door_pid_kd;
+            case SettingsField::DOOR_MAX_SPEED:
+                return &door_max_speed;
+            case SettingsField::DOOR_ACCEL:
+                return &door_accel;
+            case SettingsField::DOOR_PROFILE:
+                return &door_profile;
+            case SettingsField::RANGE_TRIGGER_THRESHOLD:
+                return &range_trigger_threshold;
+            case SettingsField::RANGE_FIXED_CALIBRATION:
+                return &range_fixed_calibration;
+            case SettingsField::RANGE_TRIGGER_COEFFICIENT:
+                return &range_trigger_coefficient;
+            case SettingsField::RANGE_MEDIAN_WINDOW:
+                return &range_median_window;
+            case SettingsField::RANGE_PROCESS_NOISE:
+                return &range_process_noise;
+            case SettingsField::RANGE_MEASUREMENT_NOISE:
+                return &range_measurement_noise;
+            case SettingsField::RELAY_ACTIVATION_TIME:
+                return &relay_activation_time;
+            case SettingsField::RELAY_CHANNELS:
+                return &relay_channels;
+            case SettingsField::RELAY_TIMEZONE:
+                return &relay_timezone;
+            case SettingsField::RELAY_SCHEDULE:
+                return relay_schedule;
+            case SettingsField::OTA_SERVER_PORT:
+                return &ota_server_port;
+            default:
+                return nullptr;
+        }
+    }
+
+    /**
+     * Storage of a string field.
+     */
+    String* stringField(SettingsField field)
+    {
+        switch (field) {
+            case SettingsField::PIN:
+                return &pin;
+            case SettingsField::DEVICE_NAME:
+                return &device_name;
+            case SettingsField::WIFI_SSID:
+                return &wifi_ssid;
+            case SettingsField::WIFI_PASSWORD:
+                return &wifi_password;
+            case SettingsField::STATS_SERVER_ADDR:
+                return &stats_server_addr;
+            case SettingsField::RELAY_CHANNEL_MAP:
+                return &relay_channel_map;
+            case SettingsField::LISTEN_DEVICES:
+                return &listen_devices;
+            case SettingsField::OTA_SERVER_ADDR:
+                return &ota_server_addr;
+            case SettingsField::OTA_SERVER_PATH:
+                return &ota_server_path;
+            default:
+                return nullptr;
+        }
+    }
 
     [[nodiscard]] static uint8_t getSettingsVersion(String const& version)
     {
@@ -668,7 +1113,7 @@ class Settings : public Loggable
     virtual bool canUpgrade(String const& version)
     {
         auto v = getSettingsVersion(version);
-        return v >= 17 && v <= getSettingsVersion(current_settings_header);
+        return v >= 17 && v <= DOSA_SETTINGS_LEGACY_VERSION;
     }
 
     /**
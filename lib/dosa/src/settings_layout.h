@@ -0,0 +1,297 @@
+/**
+ * FRAM layout of the settings image.
+ *
+ * Every field has a fixed offset, so that a single changed field can be written in place. Fixed-size fields are packed
+ * into a fixed region with room to grow; strings follow in a slotted region, each slot holding a 2-byte length and the
+ * string's maximum capacity, so a string changing length never moves anything else.
+ *
+ * New fields must be added to the end of their region, existing offsets must never change. A new field also bumps the
+ * settings version.
+ *
+ * Two copies of the image are kept in alternating slots, so that a save interrupted by a power cut always leaves the
+ * previous copy intact. Each slot begins with a header:
+ *   Offset  Size  Type      Detail
+ *   ----------------------------------
+ *   0       4     char      Settings version
+ *   4       4     uint32    Generation, incremented with each save
+ *   8       4     uint32    CRC-32 of the generation and the image, string slots covering only their length
+ *   12      ...   ...       Image
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Size reserved for fixed-size fields, the string region begins after it.
+ */
+#define SETTINGS_FIXED_REGION_SIZE 256
+
+/**
+ * Version of the layout, the settings header is "DS" followed by this.
+ */
+#define SETTINGS_VERSION 24
+
+#define SETTINGS_SLOT_COUNT 2
+#define SETTINGS_SLOT_SIZE 0x500
+#define SETTINGS_SLOT_HEADER_SIZE 12
+
+namespace dosa {
+
+enum class SettingsField : uint8_t
+{
+    // Fixed region
+    LOCKED,
+    STATS_SERVER_PORT,
+    PIR_MIN_PIXELS,
+    PIR_PIXEL_DELTA,
+    PIR_TOTAL_DELTA,
+    DOOR_OPEN_DISTANCE,
+    DOOR_OPEN_WAIT,
+    DOOR_COOL_DOWN,
+    DOOR_CLOSE_TICKS,
+    DOOR_PID_KP,
+    DOOR_PID_KI,
+    DOOR_PID_KD,
+    DOOR_MAX_SPEED,
+    DOOR_ACCEL,
+    DOOR_PROFILE,
+    RANGE_TRIGGER_THRESHOLD,
+    RANGE_FIXED_CALIBRATION,
+    RANGE_TRIGGER_COEFFICIENT,
+    RANGE_MEDIAN_WINDOW,
+    RANGE_PROCESS_NOISE,
+    RANGE_MEASUREMENT_NOISE,
+    RELAY_ACTIVATION_TIME,
+    RELAY_CHANNELS,
+    RELAY_TIMEZONE,
+    RELAY_SCHEDULE,
+    OTA_SERVER_PORT,
+
+    // String region
+    PIN,
+    DEVICE_NAME,
+    WIFI_SSID,
+    WIFI_PASSWORD,
+    STATS_SERVER_ADDR,
+    RELAY_CHANNEL_MAP,
+    LISTEN_DEVICES,
+    OTA_SERVER_ADDR,
+    OTA_SERVER_PATH,
+
+    COUNT,
+};
+
+/**
+ * Maximum length of each string field, or the size of each fixed field.
+ *
+ * Held as a template so that the table may be defined here, in the header, and still be shared by every translation
+ * unit that includes it.
+ */
+template <class T = void>
+struct SettingsFieldSizes
+{
+    constexpr static uint16_t values[static_cast<uint8_t>(SettingsField::COUNT)] = {
+        1,    // LOCKED
+        2,    // STATS_SERVER_PORT
+        1,    // PIR_MIN_PIXELS
+        4,    // PIR_PIXEL_DELTA
+        4,    // PIR_TOTAL_DELTA
+        2,    // DOOR_OPEN_DISTANCE
+        4,    // DOOR_OPEN_WAIT
+        4,    // DOOR_COOL_DOWN
+        4,    // DOOR_CLOSE_TICKS
+        4,    // DOOR_PID_KP
+        4,    // DOOR_PID_KI
+        4,    // DOOR_PID_KD
+        2,    // DOOR_MAX_SPEED
+        4,    // DOOR_ACCEL
+        1,    // DOOR_PROFILE
+        2,    // RANGE_TRIGGER_THRESHOLD
+        2,    // RANGE_FIXED_CALIBRATION
+        4,    // RANGE_TRIGGER_COEFFICIENT
+        1,    // RANGE_MEDIAN_WINDOW
+        4,    // RANGE_PROCESS_NOISE
+        4,    // RANGE_MEASUREMENT_NOISE
+        4,    // RELAY_ACTIVATION_TIME
+        1,    // RELAY_CHANNELS
+        1,    // RELAY_TIMEZONE
+        48,   // RELAY_SCHEDULE
+        2,    // OTA_SERVER_PORT
+        50,   // PIN
+        20,   // DEVICE_NAME
+        32,   // WIFI_SSID
+        64,   // WIFI_PASSWORD
+        64,   // STATS_SERVER_ADDR
+        128,  // RELAY_CHANNEL_MAP
+        500,  // LISTEN_DEVICES
+        64,   // OTA_SERVER_ADDR
+        48,   // OTA_SERVER_PATH
+    };
+};
+
+template <class T>
+constexpr uint16_t SettingsFieldSizes<T>::values[static_cast<uint8_t>(SettingsField::COUNT)];
+
+class SettingsLayout
+{
+   public:
+    constexpr static uint8_t field_count = static_cast<uint8_t>(SettingsField::COUNT);
+
+    /**
+     * True if the field is a string, held in the slotted region.
+     */
+    constexpr static bool isString(SettingsField field)
+    {
+        return field >= SettingsField::PIN && field < SettingsField::COUNT;
+    }
+
+    /**
+     * Maximum length of a string field, or the size of a fixed field.
+     */
+    constexpr static uint16_t getCapacity(SettingsField field)
+    {
+        return field < SettingsField::COUNT ? SettingsFieldSizes<>::values[static_cast<uint8_t>(field)] : 0;
+    }
+
+    /**
+     * Bytes the field occupies in the image, including the length marker of a string.
+     */
+    constexpr static uint16_t getSize(SettingsField field)
+    {
+        return isString(field) ? 2 + getCapacity(field) : getCapacity(field);
+    }
+
+    /**
+     * Offset of the field from the start of the image.
+     */
+    constexpr static uint16_t getOffset(SettingsField field)
+    {
+        return field >= SettingsField::PIN ? SETTINGS_FIXED_REGION_SIZE + sumSizes(SettingsField::PIN, field)
+                                            : sumSizes(SettingsField::LOCKED, field);
+    }
+
+    /**
+     * Bytes of the fixed region in use.
+     */
+    constexpr static uint16_t getFixedUsed()
+    {
+        return sumSizes(SettingsField::LOCKED, SettingsField::PIN);
+    }
+
+    /**
+     * Total size of the image.
+     */
+    constexpr static uint16_t getImageSize()
+    {
+        return getOffset(SettingsField::COUNT);
+    }
+
+   private:
+    /**
+     * Sum of the image sizes of the fields from `from` up to, but excluding, `to`.
+     */
+    constexpr static uint16_t sumSizes(SettingsField from, SettingsField to)
+    {
+        return from < to ? getSize(from) + sumSizes(static_cast<SettingsField>(static_cast<uint8_t>(from) + 1), to) : 0;
+    }
+};
+
+static_assert(SettingsLayout::getFixedUsed() <= SETTINGS_FIXED_REGION_SIZE, "Settings fixed region overflow");
+static_assert(
+    SETTINGS_SLOT_HEADER_SIZE + SettingsLayout::getImageSize() <= SETTINGS_SLOT_SIZE,
+    "Settings image does not fit its slot");
+
+struct SettingsSlotHeader
+{
+    char version[4];
+    uint32_t generation;
+    uint32_t crc;
+};
+
+static_assert(sizeof(SettingsSlotHeader) == SETTINGS_SLOT_HEADER_SIZE, "Settings slot header is not packed");
+
+class SettingsSlots
+{
+   public:
+    /**
+     * FRAM address of the header of `slot`, the image follows it.
+     */
+    constexpr static uint32_t getAddress(uint8_t slot)
+    {
+        return uint32_t(slot) * SETTINGS_SLOT_SIZE;
+    }
+
+    /**
+     * True if a slot header carries the current settings version, "DS" followed by SETTINGS_VERSION.
+     */
+    static bool isCurrent(SettingsSlotHeader const& header)
+    {
+        char const* v = header.version;
+        return v[0] == 'D' && v[1] == 'S' && v[2] == '0' + SETTINGS_VERSION / 10 && v[3] == '0' + SETTINGS_VERSION % 10;
+    }
+
+    /**
+     * True if generation `a` was written after `b`, allowing for the counter wrapping.
+     */
+    constexpr static bool isNewer(uint32_t a, uint32_t b)
+    {
+        return int32_t(a - b) > 0;
+    }
+
+    /**
+     * Slot to try first, given which slots carry a current header, or -1 if neither does. If its image fails the CRC,
+     * the other slot holds the previous save.
+     */
+    constexpr static int8_t select(bool valid_a, uint32_t generation_a, bool valid_b, uint32_t generation_b)
+    {
+        return valid_a && valid_b ? (isNewer(generation_b, generation_a) ? 1 : 0) : (valid_a ? 0 : (valid_b ? 1 : -1));
+    }
+};
+
+/**
+ * Fields changed since the image was last written.
+ */
+class SettingsDirty
+{
+   public:
+    void mark(SettingsField field)
+    {
+        bits |= uint64_t(1) << static_cast<uint8_t>(field);
+    }
+
+    void markAll()
+    {
+        bits = (uint64_t(1) << SettingsLayout::field_count) - 1;
+    }
+
+    [[nodiscard]] bool isDirty(SettingsField field) const
+    {
+        return bits & (uint64_t(1) << static_cast<uint8_t>(field));
+    }
+
+    /**
+     * Also mark the fields dirty in `other`.
+     */
+    void merge(SettingsDirty const& other)
+    {
+        bits |= other.bits;
+    }
+
+    [[nodiscard]] bool any() const
+    {
+        return bits != 0;
+    }
+
+    void clear()
+    {
+        bits = 0;
+    }
+
+   private:
+    uint64_t bits = 0;
+};
+
+static_assert(SettingsLayout::field_count <= 64, "Too many settings fields for the dirty mask");
+
+}  // namespace dosa
@@ -2,4 +2,6 @@
 
 #include "laser.h"
 #include "laser_app.h"
+#include "laser_bus.h"
 #include "laser_container.h"
+#include "laser_frame.h"
@@ -2,6 +2,23 @@
 
 #include <dosa.h>
 
+#include "laser_frame.h"
+
+/**
+ * Factory address of the laser.
+ */
+#define LASER_DEFAULT_ADDR 0x80
+
+/**
+ * Time (in ms) over which the laser measurement frequency is calculated.
+ */
+#define LASER_FREQUENCY_WINDOW 1000
+
+/**
+ * Time (in ms) without a valid measurement before a laser's last distance is no longer trusted.
+ */
+#define LASER_STALE_TIME 1000
+
 namespace dosa {
 
 enum class LaserResponseCode : uint8_t
@@ -33,11 +50,14 @@ constexpr LaserMessage addr_failed{data_addr_failed, 5};
 class Laser
 {
    public:
-    Laser()
+    explicit Laser(uint8_t addr = LASER_DEFAULT_ADDR) : device_addr(addr)
     {
         Serial1.begin(9600);
     }
 
+    /**
+     * Broadcasts a new address to the laser. Only one laser may be connected to the UART while doing this.
+     */
     LaserResponseCode setAddress(uint8_t addr)
     {
         uint8_t data[5] = {0xFA, 0x04, 0x01, addr};
@@ -48,6 +68,14 @@ class Laser
         return sendCommand({data, 5}, addr_success, addr_failed);
     }
 
+    /**
+     * Talk to a laser that has already been given `addr` with setAddress(), without reprogramming it.
+     */
+    void useAddress(uint8_t addr)
+    {
+        device_addr = addr;
+    }
+
     LaserResponseCode setControlLaser(bool enabled)
     {
         uint8_t enabled_byte = enabled ? 0x01 : 0x00;
@@ -71,6 +99,9 @@ class Laser
         tx(data, 4);
     }
 
+    /**
+     * Stops the laser and discards anything it was sending. The laser does not acknowledge this command.
+     */
     LaserResponseCode stop()
     {
         uint8_t data[4] = {device_addr, 0x04, 0x02};
@@ -78,65 +109,66 @@ class Laser
 
         tx(data, 4);
         hardFlush(250);
+        parser.reset();
+
+        return LaserResponseCode::SUCCESS;
     }
 
     /**
      * Checks the laser for new data. Should be run in main loop.
      *
+     * Consumes everything waiting on the UART, ignoring frames from other addresses. Do not use this when several
+     * lasers share the UART, use a LaserBus instead.
+     *
      * Returns true if the distance has been updated.
      */
     bool process()
     {
-        static uint8_t pos = 0;
-        static uint8_t data[11] = {};
-
-        if (Serial1.available() == 0) {
-            return false;
-        }
-
-        // Read the header, if it looks like this isn't the header - abort, eventually loop will rsync with the
-        // 11-byte pattern.
+        bool updated = false;
+        LaserReading reading{};
 
         while (Serial1.available()) {
-            uint8_t b = Serial1.read();
-            if (error_correction && b == 0xFF) {
-                continue;
-            }
-
-            if (pos == 0 && b != device_addr) {
-                pos = 0;
-                continue;
-            } else if (pos == 1 && b != 0x06) {
-                pos = 0;
-                continue;
-            } else if (pos == 2 && b != 0x83) {
-                continue;
+            if (parser.push(Serial1.read(), reading) && accept(reading)) {
+                updated = true;
             }
+        }
 
-            data[pos] = b;
-            ++pos;
+        updateFrequency();
+        return updated;
+    }
 
-            if (pos == 11) {
-                pos = 0;
+    /**
+     * Consider a reading parsed from the UART.
+     *
+     * Returns true if the reading was addressed to this laser and contained a valid distance.
+     */
+    bool accept(LaserReading const& reading)
+    {
+        if (reading.address != device_addr) {
+            return false;
+        }
 
-                if (data[10] != getChecksum(data, 10)) {
-                    return false;
-                }
+        if (reading.error) {
+            ++measurement_errors;
+            return false;
+        }
 
-                // Device prints ASCII 'ERR' when it can't make a measurement
-                if ((data[3] == 'E' && data[4] == 'R' && data[5] == 'R') || (data[6] != '.')) {
-                    return false;
-                }
+        distance = reading.distance;
+        last_reading = millis();
+        ++measurements;
+        return true;
+    }
 
-                distance = 0;
-                distance += data[9] - 0x30;
-                distance += (data[8] - 0x30) * 10;
-                distance += (data[7] - 0x30) * 100;
-                distance += (data[5] - 0x30) * 1000;
-                distance += (data[4] - 0x30) * 10000;
-                distance += (data[3] - 0x30) * 100000;
-                return true;
-            }
+    /**
+     * Recalculate the measurement frequency, called by process() or by the LaserBus.
+     */
+    void updateFrequency()
+    {
+        auto now = millis();
+        if (now - frequency_window_start >= LASER_FREQUENCY_WINDOW) {
+            frequency = (measurements - frequency_window_measurements) * 1000 / (now - frequency_window_start);
+            frequency_window_start = now;
+            frequency_window_measurements = measurements;
         }
     }
 
@@ -145,13 +177,56 @@ class Laser
         return distance;
     }
 
+    [[nodiscard]] uint8_t getAddress() const
+    {
+        return device_addr;
+    }
+
+    /**
+     * millis() timestamp of the last valid measurement, zero if the laser has never reported.
+     */
+    [[nodiscard]] uint32_t getLastReadingTime() const
+    {
+        return last_reading;
+    }
+
+    /**
+     * Valid measurements per second, calculated over the last LASER_FREQUENCY_WINDOW.
+     */
+    [[nodiscard]] uint32_t getFrequency() const
+    {
+        return frequency;
+    }
+
+    [[nodiscard]] uint32_t getMeasurementCount() const
+    {
+        return measurements;
+    }
+
+    /**
+     * Number of frames where the laser reported it could not make a measurement.
+     */
+    [[nodiscard]] uint32_t getMeasurementErrors() const
+    {
+        return measurement_errors;
+    }
+
+    /**
+     * Frame parser used by process(), exposes framing error counters.
+     */
+    [[nodiscard]] LaserFrameParser const& getParser() const
+    {
+        return parser;
+    }
+
     bool getErrorCorrection() const
     {
-        return error_correction;
+        return parser.getErrorCorrection();
     }
+
     void setErrorCorrection(bool errorCorrection)
     {
-        error_correction = errorCorrection;
+        parser.setErrorCorrection(errorCorrection);
     }
 
    protected:
@@ -200,7 +275,7 @@ class Laser
 
             // The schema never uses 0xFF, and occasionally the device will add random 0xFF bytes in the response.
             // We can safely skip over them -
-            if (error_correction && buffer[read] == 0xFF) {
+            if (getErrorCorrection() && buffer[read] == 0xFF) {
                 continue;
             }
 
@@ -229,19 +304,21 @@ class Laser
 
     uint8_t getChecksum(uint8_t const* data, size_t len)
     {
-        uint8_t checksum = 0;
-
-        for (int i = 0; i < len; ++i) {
-            checksum = checksum + data[i];
-        }
-
-        return ~checksum + 1;
+        return LaserFrameParser::getChecksum(data, len);
     }
 
    private:
+    uint8_t device_addr;
+    LaserFrameParser parser;
     uint32_t distance = 0;
-    uint8_t device_addr = 0x80;
-    bool error_correction = true;
+    uint32_t last_reading = 0;
+
+    // Stats
+    uint32_t measurements = 0;
+    uint32_t measurement_errors = 0;
+    uint32_t frequency = 0;
+    uint32_t frequency_window_start = 0;
+    uint32_t frequency_window_measurements = 0;
 };
 
 }  // namespace dosa
@@ -15,21 +15,80 @@ class LaserApp final : public dosa::RangingApp
     {
         RangingApp::init();
         logln("Laser init..");
-        container.getLaser().stop();
-        container.getLaser().startContinuousMeasurement();
+
+        auto& bus = container.getLaserBus();
+        for (uint8_t i = 0; i < bus.getDeviceCount(); ++i) {
+            bus.getDevice(i).stop();
+            bus.getDevice(i).startContinuousMeasurement();
+        }
+        bus.reset();
     }
 
    private:
     LaserContainer container;
+    uint32_t beam_measurements[LASER_BUS_MAX_DEVICES] = {0};  // Measurement count of each beam last read
+    bool beam_live[LASER_BUS_MAX_DEVICES] = {false};
 
     bool sensorUpdateReady() override
     {
-        return container.getLaser().process();
+        return container.getLaserBus().process();
+    }
+
+    uint8_t getSensorCount() const override
+    {
+        return container.getLaserBus().getDeviceCount();
     }
 
-    uint32_t getSensorDistance() override
+    /**
+     * Each beam is a sensor of its own, tripping against its own baseline. Only a measurement the beam hasn't already
+     * given is read, so a laser that stops reporting is left out rather than repeating its last distance.
+     */
+    bool getSensorDistance(uint8_t index, uint32_t& distance) override
     {
-        return container.getLaser().getDistance();
+        auto const& laser = container.getLaserBus().getDevice(index);
+        bool live = !isStale(laser);
+        if (live != beam_live[index]) {
+            beam_live[index] = live;
+            netLog(
+                "Laser 0x" + String(laser.getAddress(), HEX) + (live ? " reporting" : " not reporting"),
+                live ? NetLogLevel::INFO : NetLogLevel::WARNING);
+        }
+
+        if (!live || laser.getMeasurementCount() == beam_measurements[index]) {
+            return false;
+        }
+
+        beam_measurements[index] = laser.getMeasurementCount();
+        distance = laser.getDistance();
+        return true;
+    }
+
+    /**
+     * True if the laser has gone LASER_STALE_TIME without a valid measurement.
+     */
+    static bool isStale(Laser const& laser)
+    {
+        return laser.getMeasurementCount() == 0 || millis() - laser.getLastReadingTime() > LASER_STALE_TIME;
+    }
+
+    void onSensorDebug(comms::Node const& sender) override
+    {
+        auto& bus = container.getLaserBus();
+        for (uint8_t i = 0; i < bus.getDeviceCount(); ++i) {
+            auto const& laser = bus.getDevice(i);
+            netLog(
+                "Laser 0x" + String(laser.getAddress(), HEX) + ": " + String(laser.getDistance()) + "mm" +
+                    (isStale(laser) ? " (stale)" : "") + "; " + String(laser.getFrequency()) +
+                    " Hz; measurement errors: " + String(laser.getMeasurementErrors()),
+                sender);
+        }
+
+        auto const& parser = bus.getParser();
+        netLog(
+            "Laser frames: " + String(parser.getFrameCount()) + "; checksum errors: " +
+                String(parser.getChecksumErrors()) + "; resyncs: " + String(parser.getResyncs()) +
+                "; unknown address: " + String(bus.getUnknownAddressCount()),
+            sender);
     }
 
     Container& getContainer() override
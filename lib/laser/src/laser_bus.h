@@ -0,0 +1,111 @@
+#pragma once
+
+#include <dosa.h>
+
+#include "laser.h"
+#include "laser_frame.h"
+
+/**
+ * Max number of lasers that may share a single UART.
+ */
+#define LASER_BUS_MAX_DEVICES 4
+
+namespace dosa {
+
+/**
+ * Several lasers, each with a unique address, sharing Serial1.
+ *
+ * The bus owns reading from the UART and dispatches each frame to the laser it is addressed to. Lasers attached to a
+ * bus should not have their own process() called.
+ */
+class LaserBus
+{
+   public:
+    /**
+     * Add a laser to the bus. Returns false if the bus is full.
+     */
+    bool attach(Laser& laser)
+    {
+        if (device_count >= LASER_BUS_MAX_DEVICES) {
+            return false;
+        }
+
+        devices[device_count++] = &laser;
+        return true;
+    }
+
+    /**
+     * Checks the bus for new data. Should be run in main loop.
+     *
+     * Returns true if any laser has an updated distance.
+     */
+    bool process()
+    {
+        bool updated = false;
+        LaserReading reading{};
+
+        while (Serial1.available()) {
+            if (!parser.push(Serial1.read(), reading)) {
+                continue;
+            }
+
+            bool matched = false;
+            for (uint8_t i = 0; i < device_count; ++i) {
+                if (devices[i]->getAddress() == reading.address) {
+                    matched = true;
+                    updated = devices[i]->accept(reading) || updated;
+                    break;
+                }
+            }
+
+            if (!matched) {
+                ++unknown_address;
+            }
+        }
+
+        for (uint8_t i = 0; i < device_count; ++i) {
+            devices[i]->updateFrequency();
+        }
+
+        return updated;
+    }
+
+    /**
+     * Discard any partially read frame, use after sending commands to the lasers.
+     */
+    void reset()
+    {
+        parser.reset();
+    }
+
+    [[nodiscard]] uint8_t getDeviceCount() const
+    {
+        return device_count;
+    }
+
+    [[nodiscard]] Laser& getDevice(uint8_t index)
+    {
+        return *devices[index];
+    }
+
+    [[nodiscard]] LaserFrameParser const& getParser() const
+    {
+        return parser;
+    }
+
+    /**
+     * Number of valid frames received from an address not attached to the bus.
+     */
+    [[nodiscard]] uint32_t getUnknownAddressCount() const
+    {
+        return unknown_address;
+    }
+
+   private:
+    Laser* devices[LASER_BUS_MAX_DEVICES] = {nullptr};
+    uint8_t device_count = 0;
+    LaserFrameParser parser;
+    uint32_t unknown_address = 0;
+};
+
+}  // namespace dosa
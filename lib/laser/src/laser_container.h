@@ -3,21 +3,47 @@
 #include <dosa.h>
 
 #include "laser.h"
+#include "laser_bus.h"
+
+/**
+ * Number of lasers (beams) on the UART. Each must have been given a sequential address from LASER_DEFAULT_ADDR with
+ * Laser::setAddress().
+ */
+#ifndef LASER_BEAMS
+#define LASER_BEAMS 1
+#endif
 
 namespace dosa {
 
 class LaserContainer : public Container
 {
    public:
-    LaserContainer() : Container() {}
+    LaserContainer() : Container()
+    {
+        for (uint8_t i = 0; i < LASER_BEAMS; ++i) {
+            lasers[i].useAddress(LASER_DEFAULT_ADDR + i);
+            bus.attach(lasers[i]);
+        }
+    }
+
+    [[nodiscard]] Laser& getLaser(uint8_t index = 0)
+    {
+        return lasers[index];
+    }
+
+    [[nodiscard]] LaserBus& getLaserBus()
+    {
+        return bus;
+    }
 
-    [[nodiscard]] Laser& getLaser()
+    [[nodiscard]] LaserBus const& getLaserBus() const
     {
-        return laser;
+        return bus;
     }
 
    protected:
-    Laser laser;
+    Laser lasers[LASER_BEAMS];
+    LaserBus bus;
 };
 
 }  // namespace dosa
@@ -0,0 +1,156 @@
+/**
+ * Laser range finder frame parser.
+ *
+ * Continuous measurement frames are 11 bytes: [addr, 0x06, 0x83, 'D', 'D', 'D', '.', 'D', 'D', 'D', checksum], where
+ * the ASCII digits are the distance in metres.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#define LASER_FRAME_SIZE 11
+
+namespace dosa {
+
+/**
+ * A single checksummed measurement frame.
+ */
+struct LaserReading
+{
+    uint8_t address;    // device address the frame came from
+    bool error;         // device could not make a measurement, or the frame contained garbage
+    uint32_t distance;  // in mm, zero on error
+};
+
+class LaserFrameParser
+{
+   public:
+    /**
+     * Sum-complement checksum used by all laser commands and responses.
+     */
+    static uint8_t getChecksum(uint8_t const* data, size_t len)
+    {
+        uint8_t checksum = 0;
+
+        for (size_t i = 0; i < len; ++i) {
+            checksum = checksum + data[i];
+        }
+
+        return ~checksum + 1;
+    }
+
+    /**
+     * Feed a single byte from the UART.
+     *
+     * Returns true if a complete, checksummed frame was parsed, in which case `reading` is populated. Frames from any
+     * address are returned, it's up to the caller to match them to a device.
+     */
+    bool push(uint8_t b, LaserReading& reading)
+    {
+        // The schema never uses 0xFF outside of the checksum, and occasionally the device will add random 0xFF bytes
+        if (error_correction && b == 0xFF && pos < LASER_FRAME_SIZE - 1) {
+            return false;
+        }
+
+        if ((pos == 1 && b != 0x06) || (pos == 2 && b != 0x83)) {
+            // Lost our place in the stream, the byte may still be the start of the next frame
+            ++resyncs;
+            pos = 0;
+        }
+
+        buffer[pos++] = b;
+
+        if (pos < LASER_FRAME_SIZE) {
+            return false;
+        }
+
+        pos = 0;
+
+        if (buffer[LASER_FRAME_SIZE - 1] != getChecksum(buffer, LASER_FRAME_SIZE - 1)) {
+            ++checksum_errors;
+            return false;
+        }
+
+        ++frames;
+        reading.address = buffer[0];
+        reading.error = !decode(reading.distance);
+        return true;
+    }
+
+    /**
+     * Discard any partially read frame.
+     */
+    void reset()
+    {
+        pos = 0;
+    }
+
+    [[nodiscard]] uint32_t getFrameCount() const
+    {
+        return frames;
+    }
+
+    [[nodiscard]] uint32_t getChecksumErrors() const
+    {
+        return checksum_errors;
+    }
+
+    [[nodiscard]] uint32_t getResyncs() const
+    {
+        return resyncs;
+    }
+
+    [[nodiscard]] bool getErrorCorrection() const
+    {
+        return error_correction;
+    }
+
+    void setErrorCorrection(bool errorCorrection)
+    {
+        error_correction = errorCorrection;
+    }
+
+   private:
+    uint8_t buffer[LASER_FRAME_SIZE] = {0};
+    uint8_t pos = 0;
+    bool error_correction = true;
+
+    // Stats
+    uint32_t frames = 0;
+    uint32_t checksum_errors = 0;
+    uint32_t resyncs = 0;
+
+    /**
+     * Convert the "DDD.DDD" metre reading in the buffer to mm.
+     *
+     * Device prints ASCII 'ERR' when it can't make a measurement, which will fail the digit check.
+     */
+    bool decode(uint32_t& distance) const
+    {
+        distance = 0;
+
+        if (buffer[6] != '.') {
+            return false;
+        }
+
+        for (uint8_t i = 3; i < LASER_FRAME_SIZE - 1; ++i) {
+            if (i == 6) {
+                continue;
+            }
+
+            uint8_t digit = buffer[i] - '0';
+            if (digit > 9) {
+                distance = 0;
+                return false;
+            }
+
+            distance = distance * 10 + digit;
+        }
+
+        return true;
+    }
+};
+
+}  // namespace dosa
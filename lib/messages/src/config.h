@@ -5,6 +5,7 @@
 
 #include "const.h"
 #include "payload.h"
+#include "settings_layout.h"
 
 namespace dosa {
 namespace messages {
@@ -66,6 +67,14 @@ class Configuration : public Payload
 
         /**
          * uint32 (4 bytes):  relay activation time
+         *
+         * Optionally followed by the relay bank configuration:
+         * uint8  (1 byte):   channel count
+         * int8   (1 byte):   schedule timezone, hours from UTC
+         * uint8  (1 byte):   schedule entry count (N), max 8
+         * N x 6 bytes:       schedule entries: uint8 channel, uint8 days mask (bit 0 Sunday), uint16 start minute,
+         *                    uint16 end minute
+         * Byte-string:       channel map, "<device name>=<channel mask>" per line
          */
         RELAY_CALIBRATION = 8,
 
@@ -74,6 +83,21 @@ class Configuration : public Payload
          * Byte-string:       server address
          */
         STATS_SERVER = 9,
+
+        /**
+         * A batch of the above items, validated as a whole, applied in order and saved once. Each item:
+         * uint8  (1 byte):   ConfigItem, may not itself be BATCH
+         * uint16 (2 bytes):  item data size (N)
+         * N bytes:           item data, as for the single item
+         */
+        BATCH = 10,
+
+        /**
+         * uint16 (2 bytes):  server port, 0 for the build default
+         * Byte-string:       server host, empty for the build default; optionally followed by "\n" and the path
+         *                    holding the application directories
+         */
+        OTA_SERVER = 11,
     };
 
     /**
@@ -135,6 +159,58 @@ class Configuration : public Payload
         }
     }
 
+    /**
+     * True if `size` bytes of `data` are well-formed for `item`.
+     *
+     * Checks sizes and framing only, so that a batch can be rejected before any of it is applied. Strings must fit
+     * their settings field, so that nothing is truncated when saved. A BATCH is checked by ConfigBatch.
+     */
+    static bool isValidItem(ConfigItem item, uint8_t const* data, uint16_t size)
+    {
+        switch (item) {
+            case ConfigItem::PASSWORD:
+                return size >= 4 && fits(SettingsField::PIN, size);
+            case ConfigItem::DEVICE_NAME:
+                return size >= 2 && fits(SettingsField::DEVICE_NAME, size);
+            case ConfigItem::WIFI_AP: {
+                auto brk = static_cast<uint8_t const*>(memchr(data, '\n', size));
+                return brk != nullptr && fits(SettingsField::WIFI_SSID, brk - data) &&
+                       fits(SettingsField::WIFI_PASSWORD, size - (brk - data) - 1);
+            }
+            case ConfigItem::PIR_CALIBRATION:
+                return size == 9;
+            case ConfigItem::DOOR_CALIBRATION:
+                // Older clients send only the sequence values, leaving the motion controller untouched
+                return size == 14 || size == 33;
+            case ConfigItem::RANGE_CALIBRATION:
+                // Older clients send only the trigger values, leaving the filter untouched
+                return size == 8 || size == 17;
+            case ConfigItem::RELAY_CALIBRATION:
+                // Either the activation time alone, or followed by the channel bank configuration
+                return size == 4 || (size >= 7 && data[6] <= 8 && size >= 7 + data[6] * 6 &&
+                                     fits(SettingsField::RELAY_CHANNEL_MAP, size - 7 - data[6] * 6));
+            case ConfigItem::DEVICE_LOCK:
+                return size == 1;
+            case ConfigItem::LISTEN_DEVICES:
+                return fits(SettingsField::LISTEN_DEVICES, size);
+            case ConfigItem::STATS_SERVER:
+                return size >= 2 && fits(SettingsField::STATS_SERVER_ADDR, size - 2);
+            case ConfigItem::OTA_SERVER: {
+                // Port, then the host, optionally followed by a newline and the path
+                if (size < 2) {
+                    return false;
+                }
+
+                auto brk = static_cast<uint8_t const*>(memchr(data + 2, '\n', size - 2));
+                return brk == nullptr ? fits(SettingsField::OTA_SERVER_ADDR, size - 2)
+                                      : fits(SettingsField::OTA_SERVER_ADDR, brk - data - 2) &&
+                                            fits(SettingsField::OTA_SERVER_PATH, size - (brk - data) - 1);
+            }
+            default:
+                return false;
+        }
+    }
+
     [[nodiscard]] char const* getPayload() const override
     {
         return payload.getPayload();
@@ -147,6 +223,95 @@ class Configuration : public Payload
 
    protected:
     VariablePayload payload;
+
+    /**
+     * True if a string of `size` bytes fits the settings `field`.
+     */
+    static bool fits(SettingsField field, size_t size)
+    {
+        return size <= SettingsLayout::getCapacity(field);
+    }
+};
+
+/**
+ * Reader for the items of a BATCH configuration.
+ */
+class ConfigBatch
+{
+   public:
+    struct Item
+    {
+        Configuration::ConfigItem item;
+        uint8_t const* data;
+        uint16_t size;
+    };
+
+    ConfigBatch(uint8_t const* data, uint16_t size) : data(data), size(size) {}
+
+    /**
+     * True if the batch holds at least one item, every item is well-formed and none is itself a batch.
+     */
+    [[nodiscard]] bool isValid() const
+    {
+        uint16_t count = 0;
+        uint16_t pos = 0;
+        Item it{};
+
+        while (read(pos, it)) {
+            if (it.item == Configuration::ConfigItem::BATCH ||
+                !Configuration::isValidItem(it.item, it.data, it.size)) {
+                return false;
+            }
+            ++count;
+        }
+
+        // A trailing partial item header or an item overrunning the batch leaves unread bytes
+        return count > 0 && pos == size;
+    }
+
+    /**
+     * Number of complete items in the batch.
+     */
+    [[nodiscard]] uint16_t getCount() const
+    {
+        uint16_t count = 0;
+        uint16_t pos = 0;
+        Item it{};
+
+        while (read(pos, it)) {
+            ++count;
+        }
+
+        return count;
+    }
+
+    /**
+     * Read the item at `pos` into `it` and advance `pos` past it. Returns false at the end of the batch, or if the
+     * item does not fit within it.
+     */
+    bool read(uint16_t& pos, Item& it) const
+    {
+        if (size - pos < 3) {
+            return false;
+        }
+
+        uint16_t item_size;
+        memcpy(&item_size, data + pos + 1, 2);
+        if (size - pos - 3 < item_size) {
+            return false;
+        }
+
+        it.item = static_cast<Configuration::ConfigItem>(data[pos]);
+        it.data = data + pos + 3;
+        it.size = item_size;
+        pos += 3 + item_size;
+
+        return true;
+    }
+
+   private:
+    uint8_t const* data;
+    uint16_t size;
 };
 
 }  // namespace messages
@@ -10,14 +10,15 @@ typedef __uint64_t uint64_t;
 
 // Some generic commands (no additional info outside of the command itself, can use the GenericMessage class)
 #define DOSA_COMMS_MSG_BT_MODE "btc"   // request to fallback into Bluetooth config mode
-#define DOSA_COMMS_MSG_ONLINE "onl"    // device is online and ready
+#define DOSA_COMMS_MSG_ONLINE "onl"    // device is online and ready, with its uint32 version and uint8 device state
 #define DOSA_COMMS_MSG_BEGIN "bgn"     // device is beginning its primary function
 #define DOSA_COMMS_MSG_END "end"       // device has completed its primary function
 #define DOSA_COMMS_MSG_PING "pin"      // ping (request for pong)
-#define DOSA_COMMS_MSG_OTA "ota"       // request device check for (and install) OTA updates
+#define DOSA_COMMS_MSG_OTA "ota"       // request device check for (and install) OTA updates, with an optional rollout
 #define DOSA_COMMS_MSG_DEBUG "dbg"     // request device return log messages containing device state & settings
 #define DOSA_COMMS_MSG_FLUSH "fls"     // instruct recipients to flush any cached DOSA data (network reset)
 #define DOSA_COMMS_MSG_REQ_STAT "req"  // request the device reply with a full status message
+#define DOSA_COMMS_MSG_JOURNAL "jnl"   // request a page of the device's event journal, from an optional uint32 sequence
 
 // Command codes with additional information (and their own class)
 #define DOSA_COMMS_MSG_LOG "log"       // network-level log
@@ -57,7 +58,10 @@ static char const* bad_dev_name = "BAD_PACKET__________";
  */
 enum class StatusFormat : uint16_t
 {
-    STATUS_ONLY = 0,  // Message contains a single 1-byte flag containing the device state
+    STATUS_ONLY = 0,      // Message contains a single 1-byte flag containing the device state
+    RANGING = 1,          // Device state followed by the ranging sensor calibration
+    WINCH_TELEMETRY = 2,  // Device state followed by a chunk of a door sequence recording
+    JOURNAL = 3,          // Device state followed by a page of the event journal
 };
 
 }  // namespace messages
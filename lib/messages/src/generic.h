@@ -38,6 +38,17 @@ class GenericMessage final : public Payload
         buildBasePayload(payload);
     }
 
+    /**
+     * Generic message carrying `size` bytes of additional `data`.
+     */
+    explicit GenericMessage(char const* cmd_code, void const* data, uint16_t size, char const* dev_name)
+        : Payload(cmd_code, dev_name),
+          payload(DOSA_COMMS_PAYLOAD_BASE_SIZE + size)
+    {
+        buildBasePayload(payload);
+        payload.set(DOSA_COMMS_PAYLOAD_BASE_SIZE, data, size);
+    }
+
     static GenericMessage fromPacket(char const* packet, uint32_t size)
     {
         if (size < DOSA_COMMS_PAYLOAD_BASE_SIZE) {
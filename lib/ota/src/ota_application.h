@@ -5,8 +5,13 @@
 #include <HttpClient.h>
 #include <dosa.h>
 
+#include "ota_patch.h"
+#include "ota_rollout.h"
+#include "ota_stream.h"
+
 namespace dosa {
 
+// Build default OTA server, a device may be pointed at another (eg a LAN server) with the OTA_SERVER config item
 #ifndef DOSA_OTA_HOST
 #define DOSA_OTA_HOST "storage.googleapis.com"
 #define DOSA_OTA_PORT 80
@@ -17,6 +22,15 @@ namespace dosa {
 #define DOSA_OTA_SIZE_MIN 50000
 #define DOSA_OTA_SIZE_MAX 250000
 
+#define DOSA_OTA_ATTEMPTS 4      // Connections made to download an image, each resuming where the last dropped
+#define DOSA_OTA_TIMEOUT 5000    // Time without data before a download connection is dropped (ms)
+#define DOSA_OTA_CHUNK_SIZE 128  // Bytes requested from the network per read
+
+// Flash address of the running sketch, after the bootloader; patches are applied against the image held here
+#ifndef DOSA_OTA_SKETCH_START
+#define DOSA_OTA_SKETCH_START 0x2000
+#endif
+
 class OtaApplication : public App
 {
    public:
@@ -36,21 +50,76 @@ class OtaApplication : public App
     void loop() override
     {
         App::loop();
+
+        // Scheduled update check, staggered by the rollout
+        if (ota_pending && millis() - ota_requested >= ota_delay) {
+            ota_pending = false;
+            checkForUpdate();
+        }
     }
 
    private:
+    using ImageStream = OtaStream<decltype(InternalStorage)>;
+
+    OtaRollout rollout;
+    bool ota_pending = false;
+    uint32_t ota_requested = 0;
+    uint32_t ota_delay = 0;
+
     /**
-     * OTA update requested, check for new firmware.
+     * OTA update requested, schedule a check for new firmware if this device is in the rollout wave.
+     *
+     * The check is not made from the message handler; it waits out the device's share of the rollout spread so that a
+     * fleet does not hit the server at once.
      */
     void onOtaRequest(messages::GenericMessage const& msg, comms::Node const& sender)
     {
         // Send reply ack
         getContainer().getComms().dispatch(sender, messages::Ack(msg, getDeviceNameBytes()));
-        netLog("OTA update initiated by " + comms::ipToString(sender.ip));
 
+        OtaRollout request;
+        if (!OtaRollout::parse(msg.getMessage(), msg.getMessageSize(), request)) {
+            netLog("Malformed OTA rollout from " + comms::ipToString(sender.ip), NetLogLevel::ERROR);
+            return;
+        }
+
+        auto name = getDeviceNameBytes();
+        if (!request.includes(name)) {
+            logln(
+                "OTA wave " + String(request.getWave()) + "% excludes this device (bucket " +
+                    String(request.getBucket(name)) + ")");
+            return;
+        }
+
+        // Already running the rollout's version, report in so the wave can advance
+        if (request.getVersion() > 0 && request.getVersion() <= DOSA_VERSION) {
+            dispatchOnline();
+            return;
+        }
+
+        rollout = request;
+        ota_pending = true;
+        ota_requested = millis();
+        ota_delay = rollout.getDelay(name);
+
+        netLog(
+            "OTA update initiated by " + comms::ipToString(sender.ip) + ", server " + getOtaHost() + ", wave " +
+                String(rollout.getWave()) + "%, checking in " + String(ota_delay / 1000) + "s");
+    }
+
+    /**
+     * Check the OTA server for new firmware, applying it if it matches the rollout.
+     */
+    void checkForUpdate()
+    {
         auto ota_version = getOtaVersion();
         if (ota_version == 0) {
             return;
+        } else if (rollout.getVersion() > 0 && ota_version != rollout.getVersion()) {
+            netLog(
+                "OTA server publishes v" + String(ota_version) + ", not the rollout's v" +
+                    String(rollout.getVersion()) + "; not updating",
+                NetLogLevel::WARNING);
         } else if (ota_version > DOSA_VERSION) {
             performOtaUpdate(ota_version);
         } else {
@@ -58,6 +127,40 @@ class OtaApplication : public App
         }
     }
 
+    /**
+     * OTA server host, from settings or the build default.
+     */
+    String getOtaHost()
+    {
+        auto const& host = getSettings().getOtaServerAddr();
+        return host.length() > 0 ? host : String(DOSA_OTA_HOST);
+    }
+
+    uint16_t getOtaPort()
+    {
+        auto port = getSettings().getOtaServerPort();
+        return port > 0 ? port : DOSA_OTA_PORT;
+    }
+
+    /**
+     * Path holding the application directories, always with a trailing slash.
+     */
+    String getOtaPath()
+    {
+        String path = getSettings().getOtaServerPath();
+        if (path.length() == 0) {
+            return DOSA_OTA_PATH;
+        } else if (!path.startsWith("/")) {
+            path = "/" + path;
+        }
+
+        if (!path.endsWith("/")) {
+            path += "/";
+        }
+
+        return path;
+    }
+
     /**
      * Makes an HTTP request to the OTA server and retrieves the latest version number for this application.
      */
@@ -66,9 +169,9 @@ class OtaApplication : public App
         WiFiClient wifi_client;
         HttpClient http_client(wifi_client);
 
-        String path(DOSA_OTA_PATH);
+        String path = getOtaPath();
         path += config.short_name + "/version?v=" + String(random(100000));
-        http_client.get(DOSA_OTA_HOST, DOSA_OTA_PORT, path.c_str(), DOSA_OTA_UA);
+        http_client.get(getOtaHost().c_str(), getOtaPort(), path.c_str(), DOSA_OTA_UA);
 
         auto status = http_client.responseStatusCode();
         if (status != 200) {
@@ -83,63 +186,300 @@ class OtaApplication : public App
         return version.toInt();
     }
 
-    void performOtaUpdate(uint32_t version)
+    /**
+     * Retrieves the published CRC-32 of a build, 8 hex digits in `build-N.crc32` beside the binary.
+     */
+    bool getOtaDigest(uint32_t version, uint32_t& digest)
     {
-        netLog("Performing OTA update for " + config.short_name + " v" + version + "..");
-        getStats().count(stats::ota);
-
         WiFiClient wifi_client;
         HttpClient http_client(wifi_client);
 
-        String path(DOSA_OTA_PATH);
-        path += config.short_name + "/build-" + String(version) + ".bin";
-        http_client.get(DOSA_OTA_HOST, DOSA_OTA_PORT, path.c_str(), DOSA_OTA_UA);
+        String path = getOtaPath();
+        path += config.short_name + "/build-" + String(version) + ".crc32";
+        http_client.get(getOtaHost().c_str(), getOtaPort(), path.c_str(), DOSA_OTA_UA);
 
         auto status = http_client.responseStatusCode();
         if (status != 200) {
             http_client.stop();
-            netLog("OTA update download failed: " + String(status), NetLogLevel::ERROR);
-            return;
+            netLog("OTA digest check failed: " + String(status), NetLogLevel::ERROR);
+            return false;
         }
 
         http_client.skipResponseHeaders();
-        auto content_length = http_client.contentLength();
+        auto text = http_client.readStringUntil('\n');
+        http_client.stop();
+
+        if (!ImageStream::parseDigest(text.c_str(), text.length(), digest)) {
+            netLog("Malformed OTA digest: " + text, NetLogLevel::ERROR);
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Updates to a build, from a patch against the running image if one is published, else from the full image.
+     *
+     * Either way the new image is checked against its published digest before it is applied.
+     */
+    void performOtaUpdate(uint32_t version)
+    {
+        netLog("Performing OTA update for " + config.short_name + " v" + version + "..");
+        getStats().count(stats::ota);
 
-        if (content_length == 0) {
-            netLog("Cannot update via OTA; null content-length", NetLogLevel::ERROR);
+        uint32_t digest;
+        if (!getOtaDigest(version, digest)) {
             return;
-        } else if (content_length < DOSA_OTA_SIZE_MIN) {
-            netLog("Cannot update via OTA; payload size too small", NetLogLevel::ERROR);
+        }
+
+        if (!performPatchUpdate(version, digest)) {
+            performImageUpdate(version, digest);
+        }
+    }
+
+    /**
+     * Downloads the full image of a build into InternalStorage and applies it.
+     */
+    void performImageUpdate(uint32_t version, uint32_t digest)
+    {
+        String path = getOtaPath();
+        path += config.short_name + "/build-" + String(version) + ".bin";
+
+        ImageStream stream(InternalStorage);
+        uint32_t started = millis();
+
+        auto image_size = downloadOtaAsset(path, stream, 0, false);
+        if (image_size == 0) {
             return;
+        }
+
+        InternalStorage.close();
+        applyOtaImage(stream, digest, image_size, millis() - started);
+    }
+
+    /**
+     * Downloads the patch from the running build to `version`, rebuilding the new image into InternalStorage from the
+     * running flash as it arrives, and applies it.
+     *
+     * Returns false if there is no usable patch, leaving the caller to fall back to the full image.
+     */
+    bool performPatchUpdate(uint32_t version, uint32_t digest)
+    {
+        String path = getOtaPath();
+        path += config.short_name + "/build-" + String(version) + "-from-" + String(DOSA_VERSION) + ".patch";
+
+        ImageStream stream(InternalStorage);
+        OtaPatcher<ImageStream> patcher(
+            reinterpret_cast<uint8_t const*>(DOSA_OTA_SKETCH_START),
+            InternalStorage.maxSize(),
+            stream);
+        uint32_t started = millis();
+
+        // The image size isn't known until the patch header arrives, so reserve the most an image may take
+        auto patch_size = downloadOtaAsset(path, patcher, DOSA_OTA_SIZE_MAX, true);
+        if (patch_size == 0) {
+            return false;
+        }
+
+        InternalStorage.close();
+
+        auto const& header = patcher.getHeader();
+        if (!patcher.isComplete()) {
+            netLog(
+                "OTA patch could not be applied (error " + String(static_cast<uint8_t>(patcher.getError())) +
+                    "), downloading full image",
+                NetLogLevel::WARNING);
+            getStats().count(String(stats::ota) + ".patch_failed");
+            return false;
+        } else if (header.new_size < DOSA_OTA_SIZE_MIN || header.new_size > DOSA_OTA_SIZE_MAX) {
+            netLog("OTA patch builds an image of invalid size, downloading full image", NetLogLevel::WARNING);
+            return false;
+        }
+
+        netLog(
+            "Patched " + String(header.old_size) + " byte image to " + String(header.new_size) + " bytes from a " +
+                String(patch_size) + " byte patch");
+        getStats().count(String(stats::ota) + ".patch");
+
+        // A patched image that fails its digest isn't retried from the full image, something is amiss with the build
+        applyOtaImage(stream, digest, header.new_size, millis() - started);
+        return true;
+    }
+
+    /**
+     * Checks a downloaded image against its published digest, and applies it.
+     */
+    void applyOtaImage(ImageStream const& stream, uint32_t digest, uint32_t image_size, uint32_t elapsed)
+    {
+        uint32_t rate = ImageStream::getRate(image_size, elapsed);
+        getStats().timing(String(stats::ota) + ".download", elapsed);
+        getStats().gauge(String(stats::ota) + ".rate", rate);
+
+        if (stream.getCrc() != digest) {
+            netLog(
+                "OTA image failed integrity check (CRC " + String(stream.getCrc(), HEX) + ", published " +
+                    String(digest, HEX) + "), not applying",
+                NetLogLevel::ERROR);
+            getStats().count(String(stats::ota) + ".corrupt");
+            return;
+        }
+
+        netLog(
+            "Downloaded " + String(image_size) + " bytes in " + String(elapsed) + " ms (" + String(rate / 1024) +
+            " KiB/s)");
+
+        netLog("Device applying OTA update");
+        InternalStorage.apply();
+    }
+
+    /**
+     * Downloads an OTA asset into `sink`, opening InternalStorage for `reserve` bytes, or the asset size if 0.
+     *
+     * The asset is read from the network in chunks. A dropped connection is resumed with an HTTP Range request from the
+     * last byte received, as InternalStorage cannot be reopened without erasing it. Returns the size of the asset, or
+     * 0 if it could not be downloaded in full. An `optional` asset missing from the server is not logged as an error.
+     */
+    template <class Sink>
+    uint32_t downloadOtaAsset(String const& path, Sink& sink, uint32_t reserve, bool optional)
+    {
+        uint32_t asset_size = 0;
+
+        for (uint8_t attempt = 0; attempt < DOSA_OTA_ATTEMPTS; ++attempt) {
+            uint32_t offset = sink.getReceived();
+            if (attempt > 0) {
+                netLog("Resuming OTA download from byte " + String(offset), NetLogLevel::WARNING);
+            }
+
+            WiFiClient wifi_client;
+            HttpClient http_client(wifi_client);
+
+            http_client.beginRequest();
+            http_client.get(getOtaHost().c_str(), getOtaPort(), path.c_str(), DOSA_OTA_UA);
+            if (offset > 0) {
+                String range("bytes=");
+                range += String(offset) + "-";
+                http_client.sendHeader("Range", range.c_str());
+            }
+            http_client.endRequest();
+
+            auto status = http_client.responseStatusCode();
+            if (status != 200 && status != 206) {
+                http_client.stop();
+                if (optional && status == 404) {
+                    logln("No OTA asset at " + path, LogLevel::DEBUG);
+                    return 0;
+                }
+
+                netLog("OTA download failed: " + String(status), NetLogLevel::ERROR);
+
+                // A negative status is a connection failure, worth retrying; an HTTP error is not
+                if (status < 0) {
+                    continue;
+                }
+                return 0;
+            }
+
+            http_client.skipResponseHeaders();
+            uint32_t content_length = http_client.contentLength();
+
+            // A server ignoring the range resends the whole asset, skip what we already have
+            uint32_t skip = 0;
+            if (offset == 0) {
+                if (content_length == 0) {
+                    http_client.stop();
+                    netLog("Cannot update via OTA; null content-length", NetLogLevel::ERROR);
+                    return 0;
+                } else if (!openOtaStorage(reserve > 0 ? reserve : content_length)) {
+                    http_client.stop();
+                    return 0;
+                }
+                asset_size = content_length;
+            } else if (status == 200) {
+                skip = offset;
+            }
+
+            bool complete = receiveOtaAsset(http_client, sink, skip, asset_size);
+            http_client.stop();
+
+            if (complete) {
+                break;
+            }
+        }
+
+        if (asset_size == 0) {
+            return 0;
+        } else if (sink.getReceived() != asset_size) {
+            InternalStorage.close();
+            netLog(
+                "OTA download incomplete after " + String(DOSA_OTA_ATTEMPTS) + " attempts (" +
+                    String(sink.getReceived()) + "/" + String(asset_size) + " bytes)",
+                NetLogLevel::ERROR);
+            getStats().count(String(stats::ota) + ".incomplete");
+            return 0;
+        }
+
+        return asset_size;
+    }
+
+    /**
+     * Validates the image size and opens (erasing) InternalStorage for it.
+     */
+    bool openOtaStorage(uint32_t content_length)
+    {
+        if (content_length < DOSA_OTA_SIZE_MIN) {
+            netLog("Cannot update via OTA; payload size too small", NetLogLevel::ERROR);
+            return false;
         } else if (content_length > DOSA_OTA_SIZE_MAX) {
             netLog("Cannot update via OTA; payload size too large", NetLogLevel::ERROR);
-            return;
+            return false;
         }
 
         if (!InternalStorage.open(content_length)) {
-            http_client.stop();
             netLog("Insufficient space for OTA update", NetLogLevel::ERROR);
-            return;
+            return false;
         }
 
-        // We can only write to internal storage 1-byte at a time, so download the OTA update and write as we go
-        byte b;
-        while (content_length > 0) {
-            if (!http_client.readBytes(&b, 1)) {
-                // Timeout occurred
-                netLog("Timeout while downloading OTA update");
-                return;
+        return true;
+    }
+
+    /**
+     * Reads the response body into the sink until the asset is complete, discarding the first `skip` bytes.
+     *
+     * Returns false if the connection stalls or closes first, the sink then holds everything received so far.
+     */
+    template <class Sink>
+    bool receiveOtaAsset(HttpClient& http_client, Sink& sink, uint32_t skip, uint32_t asset_size)
+    {
+        uint8_t chunk[DOSA_OTA_CHUNK_SIZE];
+        uint32_t last_data = millis();
+
+        while (sink.getReceived() < asset_size) {
+            uint32_t want = skip > 0 ? skip : asset_size - sink.getReceived();
+            if (want > DOSA_OTA_CHUNK_SIZE) {
+                want = DOSA_OTA_CHUNK_SIZE;
             }
 
-            InternalStorage.write(b);
-            --content_length;
-        }
+            int n = http_client.read(chunk, want);
+            if (n <= 0) {
+                if (!http_client.connected() && !http_client.available()) {
+                    netLog("Connection closed while downloading OTA update", NetLogLevel::WARNING);
+                    return false;
+                } else if (millis() - last_data > DOSA_OTA_TIMEOUT) {
+                    netLog("Timeout while downloading OTA update", NetLogLevel::WARNING);
+                    return false;
+                }
+                continue;
+            }
 
-        InternalStorage.close();
-        http_client.stop();
+            last_data = millis();
+            if (skip > 0) {
+                skip -= n;
+            } else {
+                sink.write(chunk, n);
+            }
+        }
 
-        netLog("Device applying OTA update");
-        InternalStorage.apply();
+        return true;
     }
 
     /**
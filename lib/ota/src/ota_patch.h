@@ -0,0 +1,306 @@
+/**
+ * Applies a binary delta patch to the running firmware, streaming the new image out as the patch arrives.
+ *
+ * Patches are bsdiff-style: the new image is built from blocks, each adding a run of diff bytes to the old image then
+ * appending a run of extra bytes that have no counterpart in it. Code that has only moved leaves the diff bytes mostly
+ * zero, which are run-length encoded rather than compressed, so that applying a patch needs no more RAM than this
+ * class.
+ *
+ * Patch layout (little-endian):
+ *   Offset  Size  Type      Detail
+ *   ----------------------------------
+ *   0       4     char[4]   Magic, "DOSP"
+ *   4       4     uint32    Size of the old image
+ *   8       4     uint32    CRC-32 of the old image
+ *   12      4     uint32    Size of the new image
+ *   16      4     uint32    CRC-32 of the new image
+ *   20      ...   ...       Blocks, until the new image is complete
+ *
+ * Block layout:
+ *   0       4     uint32    Diff length, bytes of new image taken from the old image plus a diff byte
+ *   4       4     uint32    Extra length, bytes of new image given verbatim
+ *   8       4     int32     Seek, applied to the old image position after the diff
+ *   12      ...   ...       Diff tokens, then the extra bytes
+ *
+ * A diff token under 0x80 is followed by that many plus one diff bytes; a token of 0x80 or above is a run of (token -
+ * 0x7F) zero diff bytes, with nothing following.
+ *
+ * `Stream` must provide `write(uint8_t const* data, size_t size)`, as OtaStream does.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "crc32.h"
+
+#define DOSA_OTA_PATCH_MAGIC "DOSP"
+#define DOSA_OTA_PATCH_HEADER_SIZE 20
+#define DOSA_OTA_PATCH_CONTROL_SIZE 12
+#define DOSA_OTA_PATCH_ZERO_RUN 0x80
+
+namespace dosa {
+
+enum class OtaPatchError : uint8_t
+{
+    NONE = 0,
+    HEADER = 1,    // Bad magic, or an old image larger than the flash holds
+    SOURCE = 2,    // The running image is not the one the patch was made from
+    CONTROL = 3,   // A block runs outside of either image
+    TRAILING = 4,  // Data after the new image was complete
+};
+
+struct OtaPatchHeader
+{
+    char magic[4];
+    uint32_t old_size;
+    uint32_t old_crc;
+    uint32_t new_size;
+    uint32_t new_crc;
+};
+
+static_assert(sizeof(OtaPatchHeader) == DOSA_OTA_PATCH_HEADER_SIZE, "Patch header is not packed");
+
+template <class Stream>
+class OtaPatcher
+{
+   public:
+    /**
+     * Patch the `old_capacity` bytes of `old` available, writing the new image to `stream`.
+     */
+    OtaPatcher(uint8_t const* old, uint32_t old_capacity, Stream& stream)
+        : old(old),
+          old_capacity(old_capacity),
+          stream(stream)
+    {}
+
+    /**
+     * Add `size` bytes of the patch. Once failed, further data is ignored.
+     */
+    void write(uint8_t const* data, size_t size)
+    {
+        for (size_t i = 0; i < size && state != State::FAILED; ++i) {
+            ++received;
+            consume(data[i]);
+        }
+
+        flushOutput();
+    }
+
+    /**
+     * The patch has been applied in full; the stream holds the whole new image.
+     */
+    [[nodiscard]] bool isComplete() const
+    {
+        return state == State::DONE;
+    }
+
+    [[nodiscard]] OtaPatchError getError() const
+    {
+        return error;
+    }
+
+    /**
+     * Bytes of the patch received so far. A resumed download continues from here.
+     */
+    [[nodiscard]] uint32_t getReceived() const
+    {
+        return received;
+    }
+
+    /**
+     * Bytes of the new image produced.
+     */
+    [[nodiscard]] uint32_t getWritten() const
+    {
+        return written;
+    }
+
+    /**
+     * Header of the patch, valid once the first DOSA_OTA_PATCH_HEADER_SIZE bytes have been received.
+     */
+    [[nodiscard]] OtaPatchHeader const& getHeader() const
+    {
+        return header;
+    }
+
+   private:
+    enum class State : uint8_t
+    {
+        HEADER,
+        CONTROL,
+        TOKEN,
+        LITERAL,
+        EXTRA,
+        DONE,
+        FAILED,
+    };
+
+    uint8_t const* old;
+    uint32_t old_capacity;
+    Stream& stream;
+
+    State state = State::HEADER;
+    OtaPatchError error = OtaPatchError::NONE;
+    OtaPatchHeader header = {};
+    uint8_t control[DOSA_OTA_PATCH_CONTROL_SIZE] = {0};
+    uint8_t filled = 0;
+
+    uint32_t received = 0;
+    uint32_t written = 0;
+    uint32_t old_pos = 0;
+    uint32_t diff_left = 0;
+    uint32_t extra_left = 0;
+    int32_t seek = 0;
+    uint8_t literal_left = 0;
+
+    uint8_t output[32] = {0};
+    uint8_t output_size = 0;
+
+    void consume(uint8_t b)
+    {
+        switch (state) {
+            case State::HEADER:
+                reinterpret_cast<uint8_t*>(&header)[filled++] = b;
+                if (filled == DOSA_OTA_PATCH_HEADER_SIZE) {
+                    filled = 0;
+                    beginPatch();
+                }
+                break;
+            case State::CONTROL:
+                control[filled++] = b;
+                if (filled == DOSA_OTA_PATCH_CONTROL_SIZE) {
+                    filled = 0;
+                    beginBlock();
+                }
+                break;
+            case State::TOKEN:
+                if (b < DOSA_OTA_PATCH_ZERO_RUN) {
+                    literal_left = b + 1;
+                    if (literal_left > diff_left) {
+                        fail(OtaPatchError::CONTROL);
+                        return;
+                    }
+                    state = State::LITERAL;
+                } else {
+                    uint8_t zeros = b - (DOSA_OTA_PATCH_ZERO_RUN - 1);
+                    if (zeros > diff_left) {
+                        fail(OtaPatchError::CONTROL);
+                        return;
+                    }
+
+                    for (uint8_t i = 0; i < zeros; ++i) {
+                        emit(old[old_pos++]);
+                    }
+                    diff_left -= zeros;
+                    if (diff_left == 0) {
+                        endDiff();
+                    }
+                }
+                break;
+            case State::LITERAL:
+                emit(old[old_pos++] + b);
+                --literal_left;
+                if (--diff_left == 0) {
+                    endDiff();
+                } else if (literal_left == 0) {
+                    state = State::TOKEN;
+                }
+                break;
+            case State::EXTRA:
+                emit(b);
+                if (--extra_left == 0) {
+                    endBlock();
+                }
+                break;
+            case State::DONE:
+                fail(OtaPatchError::TRAILING);
+                break;
+            case State::FAILED:
+                break;
+        }
+    }
+
+    void beginPatch()
+    {
+        if (memcmp(header.magic, DOSA_OTA_PATCH_MAGIC, 4) != 0 || header.old_size > old_capacity) {
+            fail(OtaPatchError::HEADER);
+        } else if (Crc32::of(old, header.old_size) != header.old_crc) {
+            fail(OtaPatchError::SOURCE);
+        } else {
+            state = header.new_size == 0 ? State::DONE : State::CONTROL;
+        }
+    }
+
+    void beginBlock()
+    {
+        memcpy(&diff_left, control, 4);
+        memcpy(&extra_left, control + 4, 4);
+        memcpy(&seek, control + 8, 4);
+
+        if (uint64_t(getProduced()) + diff_left + extra_left > header.new_size ||
+            uint64_t(old_pos) + diff_left > header.old_size) {
+            fail(OtaPatchError::CONTROL);
+        } else if (diff_left > 0) {
+            state = State::TOKEN;
+        } else {
+            endDiff();
+        }
+    }
+
+    void endDiff()
+    {
+        if (extra_left > 0) {
+            state = State::EXTRA;
+        } else {
+            endBlock();
+        }
+    }
+
+    void endBlock()
+    {
+        int64_t pos = int64_t(old_pos) + seek;
+        if (pos < 0 || pos > int64_t(header.old_size)) {
+            fail(OtaPatchError::CONTROL);
+            return;
+        }
+
+        old_pos = uint32_t(pos);
+        state = getProduced() == header.new_size ? State::DONE : State::CONTROL;
+    }
+
+    /**
+     * Bytes of the new image produced, including those not yet handed to the stream.
+     */
+    [[nodiscard]] uint32_t getProduced() const
+    {
+        return written + output_size;
+    }
+
+    void emit(uint8_t b)
+    {
+        output[output_size++] = b;
+        if (output_size == sizeof(output)) {
+            flushOutput();
+        }
+    }
+
+    void flushOutput()
+    {
+        if (output_size > 0) {
+            stream.write(output, output_size);
+            written += output_size;
+            output_size = 0;
+        }
+    }
+
+    void fail(OtaPatchError e)
+    {
+        state = State::FAILED;
+        error = e;
+    }
+};
+
+}  // namespace dosa
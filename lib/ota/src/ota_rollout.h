@@ -0,0 +1,127 @@
+/**
+ * Staggered OTA rollout, so that a fleet neither hits the server at once nor takes a bad build all together.
+ *
+ * An OTA request may carry a rollout (little-endian):
+ *   Offset  Size  Type      Detail
+ *   ----------------------------------
+ *   0       1     uint8     Wave, the percentage of the fleet that should update (1-100)
+ *   1       2     uint16    Spread, seconds over which the wave's version checks are staggered
+ *   3       4     uint32    Target version, 0 for whatever the server publishes
+ *
+ * A device's place in the fleet is taken from the CRC-32 of its name followed by the target version, so it is stable
+ * for a release, but the canaries differ from one release to the next. A device is in a wave if its bucket (0-99) is
+ * under the wave percentage, so each wave includes the one before it. The same hash spreads the devices of a wave over
+ * the spread window. A request without a rollout is a single 100% wave with no delay, as before.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "crc32.h"
+
+#define DOSA_OTA_ROLLOUT_SIZE 7
+#define DOSA_OTA_NAME_SIZE 20
+
+namespace dosa {
+
+class OtaRollout
+{
+   public:
+    OtaRollout() = default;
+
+    OtaRollout(uint8_t wave, uint16_t spread, uint32_t version) : wave(wave), spread(spread), version(version) {}
+
+    /**
+     * Read a rollout from the message data of an OTA request. Returns false if present but malformed.
+     */
+    static bool parse(void const* data, size_t size, OtaRollout& rollout)
+    {
+        if (size == 0) {
+            rollout = OtaRollout();
+            return true;
+        } else if (size < DOSA_OTA_ROLLOUT_SIZE) {
+            return false;
+        }
+
+        auto const* ptr = static_cast<uint8_t const*>(data);
+        OtaRollout r;
+        r.wave = ptr[0];
+        memcpy(&r.spread, ptr + 1, 2);
+        memcpy(&r.version, ptr + 3, 4);
+
+        if (r.wave == 0 || r.wave > 100) {
+            return false;
+        }
+
+        rollout = r;
+        return true;
+    }
+
+    /**
+     * Hash placing the device `name` (null-padded, up to DOSA_OTA_NAME_SIZE bytes) in the fleet for this rollout.
+     */
+    [[nodiscard]] uint32_t getHash(char const* name) const
+    {
+        size_t len = 0;
+        while (len < DOSA_OTA_NAME_SIZE && name[len] != 0) {
+            ++len;
+        }
+
+        Crc32 crc;
+        crc.update(name, len);
+        crc.update(&version, 4);
+        return crc.getValue();
+    }
+
+    /**
+     * Bucket of the device `name`, 0-99.
+     */
+    [[nodiscard]] uint8_t getBucket(char const* name) const
+    {
+        return getHash(name) % 100;
+    }
+
+    /**
+     * Check if the device `name` should take part in this wave.
+     */
+    [[nodiscard]] bool includes(char const* name) const
+    {
+        return getBucket(name) < wave;
+    }
+
+    /**
+     * Time the device `name` should wait before checking for the update, ms.
+     */
+    [[nodiscard]] uint32_t getDelay(char const* name) const
+    {
+        return spread == 0 ? 0 : (getHash(name) / 100) % (uint32_t(spread) * 1000);
+    }
+
+    [[nodiscard]] uint8_t getWave() const
+    {
+        return wave;
+    }
+
+    [[nodiscard]] uint16_t getSpread() const
+    {
+        return spread;
+    }
+
+    /**
+     * Version the rollout is for, 0 if any published version.
+     */
+    [[nodiscard]] uint32_t getVersion() const
+    {
+        return version;
+    }
+
+   private:
+    uint8_t wave = 100;
+    uint16_t spread = 0;
+    uint32_t version = 0;
+};
+
+}  // namespace dosa
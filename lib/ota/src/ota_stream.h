@@ -0,0 +1,105 @@
+/**
+ * Streams a downloaded firmware image into flash storage.
+ *
+ * Network reads arrive in chunks of any size and are passed straight to the storage, which takes a byte at a time and
+ * does its own buffering into flash. A CRC-32 is built up as the image streams, so it can be checked against the
+ * published digest before the image is applied.
+ *
+ * `Storage` must provide `write(uint8_t)`, as InternalStorage does.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "crc32.h"
+
+namespace dosa {
+
+template <class Storage>
+class OtaStream
+{
+   public:
+    explicit OtaStream(Storage& storage) : storage(storage) {}
+
+    /**
+     * Add `size` bytes of `data` to the image.
+     */
+    void write(uint8_t const* data, size_t size)
+    {
+        crc.update(data, size);
+        received += size;
+
+        for (size_t i = 0; i < size; ++i) {
+            storage.write(data[i]);
+        }
+    }
+
+    /**
+     * Bytes of the image received so far. A resumed download continues from here.
+     */
+    [[nodiscard]] uint32_t getReceived() const
+    {
+        return received;
+    }
+
+    /**
+     * CRC-32 of the image received so far.
+     */
+    [[nodiscard]] uint32_t getCrc() const
+    {
+        return crc.getValue();
+    }
+
+    /**
+     * Parse a published digest, 8 hex digits optionally followed by whitespace. Returns false if malformed.
+     */
+    static bool parseDigest(char const* text, size_t size, uint32_t& digest)
+    {
+        if (size < 8) {
+            return false;
+        }
+
+        digest = 0;
+        for (uint8_t i = 0; i < 8; ++i) {
+            char c = text[i];
+            uint8_t nibble;
+            if (c >= '0' && c <= '9') {
+                nibble = c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                nibble = c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                nibble = c - 'A' + 10;
+            } else {
+                return false;
+            }
+
+            digest = (digest << 4) | nibble;
+        }
+
+        for (size_t i = 8; i < size; ++i) {
+            if (text[i] != '\n' && text[i] != '\r' && text[i] != ' ') {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Throughput in bytes per second for `bytes` over `elapsed` ms.
+     */
+    static uint32_t getRate(uint32_t bytes, uint32_t elapsed)
+    {
+        return elapsed == 0 ? bytes : uint32_t(uint64_t(bytes) * 1000 / elapsed);
+    }
+
+   private:
+    Storage& storage;
+    Crc32 crc;
+    uint32_t received = 0;
+};
+
+}  // namespace dosa
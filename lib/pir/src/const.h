@@ -15,3 +15,23 @@
  * Time (in ms) before firing a second trigger message.
  */
 #define REFIRE_DELAY 5000
+
+/**
+ * Use the IR grid hardware interrupt instead of polling every IR_POLL ms. Requires the sensor INT pin be wired to
+ * IR_GRID_INT_PIN.
+ *
+ *   0: disabled, poll the grid every IR_POLL ms
+ *   1: difference mode, the sensor fires when any pixel changes by more than the PIR pixel delta between its frames
+ *   2: absolute mode, the sensor fires when any pixel exceeds the resting frame range by more than the pixel delta
+ *
+ * When the interrupt fires, the full frame is read and analysed as per the polling mode, no more often than IR_POLL.
+ */
+#ifndef IR_INTERRUPT_MODE
+#define IR_INTERRUPT_MODE 0
+#endif
+
+/**
+ * Time (in ms) between reading a resting frame while in interrupt mode. This keeps the comparison frame fresh against
+ * ambient drift and re-programs absolute thresholds.
+ */
+#define IR_BASELINE_REFRESH 10000
@@ -1,2 +1,5 @@
+#include "frame_source.h"
+#include "grid_frame_source.h"
 #include "pir_app.h"
 #include "pir_container.h"
+#include "pir_detector.h"
@@ -0,0 +1,27 @@
+/**
+ * Source of 8x8 infrared frames.
+ *
+ * Abstracts the IR grid away from the detection logic so that the detector may be fed by either the hardware or a
+ * recorded corpus on a host machine.
+ */
+
+#pragma once
+
+#define PIR_FRAME_PIXELS 64
+
+namespace dosa {
+
+class FrameSource
+{
+   public:
+    virtual ~FrameSource() = default;
+
+    /**
+     * Fill `frame` with PIR_FRAME_PIXELS pixel temperatures (Celsius), row-major.
+     *
+     * Returns false if a frame could not be read.
+     */
+    virtual bool readFrame(float* frame) = 0;
+};
+
+}  // namespace dosa
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <dosa.h>
+
+#include "frame_source.h"
+
+namespace dosa {
+
+/**
+ * Frame source backed by the hardware IR grid.
+ */
+class GridFrameSource : public FrameSource
+{
+   public:
+    explicit GridFrameSource(IrGrid& ir) : ir(ir) {}
+
+    bool readFrame(float* frame) override
+    {
+        for (unsigned char index = 0; index < PIR_FRAME_PIXELS; ++index) {
+            frame[index] = ir.getPixelTemp(index);
+        }
+
+        return true;
+    }
+
+   protected:
+    IrGrid& ir;
+};
+
+}  // namespace dosa
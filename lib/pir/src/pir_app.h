@@ -4,6 +4,7 @@
 
 #include "const.h"
 #include "pir_container.h"
+#include "pir_detector.h"
 
 namespace dosa {
 
@@ -15,6 +16,10 @@ class PirApp final : public dosa::OtaApplication
     void init() override
     {
         OtaApplication::init();
+
+#if IR_INTERRUPT_MODE > 0
+        logln("IR grid in interrupt mode");
+#endif
     }
 
     void loop() override
@@ -28,61 +33,100 @@ class PirApp final : public dosa::OtaApplication
    private:
     PirContainer container;
 
-    float grid[64] = {0};
-    unsigned long last_fired = 0;
+    PirDetector detector;
     unsigned long ir_grid_last_update = 0;  // Last time we polled the sensor
+    float ir_armed_pixel_delta = 0;         // Pixel delta the interrupt thresholds were last derived from
 
     void checkIrGrid()
     {
-        if (millis() - ir_grid_last_update > IR_POLL) {
-            ir_grid_last_update = millis();
-
-            auto& ir = container.getIrGrid();
-            auto& serial = container.getSerial();
-            auto& settings = container.getSettings();
-
-            float new_grid[64] = {0};
-            float ttl_delta = 0;
-            uint8_t changed = 0;
-            uint8_t map[64] = {0};
-
-            for (unsigned row = 0; row < 8; ++row) {
-                for (unsigned col = 0; col < 8; ++col) {
-                    auto index = col + (row * 8);
-                    new_grid[index] = ir.getPixelTemp(index);
-
-                    float delta = abs(new_grid[index] - grid[index]);
-                    if (delta >= settings.getPirPixelDelta()) {
-                        ++changed;
-                        ttl_delta += delta;
-                        map[index] = delta * 10;  // NB: truncated precision
-                    } else {
-                        map[index] = 0;
-                    }
-                }
-            }
+        if (!irGridReady()) {
+            return;
+        }
+
+        ir_grid_last_update = millis();
+
+        auto const& settings = container.getSettings();
+        PirCalibration calibration{
+            settings.getPirMinPixels(),
+            settings.getPirPixelDelta(),
+            settings.getPirTotalDelta()};
 
-            triggerIf(ttl_delta, changed, map);
-            memcpy(grid, new_grid, sizeof(float) * 64);
+        if (detector.process(container.getFrameSource(), millis(), calibration)) {
+            onMotion(detector.getMap());
         }
+
+#if IR_INTERRUPT_MODE > 0
+        armIrInterrupt(calibration);
+#endif
     }
 
     /**
-     * Fire a trigger message if rules for comparing IR-grid deltas pass.
+     * Check if the grid should be read.
      *
-     * Will also consider a cool-down before a second trigger.
+     * When polling, this is every IR_POLL ms. In interrupt mode the grid is only read when the sensor has fired (no
+     * more often than IR_POLL) or the resting frame is due to be refreshed.
      */
-    bool triggerIf(float ttl_delta, uint8_t pixels_changed, uint8_t const* map)
+    bool irGridReady()
     {
-        auto& settings = container.getSettings();
+        auto since_update = millis() - ir_grid_last_update;
 
-        if (grid[0] == 0 || ttl_delta < settings.getPirTotalDelta() || pixels_changed < settings.getPirMinPixels() ||
-            millis() - last_fired < REFIRE_DELAY) {
-            return false;
+#if IR_INTERRUPT_MODE > 0
+        auto& ir = container.getIrGrid();
+        if (!ir.isInterruptEnabled() || since_update > IR_BASELINE_REFRESH) {
+            return true;
         }
 
+        return since_update > IR_POLL && ir.isInterruptPending();
+#else
+        return since_update > IR_POLL;
+#endif
+    }
+
+#if IR_INTERRUPT_MODE > 0
+    /**
+     * Program the IR grid interrupt thresholds from calibration settings and release the INT pin.
+     *
+     * Difference thresholds only depend on the calibration, so are only re-programmed if it changes. Absolute
+     * thresholds are derived from the range of the last frame read and are re-programmed with every frame.
+     */
+    void armIrInterrupt(PirCalibration const& calibration)
+    {
+        auto& ir = container.getIrGrid();
+
+#if IR_INTERRUPT_MODE == 2
+        auto frame = detector.getFrame();
+        float lowest = frame[0], highest = frame[0];
+        for (unsigned i = 1; i < PIR_FRAME_PIXELS; ++i) {
+            lowest = min(lowest, frame[i]);
+            highest = max(highest, frame[i]);
+        }
+
+        ir.enableInterrupt(
+            IrInterruptMode::ABSOLUTE,
+            highest + calibration.pixel_delta,
+            lowest - calibration.pixel_delta,
+            calibration.pixel_delta / 2);
+#else
+        if (!ir.isInterruptEnabled() || ir_armed_pixel_delta != calibration.pixel_delta) {
+            ir.enableInterrupt(
+                IrInterruptMode::DIFFERENCE,
+                calibration.pixel_delta,
+                -calibration.pixel_delta,
+                calibration.pixel_delta / 2);
+            ir_armed_pixel_delta = calibration.pixel_delta;
+        } else {
+            ir.clearInterrupt();
+        }
+#endif
+    }
+#endif
+
+    /**
+     * The detector has reported motion, fire a trigger message (or security alert if locked).
+     */
+    void onMotion(uint8_t const* map)
+    {
         logln("IR grid motion detected");
-        last_fired = millis();
 
         if (isLocked()) {
             netLog("Trigger in locked state");
@@ -107,11 +151,10 @@ class PirApp final : public dosa::OtaApplication
         } else {
             // Normal mode: dispatch trigger
             logln("IR grid motion detected");
+            journal(JournalEvent::TRIGGER, 1);
             dispatchMessage(messages::Trigger(messages::TriggerDevice::SENSOR_GRID, map, getDeviceNameBytes()), true);
             getStats().count(stats::trigger);
         }
-
-        return true;
     }
 
     void onDebugRequest(messages::GenericMessage const& msg, comms::Node const& sender) override
@@ -124,6 +167,13 @@ class PirApp final : public dosa::OtaApplication
         netLog("Min pixels: " + String(getContainer().getSettings().getPirMinPixels()), sender);
         netLog("Per-pixel delta: " + String(getContainer().getSettings().getPirPixelDelta()), sender);
         netLog("Aggregate delta: " + String(getContainer().getSettings().getPirTotalDelta()), sender);
+#if IR_INTERRUPT_MODE == 2
+        netLog("IR grid mode: interrupt (absolute)", sender);
+#elif IR_INTERRUPT_MODE > 0
+        netLog("IR grid mode: interrupt (difference)", sender);
+#else
+        netLog("IR grid mode: polling", sender);
+#endif
     }
 
     Container& getContainer() override
@@ -2,20 +2,28 @@
 
 #include <dosa.h>
 
+#include "grid_frame_source.h"
+
 namespace dosa {
 
 class PirContainer : public Container
 {
    public:
-    PirContainer() : Container(), ir(&serial) {}
+    PirContainer() : Container(), ir(&serial), frame_source(ir) {}
 
     [[nodiscard]] IrGrid& getIrGrid()
     {
         return ir;
     }
 
+    [[nodiscard]] FrameSource& getFrameSource()
+    {
+        return frame_source;
+    }
+
    protected:
     IrGrid ir;
+    GridFrameSource frame_source;
 };
 
 }  // namespace dosa
@@ -0,0 +1,129 @@
+/**
+ * IR grid motion detection.
+ *
+ * Compares consecutive frames and decides if the change between them constitutes motion.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "const.h"
+#include "frame_source.h"
+
+namespace dosa {
+
+/**
+ * Detection thresholds, see Settings for a description of each value.
+ */
+struct PirCalibration
+{
+    uint8_t min_pixels;
+    float pixel_delta;
+    float total_delta;
+};
+
+class PirDetector
+{
+   public:
+    explicit PirDetector(uint32_t refire_delay = REFIRE_DELAY) : refire_delay(refire_delay) {}
+
+    /**
+     * Read a frame from `source` and process it.
+     *
+     * Returns true if motion was detected.
+     */
+    bool process(FrameSource& source, uint32_t now, PirCalibration const& calibration)
+    {
+        float frame[PIR_FRAME_PIXELS];
+        if (!source.readFrame(frame)) {
+            return false;
+        }
+
+        return process(frame, now, calibration);
+    }
+
+    /**
+     * Compare a new frame against the last frame.
+     *
+     * Returns true if motion was detected, in which case getMap() will contain the per-pixel deltas (x10) of the
+     * pixels that changed. Will not detect again within the refire delay of the last detection.
+     */
+    bool process(float const* frame, uint32_t now, PirCalibration const& calibration)
+    {
+        total_delta = 0;
+        pixels_changed = 0;
+
+        for (unsigned index = 0; index < PIR_FRAME_PIXELS; ++index) {
+            float delta = frame[index] > grid[index] ? frame[index] - grid[index] : grid[index] - frame[index];
+            if (delta >= calibration.pixel_delta) {
+                ++pixels_changed;
+                total_delta += delta;
+                map[index] = delta * 10;  // NB: truncated precision
+            } else {
+                map[index] = 0;
+            }
+        }
+
+        // The first frame has nothing to compare against
+        bool detected = grid[0] != 0 && total_delta >= calibration.total_delta &&
+                        pixels_changed >= calibration.min_pixels && now - last_fired >= refire_delay;
+
+        if (detected) {
+            last_fired = now;
+        }
+
+        memcpy(grid, frame, sizeof(float) * PIR_FRAME_PIXELS);
+        return detected;
+    }
+
+    /**
+     * Sum of all pixel deltas that exceeded the pixel threshold in the last frame.
+     */
+    [[nodiscard]] float getTotalDelta() const
+    {
+        return total_delta;
+    }
+
+    [[nodiscard]] uint8_t getPixelsChanged() const
+    {
+        return pixels_changed;
+    }
+
+    /**
+     * 8x8 map of the pixel deltas (x10) from the last frame, suitable for a Trigger message.
+     */
+    [[nodiscard]] uint8_t const* getMap() const
+    {
+        return map;
+    }
+
+    /**
+     * The last frame processed, which the next frame will be compared against.
+     */
+    [[nodiscard]] float const* getFrame() const
+    {
+        return grid;
+    }
+
+    /**
+     * Forget the previous frame and detection time.
+     */
+    void reset()
+    {
+        memset(grid, 0, sizeof(grid));
+        memset(map, 0, sizeof(map));
+        last_fired = 0;
+    }
+
+   protected:
+    uint32_t refire_delay;
+    uint32_t last_fired = 0;
+    float grid[PIR_FRAME_PIXELS] = {0};
+    uint8_t map[PIR_FRAME_PIXELS] = {0};
+    float total_delta = 0;
+    uint8_t pixels_changed = 0;
+};
+
+}  // namespace dosa
@@ -8,3 +8,14 @@
  * Time (in ms) before firing a second trigger message.
  */
 #define REFIRE_DELAY 5000
+
+/**
+ * Trigger coefficient used in automatic mode (coefficient set to zero) until the resting histogram has learned enough
+ * of the background to derive one.
+ */
+#define RANGE_FALLBACK_TRIGGER_COEFFICIENT 0.9
+
+/**
+ * Most sensors a ranging app may read, each is calibrated independently.
+ */
+#define RANGE_MAX_SENSORS 4
@@ -0,0 +1,251 @@
+/**
+ * Ranging sensor filter stage.
+ *
+ * Raw distances pass through a sliding median to reject single-read spikes, then a 1-D constant-velocity Kalman filter
+ * to smooth the result and estimate approach velocity.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Largest sliding median window supported.
+ */
+#define RANGE_MEDIAN_MAX_WINDOW 9
+
+namespace dosa {
+
+/**
+ * Filter tuning, see Settings for a description of each value.
+ */
+struct RangeFilterConfig
+{
+    uint8_t median_window;    // 0 or 1 disables the median
+    float process_noise;      // Kalman acceleration variance, (mm/s^2)^2
+    float measurement_noise;  // Kalman measurement variance, mm^2; 0 disables the Kalman stage
+};
+
+/**
+ * Median of the last N distances, allocation-free.
+ *
+ * A zero distance means the sensor had no bounce-back, it is sorted as the farthest possible reading so that a
+ * minority of dropped reads doesn't look like something close to the sensor.
+ */
+class MedianFilter
+{
+   public:
+    uint32_t process(uint32_t distance, uint8_t window)
+    {
+        if (window > RANGE_MEDIAN_MAX_WINDOW) {
+            window = RANGE_MEDIAN_MAX_WINDOW;
+        }
+
+        if (window <= 1) {
+            count = 0;
+            return distance;
+        }
+
+        samples[head] = distance;
+        head = (head + 1) % RANGE_MEDIAN_MAX_WINDOW;
+        if (count < RANGE_MEDIAN_MAX_WINDOW) {
+            ++count;
+        }
+
+        // Insertion sort of the newest `window` samples
+        uint8_t n = count < window ? count : window;
+        uint32_t sorted[RANGE_MEDIAN_MAX_WINDOW];
+        for (uint8_t i = 0; i < n; ++i) {
+            uint32_t v = samples[(head + RANGE_MEDIAN_MAX_WINDOW - 1 - i) % RANGE_MEDIAN_MAX_WINDOW];
+            uint8_t j = i;
+            while (j > 0 && sortKey(sorted[j - 1]) > sortKey(v)) {
+                sorted[j] = sorted[j - 1];
+                --j;
+            }
+            sorted[j] = v;
+        }
+
+        return sorted[n / 2];
+    }
+
+    void reset()
+    {
+        head = 0;
+        count = 0;
+    }
+
+   private:
+    uint32_t samples[RANGE_MEDIAN_MAX_WINDOW] = {0};
+    uint8_t head = 0;
+    uint8_t count = 0;
+
+    static uint32_t sortKey(uint32_t distance)
+    {
+        return distance == 0 ? UINT32_MAX : distance;
+    }
+};
+
+/**
+ * Constant-velocity Kalman filter over distance.
+ */
+class RangeKalman
+{
+   public:
+    /**
+     * Add a measurement taken at `now` (ms). Returns the filtered distance.
+     */
+    float process(float distance, uint32_t now, float process_noise, float measurement_noise)
+    {
+        if (!initialised) {
+            x = distance;
+            v = 0;
+            p00 = measurement_noise;
+            p01 = 0;
+            p11 = initial_velocity_variance;
+            last_update = now;
+            initialised = true;
+            return x;
+        }
+
+        float dt = float(now - last_update) / 1000.0f;
+        last_update = now;
+
+        // Predict
+        x += v * dt;
+        float dt2 = dt * dt;
+        p00 += dt * (2 * p01 + dt * p11) + process_noise * dt2 * dt2 / 4;
+        p01 += dt * p11 + process_noise * dt2 * dt / 2;
+        p11 += process_noise * dt2;
+
+        // Update
+        float s = p00 + measurement_noise;
+        float k0 = p00 / s;
+        float k1 = p01 / s;
+        float y = distance - x;
+
+        x += k0 * y;
+        v += k1 * y;
+
+        p11 -= k1 * p01;
+        p01 -= k0 * p01;
+        p00 -= k0 * p00;
+
+        return x;
+    }
+
+    void reset()
+    {
+        initialised = false;
+        x = 0;
+        v = 0;
+    }
+
+    [[nodiscard]] bool isInitialised() const
+    {
+        return initialised;
+    }
+
+    [[nodiscard]] float getDistance() const
+    {
+        return x;
+    }
+
+    /**
+     * Rate of change of distance in mm/s, negative when something is approaching the sensor.
+     */
+    [[nodiscard]] float getVelocity() const
+    {
+        return v;
+    }
+
+    /**
+     * Variance of the distance estimate, mm^2.
+     */
+    [[nodiscard]] float getVariance() const
+    {
+        return p00;
+    }
+
+   private:
+    constexpr static float initial_velocity_variance = 1000000.0f;  // (1 m/s)^2
+
+    bool initialised = false;
+    uint32_t last_update = 0;
+    float x = 0;  // distance, mm
+    float v = 0;  // velocity, mm/s
+    float p00 = 0, p01 = 0, p11 = 0;
+};
+
+/**
+ * Median followed by Kalman, as configured.
+ */
+class RangeFilter
+{
+   public:
+    /**
+     * Add a raw sensor distance read at `now` (ms). Returns the filtered distance, zero if there is no bounce-back.
+     */
+    uint32_t process(uint32_t raw, uint32_t now, RangeFilterConfig const& config)
+    {
+        last_raw = raw;
+        last_median = median.process(raw, config.median_window);
+
+        if (last_median == 0) {
+            // Nothing in range, restart tracking when something returns
+            kalman.reset();
+            last_filtered = 0;
+        } else if (config.measurement_noise <= 0) {
+            kalman.reset();
+            last_filtered = last_median;
+        } else {
+            auto est = kalman.process(float(last_median), now, config.process_noise, config.measurement_noise);
+            last_filtered = est < 1 ? 1 : uint32_t(est + 0.5f);
+        }
+
+        return last_filtered;
+    }
+
+    void reset()
+    {
+        median.reset();
+        kalman.reset();
+        last_raw = last_median = last_filtered = 0;
+    }
+
+    [[nodiscard]] uint32_t getRaw() const
+    {
+        return last_raw;
+    }
+
+    [[nodiscard]] uint32_t getMedian() const
+    {
+        return last_median;
+    }
+
+    [[nodiscard]] uint32_t getFiltered() const
+    {
+        return last_filtered;
+    }
+
+    /**
+     * Estimated velocity in mm/s (negative is approaching), zero if the Kalman stage is disabled or not tracking.
+     */
+    [[nodiscard]] float getVelocity() const
+    {
+        return kalman.isInitialised() ? kalman.getVelocity() : 0;
+    }
+
+    [[nodiscard]] RangeKalman const& getKalman() const
+    {
+        return kalman;
+    }
+
+   private:
+    MedianFilter median;
+    RangeKalman kalman;
+    uint32_t last_raw = 0;
+    uint32_t last_median = 0;
+    uint32_t last_filtered = 0;
+};
+
+}  // namespace dosa
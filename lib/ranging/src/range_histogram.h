@@ -0,0 +1,220 @@
+/**
+ * Resting-distance histogram for ranging auto-calibration.
+ *
+ * Learns the distribution of the background the sensor is aimed at, so that the baseline and trigger margin can be
+ * derived from measured noise instead of a single "longest recent distance".
+ */
+
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Number of histogram bins, centred on the learned baseline.
+ */
+#define RANGE_HISTOGRAM_BINS 64
+
+/**
+ * Width of each histogram bin, in mm. The histogram covers BINS * BIN_WIDTH mm around the baseline.
+ */
+#define RANGE_HISTOGRAM_BIN_WIDTH 20
+
+/**
+ * Total count at which all bins are halved, giving the histogram a rolling memory of roughly this many samples.
+ */
+#define RANGE_HISTOGRAM_CAPACITY 1024
+
+/**
+ * Samples required before the histogram is trusted over the legacy calibration.
+ */
+#define RANGE_HISTOGRAM_MIN_SAMPLES 64
+
+/**
+ * Net excess of samples outside of the histogram range over samples inside it before the histogram is re-centred on
+ * the new distance.
+ */
+#define RANGE_HISTOGRAM_RECENTRE 64
+
+/**
+ * The trigger margin below the baseline is this multiple of the lower noise band..
+ */
+#define RANGE_NOISE_MARGIN_FACTOR 3
+
+/**
+ * ..but never less than this many mm.
+ */
+#define RANGE_MIN_TRIGGER_MARGIN 50
+
+namespace dosa {
+
+class RangeHistogram
+{
+   public:
+    /**
+     * Add a resting distance (mm), see isResting(). Zero (no bounce-back) distances should not be added.
+     */
+    void add(uint32_t distance)
+    {
+        if (total == 0 && outside == 0) {
+            centre(distance);
+        }
+
+        if (distance < origin || distance >= origin + RANGE_HISTOGRAM_BINS * RANGE_HISTOGRAM_BIN_WIDTH) {
+            if (++outside >= RANGE_HISTOGRAM_RECENTRE) {
+                // The background has moved, start learning again around the new distance
+                reset();
+                centre(distance);
+            } else {
+                return;
+            }
+        }
+
+        if (outside > 0) {
+            --outside;
+        }
+
+        ++bins[(distance - origin) / RANGE_HISTOGRAM_BIN_WIDTH];
+        ++total;
+
+        if (total >= RANGE_HISTOGRAM_CAPACITY) {
+            decay();
+        }
+    }
+
+    /**
+     * Distance (mm) below which `percent` of resting samples fall. Zero if there are no samples.
+     */
+    [[nodiscard]] uint32_t getPercentile(uint8_t percent) const
+    {
+        if (total == 0) {
+            return 0;
+        }
+
+        uint32_t target = (total * percent + 50) / 100;
+        uint32_t sum = 0;
+
+        for (uint16_t i = 0; i < RANGE_HISTOGRAM_BINS; ++i) {
+            sum += bins[i];
+            if (sum >= target && sum > 0) {
+                return origin + i * RANGE_HISTOGRAM_BIN_WIDTH + RANGE_HISTOGRAM_BIN_WIDTH / 2;
+            }
+        }
+
+        return origin + RANGE_HISTOGRAM_BINS * RANGE_HISTOGRAM_BIN_WIDTH - RANGE_HISTOGRAM_BIN_WIDTH / 2;
+    }
+
+    /**
+     * Median resting distance.
+     */
+    [[nodiscard]] uint32_t getBaseline() const
+    {
+        return getPercentile(50);
+    }
+
+    /**
+     * Spread of the nearer resting distances, baseline to 5th percentile. This is the noise that a trigger must beat.
+     */
+    [[nodiscard]] uint32_t getLowerNoise() const
+    {
+        return getBaseline() - getPercentile(5);
+    }
+
+    /**
+     * Spread of the farther resting distances, 95th percentile to baseline.
+     */
+    [[nodiscard]] uint32_t getUpperNoise() const
+    {
+        return getPercentile(95) - getBaseline();
+    }
+
+    /**
+     * Distance (mm) below the baseline that a trigger must beat, derived from the lower noise.
+     */
+    [[nodiscard]] uint32_t getTriggerMargin() const
+    {
+        uint32_t margin = getLowerNoise() * RANGE_NOISE_MARGIN_FACTOR;
+        return margin < RANGE_MIN_TRIGGER_MARGIN ? RANGE_MIN_TRIGGER_MARGIN : margin;
+    }
+
+    /**
+     * Fraction of the baseline a distance must fall below to be considered a trigger.
+     */
+    [[nodiscard]] float getTriggerCoefficient() const
+    {
+        auto baseline = getBaseline();
+        if (baseline == 0) {
+            return 0;
+        }
+
+        auto margin = getTriggerMargin();
+        if (margin >= baseline) {
+            return 0;
+        }
+
+        return float(baseline - margin) / float(baseline);
+    }
+
+    /**
+     * True if `distance` fits the background learned so far, and so may be added.
+     *
+     * Anything is accepted until the histogram is ready. After that, a distance nearer than the trigger margin below
+     * the baseline is something in the beam rather than background. Farther distances are always accepted, as nothing
+     * in the beam can be beyond the background, so the histogram can still follow a background that moves away.
+     */
+    [[nodiscard]] bool isResting(uint32_t distance) const
+    {
+        return !isReady() || distance + getTriggerMargin() >= getBaseline();
+    }
+
+    /**
+     * True once enough samples have been collected to trust the baseline.
+     */
+    [[nodiscard]] bool isReady() const
+    {
+        return total >= RANGE_HISTOGRAM_MIN_SAMPLES;
+    }
+
+    /**
+     * Number of samples currently weighted in the histogram.
+     */
+    [[nodiscard]] uint32_t getSampleCount() const
+    {
+        return total;
+    }
+
+    void reset()
+    {
+        for (auto& bin : bins) {
+            bin = 0;
+        }
+        total = 0;
+        outside = 0;
+        origin = 0;
+    }
+
+   private:
+    uint16_t bins[RANGE_HISTOGRAM_BINS] = {0};
+    uint32_t total = 0;
+    uint32_t origin = 0;  // distance at the low edge of the first bin
+    uint16_t outside = 0;
+
+    void centre(uint32_t distance)
+    {
+        uint32_t half = RANGE_HISTOGRAM_BINS / 2 * RANGE_HISTOGRAM_BIN_WIDTH;
+        origin = distance > half ? distance - half : 0;
+    }
+
+    /**
+     * Halve every bin, so that old samples carry less weight than new ones.
+     */
+    void decay()
+    {
+        total = 0;
+        for (auto& bin : bins) {
+            bin /= 2;
+            total += bin;
+        }
+    }
+};
+
+}  // namespace dosa
@@ -0,0 +1,137 @@
+/**
+ * Recent distance samples for the ranging trigger payload.
+ *
+ * Keeps a small ring of timestamped distances and packs them into the 64-byte Trigger map, so that consumers can see
+ * how the trip developed without a round trip to the sensor.
+ *
+ * Trigger map layout (little-endian):
+ *   Offset  Size  Type      Detail
+ *   ----------------------------------
+ *   0       2     uint16    Calibrated (previous) distance, mm
+ *   2       2     uint16    Trigger (current) distance, mm
+ *   4       2     int16     Approach velocity, mm/s (negative is approaching)
+ *   6       1     uint8     Trace format version
+ *   7       1     uint8     Number of samples in trace (N)
+ *   8       2     uint16    Oldest sample distance, mm
+ *   10      2     uint16    Age of oldest sample at trigger time, ms
+ *   12      3x    ...       N-1 entries, oldest to newest: uint8 time since previous sample (10 ms units), int16
+ *                           distance delta from previous sample (mm, modulo 2^16)
+ *
+ * Samples are raw sensor distances, a zero distance means the sensor had no bounce-back.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Samples kept in the ring, which is also the most that fit in the Trigger map.
+ */
+#define RANGE_TRACE_SAMPLES 18
+
+#define RANGE_TRACE_VERSION 1
+#define RANGE_TRACE_MAP_SIZE 64
+#define RANGE_TRACE_HEADER_SIZE 12
+#define RANGE_TRACE_ENTRY_SIZE 3
+#define RANGE_TRACE_TIME_UNIT 10
+
+namespace dosa {
+
+class RangeTrace
+{
+   public:
+    /**
+     * Record a distance (mm) read at `now` (ms).
+     */
+    void add(uint32_t distance, uint32_t now)
+    {
+        samples[head] = {now, clamp16(distance)};
+        head = (head + 1) % RANGE_TRACE_SAMPLES;
+        if (count < RANGE_TRACE_SAMPLES) {
+            ++count;
+        }
+    }
+
+    /**
+     * Pack the trace into a Trigger map of RANGE_TRACE_MAP_SIZE bytes.
+     */
+    void pack(uint8_t* map, uint16_t previous, uint16_t current, float velocity, uint32_t now) const
+    {
+        memset(map, 0, RANGE_TRACE_MAP_SIZE);
+
+        int16_t v = velocity > INT16_MAX ? INT16_MAX : (velocity < INT16_MIN ? INT16_MIN : int16_t(velocity));
+        uint8_t version = RANGE_TRACE_VERSION;
+
+        memcpy(map, &previous, 2);
+        memcpy(map + 2, &current, 2);
+        memcpy(map + 4, &v, 2);
+        memcpy(map + 6, &version, 1);
+        memcpy(map + 7, &count, 1);
+
+        if (count == 0) {
+            return;
+        }
+
+        auto const& oldest = at(0);
+        uint32_t age = now - oldest.time;
+        uint16_t age16 = age > UINT16_MAX ? UINT16_MAX : uint16_t(age);
+        memcpy(map + 8, &oldest.distance, 2);
+        memcpy(map + 10, &age16, 2);
+
+        uint8_t* ptr = map + RANGE_TRACE_HEADER_SIZE;
+        for (uint8_t i = 1; i < count; ++i) {
+            auto const& prev = at(i - 1);
+            auto const& sample = at(i);
+
+            uint32_t dt = (sample.time - prev.time + RANGE_TRACE_TIME_UNIT / 2) / RANGE_TRACE_TIME_UNIT;
+            uint8_t dt8 = dt > UINT8_MAX ? UINT8_MAX : uint8_t(dt);
+            auto delta = int16_t(uint16_t(sample.distance - prev.distance));
+
+            memcpy(ptr, &dt8, 1);
+            memcpy(ptr + 1, &delta, 2);
+            ptr += RANGE_TRACE_ENTRY_SIZE;
+        }
+    }
+
+    [[nodiscard]] uint8_t getCount() const
+    {
+        return count;
+    }
+
+    void reset()
+    {
+        head = 0;
+        count = 0;
+    }
+
+   private:
+    struct Sample
+    {
+        uint32_t time;
+        uint16_t distance;
+    };
+
+    Sample samples[RANGE_TRACE_SAMPLES] = {};
+    uint8_t head = 0;
+    uint8_t count = 0;
+
+    static_assert(
+        RANGE_TRACE_HEADER_SIZE + (RANGE_TRACE_SAMPLES - 1) * RANGE_TRACE_ENTRY_SIZE <= RANGE_TRACE_MAP_SIZE,
+        "Range trace does not fit in trigger map");
+
+    /**
+     * Sample by age order, 0 being the oldest.
+     */
+    [[nodiscard]] Sample const& at(uint8_t index) const
+    {
+        return samples[(head + RANGE_TRACE_SAMPLES - count + index) % RANGE_TRACE_SAMPLES];
+    }
+
+    static uint16_t clamp16(uint32_t value)
+    {
+        return value > UINT16_MAX ? UINT16_MAX : uint16_t(value);
+    }
+};
+
+}  // namespace dosa
@@ -3,6 +3,9 @@
 #include <dosa_ota.h>
 
 #include "const.h"
+#include "range_filter.h"
+#include "range_histogram.h"
+#include "range_trace.h"
 
 namespace dosa {
 
@@ -17,6 +20,9 @@ class RangingApp : public dosa::OtaApplication
         logln("Trigger threshold:   " + String(getSettings().getRangeTriggerThreshold()), LogLevel::DEBUG);
         logln("Trigger coefficient: " + String(getSettings().getRangeTriggerCoefficient()), LogLevel::DEBUG);
         logln("Fixed calibration:   " + String(getSettings().getRangeFixedCalibration()), LogLevel::DEBUG);
+        logln("Median window:       " + String(getSettings().getRangeMedianWindow()), LogLevel::DEBUG);
+        logln("Process noise:       " + String(getSettings().getRangeProcessNoise()), LogLevel::DEBUG);
+        logln("Measurement noise:   " + String(getSettings().getRangeMeasurementNoise()), LogLevel::DEBUG);
     }
 
     void loop() override
@@ -27,12 +33,91 @@ class RangingApp : public dosa::OtaApplication
 
    protected:
     virtual bool sensorUpdateReady() = 0;
-    virtual uint32_t getSensorDistance() = 0;
+
+    /**
+     * Number of sensors read by getSensorDistance(), each is calibrated and trips independently.
+     */
+    virtual uint8_t getSensorCount() const
+    {
+        return 1;
+    }
+
+    /**
+     * Set `distance` to the latest reading of sensor `index`, zero if nothing bounced back. Returns false if the
+     * sensor has no new reading to consider.
+     */
+    virtual bool getSensorDistance(uint8_t index, uint32_t& distance) = 0;
+
+    /**
+     * Add sensor-specific detail to the debug response.
+     */
+    virtual void onSensorDebug(comms::Node const& sender) {}
+
+    /**
+     * REQ message received, reply with the device state and learned calibration.
+     */
+    void onRequestStat(messages::GenericMessage const& msg, comms::Node const& sender) override
+    {
+        getStats().count("dosa.request.req-stat");
+        netLog("Request-stat received from '" + Comms::getDeviceName(msg) + "' (" + comms::nodeToString(sender) + ")");
+
+        /**
+         * Ranging status, of the first sensor:
+         *   Size   Type      Detail
+         *   ----------------------------------
+         *   1      uint8     Device state
+         *   2      uint16    Calibrated (baseline) distance, mm
+         *   2      uint16    Lower noise band, mm
+         *   2      uint16    Upper noise band, mm
+         *   4      float     Trigger coefficient in use
+         *   4      uint32    Resting samples in histogram
+         */
+        auto const& channel = channels[0];
+        char status[15];
+        auto state = static_cast<uint8_t>(getDeviceState());
+        uint16_t lower_noise = channel.histogram.getLowerNoise();
+        uint16_t upper_noise = channel.histogram.getUpperNoise();
+        float coefficient = getTriggerCoefficient(channel);
+        uint32_t samples = channel.histogram.getSampleCount();
+
+        memcpy(status, &state, 1);
+        memcpy(status + 1, &channel.calibrated_distance, 2);
+        memcpy(status + 3, &lower_noise, 2);
+        memcpy(status + 5, &upper_noise, 2);
+        memcpy(status + 7, &coefficient, 4);
+        memcpy(status + 11, &samples, 4);
+
+        getContainer().getComms().dispatch(
+            sender,
+            messages::StatusMessage(
+                static_cast<uint16_t>(messages::StatusFormat::RANGING),
+                status,
+                sizeof(status),
+                getSettings().getDeviceNameBytes()));
+    }
 
    private:
-    uint16_t calibrated_distance = 1;
+    /**
+     * Calibration and trigger state of a single sensor.
+     */
+    struct RangeChannel
+    {
+        uint16_t calibrated_distance = 1;
+        uint16_t trigger_count = 0;      // number of triggers (distance < last_distance)
+        uint16_t calibration_count = 0;  // number of calibrations (distance > last_distance)
+        RangeFilter filter;
+        RangeHistogram histogram;
+        RangeTrace trace;
+    };
+
+    RangeChannel channels[RANGE_MAX_SENSORS];
     unsigned long last_fired = 0;
 
+    [[nodiscard]] uint8_t getChannelCount() const
+    {
+        return getSensorCount() < RANGE_MAX_SENSORS ? getSensorCount() : RANGE_MAX_SENSORS;
+    }
+
     void onDebugRequest(messages::GenericMessage const& msg, comms::Node const& sender) override
     {
         if (msg_cache.validate(sender, msg.getMessageId())) {
@@ -44,48 +129,119 @@ class RangingApp : public dosa::OtaApplication
         netLog("Sensor calibration threshold: " + String(settings.getRangeTriggerThreshold()), sender);
         netLog("Sensor trigger coefficient: " + String(settings.getRangeTriggerCoefficient()), sender);
         netLog("Sensor fixed calibration: " + String(settings.getRangeFixedCalibration()), sender);
-        netLog("Sensor distance: " + String(getSensorDistance()), sender);
+        netLog(
+            "Filter: median window " + String(settings.getRangeMedianWindow()) + "; process noise " +
+                String(settings.getRangeProcessNoise()) + "; measurement noise " +
+                String(settings.getRangeMeasurementNoise()),
+            sender);
+
+        for (uint8_t i = 0; i < getChannelCount(); ++i) {
+            auto const& channel = channels[i];
+            auto const& filter = channel.filter;
+            auto const& histogram = channel.histogram;
+            String prefix = getChannelCount() > 1 ? "Sensor " + String(i) + " " : String("");
+
+            netLog(
+                prefix + "filter state: raw " + String(filter.getRaw()) + "mm; median " + String(filter.getMedian()) +
+                    "mm; filtered " + String(filter.getFiltered()) + "mm; velocity " + String(filter.getVelocity()) +
+                    "mm/s; variance " + String(filter.getKalman().getVariance()),
+                sender);
+            netLog(
+                prefix + "learned baseline: " + String(histogram.getBaseline()) + "mm (-" +
+                    String(histogram.getLowerNoise()) + "/+" + String(histogram.getUpperNoise()) + "mm, " +
+                    String(histogram.getSampleCount()) + " samples" + (histogram.isReady() ? "" : ", learning") + ")",
+                sender);
+            netLog(
+                prefix + "calibrated distance: " + String(channel.calibrated_distance) + "mm; coefficient in use: " +
+                    String(getTriggerCoefficient(channel)),
+                sender);
+        }
+
+        onSensorDebug(sender);
     }
 
     /**
-     * Reads the sensor and will either auto-calibrate or fire a trigger.
+     * Trigger coefficient from settings, or derived from the sensor's resting noise if set to zero.
      */
-    void checkSensor()
+    [[nodiscard]] float getTriggerCoefficient(RangeChannel const& channel) const
     {
-        static uint16_t trigger_count = 0;      // number of triggers (distance < last_distance)
-        static uint16_t calibration_count = 0;  // number of calibrations (distance > last_distance)
+        auto coefficient = getSettings().getRangeTriggerCoefficient();
+        if (coefficient > 0) {
+            return coefficient;
+        }
+
+        auto learned = channel.histogram.isReady() ? channel.histogram.getTriggerCoefficient() : 0;
+        return learned > 0 ? learned : RANGE_FALLBACK_TRIGGER_COEFFICIENT;
+    }
 
+    /**
+     * Reads the sensors, each will either auto-calibrate or fire a trigger.
+     */
+    void checkSensor()
+    {
         if (!sensorUpdateReady()) {
             return;
         }
 
-        logln("Distance: " + String(getSensorDistance()), LogLevel::TRACE);
+        if (millis() - last_fired >= REFIRE_DELAY && getDeviceState() == messages::DeviceState::WORKING) {
+            setDeviceState(messages::DeviceState::OK);
+        }
 
+        for (uint8_t i = 0; i < getChannelCount(); ++i) {
+            uint32_t raw;
+            if (getSensorDistance(i, raw)) {
+                checkChannel(channels[i], raw);
+            }
+        }
+    }
+
+    /**
+     * Consider a new reading of a single sensor against its own calibration.
+     */
+    void checkChannel(RangeChannel& channel, uint32_t raw)
+    {
         auto const& settings = getContainer().getSettings();
 
+        auto now = millis();
+        channel.trace.add(raw, now);
+
+        // Zero distance implies the sensor didn't receive a bounce-back (beyond range, aimed at carpet, etc)
+        auto distance = channel.filter.process(
+            raw,
+            now,
+            {settings.getRangeMedianWindow(), settings.getRangeProcessNoise(), settings.getRangeMeasurementNoise()});
+
+        logln("Distance: " + String(channel.filter.getRaw()) + " -> " + String(distance), LogLevel::TRACE);
+
         if (millis() - last_fired < REFIRE_DELAY) {
             return;
-        } else if (getDeviceState() == messages::DeviceState::WORKING) {
-            setDeviceState(messages::DeviceState::OK);
         }
 
-        // Zero distance implies the sensor didn't receive a bounce-back (beyond range, aimed at carpet, etc)
-        auto distance = getSensorDistance();
+        auto fixed_calibration = settings.getRangeFixedCalibration();
+        if (fixed_calibration == 0 && channel.histogram.isReady()) {
+            // Automatic calibration, with enough of the background learned
+            channel.calibrated_distance = channel.histogram.getBaseline();
+        }
 
-        if ((distance > 0) && (distance < int(float(calibrated_distance) * settings.getRangeTriggerCoefficient()) ||
-                               calibrated_distance == 0)) {
-            calibration_count = 0;
-            considerTrigger(distance, trigger_count);
+        if ((distance > 0) && (distance < int(float(channel.calibrated_distance) * getTriggerCoefficient(channel)) ||
+                               channel.calibrated_distance == 0)) {
+            channel.calibration_count = 0;
+            considerTrigger(channel, distance);
         } else {
-            trigger_count = 0;
-            auto fixed_calibration = settings.getRangeFixedCalibration();
+            // Only learn the background from reads with nothing in the beam, a read following a warning may still be
+            // the tail end of someone passing
+            if (distance > 0 && channel.trigger_count == 0 && channel.histogram.isResting(distance)) {
+                channel.histogram.add(distance);
+            }
 
-            if (fixed_calibration == 0) {
-                // Using automatic calibration
-                calibrateSensor(distance, calibration_count);
-            } else {
+            channel.trigger_count = 0;
+
+            if (fixed_calibration != 0) {
                 // Fixed-distance calibration
-                calibrated_distance = fixed_calibration;
+                channel.calibrated_distance = fixed_calibration;
+            } else if (!channel.histogram.isReady()) {
+                // Automatic calibration, still learning the background
+                calibrateSensor(channel, distance);
             }
         }
     }
@@ -96,22 +252,22 @@ class RangingApp : public dosa::OtaApplication
      * Sensor is reading a trigger state (distance < calibrated threshold), consider if we should wait for more
      * positives or actually fire.
      */
-    void considerTrigger(uint16_t distance, uint16_t& trigger_count)
+    void considerTrigger(RangeChannel& channel, uint16_t distance)
     {
-        ++trigger_count;
+        ++channel.trigger_count;
 
-        if (trigger_count >= getSettings().getRangeTriggerThreshold()) {
+        if (channel.trigger_count >= getSettings().getRangeTriggerThreshold()) {
             // Trigger-warn state surpassed, fire trigger message
             setDeviceState(messages::DeviceState::WORKING);
-            sendTrigger(calibrated_distance, distance);
+            sendTrigger(channel, channel.calibrated_distance, distance);
             last_fired = millis();
-            calibrated_distance = distance;
-            trigger_count = 0;
+            channel.calibrated_distance = distance;
+            channel.trigger_count = 0;
         } else {
             // Trigger-warn state: count up reads to de-noise until we're sure this is a real trigger
             logln(
-                "Sensor warning (" + String(trigger_count) + "): " + String(calibrated_distance) + "mm -> " +
-                    String(distance) + "mm",
+                "Sensor warning (" + String(channel.trigger_count) + "): " + String(channel.calibrated_distance) +
+                    "mm -> " + String(distance) + "mm",
                 LogLevel::DEBUG);
         }
     }
@@ -122,8 +278,11 @@ class RangingApp : public dosa::OtaApplication
      * To ensure an errant longer-distance isn't recorded, we'll also apply a threshold before increasing the
      * current distance.
      */
-    void calibrateSensor(uint16_t distance, uint16_t& calibration_count)
+    void calibrateSensor(RangeChannel& channel, uint16_t distance)
     {
+        auto& calibrated_distance = channel.calibrated_distance;
+        auto& calibration_count = channel.calibration_count;
+
         if (calibrated_distance == distance) {
             // Measurement is bang on, do nothing
             calibration_count = 0;
@@ -153,7 +312,7 @@ class RangingApp : public dosa::OtaApplication
     /**
      * Broadcasts a trigger message.
      */
-    void sendTrigger(uint16_t previous, uint16_t current)
+    void sendTrigger(RangeChannel const& channel, uint16_t previous, uint16_t current)
     {
         String distance = String(previous) + "mm -> " + String(current) + "mm";
         logln("Sensor TRIGGER: " + distance);
@@ -178,11 +337,11 @@ class RangingApp : public dosa::OtaApplication
             return;
         }
 
-        // Trigger data will contain two 16-bit numbers, the previous and new distance measurements
-        uint8_t map[64] = {0};
-        memcpy(map, &previous, 2);
-        memcpy(map + 2, &current, 2);
+        // Trigger data leads with the previous and new distance measurements, followed by a trace of recent samples
+        uint8_t map[RANGE_TRACE_MAP_SIZE];
+        channel.trace.pack(map, previous, current, channel.filter.getVelocity(), millis());
 
+        journal(JournalEvent::TRIGGER, 1);
         dispatchMessage(messages::Trigger(messages::TriggerDevice::SENSOR_RANGING, map, getDeviceNameBytes()), true);
         getStats().count(stats::trigger);
     }
@@ -1,7 +1,35 @@
 #pragma once
 
+#include "relay_bank.h"
 
 /**
  * Pin that controls the relay state.
  */
 #define DOSA_RELAY_PIN 9
+
+/**
+ * Pins for the additional channels of a relay bank, D10-D13 are taken by the FRAM.
+ */
+#define DOSA_RELAY_PIN_2 8
+#define DOSA_RELAY_PIN_3 7
+#define DOSA_RELAY_PIN_4 6
+
+/**
+ * Schedule windows are re-evaluated this often (ms).
+ */
+#define DOSA_RELAY_SCHEDULE_INTERVAL 10000
+
+/**
+ * Minimum time between attempts to set the clock while it is unset or stale (ms).
+ */
+#define DOSA_RELAY_NTP_RETRY 60000
+
+namespace dosa {
+
+constexpr static uint8_t relay_pins[RELAY_MAX_CHANNELS] = {
+    DOSA_RELAY_PIN,
+    DOSA_RELAY_PIN_2,
+    DOSA_RELAY_PIN_3,
+    DOSA_RELAY_PIN_4};
+
+}  // namespace dosa
@@ -6,6 +6,14 @@
 
 namespace dosa {
 
+static_assert(RELAY_SCHEDULE_SIZE == DOSA_SETTINGS_RELAY_SCHEDULE_SIZE, "Relay schedule does not fit settings");
+
+/**
+ * Bank of relay channels.
+ *
+ * Triggers drive the channels their sender is mapped to, either for the activation time or as a toggle if the
+ * activation time is zero. Channels are also held on through their schedule windows, once the clock has been set.
+ */
 class RelayApp final : public dosa::OtaApplication
 {
    public:
@@ -20,57 +28,166 @@ class RelayApp final : public dosa::OtaApplication
             &triggerMessageForwarder,
             this);
 
-        pinMode(DOSA_RELAY_PIN, OUTPUT);
-        digitalWrite(DOSA_RELAY_PIN, LOW);
-        relay_last_moved = millis();
+        configureChannels();
+        schedule.load(getSettings().getRelaySchedule());
     }
 
     void loop() override
     {
         OtaApplication::loop();
 
-        // Check if we want to deactivate following a time-delay activation
-        auto switch_delay = getContainer().getSettings().getRelayActivationTime();
-        if (switch_delay > 0 && relay_state && (millis() - relay_last_moved > switch_delay)) {
-            setRelay(false);
+        // Deactivate channels following a time-delay activation, only the earliest deadline is ever checked
+        uint8_t channel;
+        while (deadlines.popDue(millis(), channel)) {
+            triggered &= ~(1 << channel);
+            applyChannels();
+        }
+
+        // Waiting on NTP, re-evaluate the schedule as soon as the clock is set
+        if (clock.pollSync()) {
+            last_schedule_check = millis() - DOSA_RELAY_SCHEDULE_INTERVAL;
         }
+
+        processSchedule();
     }
 
    private:
     Container container;
-    bool relay_state = false;
-    uint32_t relay_last_moved = 0;
-    uint32_t relay_open_time = 0;
+    comms::TimeManager clock{container.getWiFi(), &container.getSerial()};
+    DeadlineQueue<RELAY_MAX_CHANNELS> deadlines;
+    RelaySchedule schedule;
+
+    uint8_t triggered = 0;  // Channels on by trigger
+    uint8_t scheduled = 0;  // Channels on by schedule
+    uint8_t active = 0;     // Channels currently driven
+    uint8_t outputs = 0;    // Channels with their pin set as an output
+    uint32_t channel_open_time[RELAY_MAX_CHANNELS] = {0};
+    uint32_t last_schedule_check = 0;
+    uint32_t last_sync_attempt = 0;
 
-    void setRelay(bool state)
+    /**
+     * Mask of the channels in use by this device.
+     */
+    uint8_t getChannelMask() const
     {
-        relay_last_moved = millis();
+        auto channels = getSettings().getRelayChannels();
+        if (channels == 0) {
+            channels = 1;
+        } else if (channels > RELAY_MAX_CHANNELS) {
+            channels = RELAY_MAX_CHANNELS;
+        }
 
-        if (relay_state == state) {
+        return (1 << channels) - 1;
+    }
+
+    /**
+     * Set the pins of the channels in use as outputs, initially off, and release those no longer in use.
+     */
+    void configureChannels()
+    {
+        auto mask = getChannelMask();
+        for (uint8_t i = 0; i < RELAY_MAX_CHANNELS; ++i) {
+            bool in_use = mask & (1 << i);
+            if (in_use == bool(outputs & (1 << i))) {
+                continue;
+            }
+
+            if (in_use) {
+                pinMode(relay_pins[i], OUTPUT);
+                digitalWrite(relay_pins[i], LOW);
+            } else {
+                pinMode(relay_pins[i], INPUT);
+            }
+        }
+
+        outputs = mask;
+    }
+
+    /**
+     * Re-apply the channel count and schedule after a config change, without waiting for a reboot.
+     */
+    void onRelayCalibration() override
+    {
+        schedule.load(getSettings().getRelaySchedule());
+
+        // Switch off any channel dropped before its pin is released, the schedule is re-evaluated on the next loop
+        auto mask = getChannelMask();
+        triggered &= mask;
+        scheduled = schedule.size() == 0 ? 0 : scheduled & mask;
+        applyChannels();
+        configureChannels();
+
+        last_schedule_check = millis() - DOSA_RELAY_SCHEDULE_INTERVAL;
+    }
+
+    /**
+     * Drive each channel to its triggered or scheduled state.
+     */
+    void applyChannels()
+    {
+        uint8_t target = (triggered | scheduled) & getChannelMask();
+        uint8_t changed = target ^ active;
+        if (changed == 0) {
             return;
         }
 
-        logln(String("Set power state: ") + (state ? "active" : "inactive"));
-        relay_state = state;
+        bool was_active = active != 0;
+
+        for (uint8_t i = 0; i < RELAY_MAX_CHANNELS; ++i) {
+            if (!(changed & (1 << i))) {
+                continue;
+            }
+
+            bool state = target & (1 << i);
+            logln("Set power state, channel " + String(i) + ": " + (state ? "active" : "inactive"));
+            digitalWrite(relay_pins[i], state ? HIGH : LOW);
 
-        if (relay_state) {
-            digitalWrite(DOSA_RELAY_PIN, HIGH);
+            if (state) {
+                getStats().count(stats::begin);
+                channel_open_time[i] = millis();
+            } else {
+                getStats().count(stats::end);
+                getStats().timing(stats::sequence, millis() - channel_open_time[i]);
+            }
+        }
+
+        active = target;
+
+        if (active != 0 && !was_active) {
             setDeviceState(messages::DeviceState::WORKING);
-            getStats().count(stats::begin);
-            relay_open_time = millis();
             dispatchGenericMessage(DOSA_COMMS_MSG_BEGIN, true);
-        } else {
-            digitalWrite(DOSA_RELAY_PIN, LOW);
+        } else if (active == 0 && was_active) {
             setDeviceState(messages::DeviceState::OK);
-            getStats().count(stats::end);
-            if (relay_open_time != 0) {
-                getStats().timing(stats::sequence, millis() - relay_open_time);
-            }
             dispatchGenericMessage(DOSA_COMMS_MSG_END, true);
-            relay_open_time = 0;
         }
     }
 
+    /**
+     * Re-evaluate the schedule windows, setting the clock first if required.
+     */
+    void processSchedule()
+    {
+        if (schedule.size() == 0 || millis() - last_schedule_check < DOSA_RELAY_SCHEDULE_INTERVAL) {
+            return;
+        }
+
+        last_schedule_check = millis();
+
+        if (clock.needsSync() && !clock.isSyncing() && isWifiConnected() &&
+            millis() - last_sync_attempt > DOSA_RELAY_NTP_RETRY) {
+            last_sync_attempt = millis();
+            clock.beginSync(DOSA_NTP_HOST);
+        }
+
+        if (!clock.isSynced()) {
+            return;
+        }
+
+        // The clock is kept in UTC so that a timezone change applies without a re-sync
+        scheduled = schedule.getActiveMask(clock.getTime() + time_t(getSettings().getRelayTimezone()) * 3600);
+        applyChannels();
+    }
+
     void onDebugRequest(messages::GenericMessage const& msg, comms::Node const& sender) override
     {
         if (msg_cache.validate(sender, msg.getMessageId())) {
@@ -80,6 +197,27 @@ class RelayApp final : public dosa::OtaApplication
         App::onDebugRequest(msg, sender);
         auto const& settings = getContainer().getSettings();
         netLog("Relay activation time: " + String(settings.getRelayActivationTime()), sender);
+
+        auto mask = getChannelMask();
+        for (uint8_t i = 0; i < RELAY_MAX_CHANNELS; ++i) {
+            if (!(mask & (1 << i))) {
+                break;
+            }
+
+            String line = "Relay channel " + String(i) + ": " + ((active & (1 << i)) ? "active" : "inactive");
+            if (deadlines.has(i)) {
+                line += "; off in " + String(int32_t(deadlines.getDeadline(i) - millis())) + " ms";
+            }
+            if (scheduled & (1 << i)) {
+                line += "; scheduled";
+            }
+            netLog(line, sender);
+        }
+
+        netLog(
+            "Relay schedule: " + String(schedule.size()) + " windows; clock " +
+                (clock.isSynced() ? String(uint32_t(clock.getTime())) : String("not set")),
+            sender);
     }
 
     Container& getContainer() override
@@ -93,17 +231,28 @@ class RelayApp final : public dosa::OtaApplication
     }
 
     /**
-     * Toggles the state of the relay, based on the application settings.
+     * Activate or toggle the channels in `mask`, based on the application settings.
      */
-    void executePowerToggle()
+    void executePowerToggle(uint8_t mask)
     {
-        if (getContainer().getSettings().getRelayActivationTime() > 0) {
-            // Time-delay mode
-            setRelay(true);
-        } else {
-            // Toggle mode
-            setRelay(!relay_state);
+        auto activation_time = getContainer().getSettings().getRelayActivationTime();
+
+        for (uint8_t i = 0; i < RELAY_MAX_CHANNELS; ++i) {
+            if (!(mask & (1 << i))) {
+                continue;
+            }
+
+            if (activation_time > 0) {
+                // Time-delay mode, a repeat trigger extends the activation
+                triggered |= 1 << i;
+                deadlines.set(i, millis() + activation_time);
+            } else {
+                // Toggle mode
+                triggered ^= 1 << i;
+            }
         }
+
+        applyChannels();
     }
 
     /**
@@ -115,13 +264,16 @@ class RelayApp final : public dosa::OtaApplication
             return;
         }
 
-        // Physically toggle the relay
+        // Physically toggle the channels mapped to the sender
         if (canTrigger(trigger, sender)) {
-            executePowerToggle();
+            auto mask = relayChannelMask(
+                getSettings().getRelayChannelMap().c_str(),
+                Comms::getDeviceName(trigger).c_str());
+            executePowerToggle(mask & getChannelMask());
         }
     }
+
     /**
-     *
      * Context forwarder for trigger messages.
      */
     static void triggerMessageForwarder(messages::Trigger const& trigger, comms::Node const& sender, void* context)
@@ -0,0 +1,314 @@
+/**
+ * Relay bank scheduling.
+ *
+ * Timed activations are kept in a deadline queue (a binary min-heap indexed by channel), so the main loop only ever
+ * compares the earliest deadline against the clock, however many channels are active. Schedule windows and the
+ * sender-to-channel map are decoded here too.
+ *
+ * Schedule table layout (little-endian), RELAY_SCHEDULE_ENTRIES entries of:
+ *   Offset  Size  Type      Detail
+ *   ----------------------------------
+ *   0       1     uint8     Channel, an entry for a channel beyond the bank is unused
+ *   1       1     uint8     Days mask, bit 0 is Sunday
+ *   2       2     uint16    Window start, minute of the day
+ *   4       2     uint16    Window end, minute of the day; before the start for a window that runs past midnight
+ *
+ * Channel map, one line per sender: "<device name>=<channel mask>", eg "Hallway PIR=3" for channels 0 and 1. The
+ * device name "*" sets the mask for senders not listed, otherwise they drive channel 0.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#define RELAY_MAX_CHANNELS 4
+#define RELAY_SCHEDULE_ENTRIES 8
+#define RELAY_SCHEDULE_ENTRY_SIZE 6
+#define RELAY_SCHEDULE_SIZE (RELAY_SCHEDULE_ENTRIES * RELAY_SCHEDULE_ENTRY_SIZE)
+#define RELAY_MINUTES_PER_DAY 1440
+#define RELAY_CHANNEL_MASK_DEFAULT 0x01
+
+namespace dosa {
+
+/**
+ * Pending deadlines for up to `N` channels, each channel holds at most one.
+ *
+ * Deadlines are millis() values and compared in a wrap-safe manner, so must lie within 24 days of each other.
+ */
+template <uint8_t N>
+class DeadlineQueue
+{
+   public:
+    DeadlineQueue()
+    {
+        for (auto& p : position) {
+            p = NONE;
+        }
+    }
+
+    /**
+     * Set the deadline for `channel`, replacing any it already had.
+     */
+    void set(uint8_t channel, uint32_t deadline)
+    {
+        if (channel >= N) {
+            return;
+        }
+
+        if (position[channel] == NONE) {
+            position[channel] = count;
+            heap[count++] = {deadline, channel};
+            siftUp(position[channel]);
+        } else {
+            uint8_t i = position[channel];
+            bool earlier = before(deadline, heap[i].deadline);
+            heap[i].deadline = deadline;
+            if (earlier) {
+                siftUp(i);
+            } else {
+                siftDown(i);
+            }
+        }
+    }
+
+    /**
+     * Remove any deadline for `channel`.
+     */
+    void cancel(uint8_t channel)
+    {
+        if (channel >= N || position[channel] == NONE) {
+            return;
+        }
+
+        uint8_t i = position[channel];
+        position[channel] = NONE;
+        --count;
+
+        if (i == count) {
+            return;
+        }
+
+        heap[i] = heap[count];
+        position[heap[i].channel] = i;
+        if (i > 0 && before(heap[i].deadline, heap[parent(i)].deadline)) {
+            siftUp(i);
+        } else {
+            siftDown(i);
+        }
+    }
+
+    /**
+     * If the earliest deadline has been reached at `now`, remove it and write its channel to `channel`.
+     */
+    bool popDue(uint32_t now, uint8_t& channel)
+    {
+        if (count == 0 || before(now, heap[0].deadline)) {
+            return false;
+        }
+
+        channel = heap[0].channel;
+        cancel(channel);
+        return true;
+    }
+
+    [[nodiscard]] bool has(uint8_t channel) const
+    {
+        return channel < N && position[channel] != NONE;
+    }
+
+    /**
+     * Deadline of `channel`, only valid if has() is true.
+     */
+    [[nodiscard]] uint32_t getDeadline(uint8_t channel) const
+    {
+        return has(channel) ? heap[position[channel]].deadline : 0;
+    }
+
+    [[nodiscard]] uint8_t size() const
+    {
+        return count;
+    }
+
+   private:
+    constexpr static uint8_t NONE = 0xFF;
+
+    struct Entry
+    {
+        uint32_t deadline;
+        uint8_t channel;
+    };
+
+    Entry heap[N] = {};
+    uint8_t position[N];  // Heap index of each channel
+    uint8_t count = 0;
+
+    static bool before(uint32_t a, uint32_t b)
+    {
+        return int32_t(a - b) < 0;
+    }
+
+    static uint8_t parent(uint8_t i)
+    {
+        return (i - 1) / 2;
+    }
+
+    void swap(uint8_t a, uint8_t b)
+    {
+        Entry t = heap[a];
+        heap[a] = heap[b];
+        heap[b] = t;
+        position[heap[a].channel] = a;
+        position[heap[b].channel] = b;
+    }
+
+    void siftUp(uint8_t i)
+    {
+        while (i > 0 && before(heap[i].deadline, heap[parent(i)].deadline)) {
+            swap(i, parent(i));
+            i = parent(i);
+        }
+    }
+
+    void siftDown(uint8_t i)
+    {
+        while (true) {
+            uint8_t smallest = i;
+            uint8_t left = 2 * i + 1;
+            uint8_t right = 2 * i + 2;
+
+            if (left < count && before(heap[left].deadline, heap[smallest].deadline)) {
+                smallest = left;
+            }
+            if (right < count && before(heap[right].deadline, heap[smallest].deadline)) {
+                smallest = right;
+            }
+            if (smallest == i) {
+                return;
+            }
+
+            swap(i, smallest);
+            i = smallest;
+        }
+    }
+};
+
+/**
+ * Time-of-day windows in which channels are held on.
+ */
+class RelaySchedule
+{
+   public:
+    /**
+     * Load the table from `data`, of RELAY_SCHEDULE_SIZE bytes.
+     */
+    void load(uint8_t const* data)
+    {
+        count = 0;
+        for (uint8_t i = 0; i < RELAY_SCHEDULE_ENTRIES; ++i) {
+            uint8_t const* ptr = data + i * RELAY_SCHEDULE_ENTRY_SIZE;
+            Entry e;
+            memcpy(&e.channel, ptr, 1);
+            memcpy(&e.days, ptr + 1, 1);
+            memcpy(&e.start, ptr + 2, 2);
+            memcpy(&e.end, ptr + 4, 2);
+
+            if (e.channel < RELAY_MAX_CHANNELS && e.days != 0 && e.start != e.end &&
+                e.start < RELAY_MINUTES_PER_DAY && e.end < RELAY_MINUTES_PER_DAY) {
+                entries[count++] = e;
+            }
+        }
+    }
+
+    /**
+     * Mask of channels scheduled on at `minute` of `weekday` (0 is Sunday).
+     */
+    [[nodiscard]] uint8_t getActiveMask(uint8_t weekday, uint16_t minute) const
+    {
+        uint8_t mask = 0;
+        uint8_t yesterday = (weekday + 6) % 7;
+
+        for (uint8_t i = 0; i < count; ++i) {
+            auto const& e = entries[i];
+            bool active;
+            if (e.start < e.end) {
+                active = (e.days & (1 << weekday)) && minute >= e.start && minute < e.end;
+            } else {
+                // Runs past midnight, the late part belongs to the day the window started
+                active = ((e.days & (1 << weekday)) && minute >= e.start) ||
+                         ((e.days & (1 << yesterday)) && minute < e.end);
+            }
+
+            if (active) {
+                mask |= 1 << e.channel;
+            }
+        }
+
+        return mask;
+    }
+
+    /**
+     * Mask of channels scheduled on at `epoch` seconds, in local time.
+     */
+    [[nodiscard]] uint8_t getActiveMask(uint32_t epoch) const
+    {
+        uint32_t days = epoch / 86400;
+        return getActiveMask((days + 4) % 7, (epoch % 86400) / 60);  // 1 Jan 1970 was a Thursday
+    }
+
+    /**
+     * Number of valid entries.
+     */
+    [[nodiscard]] uint8_t size() const
+    {
+        return count;
+    }
+
+   private:
+    struct Entry
+    {
+        uint8_t channel;
+        uint8_t days;
+        uint16_t start;
+        uint16_t end;
+    };
+
+    Entry entries[RELAY_SCHEDULE_ENTRIES] = {};
+    uint8_t count = 0;
+};
+
+/**
+ * Channel mask that a trigger from `sender` should drive, from the channel `map`.
+ */
+inline uint8_t relayChannelMask(char const* map, char const* sender)
+{
+    uint8_t fallback = RELAY_CHANNEL_MASK_DEFAULT;
+    size_t sender_len = strlen(sender);
+
+    char const* line = map;
+    while (*line != 0) {
+        char const* eol = strchr(line, '\n');
+        if (eol == nullptr) {
+            eol = line + strlen(line);
+        }
+
+        char const* eq = static_cast<char const*>(memchr(line, '=', eol - line));
+        if (eq != nullptr) {
+            auto mask = uint8_t(strtoul(eq + 1, nullptr, 10) & ((1 << RELAY_MAX_CHANNELS) - 1));
+            size_t name_len = eq - line;
+
+            if (name_len == sender_len && memcmp(line, sender, name_len) == 0) {
+                return mask;
+            } else if (name_len == 1 && *line == '*') {
+                fallback = mask;
+            }
+        }
+
+        line = *eol == 0 ? eol : eol + 1;
+    }
+
+    return fallback;
+}
+
+}  // namespace dosa
@@ -2,6 +2,11 @@
 
 #include <dosa.h>
 
+/**
+ * Time (in ms) over which the sonar frame rate is measured.
+ */
+#define SONAR_FRAME_RATE_WINDOW 1000
+
 namespace dosa {
 
 class Sonar
@@ -15,31 +20,55 @@ class Sonar
     /**
      * Checks the sonar for new data. Should be run in main loop.
      *
-     * Returns true if the distance has been updated.
+     * Consumes everything waiting in the UART buffer, keeping only the newest valid frame. Returns true if the
+     * distance has been updated.
      */
     bool process()
     {
-        if (Serial1.available()) {
+        bool updated = false;
+
+        while (Serial1.available()) {
             uint8_t c = Serial1.read();
 
-            if (idx == 0 && c == 0xFF) {
+            if (idx == 0) {
                 // Header byte should be 0xFF
+                if (c == 0xFF) {
+                    buffer[idx++] = c;
+                    syncing = false;
+                } else if (!syncing) {
+                    // Lost our place in the stream, count once per run of discarded bytes
+                    syncing = true;
+                    ++resyncs;
+                }
+            } else if (idx < 3) {
+                // Distance found in middle bytes
                 buffer[idx++] = c;
-            } else if ((idx == 1) || (idx == 2)) {
-                // Distance found in middle byte
-                buffer[idx++] = c;
-            } else if (idx == 3) {
+            } else {
                 // Checksum byte
                 idx = 0;
                 uint8_t sum = buffer[0] + buffer[1] + buffer[2];
                 if (sum == c) {
                     distance = ((uint16_t)buffer[1] << 8) | buffer[2];
-                    return true;
+                    ++frames;
+                    updated = true;
+                } else {
+                    ++checksum_errors;
                 }
             }
         }
 
-        return false;
+        auto now = millis();
+        if (updated) {
+            last_reading = now;
+        }
+
+        if (now - frame_rate_window_start >= SONAR_FRAME_RATE_WINDOW) {
+            frame_rate = (frames - frame_rate_window_frames) * 1000 / (now - frame_rate_window_start);
+            frame_rate_window_start = now;
+            frame_rate_window_frames = frames;
+        }
+
+        return updated;
     }
 
     [[nodiscard]] uint16_t getDistance() const
@@ -47,10 +76,59 @@ class Sonar
         return distance;
     }
 
+    /**
+     * millis() timestamp of the last valid frame, zero if the sonar has never reported.
+     */
+    [[nodiscard]] uint32_t getLastReadingTime() const
+    {
+        return last_reading;
+    }
+
+    /**
+     * Time in ms since the last valid frame.
+     */
+    [[nodiscard]] uint32_t getReadingAge() const
+    {
+        return millis() - last_reading;
+    }
+
+    /**
+     * Valid frames per second, measured over the last SONAR_FRAME_RATE_WINDOW.
+     */
+    [[nodiscard]] uint32_t getFrameRate() const
+    {
+        return frame_rate;
+    }
+
+    [[nodiscard]] uint32_t getFrameCount() const
+    {
+        return frames;
+    }
+
+    [[nodiscard]] uint32_t getChecksumErrors() const
+    {
+        return checksum_errors;
+    }
+
+    [[nodiscard]] uint32_t getResyncs() const
+    {
+        return resyncs;
+    }
+
    private:
     uint16_t distance = 0;
     uint8_t buffer[4] = {0};  // serial read buffer
     uint8_t idx = 0;          // serial read index
+    bool syncing = false;     // discarding bytes while searching for a header
+    uint32_t last_reading = 0;
+
+    // Stats
+    uint32_t frames = 0;
+    uint32_t checksum_errors = 0;
+    uint32_t resyncs = 0;
+    uint32_t frame_rate = 0;
+    uint32_t frame_rate_window_start = 0;
+    uint32_t frame_rate_window_frames = 0;
 };
 
 }  // namespace dosa
@@ -19,9 +19,10 @@ class SonarApp final : public dosa::RangingApp
         return container.getSonar().process();
     }
 
-    uint32_t getSensorDistance() override
+    bool getSensorDistance(uint8_t index, uint32_t& distance) override
     {
-        return container.getSonar().getDistance();
+        distance = container.getSonar().getDistance();
+        return true;
     }
 
     Container& getContainer() override
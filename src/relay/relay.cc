@@ -2,7 +2,7 @@
  * DOSA Relay Switch
  * arduino:samd:nano_33_iot
  *
- * Triggers toggle a relay, creating a power switch.
+ * Triggers toggle a relay, or a bank of relays with scheduled windows, creating a power switch.
  */
 
 #include <dosa_relay.h>
@@ -0,0 +1,61 @@
+#include <current_monitor.h>
+#include <gtest/gtest.h>
+
+using namespace dosa;
+
+TEST(CurrentTest, PeakAndAverage)
+{
+    CurrentMonitor monitor(4000, 100, 4);
+    monitor.start(1000);
+
+    // Start-up surge is averaged but not counted as the peak
+    monitor.update(3000, 1010);
+    monitor.update(3000, 1050);
+    EXPECT_EQ(monitor.getPeak(), 0);
+
+    for (uint32_t t = 1100; t < 1200; t += 2) {
+        monitor.update(1000, t);
+    }
+    EXPECT_EQ(monitor.getCurrent(), 1000);
+    EXPECT_GT(monitor.getPeak(), 1000);
+    EXPECT_LT(monitor.getPeak(), 3000);
+    EXPECT_EQ(monitor.getAverage(), (2 * 3000 + 50 * 1000) / 52);
+    EXPECT_FALSE(monitor.isOverCurrent());
+
+    monitor.start(2000);
+    EXPECT_EQ(monitor.getPeak(), 0);
+    EXPECT_EQ(monitor.getAverage(), 0);
+}
+
+TEST(CurrentTest, OverCurrentTrips)
+{
+    CurrentMonitor monitor(4000, 100, 4);
+    monitor.start(0);
+
+    // Surge during blanking is ignored
+    for (uint32_t t = 0; t < 100; t += 2) {
+        monitor.update(t < 20 ? 8000 : 1000, t);
+    }
+    EXPECT_FALSE(monitor.isOverCurrent());
+
+    // A single high block is filtered out
+    monitor.update(6000, 100);
+    monitor.update(1000, 102);
+    monitor.update(1000, 104);
+    EXPECT_FALSE(monitor.isOverCurrent());
+
+    // Jam: filtered current crosses the limit within a couple of blocks, then must hold
+    uint32_t t = 106;
+    while (!monitor.isOverCurrent() && t < 200) {
+        monitor.update(6000, t);
+        t += 2;
+    }
+    EXPECT_TRUE(monitor.isOverCurrent());
+    EXPECT_LE(t - 106, 10);
+
+    // Latched until the next movement
+    monitor.update(1000, t);
+    EXPECT_TRUE(monitor.isOverCurrent());
+    monitor.start(t);
+    EXPECT_FALSE(monitor.isOverCurrent());
+}
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include <motion_control.h>
+
+using namespace dosa;
+
+TEST(MotionTest, TrapezoidalProfile)
+{
+    MotionProfile profile;
+    profile.start(1000, 5000, MotionProfileShape::TRAPEZOIDAL, 10000);
+
+    // Ramp from the minimum speed up to cruise over 200 ms
+    EXPECT_EQ(profile.getSetpoint(0, 0), 100);
+    EXPECT_EQ(profile.getSetpoint(100, 50), 500);
+    EXPECT_EQ(profile.getSetpoint(200, 100), 1000);
+    EXPECT_EQ(profile.getSetpoint(5000, 5000), 1000);
+
+    // Ramp down: v = sqrt(2 * a * remaining)
+    EXPECT_EQ(profile.getSetpoint(9000, 9900), 1000);
+    EXPECT_EQ(profile.getSetpoint(9000, 9950), 707);
+    EXPECT_EQ(profile.getSetpoint(9000, 9990), 316);
+
+    // Never below the minimum, even past the target
+    EXPECT_EQ(profile.getSetpoint(9000, 10000), 100);
+    EXPECT_EQ(profile.getSetpoint(9000, 12000), 100);
+}
+
+TEST(MotionTest, SCurveProfile)
+{
+    MotionProfile profile;
+    profile.start(1000, 5000, MotionProfileShape::S_CURVE);
+
+    // Ramp takes 1.5x as long, easing in and out, symmetric about the midpoint
+    EXPECT_EQ(profile.getSetpoint(150, 0), 500);
+    EXPECT_LT(profile.getSetpoint(30, 0), 5000 * 30 / 1000);
+    EXPECT_EQ(profile.getSetpoint(100, 0) + profile.getSetpoint(200, 0), 1000);
+    EXPECT_EQ(profile.getSetpoint(300, 0), 1000);
+
+    // No distance given, so no ramp down
+    EXPECT_EQ(profile.getSetpoint(10000, 1000000), 1000);
+}
+
+TEST(MotionTest, DisabledProfile)
+{
+    MotionProfile profile;
+    EXPECT_EQ(profile.getSetpoint(100, 0), 0);
+
+    profile.start(0, 5000, MotionProfileShape::TRAPEZOIDAL, 1000);
+    EXPECT_EQ(profile.getSetpoint(100, 0), 0);
+}
+
+TEST(MotionTest, PidConvergesOnSetpoint)
+{
+    // Simple first-order motor: speed lags 10 ticks/s per unit of power with a 50 ms time constant
+    SpeedPid pid(40, 200);
+    float speed = 0;
+    float dt = 0.002;
+
+    for (int i = 0; i < 1000; ++i) {
+        float power = pid.update(1000, speed, dt, 0.02, 0.5, 0);
+        speed += (power * 10 - speed) * dt / 0.05f;
+    }
+
+    EXPECT_NEAR(speed, 1000, 10);
+    EXPECT_NEAR(pid.getOutput(), 100, 2);
+}
+
+TEST(MotionTest, PidSaturatesWithoutWindup)
+{
+    SpeedPid pid(40, 200);
+
+    // Stalled motor: output pins at the limit, integral does not grow
+    for (int i = 0; i < 500; ++i) {
+        EXPECT_LE(pid.update(1000, 0, 0.002, 0.5, 1.0, 0), 200);
+    }
+    EXPECT_EQ(pid.getOutput(), 200);
+    EXPECT_LT(pid.getIntegral(), 200);
+
+    // Far over speed: clamps to the minimum
+    EXPECT_EQ(pid.update(100, 5000, 0.002, 0.5, 1.0, 0), 40);
+
+    pid.reset();
+    EXPECT_EQ(pid.getIntegral(), 0);
+    EXPECT_EQ(pid.getOutput(), 40);
+}
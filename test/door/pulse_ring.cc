@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <pulse_ring.h>
+
+using namespace dosa;
+
+TEST(PulseRingTest, CountsTicksFromReset)
+{
+    PulseRing ring;
+    EXPECT_EQ(ring.getTicks(), 0);
+    EXPECT_EQ(ring.getLastPulseTime(), 0);
+
+    for (uint32_t i = 1; i <= 50; ++i) {
+        ring.push(i * 1000);
+    }
+    EXPECT_EQ(ring.getTicks(), 50);
+    EXPECT_EQ(ring.getLastPulseTime(), 50000);
+
+    ring.reset();
+    EXPECT_EQ(ring.getTicks(), 0);
+    EXPECT_EQ(ring.getLastPulseTime(), 0);
+    EXPECT_EQ(ring.getPulsesPerSecond(50000), 0);
+
+    ring.push(51000);
+    EXPECT_EQ(ring.getTicks(), 1);
+    EXPECT_EQ(ring.getHead(), 51);
+}
+
+TEST(PulseRingTest, SpeedFromPeriods)
+{
+    PulseRing ring;
+
+    // Needs two pulses for a period
+    ring.push(1000);
+    EXPECT_EQ(ring.getPulsesPerSecond(1000), 0);
+
+    // 500us period = 2000 pulses/s
+    for (uint32_t t = 1500; t <= 10000; t += 500) {
+        ring.push(t);
+    }
+    EXPECT_EQ(ring.getPulsesPerSecond(10000), 2000);
+    EXPECT_EQ(ring.getPulsesPerSecond(10400), 2000);
+
+    // Speeding up shows once the averaged periods catch up
+    for (uint32_t t = 10250; t <= 11000; t += 250) {
+        ring.push(t);
+    }
+    EXPECT_EQ(ring.getPulsesPerSecond(11000), 4000);
+}
+
+TEST(PulseRingTest, StallShowsBeforeNextPulse)
+{
+    PulseRing ring;
+    for (uint32_t t = 1000; t <= 20000; t += 1000) {
+        ring.push(t);
+    }
+    EXPECT_EQ(ring.getPulsesPerSecond(20000), 1000);
+
+    // No further pulses: speed is bounded by the time since the last one
+    EXPECT_EQ(ring.getPulsesPerSecond(22000), 500);
+    EXPECT_EQ(ring.getPulsesPerSecond(25000), 200);
+    EXPECT_LT(ring.getPulsesPerSecond(26000), 1000 * 20 / 100);
+}
+
+TEST(PulseRingTest, TimerWrap)
+{
+    PulseRing ring;
+    uint32_t t = UINT32_MAX - 2000;
+    for (int i = 0; i < 10; ++i) {
+        ring.push(t);
+        t += 400;
+    }
+    EXPECT_EQ(ring.getPulsesPerSecond(t - 400), 2500);
+}
+
+/**
+ * The ISR may push a pulse between the caller sampling the time and reading the ring.
+ */
+TEST(PulseRingTest, PulseNewerThanNow)
+{
+    PulseRing ring;
+    for (uint32_t t = 1000; t <= 10000; t += 500) {
+        ring.push(t);
+    }
+    EXPECT_EQ(ring.getPulsesPerSecond(9990), 2000);
+    EXPECT_EQ(ring.getPulsesPerSecond(9000), 2000);
+
+    // Across the timer wrap too
+    PulseRing wrapped;
+    uint32_t t = UINT32_MAX - 2000;
+    for (int i = 0; i < 10; ++i) {
+        wrapped.push(t);
+        t += 500;
+    }
+    EXPECT_EQ(wrapped.getPulsesPerSecond(t - 600), 2000);
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include <winch_telemetry.h>
+
+using namespace dosa;
+
+namespace {
+
+uint16_t read16(uint8_t const* ptr)
+{
+    uint16_t v;
+    memcpy(&v, ptr, 2);
+    return v;
+}
+
+}  // namespace
+
+TEST(TelemetryTest, RecordsAtInterval)
+{
+    WinchTelemetry telemetry;
+    telemetry.begin(1000, WINCH_TELEMETRY_FLAG_REWIND);
+
+    for (uint32_t t = 1000; t < 1100; t += 2) {
+        if (telemetry.isDue(t)) {
+            telemetry.record(t, 4, (t - 1000) * 10, 500, 800, 1200);
+        }
+    }
+
+    EXPECT_EQ(telemetry.getSampleCount(), 5);
+    EXPECT_EQ(telemetry.getChunkCount(), 1);
+
+    uint8_t chunk[WINCH_TELEMETRY_CHUNK_SIZE];
+    EXPECT_EQ(telemetry.pack(0, 3, chunk), WINCH_TELEMETRY_HEADER_SIZE + 5 * WINCH_TELEMETRY_SAMPLE_SIZE);
+
+    EXPECT_EQ(chunk[0], 3);
+    EXPECT_EQ(chunk[1], WINCH_TELEMETRY_VERSION);
+    EXPECT_EQ(read16(chunk + 2), telemetry.getSequence());
+    EXPECT_EQ(chunk[4], WINCH_TELEMETRY_FLAG_REWIND);
+    EXPECT_EQ(chunk[5], 0);
+    EXPECT_EQ(chunk[6], 1);
+    EXPECT_EQ(read16(chunk + 7), WINCH_TELEMETRY_INTERVAL);
+    EXPECT_EQ(read16(chunk + 9), 5);
+    EXPECT_EQ(read16(chunk + 11), 0);
+    EXPECT_EQ(chunk[13], 5);
+
+    // Third sample: 40 ms in
+    uint8_t const* sample = chunk + WINCH_TELEMETRY_HEADER_SIZE + 2 * WINCH_TELEMETRY_SAMPLE_SIZE;
+    EXPECT_EQ(read16(sample), 4);
+    EXPECT_EQ(sample[2], 4);
+    EXPECT_EQ(read16(sample + 3), 400);
+    EXPECT_EQ(read16(sample + 5), 500);
+    EXPECT_EQ(read16(sample + 7), 800);
+    EXPECT_EQ(read16(sample + 9), 1200);
+}
+
+TEST(TelemetryTest, DecimatesWhenFull)
+{
+    WinchTelemetry telemetry;
+    telemetry.begin(0, 0);
+
+    // Twice as long as the buffer holds at the initial interval
+    uint32_t duration = WINCH_TELEMETRY_MAX_SAMPLES * WINCH_TELEMETRY_INTERVAL * 2;
+    for (uint32_t t = 0; t < duration; t += 2) {
+        if (telemetry.isDue(t)) {
+            telemetry.record(t, 2, t, 0, 0, 0);
+        }
+    }
+
+    EXPECT_EQ(telemetry.getInterval(), WINCH_TELEMETRY_INTERVAL * 2);
+    EXPECT_LE(telemetry.getSampleCount(), WINCH_TELEMETRY_MAX_SAMPLES);
+    EXPECT_GT(telemetry.getSampleCount(), WINCH_TELEMETRY_MAX_SAMPLES * 9 / 10);
+    EXPECT_EQ(telemetry.getChunkCount(), 3);
+
+    // Chunks cover the whole sequence, evenly spaced from start to end
+    uint8_t chunk[WINCH_TELEMETRY_CHUNK_SIZE];
+    uint16_t expected_time = 0;
+    uint16_t total = 0;
+    for (uint8_t i = 0; i < telemetry.getChunkCount(); ++i) {
+        telemetry.pack(i, 0, chunk);
+        EXPECT_TRUE(chunk[4] & WINCH_TELEMETRY_FLAG_DECIMATED);
+        EXPECT_EQ(read16(chunk + 11), total);
+
+        for (uint8_t j = 0; j < chunk[13]; ++j) {
+            auto time = read16(chunk + WINCH_TELEMETRY_HEADER_SIZE + j * WINCH_TELEMETRY_SAMPLE_SIZE);
+            EXPECT_EQ(time, expected_time);
+            expected_time += WINCH_TELEMETRY_INTERVAL * 2 / WINCH_TELEMETRY_TIME_UNIT;
+        }
+        total += chunk[13];
+    }
+
+    EXPECT_EQ(total, telemetry.getSampleCount());
+    EXPECT_GE(uint32_t(expected_time) * WINCH_TELEMETRY_TIME_UNIT, duration - WINCH_TELEMETRY_INTERVAL * 2);
+}
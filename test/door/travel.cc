@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include <travel_model.h>
+
+using namespace dosa;
+
+TEST(TravelTest, ConfiguredUntilReady)
+{
+    TravelModel model;
+    EXPECT_FALSE(model.isReady());
+    EXPECT_EQ(model.predict(10000, 15000), 15000);
+
+    model.learn(10000, 12000);
+    model.learn(10000, 12000);
+    EXPECT_EQ(model.predict(10000, 15000), 15000);
+
+    model.learn(10000, 12000);
+    EXPECT_TRUE(model.isReady());
+    EXPECT_EQ(model.predict(10000, 15000), 12600);  // 12000 + 5% margin
+}
+
+TEST(TravelTest, RatioWhenOpensAreConsistent)
+{
+    TravelModel model;
+    for (int i = 0; i < 5; ++i) {
+        model.learn(10000 + (i % 2) * 20, 11000);
+    }
+
+    EXPECT_NEAR(model.getGain(), 1.1, 0.01);
+    EXPECT_EQ(model.getOffset(), 0);
+    EXPECT_NEAR(model.predict(12000, 15000), 13200 * 1.05, 20);
+}
+
+TEST(TravelTest, FitsLine)
+{
+    TravelModel model;
+    uint32_t opens[] = {8000, 10000, 12000, 9000, 11000};
+    for (auto open : opens) {
+        model.learn(open, open / 2 + 6000);
+    }
+
+    EXPECT_NEAR(model.getGain(), 0.5, 0.01);
+    EXPECT_NEAR(model.getOffset(), 6000, 100);
+    EXPECT_NEAR(model.predict(10000, 15000), 11000 * 1.05, 20);
+
+    // Kept within limits of the configured value
+    EXPECT_EQ(model.predict(100000, 15000), 22500);
+    EXPECT_EQ(model.predict(0, 15000), 7500);
+}
+
+TEST(TravelTest, AdaptsToStretch)
+{
+    TravelModel model;
+    for (int i = 0; i < 10; ++i) {
+        model.learn(10000, 11000);
+    }
+
+    // Line stretches, the door now needs more release for the same open
+    for (int i = 0; i < 10; ++i) {
+        model.learn(10000, 12000);
+    }
+
+    EXPECT_NEAR(model.predict(10000, 15000), 12000 * 1.05, 150);
+}
+
+TEST(TravelTest, SaveAndLoad)
+{
+    TravelModel model;
+    model.learn(8000, 10000);
+    model.learn(12000, 12000);
+    model.learn(10000, 11000);
+
+    uint8_t state[TRAVEL_MODEL_STATE_SIZE];
+    model.save(state);
+
+    TravelModel restored;
+    restored.load(state);
+    EXPECT_EQ(restored.getSampleCount(), 3);
+    EXPECT_EQ(restored.predict(9000, 15000), model.predict(9000, 15000));
+
+    // Empty (zeroed) settings block
+    uint8_t empty[TRAVEL_MODEL_STATE_SIZE] = {0};
+    restored.load(empty);
+    EXPECT_FALSE(restored.isReady());
+    EXPECT_EQ(restored.getSampleCount(), 0);
+}
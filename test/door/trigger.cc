@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+#include <trigger_queue.h>
+
+using namespace dosa;
+
+TEST(TriggerTest, StartsWhenIdle)
+{
+    TriggerQueue queue;
+    EXPECT_EQ(queue.next(WinchState::IDLE, false, 0), TriggerAction::NONE);
+
+    queue.push(100);
+    EXPECT_TRUE(queue.isPending());
+    EXPECT_EQ(queue.next(WinchState::IDLE, false, 110), TriggerAction::START);
+    EXPECT_FALSE(queue.isPending());
+    EXPECT_EQ(queue.next(WinchState::IDLE, false, 120), TriggerAction::NONE);
+}
+
+TEST(TriggerTest, ExtendsOpenWait)
+{
+    TriggerQueue queue;
+    queue.push(100);
+    EXPECT_EQ(queue.next(WinchState::OPEN_WAIT, false, 110), TriggerAction::EXTEND);
+    EXPECT_FALSE(queue.isPending());
+}
+
+TEST(TriggerTest, ReversesCloseButNotRewind)
+{
+    TriggerQueue queue;
+    queue.push(100);
+    EXPECT_EQ(queue.next(WinchState::CLOSING, false, 110), TriggerAction::REVERSE);
+
+    // A rewind runs to completion, the trigger then starts a sequence once idle
+    queue.push(200);
+    EXPECT_EQ(queue.next(WinchState::CLOSING, true, 210), TriggerAction::NONE);
+    EXPECT_TRUE(queue.isPending());
+    EXPECT_EQ(queue.next(WinchState::IDLE, false, 5000), TriggerAction::START);
+}
+
+TEST(TriggerTest, SatisfiedByOpening)
+{
+    TriggerQueue queue;
+    for (auto state : {WinchState::SONAR_WAIT, WinchState::OPENING, WinchState::REVERSING}) {
+        queue.push(100);
+        EXPECT_EQ(queue.next(state, false, 110), TriggerAction::COALESCE);
+        EXPECT_FALSE(queue.isPending());
+    }
+    EXPECT_EQ(queue.getCoalescedCount(), 3);
+}
+
+TEST(TriggerTest, HeldThroughCalibrateAndCooldown)
+{
+    TriggerQueue queue;
+    queue.push(100);
+    queue.push(150);
+    queue.push(200);
+    EXPECT_EQ(queue.getCoalescedCount(), 2);
+
+    for (auto state : {WinchState::SETTLE,
+                       WinchState::CALIBRATE_TENSION,
+                       WinchState::CALIBRATE_PAUSE,
+                       WinchState::CALIBRATE_ROLLBACK,
+                       WinchState::COOLDOWN}) {
+        EXPECT_EQ(queue.next(state, false, 1000), TriggerAction::NONE);
+        EXPECT_TRUE(queue.isPending());
+    }
+
+    // Three triggers, one sequence
+    EXPECT_EQ(queue.next(WinchState::IDLE, false, 4000), TriggerAction::START);
+    EXPECT_EQ(queue.next(WinchState::IDLE, false, 4010), TriggerAction::NONE);
+}
+
+TEST(TriggerTest, ExpiresWhenStale)
+{
+    TriggerQueue queue;
+    queue.push(1000);
+    EXPECT_EQ(queue.next(WinchState::COOLDOWN, false, 1000 + TRIGGER_QUEUE_MAX_AGE), TriggerAction::NONE);
+    EXPECT_TRUE(queue.isPending());
+
+    EXPECT_EQ(queue.next(WinchState::IDLE, false, 1001 + TRIGGER_QUEUE_MAX_AGE), TriggerAction::NONE);
+    EXPECT_FALSE(queue.isPending());
+    EXPECT_EQ(queue.getExpiredCount(), 1);
+
+    // Refreshed by a later trigger
+    queue.push(20000);
+    queue.push(30000);
+    EXPECT_EQ(queue.next(WinchState::IDLE, false, 31000), TriggerAction::START);
+}
@@ -0,0 +1,34 @@
+#include <crc32.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+using namespace dosa;
+
+TEST(Crc32Test, KnownValues)
+{
+    char const* check = "123456789";
+    EXPECT_EQ(Crc32::of(check, strlen(check)), 0xCBF43926);
+    EXPECT_EQ(Crc32::of(nullptr, 0), 0x00000000);
+
+    uint8_t zeros[4] = {0};
+    EXPECT_EQ(Crc32::of(zeros, sizeof(zeros)), 0x2144DF1C);
+}
+
+TEST(Crc32Test, Incremental)
+{
+    char const* data = "The quick brown fox jumps over the lazy dog";
+    size_t len = strlen(data);
+
+    Crc32 crc;
+    crc.update(data, 10);
+    crc.update(data + 10, 1);
+    crc.update(data + 11, len - 11);
+    EXPECT_EQ(crc.getValue(), Crc32::of(data, len));
+    EXPECT_EQ(crc.getValue(), 0x414FA339);
+
+    crc.reset();
+    EXPECT_EQ(crc.getValue(), 0x00000000);
+    crc.update(data, len);
+    EXPECT_EQ(crc.getValue(), 0x414FA339);
+}
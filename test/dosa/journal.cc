@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include <journal.h>
+
+#include <cstring>
+
+using namespace dosa;
+
+namespace {
+
+struct MemStorage
+{
+    uint8_t mem[1024] = {0};
+
+    void read(uint32_t addr, void* dest, size_t size)
+    {
+        memcpy(dest, mem + addr, size);
+    }
+
+    void write(uint32_t addr, void const* src, size_t size)
+    {
+        memcpy(mem + addr, src, size);
+    }
+};
+
+JournalRecord getRecord(uint8_t const* page, uint8_t index)
+{
+    JournalRecord rec;
+    memcpy(&rec, page + JOURNAL_PAGE_HEADER_SIZE + index * JOURNAL_RECORD_SIZE, JOURNAL_RECORD_SIZE);
+    return rec;
+}
+
+uint32_t getPageField(uint8_t const* page, uint8_t offset)
+{
+    uint32_t value;
+    memcpy(&value, page + offset, 4);
+    return value;
+}
+
+}  // namespace
+
+TEST(JournalTest, AppendAndPage)
+{
+    MemStorage storage;
+    Journal<MemStorage> journal(storage, 64, 16 * JOURNAL_RECORD_SIZE);
+    journal.mount();
+    EXPECT_EQ(journal.getNext(), 0);
+
+    journal.append(JournalEvent::BOOT, 1, 10, 7);
+    journal.append(JournalEvent::TRIGGER, 0, 2000, 7);
+    journal.append(JournalEvent::SECURITY, 1, 3000, 7);
+
+    uint8_t page[JOURNAL_PAGE_SIZE];
+    EXPECT_EQ(journal.packPage(0, 2, page), JOURNAL_PAGE_HEADER_SIZE + 3 * JOURNAL_RECORD_SIZE);
+    EXPECT_EQ(page[0], 2);
+    EXPECT_EQ(page[1], JOURNAL_VERSION);
+    EXPECT_EQ(getPageField(page, 2), 0);
+    EXPECT_EQ(getPageField(page, 6), 3);
+    EXPECT_EQ(getPageField(page, 10), 3);
+    EXPECT_EQ(page[14], 3);
+
+    auto rec = getRecord(page, 1);
+    EXPECT_EQ(rec.sequence, 1);
+    EXPECT_EQ(rec.time, 2000);
+    EXPECT_EQ(rec.boot, 7);
+    EXPECT_EQ(rec.event, JournalEvent::TRIGGER);
+    EXPECT_EQ(rec.detail, 0);
+
+    // Sequence continues after a reboot
+    Journal<MemStorage> remounted(storage, 64, 16 * JOURNAL_RECORD_SIZE);
+    remounted.mount();
+    EXPECT_EQ(remounted.getNext(), 3);
+    remounted.append(JournalEvent::BOOT, 1, 10, 8);
+    EXPECT_EQ(remounted.packPage(3, 0, page), JOURNAL_PAGE_HEADER_SIZE + JOURNAL_RECORD_SIZE);
+    EXPECT_EQ(getRecord(page, 0).boot, 8);
+
+    // Nothing outside of the region is touched
+    for (uint32_t i = 0; i < 64; ++i) {
+        EXPECT_EQ(storage.mem[i], 0);
+    }
+}
+
+TEST(JournalTest, RingOverwritesOldest)
+{
+    MemStorage storage;
+    Journal<MemStorage> journal(storage, 0, 16 * JOURNAL_RECORD_SIZE);
+    journal.mount();
+
+    for (uint32_t i = 0; i < 100; ++i) {
+        journal.append(JournalEvent::TRIGGER, i, i * 10, 1);
+    }
+
+    Journal<MemStorage> remounted(storage, 0, 16 * JOURNAL_RECORD_SIZE);
+    remounted.mount();
+    EXPECT_EQ(remounted.getNext(), 100);
+    EXPECT_EQ(remounted.getOldest(), 84);
+
+    // A request from before the oldest starts at the oldest
+    uint8_t page[JOURNAL_PAGE_SIZE];
+    remounted.packPage(10, 0, page);
+    EXPECT_EQ(page[14], 16);
+    EXPECT_EQ(getRecord(page, 0).sequence, 84);
+    EXPECT_EQ(getRecord(page, 15).detail, 99);
+    EXPECT_EQ(getPageField(page, 10), 100);
+}
+
+TEST(JournalTest, Paging)
+{
+    MemStorage storage;
+    Journal<MemStorage> journal(storage, 0, sizeof(storage.mem));
+    journal.mount();
+
+    for (uint32_t i = 0; i < 50; ++i) {
+        journal.append(JournalEvent::TRIGGER, i, i, 1);
+    }
+
+    uint8_t page[JOURNAL_PAGE_SIZE];
+    journal.packPage(0, 0, page);
+    EXPECT_EQ(page[14], JOURNAL_PAGE_RECORDS);
+    EXPECT_EQ(getPageField(page, 10), JOURNAL_PAGE_RECORDS);
+
+    journal.packPage(getPageField(page, 10), 0, page);
+    EXPECT_EQ(page[14], 50 - JOURNAL_PAGE_RECORDS);
+    EXPECT_EQ(getRecord(page, 0).sequence, JOURNAL_PAGE_RECORDS);
+
+    journal.packPage(50, 0, page);
+    EXPECT_EQ(page[14], 0);
+}
+
+TEST(JournalTest, TornRecordIsIgnored)
+{
+    MemStorage storage;
+    Journal<MemStorage> journal(storage, 0, 16 * JOURNAL_RECORD_SIZE);
+    journal.mount();
+
+    for (uint32_t i = 0; i < 5; ++i) {
+        journal.append(JournalEvent::TRIGGER, i, i, 1);
+    }
+
+    // Half of the last record written
+    storage.mem[4 * JOURNAL_RECORD_SIZE + 12] ^= 0xFF;
+
+    Journal<MemStorage> remounted(storage, 0, 16 * JOURNAL_RECORD_SIZE);
+    remounted.mount();
+    EXPECT_EQ(remounted.getNext(), 4);
+
+    uint8_t page[JOURNAL_PAGE_SIZE];
+    remounted.packPage(0, 0, page);
+    EXPECT_EQ(page[14], 4);
+}
@@ -0,0 +1,240 @@
+#include <gtest/gtest.h>
+#include <kv_store.h>
+
+#include <cstring>
+
+using namespace dosa;
+
+namespace {
+
+/**
+ * In-memory storage, able to simulate losing power part-way through a write.
+ */
+struct MemStorage
+{
+    uint8_t mem[2048] = {0};
+    uint32_t reads = 0;
+    uint32_t bytes_written = 0;
+    int32_t fail_after = -1;  // Bytes that may be written before the power is cut
+
+    void read(uint32_t addr, void* dest, size_t size)
+    {
+        memcpy(dest, mem + addr, size);
+        ++reads;
+    }
+
+    void write(uint32_t addr, void const* src, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i) {
+            if (fail_after == 0) {
+                return;
+            }
+            if (fail_after > 0) {
+                --fail_after;
+            }
+
+            mem[addr + i] = static_cast<uint8_t const*>(src)[i];
+            ++bytes_written;
+        }
+    }
+};
+
+}  // namespace
+
+TEST(KvStoreTest, SetAndGet)
+{
+    MemStorage storage;
+    KvStore<MemStorage> store(storage, 0x100, 1024);
+    store.mount();
+    EXPECT_EQ(store.size(), 0);
+
+    uint32_t counter = 0;
+    EXPECT_FALSE(store.get("boots", counter));
+    EXPECT_TRUE(store.set("boots", uint32_t(41)));
+    EXPECT_TRUE(store.set("model", "abc", 3));
+    EXPECT_TRUE(store.set("boots", uint32_t(42)));
+    EXPECT_EQ(store.size(), 2);
+
+    KvStore<MemStorage> remounted(storage, 0x100, 1024);
+    remounted.mount();
+    EXPECT_EQ(remounted.size(), 2);
+    EXPECT_TRUE(remounted.get("boots", counter));
+    EXPECT_EQ(counter, 42);
+
+    char model[8] = {0};
+    EXPECT_EQ(remounted.get("model", model, sizeof(model)), 3);
+    EXPECT_STREQ(model, "abc");
+    EXPECT_EQ(remounted.getFree(), store.getFree());
+
+    // Outside of the region
+    for (uint32_t i = 0; i < 0x100; ++i) {
+        EXPECT_EQ(storage.mem[i], 0);
+    }
+}
+
+TEST(KvStoreTest, Limits)
+{
+    MemStorage storage;
+    KvStore<MemStorage> store(storage, 0, 2048);
+    store.mount();
+
+    uint8_t big[KV_STORE_MAX_VALUE_SIZE + 1] = {0};
+    EXPECT_FALSE(store.set("", 1));
+    EXPECT_FALSE(store.set("a key that is far too long to store", 1));
+    EXPECT_FALSE(store.set("big", big, sizeof(big)));
+    EXPECT_TRUE(store.set("big", big, KV_STORE_MAX_VALUE_SIZE));
+
+    // Typed read of the wrong size
+    uint32_t value = 7;
+    EXPECT_FALSE(store.get("big", value));
+    EXPECT_EQ(value, 7);
+
+    char key[8];
+    for (uint8_t i = 1; i < KV_STORE_MAX_KEYS; ++i) {
+        snprintf(key, sizeof(key), "k%d", i);
+        EXPECT_TRUE(store.set(key, i));
+    }
+    EXPECT_FALSE(store.set("one more", 1));
+    EXPECT_TRUE(store.set("k1", uint8_t(100)));
+}
+
+TEST(KvStoreTest, UnchangedValueIsNotWritten)
+{
+    MemStorage storage;
+    KvStore<MemStorage> store(storage, 0, 1024);
+    store.mount();
+
+    EXPECT_TRUE(store.set("calibration", 1.5f));
+    auto written = storage.bytes_written;
+    auto free = store.getFree();
+
+    EXPECT_TRUE(store.set("calibration", 1.5f));
+    EXPECT_EQ(storage.bytes_written, written);
+    EXPECT_EQ(store.getFree(), free);
+}
+
+TEST(KvStoreTest, Remove)
+{
+    MemStorage storage;
+    KvStore<MemStorage> store(storage, 0, 1024);
+    store.mount();
+
+    store.set("a", 1);
+    store.set("b", 2);
+    EXPECT_TRUE(store.remove("a"));
+    EXPECT_TRUE(store.remove("missing"));
+    EXPECT_FALSE(store.has("a"));
+    EXPECT_TRUE(store.has("b"));
+
+    KvStore<MemStorage> remounted(storage, 0, 1024);
+    remounted.mount();
+    EXPECT_FALSE(remounted.has("a"));
+    EXPECT_TRUE(remounted.has("b"));
+    EXPECT_EQ(remounted.size(), 1);
+}
+
+TEST(KvStoreTest, Compaction)
+{
+    MemStorage storage;
+    KvStore<MemStorage> store(storage, 0, 512);
+    store.mount();
+
+    store.set("fixed", uint32_t(0xDEADBEEF));
+    store.set("gone", 5);
+    store.remove("gone");
+    for (uint32_t i = 0; i < 200; ++i) {
+        EXPECT_TRUE(store.set("counter", i));
+    }
+    EXPECT_GT(store.getCompactions(), 0);
+
+    KvStore<MemStorage> remounted(storage, 0, 512);
+    remounted.mount();
+    uint32_t value;
+    EXPECT_TRUE(remounted.get("counter", value));
+    EXPECT_EQ(value, 199);
+    EXPECT_TRUE(remounted.get("fixed", value));
+    EXPECT_EQ(value, 0xDEADBEEF);
+    EXPECT_FALSE(remounted.has("gone"));
+    EXPECT_EQ(remounted.size(), 2);
+    EXPECT_EQ(remounted.getFree(), store.getFree());
+}
+
+TEST(KvStoreTest, PowerCutDuringWrite)
+{
+    MemStorage base;
+    {
+        KvStore<MemStorage> store(base, 0, 256);
+        store.mount();
+        store.set("other", 9);
+        for (uint32_t i = 0; i < 8; ++i) {
+            store.set("counter", i);
+        }
+    }
+
+    // Cut the power at every byte of a write, including writes that trigger a compaction
+    for (uint32_t next = 8; next < 16; ++next) {
+        for (int32_t cut = 0; cut < 64; ++cut) {
+            MemStorage storage = base;
+            KvStore<MemStorage> store(storage, 0, 256);
+            store.mount();
+            storage.fail_after = cut;
+            store.set("counter", next);
+            storage.fail_after = -1;
+
+            KvStore<MemStorage> remounted(storage, 0, 256);
+            remounted.mount();
+            uint32_t value = 0;
+            EXPECT_TRUE(remounted.get("counter", value));
+            EXPECT_TRUE(value == next || value == next - 1) << "next " << next << ", cut " << cut;
+            EXPECT_TRUE(remounted.get("other", value));
+            EXPECT_EQ(value, 9);
+
+            // The store remains usable
+            EXPECT_TRUE(remounted.set("counter", uint32_t(100)));
+            KvStore<MemStorage> again(storage, 0, 256);
+            again.mount();
+            EXPECT_TRUE(again.get("counter", value));
+            EXPECT_EQ(value, 100);
+        }
+
+        KvStore<MemStorage> store(base, 0, 256);
+        store.mount();
+        store.set("counter", next);
+    }
+}
+
+TEST(BlockReaderTest, ServesNearbyReadsFromBuffer)
+{
+    MemStorage storage;
+    for (uint32_t i = 0; i < sizeof(storage.mem); ++i) {
+        storage.mem[i] = uint8_t(i);
+    }
+
+    BlockReader<MemStorage, 16> reader(storage, 40);
+    uint8_t value[4];
+    for (uint32_t addr = 0; addr < 12; addr += 4) {
+        reader.read(addr, value, 4);
+        EXPECT_EQ(value[0], addr);
+    }
+    EXPECT_EQ(reader.getStorageReads(), 1);
+
+    // Straddles the buffer
+    reader.read(14, value, 4);
+    EXPECT_EQ(value[0], 14);
+    EXPECT_EQ(value[3], 17);
+    EXPECT_EQ(reader.getStorageReads(), 2);
+
+    // Large reads bypass the buffer
+    uint8_t large[16];
+    reader.read(100, large, sizeof(large));
+    EXPECT_EQ(large[15], 115);
+    EXPECT_EQ(reader.getStorageReads(), 3);
+    EXPECT_EQ(reader.read8(15), 15);
+    EXPECT_EQ(reader.getStorageReads(), 3);
+
+    // Nothing is read at or beyond the limit
+    reader.read(38, value, 4);
+    EXPECT_EQ(value[0], 38);
+    EXPECT_EQ(value[1], 39);
+    EXPECT_EQ(value[2], 0);
+}
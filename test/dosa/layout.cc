@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <settings_layout.h>
+
+#include <cstring>
+
+using namespace dosa;
+
+TEST(SettingsLayoutTest, FieldsDoNotOverlap)
+{
+    uint16_t end = 0;
+    for (uint8_t i = 0; i < SettingsLayout::field_count; ++i) {
+        auto field = static_cast<SettingsField>(i);
+        if (field == SettingsField::PIN) {
+            EXPECT_LE(end, SETTINGS_FIXED_REGION_SIZE);
+            end = SETTINGS_FIXED_REGION_SIZE;
+        }
+
+        EXPECT_EQ(SettingsLayout::getOffset(field), end) << "field " << int(i);
+        end += SettingsLayout::getSize(field);
+    }
+
+    EXPECT_EQ(SettingsLayout::getImageSize(), end);
+}
+
+TEST(SettingsLayoutTest, OffsetsAreStable)
+{
+    // Stored images depend on these, a change here needs a settings version bump
+    EXPECT_EQ(SettingsLayout::getOffset(SettingsField::LOCKED), 0);
+    EXPECT_EQ(SettingsLayout::getOffset(SettingsField::DOOR_PROFILE), 44);
+    EXPECT_EQ(SettingsLayout::getOffset(SettingsField::RELAY_ACTIVATION_TIME), 62);
+    EXPECT_EQ(SettingsLayout::getOffset(SettingsField::PIN), 256);
+    EXPECT_EQ(SettingsLayout::getOffset(SettingsField::LISTEN_DEVICES), 626);
+    EXPECT_EQ(SettingsLayout::getOffset(SettingsField::OTA_SERVER_PORT), 116);
+    EXPECT_EQ(SettingsLayout::getOffset(SettingsField::OTA_SERVER_ADDR), 1128);
+    EXPECT_EQ(SettingsLayout::getImageSize(), 1244);
+}
+
+TEST(SettingsLayoutTest, SlotHeaders)
+{
+    EXPECT_EQ(SettingsLayout::getFixedUsed(), 118);
+
+    SettingsSlotHeader header{{'D', 'S', '2', '4'}, 1, 0};
+    EXPECT_TRUE(SettingsSlots::isCurrent(header));
+    memcpy(header.version, "DS23", 4);
+    EXPECT_FALSE(SettingsSlots::isCurrent(header));
+    memcpy(header.version, "DS99", 4);
+    EXPECT_FALSE(SettingsSlots::isCurrent(header));
+    memset(header.version, 0xFF, 4);
+    EXPECT_FALSE(SettingsSlots::isCurrent(header));
+}
+
+TEST(SettingsLayoutTest, StringSlots)
+{
+    EXPECT_FALSE(SettingsLayout::isString(SettingsField::RELAY_SCHEDULE));
+    EXPECT_TRUE(SettingsLayout::isString(SettingsField::PIN));
+    EXPECT_EQ(SettingsLayout::getCapacity(SettingsField::DEVICE_NAME), 20);
+    EXPECT_EQ(SettingsLayout::getSize(SettingsField::DEVICE_NAME), 22);
+    EXPECT_EQ(SettingsLayout::getSize(SettingsField::RELAY_SCHEDULE), 48);
+}
+
+TEST(SettingsLayoutTest, DirtyTracking)
+{
+    SettingsDirty dirty;
+    EXPECT_FALSE(dirty.any());
+
+    dirty.mark(SettingsField::LOCKED);
+    dirty.mark(SettingsField::LISTEN_DEVICES);
+    EXPECT_TRUE(dirty.any());
+    EXPECT_TRUE(dirty.isDirty(SettingsField::LOCKED));
+    EXPECT_TRUE(dirty.isDirty(SettingsField::LISTEN_DEVICES));
+    EXPECT_FALSE(dirty.isDirty(SettingsField::PIN));
+
+    dirty.clear();
+    EXPECT_FALSE(dirty.any());
+
+    dirty.markAll();
+    for (uint8_t i = 0; i < SettingsLayout::field_count; ++i) {
+        EXPECT_TRUE(dirty.isDirty(static_cast<SettingsField>(i)));
+    }
+}
+
+TEST(SettingsLayoutTest, SlotSelection)
+{
+    EXPECT_EQ(SettingsSlots::getAddress(0), 0);
+    EXPECT_EQ(SettingsSlots::getAddress(1), SETTINGS_SLOT_SIZE);
+    EXPECT_LE(SettingsSlots::getAddress(SETTINGS_SLOT_COUNT), 8192);
+
+    EXPECT_EQ(SettingsSlots::select(false, 0, false, 0), -1);
+    EXPECT_EQ(SettingsSlots::select(true, 7, false, 8), 0);
+    EXPECT_EQ(SettingsSlots::select(false, 7, true, 3), 1);
+    EXPECT_EQ(SettingsSlots::select(true, 7, true, 8), 1);
+    EXPECT_EQ(SettingsSlots::select(true, 9, true, 8), 0);
+
+    // Generation counter wrapping
+    EXPECT_EQ(SettingsSlots::select(true, 0xFFFFFFFF, true, 0), 1);
+    EXPECT_EQ(SettingsSlots::select(true, 1, true, 0xFFFFFFFE), 0);
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <laser_frame.h>
+
+#include <cstring>
+
+using namespace dosa;
+
+namespace {
+
+/**
+ * Build a checksummed measurement frame for `addr` with a 7-character "DDD.DDD" body.
+ */
+void makeFrame(uint8_t addr, char const* body, uint8_t* frame)
+{
+    frame[0] = addr;
+    frame[1] = 0x06;
+    frame[2] = 0x83;
+    memcpy(frame + 3, body, 7);
+    frame[10] = LaserFrameParser::getChecksum(frame, 10);
+}
+
+/**
+ * Push `len` bytes, returns the number of frames parsed.
+ */
+int feed(LaserFrameParser& parser, uint8_t const* data, size_t len, LaserReading& reading)
+{
+    int parsed = 0;
+    for (size_t i = 0; i < len; ++i) {
+        parsed += parser.push(data[i], reading);
+    }
+    return parsed;
+}
+
+}  // namespace
+
+TEST(LaserFrameTest, DecodesDistance)
+{
+    uint8_t frame[LASER_FRAME_SIZE];
+    makeFrame(0x80, "012.345", frame);
+
+    LaserFrameParser parser;
+    LaserReading reading{};
+    EXPECT_EQ(feed(parser, frame, sizeof(frame), reading), 1);
+    EXPECT_EQ(reading.address, 0x80);
+    EXPECT_FALSE(reading.error);
+    EXPECT_EQ(reading.distance, 12345);
+    EXPECT_EQ(parser.getFrameCount(), 1);
+}
+
+TEST(LaserFrameTest, MeasurementError)
+{
+    uint8_t frame[LASER_FRAME_SIZE];
+    makeFrame(0x80, "ERR--20", frame);
+
+    LaserFrameParser parser;
+    LaserReading reading{};
+    EXPECT_EQ(feed(parser, frame, sizeof(frame), reading), 1);
+    EXPECT_TRUE(reading.error);
+    EXPECT_EQ(reading.distance, 0);
+}
+
+TEST(LaserFrameTest, ChecksumError)
+{
+    uint8_t frame[LASER_FRAME_SIZE];
+    makeFrame(0x80, "001.000", frame);
+    frame[10] ^= 0x01;
+
+    LaserFrameParser parser;
+    LaserReading reading{};
+    EXPECT_EQ(feed(parser, frame, sizeof(frame), reading), 0);
+    EXPECT_EQ(parser.getChecksumErrors(), 1);
+}
+
+TEST(LaserFrameTest, ResyncsAndInterleavesAddresses)
+{
+    uint8_t stream[3 + LASER_FRAME_SIZE * 2 + 1];
+    stream[0] = 0x42;  // garbage before the first frame
+    stream[1] = 0x13;
+    stream[2] = 0xFF;  // skipped by error correction
+    makeFrame(0x80, "000.500", stream + 3);
+    makeFrame(0x81, "002.000", stream + 3 + LASER_FRAME_SIZE);
+    stream[sizeof(stream) - 1] = 0x80;  // start of a partial frame
+
+    LaserFrameParser parser;
+    LaserReading readings[2]{};
+    int parsed = 0;
+    for (auto b : stream) {
+        if (parser.push(b, readings[parsed])) {
+            ++parsed;
+        }
+    }
+
+    ASSERT_EQ(parsed, 2);
+    EXPECT_EQ(readings[0].address, 0x80);
+    EXPECT_EQ(readings[0].distance, 500);
+    EXPECT_EQ(readings[1].address, 0x81);
+    EXPECT_EQ(readings[1].distance, 2000);
+    EXPECT_GE(parser.getResyncs(), 1);
+}
@@ -0,0 +1,146 @@
+#include <dosa_messages.h>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace dosa::messages;
+using ConfigItem = Configuration::ConfigItem;
+
+namespace {
+
+void addItem(std::vector<uint8_t>& batch, ConfigItem item, void const* data, uint16_t size)
+{
+    batch.push_back(static_cast<uint8_t>(item));
+    batch.push_back(size & 0xFF);
+    batch.push_back(size >> 8);
+    batch.insert(batch.end(), (uint8_t const*)data, (uint8_t const*)data + size);
+}
+
+}  // namespace
+
+/**
+ * Item payloads are checked for size before anything is applied.
+ */
+TEST(ConfigTest, ItemValidation)
+{
+    uint8_t lock = 1;
+    EXPECT_TRUE(Configuration::isValidItem(ConfigItem::DEVICE_LOCK, &lock, 1));
+    EXPECT_FALSE(Configuration::isValidItem(ConfigItem::DEVICE_LOCK, &lock, 0));
+
+    EXPECT_TRUE(Configuration::isValidItem(ConfigItem::DEVICE_NAME, (uint8_t const*)"Door", 4));
+    EXPECT_FALSE(Configuration::isValidItem(ConfigItem::DEVICE_NAME, (uint8_t const*)"D", 1));
+
+    EXPECT_TRUE(Configuration::isValidItem(ConfigItem::WIFI_AP, (uint8_t const*)"ap\npw", 5));
+    EXPECT_FALSE(Configuration::isValidItem(ConfigItem::WIFI_AP, (uint8_t const*)"appw", 4));
+
+    uint8_t door[33] = {0};
+    EXPECT_TRUE(Configuration::isValidItem(ConfigItem::DOOR_CALIBRATION, door, 14));
+    EXPECT_TRUE(Configuration::isValidItem(ConfigItem::DOOR_CALIBRATION, door, 33));
+    EXPECT_FALSE(Configuration::isValidItem(ConfigItem::DOOR_CALIBRATION, door, 20));
+
+    // Relay bank with 2 schedule entries must carry both
+    uint8_t relay[32] = {0};
+    relay[6] = 2;
+    EXPECT_TRUE(Configuration::isValidItem(ConfigItem::RELAY_CALIBRATION, relay, 19));
+    EXPECT_FALSE(Configuration::isValidItem(ConfigItem::RELAY_CALIBRATION, relay, 18));
+
+    EXPECT_FALSE(Configuration::isValidItem(ConfigItem::STATS_SERVER, relay, 1));
+    EXPECT_TRUE(Configuration::isValidItem(ConfigItem::OTA_SERVER, relay, 2));
+    EXPECT_FALSE(Configuration::isValidItem(ConfigItem::OTA_SERVER, relay, 1));
+    EXPECT_FALSE(Configuration::isValidItem(static_cast<ConfigItem>(99), relay, 1));
+}
+
+/**
+ * Strings longer than their settings field are refused, rather than truncated when saved.
+ */
+TEST(ConfigTest, ItemCapacity)
+{
+    uint8_t data[600];
+    memset(data, 'a', sizeof(data));
+
+    EXPECT_TRUE(Configuration::isValidItem(ConfigItem::DEVICE_NAME, data, 20));
+    EXPECT_FALSE(Configuration::isValidItem(ConfigItem::DEVICE_NAME, data, 21));
+    EXPECT_TRUE(Configuration::isValidItem(ConfigItem::LISTEN_DEVICES, data, 500));
+    EXPECT_FALSE(Configuration::isValidItem(ConfigItem::LISTEN_DEVICES, data, 501));
+
+    // 32 byte SSID, 64 byte password
+    data[32] = '\n';
+    EXPECT_TRUE(Configuration::isValidItem(ConfigItem::WIFI_AP, data, 97));
+    EXPECT_FALSE(Configuration::isValidItem(ConfigItem::WIFI_AP, data, 98));
+    data[32] = 'a';
+    data[33] = '\n';
+    EXPECT_FALSE(Configuration::isValidItem(ConfigItem::WIFI_AP, data, 40));
+    data[33] = 'a';
+
+    // Port, then a 64 byte address
+    EXPECT_TRUE(Configuration::isValidItem(ConfigItem::STATS_SERVER, data, 66));
+    EXPECT_FALSE(Configuration::isValidItem(ConfigItem::STATS_SERVER, data, 67));
+
+    // Port, then a 64 byte host and a 48 byte path
+    EXPECT_TRUE(Configuration::isValidItem(ConfigItem::OTA_SERVER, data, 66));
+    EXPECT_FALSE(Configuration::isValidItem(ConfigItem::OTA_SERVER, data, 67));
+    data[66] = '\n';
+    EXPECT_TRUE(Configuration::isValidItem(ConfigItem::OTA_SERVER, data, 115));
+    EXPECT_FALSE(Configuration::isValidItem(ConfigItem::OTA_SERVER, data, 116));
+    data[66] = 'a';
+    data[67] = '\n';
+    EXPECT_FALSE(Configuration::isValidItem(ConfigItem::OTA_SERVER, data, 70));
+    data[67] = 'a';
+
+    // Relay bank without a schedule, then a 128 byte channel map
+    data[6] = 0;
+    EXPECT_TRUE(Configuration::isValidItem(ConfigItem::RELAY_CALIBRATION, data, 135));
+    EXPECT_FALSE(Configuration::isValidItem(ConfigItem::RELAY_CALIBRATION, data, 136));
+}
+
+/**
+ * A batch is read back item by item, and rejected as a whole if any item is malformed.
+ */
+TEST(ConfigTest, Batch)
+{
+    std::vector<uint8_t> batch;
+    uint8_t lock = 2;
+    uint8_t stats[] = {0x7D, 0x1F, '1', '0', '.', '0', '.', '0', '.', '1'};
+    addItem(batch, ConfigItem::DEVICE_NAME, "Front Door", 10);
+    addItem(batch, ConfigItem::DEVICE_LOCK, &lock, 1);
+    addItem(batch, ConfigItem::STATS_SERVER, stats, sizeof(stats));
+
+    ConfigBatch cb(batch.data(), batch.size());
+    ASSERT_TRUE(cb.isValid());
+    ASSERT_EQ(cb.getCount(), 3);
+
+    uint16_t pos = 0;
+    ConfigBatch::Item it{};
+    ASSERT_TRUE(cb.read(pos, it));
+    EXPECT_EQ(it.item, ConfigItem::DEVICE_NAME);
+    EXPECT_EQ(std::string((char const*)it.data, it.size), "Front Door");
+    ASSERT_TRUE(cb.read(pos, it));
+    EXPECT_EQ(it.item, ConfigItem::DEVICE_LOCK);
+    EXPECT_EQ(it.data[0], 2);
+    ASSERT_TRUE(cb.read(pos, it));
+    EXPECT_EQ(it.item, ConfigItem::STATS_SERVER);
+    EXPECT_EQ(it.size, sizeof(stats));
+    EXPECT_FALSE(cb.read(pos, it));
+    EXPECT_EQ(pos, batch.size());
+
+    // Truncated final item
+    EXPECT_FALSE(ConfigBatch(batch.data(), batch.size() - 1).isValid());
+    EXPECT_EQ(ConfigBatch(batch.data(), batch.size() - 1).getCount(), 2);
+
+    // Trailing partial header
+    batch.push_back(static_cast<uint8_t>(ConfigItem::DEVICE_LOCK));
+    EXPECT_FALSE(ConfigBatch(batch.data(), batch.size()).isValid());
+    batch.pop_back();
+
+    // One bad item spoils the batch
+    std::vector<uint8_t> bad = batch;
+    addItem(bad, ConfigItem::PIR_CALIBRATION, stats, 8);
+    EXPECT_FALSE(ConfigBatch(bad.data(), bad.size()).isValid());
+
+    // Batches do not nest
+    std::vector<uint8_t> nested;
+    addItem(nested, ConfigItem::BATCH, batch.data(), batch.size());
+    EXPECT_FALSE(ConfigBatch(nested.data(), nested.size()).isValid());
+
+    EXPECT_FALSE(ConfigBatch(nullptr, 0).isValid());
+}
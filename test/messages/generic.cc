@@ -0,0 +1,31 @@
+#include <dosa_messages.h>
+#include <gtest/gtest.h>
+
+using namespace dosa::messages;
+
+/**
+ * Additional message data survives the round trip through a packet.
+ */
+TEST(GenericTest, MessageData)
+{
+    char device_name[20] = "Front Door";
+    uint8_t data[] = {0x57, 0x00, 0x00, 0x00, 0x01};
+
+    auto msg = GenericMessage(DOSA_COMMS_MSG_ONLINE, data, sizeof(data), device_name);
+    ASSERT_EQ(msg.getPayloadSize(), DOSA_COMMS_PAYLOAD_BASE_SIZE + sizeof(data));
+    EXPECT_EQ(msg.getMessageSize(), sizeof(data));
+    EXPECT_EQ(memcmp(msg.getMessage(), data, sizeof(data)), 0);
+
+    uint16_t size;
+    memcpy(&size, msg.getPayload() + 5, 2);
+    EXPECT_EQ(size, msg.getPayloadSize());
+
+    auto packet = GenericMessage::fromPacket(msg.getPayload(), msg.getPayloadSize());
+    EXPECT_EQ(packet.getMessageId(), msg.getMessageId());
+    EXPECT_EQ(std::string(packet.getCommandCode(), 3), "onl");
+    EXPECT_EQ(strcmp(packet.getDeviceName(), device_name), 0);
+    ASSERT_EQ(packet.getMessageSize(), sizeof(data));
+    EXPECT_EQ(memcmp(packet.getMessage(), data, sizeof(data)), 0);
+
+    EXPECT_EQ(GenericMessage(DOSA_COMMS_MSG_ONLINE, device_name).getMessageSize(), 0);
+}
@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+#include <ota_patch.h>
+
+#include <vector>
+
+using namespace dosa;
+
+namespace {
+
+struct Sink
+{
+    std::vector<uint8_t> data;
+
+    void write(uint8_t const* src, size_t size)
+    {
+        data.insert(data.end(), src, src + size);
+    }
+};
+
+template <class T>
+void append(std::vector<uint8_t>& out, T value)
+{
+    auto const* ptr = reinterpret_cast<uint8_t const*>(&value);
+    out.insert(out.end(), ptr, ptr + sizeof(T));
+}
+
+std::vector<uint8_t> makeImage(size_t size)
+{
+    std::vector<uint8_t> image(size);
+    for (size_t i = 0; i < size; ++i) {
+        image[i] = uint8_t(i * 31 + (i >> 8));
+    }
+
+    return image;
+}
+
+std::vector<uint8_t> makeHeader(std::vector<uint8_t> const& old_image, std::vector<uint8_t> const& new_image)
+{
+    std::vector<uint8_t> patch = {'D', 'O', 'S', 'P'};
+    append(patch, uint32_t(old_image.size()));
+    append(patch, Crc32::of(old_image.data(), old_image.size()));
+    append(patch, uint32_t(new_image.size()));
+    append(patch, Crc32::of(new_image.data(), new_image.size()));
+    return patch;
+}
+
+void appendControl(std::vector<uint8_t>& patch, uint32_t diff, uint32_t extra, int32_t seek)
+{
+    append(patch, diff);
+    append(patch, extra);
+    append(patch, seek);
+}
+
+/**
+ * The new image is the old one with its first 100 bytes moved to the end, a byte changed and one added; the two images
+ * and the patch between them.
+ */
+struct Fixture
+{
+    std::vector<uint8_t> old_image = makeImage(2000);
+    std::vector<uint8_t> new_image;
+    std::vector<uint8_t> patch;
+
+    Fixture()
+    {
+        new_image.assign(old_image.begin() + 100, old_image.end());
+        new_image.insert(new_image.end(), old_image.begin(), old_image.begin() + 100);
+        new_image[900] += 3;
+        new_image.push_back(0xAA);
+
+        patch = makeHeader(old_image, new_image);
+
+        // Old 100-1999 to new 0-1899: 900 zeros, the changed byte, 999 zeros
+        appendControl(patch, 0, 0, 100);
+        appendControl(patch, 1900, 0, -2000);
+        patch.insert(patch.end(), 7, 0xFF);
+        patch.push_back(0x83);
+        patch.push_back(0x00);
+        patch.push_back(3);
+        patch.insert(patch.end(), 7, 0xFF);
+        patch.push_back(0xE6);
+
+        // Old 0-99 to the end, then one extra byte
+        appendControl(patch, 100, 1, 0);
+        patch.push_back(0xE3);
+        patch.push_back(0xAA);
+    }
+};
+
+}  // namespace
+
+/**
+ * A patch builds the new image from the old, however it is chunked as it arrives.
+ */
+TEST(OtaPatchTest, Apply)
+{
+    Fixture f;
+    ASSERT_EQ(f.new_image.size(), 2001u);
+
+    for (size_t chunk : {size_t(1), size_t(7), size_t(128), f.patch.size()}) {
+        Sink sink;
+        OtaPatcher<Sink> patcher(f.old_image.data(), f.old_image.size(), sink);
+
+        for (size_t pos = 0; pos < f.patch.size(); pos += chunk) {
+            EXPECT_FALSE(patcher.isComplete());
+            patcher.write(f.patch.data() + pos, std::min(chunk, f.patch.size() - pos));
+        }
+
+        ASSERT_TRUE(patcher.isComplete()) << "chunk " << chunk << ", error " << int(patcher.getError());
+        EXPECT_EQ(patcher.getError(), OtaPatchError::NONE);
+        EXPECT_EQ(patcher.getReceived(), f.patch.size());
+        EXPECT_EQ(patcher.getWritten(), f.new_image.size());
+        EXPECT_EQ(patcher.getHeader().new_crc, Crc32::of(f.new_image.data(), f.new_image.size()));
+        EXPECT_EQ(sink.data, f.new_image);
+    }
+}
+
+/**
+ * A patch is refused if the running image isn't the one it was made from.
+ */
+TEST(OtaPatchTest, Source)
+{
+    Fixture f;
+    Sink sink;
+
+    auto other = f.old_image;
+    other[1500] ^= 1;
+    OtaPatcher<Sink> patcher(other.data(), other.size(), sink);
+    patcher.write(f.patch.data(), f.patch.size());
+    EXPECT_EQ(patcher.getError(), OtaPatchError::SOURCE);
+    EXPECT_FALSE(patcher.isComplete());
+    EXPECT_TRUE(sink.data.empty());
+
+    // Old image larger than the flash
+    OtaPatcher<Sink> small(f.old_image.data(), 1000, sink);
+    small.write(f.patch.data(), f.patch.size());
+    EXPECT_EQ(small.getError(), OtaPatchError::HEADER);
+
+    auto bad_magic = f.patch;
+    bad_magic[3] = 'X';
+    OtaPatcher<Sink> magic(f.old_image.data(), f.old_image.size(), sink);
+    magic.write(bad_magic.data(), bad_magic.size());
+    EXPECT_EQ(magic.getError(), OtaPatchError::HEADER);
+}
+
+TEST(OtaPatchTest, Malformed)
+{
+    Fixture f;
+
+    // Truncated
+    {
+        Sink sink;
+        OtaPatcher<Sink> patcher(f.old_image.data(), f.old_image.size(), sink);
+        patcher.write(f.patch.data(), f.patch.size() - 1);
+        EXPECT_FALSE(patcher.isComplete());
+        EXPECT_EQ(patcher.getError(), OtaPatchError::NONE);
+    }
+
+    // Trailing data
+    {
+        Sink sink;
+        auto patch = f.patch;
+        patch.push_back(0);
+        OtaPatcher<Sink> patcher(f.old_image.data(), f.old_image.size(), sink);
+        patcher.write(patch.data(), patch.size());
+        EXPECT_EQ(patcher.getError(), OtaPatchError::TRAILING);
+    }
+
+    // Block past the end of the new image
+    {
+        Sink sink;
+        auto patch = makeHeader(f.old_image, f.new_image);
+        appendControl(patch, 0, 2002, 0);
+        OtaPatcher<Sink> patcher(f.old_image.data(), f.old_image.size(), sink);
+        patcher.write(patch.data(), patch.size());
+        EXPECT_EQ(patcher.getError(), OtaPatchError::CONTROL);
+    }
+
+    // Diff reading past the end of the old image
+    {
+        Sink sink;
+        auto patch = makeHeader(f.old_image, f.new_image);
+        appendControl(patch, 0, 0, 1990);
+        appendControl(patch, 20, 0, 0);
+        OtaPatcher<Sink> patcher(f.old_image.data(), f.old_image.size(), sink);
+        patcher.write(patch.data(), patch.size());
+        EXPECT_EQ(patcher.getError(), OtaPatchError::CONTROL);
+    }
+
+    // Seek before the start of the old image
+    {
+        Sink sink;
+        auto patch = makeHeader(f.old_image, f.new_image);
+        appendControl(patch, 0, 0, -1);
+        OtaPatcher<Sink> patcher(f.old_image.data(), f.old_image.size(), sink);
+        patcher.write(patch.data(), patch.size());
+        EXPECT_EQ(patcher.getError(), OtaPatchError::CONTROL);
+    }
+
+    // Diff token running past its block
+    {
+        Sink sink;
+        auto patch = makeHeader(f.old_image, f.new_image);
+        appendControl(patch, 4, 0, 0);
+        patch.push_back(0x84);
+        OtaPatcher<Sink> patcher(f.old_image.data(), f.old_image.size(), sink);
+        patcher.write(patch.data(), patch.size());
+        EXPECT_EQ(patcher.getError(), OtaPatchError::CONTROL);
+    }
+}
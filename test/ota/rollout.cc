@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <ota_rollout.h>
+
+#include <string>
+
+using namespace dosa;
+
+namespace {
+
+std::string deviceName(int i)
+{
+    std::string name = "Device " + std::to_string(i);
+    name.resize(DOSA_OTA_NAME_SIZE, '\0');
+    return name;
+}
+
+}  // namespace
+
+TEST(OtaRolloutTest, Parse)
+{
+    OtaRollout rollout(5, 60, 1);
+    ASSERT_TRUE(OtaRollout::parse(nullptr, 0, rollout));
+    EXPECT_EQ(rollout.getWave(), 100);
+    EXPECT_EQ(rollout.getSpread(), 0);
+    EXPECT_EQ(rollout.getVersion(), 0u);
+
+    uint8_t data[] = {25, 0x2C, 0x01, 87, 0, 0, 0};
+    ASSERT_TRUE(OtaRollout::parse(data, sizeof(data), rollout));
+    EXPECT_EQ(rollout.getWave(), 25);
+    EXPECT_EQ(rollout.getSpread(), 300);
+    EXPECT_EQ(rollout.getVersion(), 87u);
+
+    EXPECT_FALSE(OtaRollout::parse(data, 6, rollout));
+    data[0] = 0;
+    EXPECT_FALSE(OtaRollout::parse(data, sizeof(data), rollout));
+    data[0] = 101;
+    EXPECT_FALSE(OtaRollout::parse(data, sizeof(data), rollout));
+    EXPECT_EQ(rollout.getWave(), 25);
+}
+
+/**
+ * Host tooling predicts the waves with zlib.crc32(name + struct.pack("<L", version)).
+ */
+TEST(OtaRolloutTest, Bucket)
+{
+    OtaRollout rollout(50, 60, 87);
+    EXPECT_EQ(rollout.getHash("Front Door"), 0x6B1C2C69u);
+    EXPECT_EQ(rollout.getBucket("Front Door"), 89);
+    EXPECT_EQ(rollout.getDelay("Front Door"), 30084u);
+    EXPECT_FALSE(rollout.includes("Front Door"));
+
+    EXPECT_EQ(rollout.getBucket("Garage PIR"), 25);
+    EXPECT_EQ(rollout.getDelay("Garage PIR"), 39012u);
+    EXPECT_TRUE(rollout.includes("Garage PIR"));
+
+    // Padding is not part of the name
+    EXPECT_EQ(rollout.getHash(deviceName(1).c_str()), rollout.getHash("Device 1"));
+}
+
+/**
+ * Each wave takes in the one before it, and a full wave every device.
+ */
+TEST(OtaRolloutTest, Waves)
+{
+    int const fleet = 1000;
+    uint8_t const waves[] = {5, 25, 50, 100};
+    int counts[4] = {0};
+
+    for (int i = 0; i < fleet; ++i) {
+        auto name = deviceName(i);
+        bool included = false;
+        for (int w = 0; w < 4; ++w) {
+            OtaRollout rollout(waves[w], 120, 90);
+            if (included) {
+                EXPECT_TRUE(rollout.includes(name.c_str()));
+            }
+
+            included = rollout.includes(name.c_str());
+            counts[w] += included;
+            EXPECT_LT(rollout.getDelay(name.c_str()), 120000u);
+        }
+    }
+
+    EXPECT_NEAR(counts[0], 50, 25);
+    EXPECT_NEAR(counts[1], 250, 50);
+    EXPECT_NEAR(counts[2], 500, 60);
+    EXPECT_EQ(counts[3], fleet);
+
+    // Canaries change with the release
+    int moved = 0;
+    for (int i = 0; i < fleet; ++i) {
+        auto name = deviceName(i);
+        moved += OtaRollout(5, 0, 90).includes(name.c_str()) != OtaRollout(5, 0, 91).includes(name.c_str());
+    }
+    EXPECT_GT(moved, 0);
+
+    EXPECT_EQ(OtaRollout(100, 0, 90).getDelay("Front Door"), 0u);
+}
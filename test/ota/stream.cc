@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <ota_stream.h>
+
+#include <vector>
+
+using namespace dosa;
+
+namespace {
+
+struct FakeFlash
+{
+    std::vector<uint8_t> data;
+
+    void write(uint8_t b)
+    {
+        data.push_back(b);
+    }
+};
+
+std::vector<uint8_t> makeImage(size_t size)
+{
+    std::vector<uint8_t> image(size);
+    for (size_t i = 0; i < size; ++i) {
+        image[i] = uint8_t(i * 31 + (i >> 8));
+    }
+
+    return image;
+}
+
+}  // namespace
+
+/**
+ * Chunks of any size are passed straight through to the storage.
+ */
+TEST(OtaStreamTest, Chunks)
+{
+    FakeFlash flash;
+    OtaStream<FakeFlash> stream(flash);
+    auto image = makeImage(1000);
+
+    size_t pos = 0;
+    size_t chunk = 1;
+    while (pos < image.size()) {
+        size_t n = std::min(chunk, image.size() - pos);
+        stream.write(image.data() + pos, n);
+        pos += n;
+        chunk = chunk * 3 % 97 + 1;
+
+        EXPECT_EQ(stream.getReceived(), pos);
+        EXPECT_EQ(flash.data.size(), pos);
+    }
+
+    EXPECT_EQ(flash.data, image);
+    EXPECT_EQ(stream.getCrc(), Crc32::of(image.data(), image.size()));
+}
+
+/**
+ * A download resumed from the received count produces the same image and CRC.
+ */
+TEST(OtaStreamTest, Resume)
+{
+    FakeFlash flash;
+    OtaStream<FakeFlash> stream(flash);
+    auto image = makeImage(600);
+
+    // First connection drops part-way through
+    stream.write(image.data(), 300);
+    ASSERT_EQ(stream.getReceived(), 300u);
+
+    stream.write(image.data() + stream.getReceived(), image.size() - stream.getReceived());
+
+    EXPECT_EQ(flash.data, image);
+    EXPECT_EQ(stream.getCrc(), Crc32::of(image.data(), image.size()));
+}
+
+TEST(OtaStreamTest, Digest)
+{
+    uint32_t digest = 0;
+    EXPECT_TRUE(OtaStream<FakeFlash>::parseDigest("cbf43926\n", 9, digest));
+    EXPECT_EQ(digest, 0xCBF43926u);
+    EXPECT_TRUE(OtaStream<FakeFlash>::parseDigest("CBF43926", 8, digest));
+    EXPECT_EQ(digest, 0xCBF43926u);
+
+    EXPECT_FALSE(OtaStream<FakeFlash>::parseDigest("cbf4392", 7, digest));
+    EXPECT_FALSE(OtaStream<FakeFlash>::parseDigest("cbf4392g", 8, digest));
+    EXPECT_FALSE(OtaStream<FakeFlash>::parseDigest("cbf43926x", 9, digest));
+
+    EXPECT_EQ(OtaStream<FakeFlash>::getRate(200000, 4000), 50000u);
+    EXPECT_EQ(OtaStream<FakeFlash>::getRate(100, 0), 100u);
+}
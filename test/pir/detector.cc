@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <pir_detector.h>
+
+using namespace dosa;
+
+class DetectorTest : public ::testing::Test
+{
+   protected:
+    PirCalibration calibration{3, 1.5, 25.0};
+    float background[PIR_FRAME_PIXELS] = {0};
+    float motion[PIR_FRAME_PIXELS] = {0};
+
+    void SetUp() override
+    {
+        for (unsigned i = 0; i < PIR_FRAME_PIXELS; ++i) {
+            background[i] = 22.0;
+            motion[i] = i < 8 ? 27.0 : 22.0;
+        }
+    }
+
+    void TearDown() override {}
+};
+
+TEST_F(DetectorTest, FirstFrameNeverDetects)
+{
+    PirDetector detector(0);
+    EXPECT_FALSE(detector.process(motion, 1000, calibration));
+}
+
+TEST_F(DetectorTest, DetectsMotion)
+{
+    PirDetector detector(0);
+    EXPECT_FALSE(detector.process(background, 1000, calibration));
+    EXPECT_FALSE(detector.process(background, 1500, calibration));
+    EXPECT_TRUE(detector.process(motion, 2000, calibration));
+    EXPECT_EQ(detector.getPixelsChanged(), 8);
+    EXPECT_FLOAT_EQ(detector.getTotalDelta(), 40.0);
+    EXPECT_EQ(detector.getMap()[0], 50);
+    EXPECT_EQ(detector.getMap()[8], 0);
+}
+
+TEST_F(DetectorTest, BelowThresholds)
+{
+    PirDetector detector(0);
+    detector.process(background, 1000, calibration);
+
+    PirCalibration strict{9, 1.5, 25.0};
+    EXPECT_FALSE(detector.process(motion, 1500, strict));
+
+    detector.process(background, 2000, calibration);
+    PirCalibration insensitive{3, 1.5, 50.0};
+    EXPECT_FALSE(detector.process(motion, 2500, insensitive));
+}
+
+TEST_F(DetectorTest, RefireDelay)
+{
+    PirDetector detector(5000);
+    detector.process(background, 10000, calibration);
+    EXPECT_TRUE(detector.process(motion, 10500, calibration));
+    EXPECT_FALSE(detector.process(background, 11000, calibration));
+    EXPECT_FALSE(detector.process(motion, 11500, calibration));
+    detector.process(background, 15000, calibration);
+    EXPECT_TRUE(detector.process(motion, 15500, calibration));
+}
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+#include <range_filter.h>
+
+using namespace dosa;
+
+TEST(RangeFilterTest, MedianRejectsSpike)
+{
+    MedianFilter median;
+    EXPECT_EQ(median.process(1000, 3), 1000);
+    EXPECT_EQ(median.process(1002, 3), 1002);
+    EXPECT_EQ(median.process(200, 3), 1000);
+    EXPECT_EQ(median.process(1001, 3), 1001);
+}
+
+TEST(RangeFilterTest, MedianTreatsZeroAsFar)
+{
+    MedianFilter median;
+    median.process(1000, 3);
+    median.process(1000, 3);
+    EXPECT_EQ(median.process(0, 3), 1000);
+    EXPECT_EQ(median.process(0, 3), 0);
+}
+
+TEST(RangeFilterTest, MedianDisabled)
+{
+    MedianFilter median;
+    median.process(1000, 1);
+    EXPECT_EQ(median.process(200, 1), 200);
+}
+
+TEST(RangeFilterTest, KalmanTracksApproach)
+{
+    RangeFilter filter;
+    RangeFilterConfig config{1, 1000000.0, 100.0};
+
+    // Resting background
+    uint32_t now = 0;
+    for (int i = 0; i < 20; ++i, now += 100) {
+        filter.process(3000, now, config);
+    }
+    EXPECT_NEAR(filter.getFiltered(), 3000, 2);
+    EXPECT_NEAR(filter.getVelocity(), 0, 50);
+
+    // Subject approaching at 1 m/s
+    uint32_t distance = 3000;
+    for (int i = 0; i < 20; ++i, now += 100) {
+        distance -= 100;
+        filter.process(distance, now, config);
+    }
+    EXPECT_NEAR(filter.getFiltered(), distance, 50);
+    EXPECT_NEAR(filter.getVelocity(), -1000, 150);
+}
+
+TEST(RangeFilterTest, NoBounceBackResetsTracking)
+{
+    RangeFilter filter;
+    RangeFilterConfig config{1, 1000000.0, 100.0};
+
+    filter.process(2000, 0, config);
+    filter.process(1900, 100, config);
+    EXPECT_EQ(filter.process(0, 200, config), 0);
+    EXPECT_FALSE(filter.getKalman().isInitialised());
+    EXPECT_EQ(filter.process(1500, 300, config), 1500);
+}
+
+TEST(RangeFilterTest, KalmanDisabled)
+{
+    RangeFilter filter;
+    RangeFilterConfig config{3, 1000000.0, 0};
+
+    filter.process(1000, 0, config);
+    filter.process(1000, 100, config);
+    EXPECT_EQ(filter.process(1500, 200, config), 1000);
+    EXPECT_EQ(filter.process(1500, 300, config), 1500);
+}
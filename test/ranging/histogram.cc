@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include <range_histogram.h>
+
+using namespace dosa;
+
+TEST(RangeHistogramTest, LearnsBaselineAndNoise)
+{
+    RangeHistogram histogram;
+    EXPECT_FALSE(histogram.isReady());
+
+    // Background wavering between 1900 and 2100mm
+    for (int i = 0; i < 200; ++i) {
+        histogram.add(1900 + (i % 11) * 20);
+    }
+
+    ASSERT_TRUE(histogram.isReady());
+    EXPECT_NEAR(histogram.getBaseline(), 2000, RANGE_HISTOGRAM_BIN_WIDTH);
+    EXPECT_NEAR(histogram.getLowerNoise(), 100, RANGE_HISTOGRAM_BIN_WIDTH);
+    EXPECT_NEAR(histogram.getUpperNoise(), 100, RANGE_HISTOGRAM_BIN_WIDTH);
+
+    // Margin is 3x the lower noise
+    EXPECT_NEAR(histogram.getTriggerCoefficient(), 0.85, 0.03);
+}
+
+TEST(RangeHistogramTest, QuietBackgroundUsesMinimumMargin)
+{
+    RangeHistogram histogram;
+    for (int i = 0; i < 100; ++i) {
+        histogram.add(3000);
+    }
+
+    EXPECT_EQ(histogram.getLowerNoise(), 0);
+    EXPECT_NEAR(
+        histogram.getTriggerCoefficient(),
+        float(histogram.getBaseline() - RANGE_MIN_TRIGGER_MARGIN) / histogram.getBaseline(),
+        0.001);
+}
+
+TEST(RangeHistogramTest, IgnoresPassersBy)
+{
+    RangeHistogram histogram;
+    for (int i = 0; i < 500; ++i) {
+        histogram.add(i % 50 < 5 ? 800 : 2500);
+    }
+
+    EXPECT_NEAR(histogram.getBaseline(), 2500, RANGE_HISTOGRAM_BIN_WIDTH);
+}
+
+TEST(RangeHistogramTest, RecentresOnNewBackground)
+{
+    RangeHistogram histogram;
+    for (int i = 0; i < 200; ++i) {
+        histogram.add(4000);
+    }
+
+    for (int i = 0; i < RANGE_HISTOGRAM_RECENTRE + 10; ++i) {
+        histogram.add(1500);
+    }
+
+    EXPECT_NEAR(histogram.getBaseline(), 1500, RANGE_HISTOGRAM_BIN_WIDTH);
+    EXPECT_LT(histogram.getSampleCount(), 20);
+}
+
+TEST(RangeHistogramTest, RollingMemory)
+{
+    RangeHistogram histogram;
+    for (int i = 0; i < RANGE_HISTOGRAM_CAPACITY * 4; ++i) {
+        histogram.add(2000);
+    }
+
+    EXPECT_LT(histogram.getSampleCount(), RANGE_HISTOGRAM_CAPACITY);
+
+    // Drifting background within the histogram range takes over
+    for (int i = 0; i < RANGE_HISTOGRAM_CAPACITY; ++i) {
+        histogram.add(2300);
+    }
+
+    EXPECT_NEAR(histogram.getBaseline(), 2300, RANGE_HISTOGRAM_BIN_WIDTH);
+}
+
+TEST(RangeHistogramTest, RejectsForeground)
+{
+    RangeHistogram histogram;
+    for (int i = 0; i < 200; ++i) {
+        histogram.add(1900 + (i % 11) * 20);
+    }
+
+    auto coefficient = histogram.getTriggerCoefficient();
+    EXPECT_FALSE(histogram.isResting(1200));
+    EXPECT_TRUE(histogram.isResting(1950));
+    EXPECT_TRUE(histogram.isResting(2600));
+
+    // A busy spot: a third of the reads are people in the beam, then someone lingers for a long while
+    for (int i = 0; i < 2000; ++i) {
+        uint32_t distance = i % 3 == 0 ? 1200 + (i % 7) * 50 : 1900 + (i % 11) * 20;
+        if (histogram.isResting(distance)) {
+            histogram.add(distance);
+        }
+    }
+
+    for (int i = 0; i < RANGE_HISTOGRAM_RECENTRE * 4; ++i) {
+        if (histogram.isResting(800)) {
+            histogram.add(800);
+        }
+    }
+
+    EXPECT_NEAR(histogram.getBaseline(), 2000, RANGE_HISTOGRAM_BIN_WIDTH);
+    EXPECT_NEAR(histogram.getTriggerCoefficient(), coefficient, 0.01);
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include <range_trace.h>
+
+#include <vector>
+
+using namespace dosa;
+
+namespace {
+
+/**
+ * Rebuild the distances from a packed trace.
+ */
+std::vector<uint16_t> unpack(uint8_t const* map)
+{
+    std::vector<uint16_t> out;
+    uint8_t count = map[7];
+    if (count == 0) {
+        return out;
+    }
+
+    uint16_t distance;
+    memcpy(&distance, map + 8, 2);
+    out.push_back(distance);
+
+    for (uint8_t i = 1; i < count; ++i) {
+        int16_t delta;
+        memcpy(&delta, map + RANGE_TRACE_HEADER_SIZE + (i - 1) * RANGE_TRACE_ENTRY_SIZE + 1, 2);
+        distance = uint16_t(distance + delta);
+        out.push_back(distance);
+    }
+
+    return out;
+}
+
+}  // namespace
+
+TEST(RangeTraceTest, PacksHeader)
+{
+    RangeTrace trace;
+    trace.add(3000, 1000);
+    trace.add(2500, 1100);
+
+    uint8_t map[RANGE_TRACE_MAP_SIZE];
+    trace.pack(map, 3000, 2500, -1234.5, 1150);
+
+    uint16_t previous, current, age;
+    int16_t velocity;
+    memcpy(&previous, map, 2);
+    memcpy(&current, map + 2, 2);
+    memcpy(&velocity, map + 4, 2);
+    memcpy(&age, map + 10, 2);
+
+    EXPECT_EQ(previous, 3000);
+    EXPECT_EQ(current, 2500);
+    EXPECT_EQ(velocity, -1234);
+    EXPECT_EQ(map[6], RANGE_TRACE_VERSION);
+    EXPECT_EQ(map[7], 2);
+    EXPECT_EQ(age, 150);
+    EXPECT_EQ(map[RANGE_TRACE_HEADER_SIZE], 10);  // 100ms between samples
+}
+
+TEST(RangeTraceTest, RingKeepsNewest)
+{
+    RangeTrace trace;
+    for (uint32_t i = 0; i < RANGE_TRACE_SAMPLES + 5; ++i) {
+        trace.add(5000 - i * 100, i * 100);
+    }
+
+    uint8_t map[RANGE_TRACE_MAP_SIZE];
+    trace.pack(map, 5000, 100, 0, RANGE_TRACE_SAMPLES * 100 + 500);
+
+    auto samples = unpack(map);
+    ASSERT_EQ(samples.size(), RANGE_TRACE_SAMPLES);
+    EXPECT_EQ(samples.front(), 5000 - 5 * 100);
+    EXPECT_EQ(samples.back(), 5000 - (RANGE_TRACE_SAMPLES + 4) * 100);
+}
+
+TEST(RangeTraceTest, LargeDeltasRoundTrip)
+{
+    RangeTrace trace;
+    trace.add(0, 0);
+    trace.add(60000, 100);
+    trace.add(100000, 200);  // clamped
+    trace.add(5, 300);
+
+    uint8_t map[RANGE_TRACE_MAP_SIZE];
+    trace.pack(map, 0, 5, 0, 300);
+
+    auto samples = unpack(map);
+    ASSERT_EQ(samples.size(), 4);
+    EXPECT_EQ(samples[0], 0);
+    EXPECT_EQ(samples[1], 60000);
+    EXPECT_EQ(samples[2], UINT16_MAX);
+    EXPECT_EQ(samples[3], 5);
+}
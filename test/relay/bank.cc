@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <relay_bank.h>
+
+using namespace dosa;
+
+TEST(RelayBankTest, DeadlinesPopInOrder)
+{
+    DeadlineQueue<4> queue;
+    queue.set(0, 500);
+    queue.set(1, 200);
+    queue.set(2, 900);
+    queue.set(3, 100);
+    EXPECT_EQ(queue.size(), 4);
+
+    uint8_t channel;
+    EXPECT_FALSE(queue.popDue(50, channel));
+
+    EXPECT_TRUE(queue.popDue(600, channel));
+    EXPECT_EQ(channel, 3);
+    EXPECT_TRUE(queue.popDue(600, channel));
+    EXPECT_EQ(channel, 1);
+    EXPECT_TRUE(queue.popDue(600, channel));
+    EXPECT_EQ(channel, 0);
+    EXPECT_FALSE(queue.popDue(600, channel));
+
+    EXPECT_TRUE(queue.has(2));
+    EXPECT_EQ(queue.getDeadline(2), 900);
+}
+
+TEST(RelayBankTest, DeadlineReplacedAndCancelled)
+{
+    DeadlineQueue<4> queue;
+    queue.set(0, 100);
+    queue.set(1, 200);
+    queue.set(2, 300);
+
+    // Extend channel 0 past the others, then bring channel 2 forward
+    queue.set(0, 1000);
+    queue.set(2, 50);
+    queue.cancel(1);
+    EXPECT_EQ(queue.size(), 2);
+    EXPECT_FALSE(queue.has(1));
+
+    uint8_t channel;
+    EXPECT_TRUE(queue.popDue(500, channel));
+    EXPECT_EQ(channel, 2);
+    EXPECT_FALSE(queue.popDue(500, channel));
+    EXPECT_TRUE(queue.popDue(1000, channel));
+    EXPECT_EQ(channel, 0);
+    EXPECT_EQ(queue.size(), 0);
+}
+
+TEST(RelayBankTest, DeadlinesSurviveClockWrap)
+{
+    DeadlineQueue<2> queue;
+    queue.set(0, UINT32_MAX - 10);
+    queue.set(1, 20);  // after the wrap
+
+    uint8_t channel;
+    EXPECT_FALSE(queue.popDue(UINT32_MAX - 20, channel));
+    EXPECT_TRUE(queue.popDue(5, channel));
+    EXPECT_EQ(channel, 0);
+    EXPECT_FALSE(queue.popDue(5, channel));
+    EXPECT_TRUE(queue.popDue(20, channel));
+    EXPECT_EQ(channel, 1);
+}
+
+static void setEntry(uint8_t* table, uint8_t index, uint8_t channel, uint8_t days, uint16_t start, uint16_t end)
+{
+    uint8_t* ptr = table + index * RELAY_SCHEDULE_ENTRY_SIZE;
+    ptr[0] = channel;
+    ptr[1] = days;
+    memcpy(ptr + 2, &start, 2);
+    memcpy(ptr + 4, &end, 2);
+}
+
+TEST(RelayBankTest, ScheduleWindows)
+{
+    uint8_t table[RELAY_SCHEDULE_SIZE] = {0};
+    setEntry(table, 0, 0, 0b0111110, 7 * 60 + 30, 18 * 60);  // weekdays, 07:30-18:00
+    setEntry(table, 1, 2, 0b1000001, 22 * 60, 6 * 60);       // weekend nights, 22:00-06:00
+    setEntry(table, 2, 9, 0b1111111, 0, 60);                 // no such channel, ignored
+
+    RelaySchedule schedule;
+    schedule.load(table);
+    EXPECT_EQ(schedule.size(), 2);
+
+    EXPECT_EQ(schedule.getActiveMask(1, 7 * 60 + 29), 0);
+    EXPECT_EQ(schedule.getActiveMask(1, 7 * 60 + 30), 0b001);
+    EXPECT_EQ(schedule.getActiveMask(5, 17 * 60 + 59), 0b001);
+    EXPECT_EQ(schedule.getActiveMask(5, 18 * 60), 0);
+    EXPECT_EQ(schedule.getActiveMask(6, 12 * 60), 0);
+
+    // Saturday night runs into Sunday morning, Sunday night into Monday morning
+    EXPECT_EQ(schedule.getActiveMask(6, 23 * 60), 0b100);
+    EXPECT_EQ(schedule.getActiveMask(0, 5 * 60), 0b100);
+    EXPECT_EQ(schedule.getActiveMask(1, 5 * 60), 0b100);
+    EXPECT_EQ(schedule.getActiveMask(5, 5 * 60), 0);
+    EXPECT_EQ(schedule.getActiveMask(2, 5 * 60), 0);
+
+    // Monday 5 Jan 2026, 08:00
+    EXPECT_EQ(schedule.getActiveMask(uint32_t(1767600000 + 8 * 3600)), 0b001);
+}
+
+TEST(RelayBankTest, ChannelMap)
+{
+    EXPECT_EQ(relayChannelMask("", "Hallway PIR"), RELAY_CHANNEL_MASK_DEFAULT);
+
+    char const* map = "Hallway PIR=3\nGarage=4\n*=8";
+    EXPECT_EQ(relayChannelMask(map, "Hallway PIR"), 3);
+    EXPECT_EQ(relayChannelMask(map, "Garage"), 4);
+    EXPECT_EQ(relayChannelMask(map, "Hallway"), 8);
+    EXPECT_EQ(relayChannelMask("Garage=255", "Garage"), 0x0F);
+}
@@ -34,10 +34,26 @@ parser.add_argument('--alt', dest='alt', action='store',
 parser.add_argument('-o', '--ota', dest='ota', default=False, nargs='?', action='store',
                     help='send an OTA update request; target optional, else will broadcast')
 
+# Staggered OTA rollout
+parser.add_argument('--rollout', dest='rollout', type=int, action='store',
+                    help='roll the given OTA version out in waves, halting if a wave does not report healthy')
+parser.add_argument('--waves', dest='waves', default="5,25,50,100", action='store',
+                    help='rollout wave percentages')
+parser.add_argument('--spread', dest='spread', type=int, default=120, action='store',
+                    help='seconds over which each wave staggers its update checks')
+parser.add_argument('--soak', dest='soak', type=int, default=60, action='store',
+                    help='seconds to watch a healthy wave for restarts before advancing')
+
 # Send flush command
 parser.add_argument('-f', '--flush', dest='flush', default=False, nargs='?', action='store',
                     help='send cache flush command; target optional, else will broadcast')
 
+# Read event journal
+parser.add_argument('-j', '--journal', dest='journal', action='store',
+                    help='read back the event journal of a given target')
+parser.add_argument('--from', dest='journal_from', type=int, default=0, action='store',
+                    help='journal sequence number to read from')
+
 # Snoop options
 parser.add_argument('-m', '--map', dest='map', action='store_const', const=True, default=False,
                     help='display an IR grid map or distance readouts with triggers')
@@ -47,6 +63,8 @@ parser.add_argument('-a', '--ack', dest='ack', action='store_const', const=True,
                     help='send a return ack for triggers')
 parser.add_argument('-x', '--noping', dest='noping', action='store_const', const=True, default=False,
                     help='ignore ping messages')
+parser.add_argument('-w', '--telemetry', dest='telemetry', action='store',
+                    help='save door sequence telemetry as CSV files in the given directory')
 
 args = parser.parse_args()
 
@@ -86,15 +104,24 @@ try:
             ota.dispatch(target=(args.ota, 6901))
         else:
             ota.dispatch()
+    elif args.rollout:
+        rollout = dosa.Rollout(comms=comms, version=args.rollout, waves=[int(w) for w in args.waves.split(",")],
+                               spread=args.spread, soak=args.soak)
+        if not rollout.run():
+            sys.exit(1)
     elif args.flush is not False:
         flush = dosa.Flush(comms=comms)
         if args.flush:
             flush.dispatch(target=(args.flush, 6901))
         else:
             flush.dispatch()
+    elif args.journal:
+        journal = dosa.Journal(comms=comms)
+        journal.run(target=(args.journal, 6901), start=args.journal_from)
 
     else:
-        snoop = dosa.Snoop(comms=comms, map=args.map, ignore=args.ignore, ack=args.ack, ignore_pings=args.noping)
+        snoop = dosa.Snoop(comms=comms, map=args.map, ignore=args.ignore, ack=args.ack, ignore_pings=args.noping,
+                           telemetry_dir=args.telemetry)
         print("Listening..")
         snoop.run_snoop()
 
@@ -89,6 +89,26 @@ function ota() {
 
     gsutil cp "src/$1/build/${fqbn//:/.}/$1.ino.bin" "gs://${ota_bucket}/${app_key}/build-${dosa_version}.bin"
     gsutil setmeta -h Cache-Control:no-cache "gs://${ota_bucket}/${app_key}/build-${dosa_version}.bin"
+
+    # Devices check the downloaded image against this digest before applying it
+    python3 -c 'import sys, zlib; print("%08x" % zlib.crc32(open(sys.argv[1], "rb").read()))' \
+      "src/$1/build/${fqbn//:/.}/$1.ino.bin" >/tmp/renogy.crc32
+    gsutil cp /tmp/renogy.crc32 "gs://${ota_bucket}/${app_key}/build-${dosa_version}.crc32"
+    gsutil setmeta -h Cache-Control:no-cache "gs://${ota_bucket}/${app_key}/build-${dosa_version}.crc32"
+    rm /tmp/renogy.crc32
+
+    # Devices running the previous build download a patch from it rather than the full image, where one is published
+    previous=$((dosa_version - 1))
+    if gsutil cp "gs://${ota_bucket}/${app_key}/build-${previous}.bin" /tmp/renogy.previous.bin &>/dev/null; then
+      echo "Building patch from v${previous}.."
+      if bazel run //host:ota_patch -- /tmp/renogy.previous.bin "$(pwd)/src/$1/build/${fqbn//:/.}/$1.ino.bin" \
+        /tmp/renogy.patch; then
+        gsutil cp /tmp/renogy.patch "gs://${ota_bucket}/${app_key}/build-${dosa_version}-from-${previous}.patch"
+        gsutil setmeta -h Cache-Control:no-cache "gs://${ota_bucket}/${app_key}/build-${dosa_version}-from-${previous}.patch"
+      fi
+      rm -f /tmp/renogy.previous.bin /tmp/renogy.patch
+    fi
+
     rm -rf "src/$1/build"
 
     echo
@@ -12,6 +12,10 @@ from dosa.ota import Ota
 from dosa.flush import Flush
 from dosa.play import Play
 from dosa.device import DeviceType, DeviceStatus, Device
+from dosa.range_trace import RangeTrace
+from dosa.winch_telemetry import WinchTelemetry
+from dosa.journal import Journal
+from dosa.rollout import Rollout
 from UnleashClient import UnleashClient
 
 
@@ -6,6 +6,12 @@ from dosa.device import DeviceType, Device
 
 
 class Config:
+    # ConfigItem marker for a batch of items
+    BATCH = 10
+
+    # Device limit on an inbound payload, less the base payload and the marker
+    MAX_BATCH_SIZE = 10240 - 28
+
     def __init__(self, comms=None):
         if comms is None:
             comms = dosa.Comms()
@@ -13,6 +19,7 @@ class Config:
         self.comms = comms
         self.device_count = 0
         self.devices = []
+        self.batch = None
 
     def run(self, target=None):
         if target is None:
@@ -37,71 +44,76 @@ class Config:
             self._print_output(
                 self.exec_config_mode(device)
             )
-        elif opt == 3:
-            # Set BT password
+        elif opt == 10:
+            # Several settings, committed together
             self._print_output(
-                self.exec_device_password(device, self.get_values(["New password"]))
+                self.exec_batch(device, self.user_build_batch(device))
             )
+        elif opt is not None:
+            result = self.exec_setting(device, opt)
+            if result is not None:
+                self._print_output(result)
+
+    def exec_setting(self, device, opt):
+        """
+        Prompt for and send a single setting, or add it to the batch if one is being built.
+
+        Returns None if the setting does not apply to the device.
+        """
+        if opt == 3:
+            # Set BT password
+            return self.exec_device_password(device, self.get_values(["New password"]))
         elif opt == 4:
             # Set device name
-            self._print_output(
-                self.exec_device_name(device, self.get_values(["Device name"]))
-            )
+            return self.exec_device_name(device, self.get_values(["Device name"]))
         elif opt == 5:
             # Set wifi details
-            self._print_output(
-                self.exec_wifi_ap(device, self.get_values(["Wifi SSID", "Wifi Password"]))
-            )
+            return self.exec_wifi_ap(device, self.get_values(["Wifi SSID", "Wifi Password"]))
         elif opt == 6:
             # Device configuration
             if device.device_type == DeviceType.IR_PASSIVE:
                 # IR sensor calibration
                 print("IR configuration")
-                self._print_output(
-                    self.exec_sensor_calibration(device, self.get_values(
-                        ["Min pixels/trigger (int)", "Single-pixel delta (float)", "Total delta (float)"]
-                    ))
-                )
+                return self.exec_sensor_calibration(device, self.get_values(
+                    ["Min pixels/trigger (int)", "Single-pixel delta (float)", "Total delta (float)"]
+                ))
             elif device.device_type == DeviceType.SONAR:
                 # Sonar sensor calibration (ranging)
                 print("Sonar configuration")
-                self._print_output(
-                    self.exec_ranging_calibration(device, self.get_values(
-                        ["Trigger threshold", "Fixed calibration", "Trigger Coefficient"]
-                    ))
-                )
+                return self.exec_ranging_calibration(device, self.get_values(
+                    ["Trigger threshold", "Fixed calibration", "Trigger coefficient (0 = auto)",
+                     "Median window (int)", "Process noise (float)", "Measurement noise (float)"]
+                ))
             elif device.device_type == DeviceType.IR_ACTIVE:
                 # Laser sensor calibration (ranging)
                 print("Laser configuration")
-                self._print_output(
-                    self.exec_ranging_calibration(device, self.get_values(
-                        ["Trigger threshold", "Fixed calibration", "Trigger Coefficient"]
-                    ))
-                )
+                return self.exec_ranging_calibration(device, self.get_values(
+                    ["Trigger threshold", "Fixed calibration", "Trigger coefficient (0 = auto)",
+                     "Median window (int)", "Process noise (float)", "Measurement noise (float)"]
+                ))
             elif device.device_type == DeviceType.MOTOR:
                 # Winch driver calibration
                 print("Motorised winch configuration")
-                self._print_output(
-                    self.exec_door_calibration(device, self.get_values(
-                        ["Open distance (mm)", "Open-wait time (ms)", "Cool-down (ms)", "Close ticks (int)"]
-                    ))
-                )
+                return self.exec_door_calibration(device, self.get_values(
+                    ["Open distance (mm)", "Open-wait time (ms)", "Cool-down (ms)", "Close ticks (int)",
+                     "PID Kp (float)", "PID Ki (float)", "PID Kd (float)", "Max speed (ticks/s, 0 = open-loop)",
+                     "Acceleration (ticks/s^2)", "Profile (0 = trapezoidal, 1 = S-curve)"]
+                ))
             elif device.device_type == DeviceType.POWER_TOGGLE:
                 # Relay calibration
                 print("Relay configuration")
-                self._print_output(
-                    self.exec_relay_calibration(device, self.get_values(
-                        ["Relay activation time"]
-                    ))
-                )
+                return self.exec_relay_calibration(device, self.get_values(
+                    ["Relay activation time", "Channels (1-4, blank for a single relay)",
+                     "Schedule timezone (hours from UTC)",
+                     "Schedule (channel:days:HH:MM-HH:MM, comma separated; days as 0-6 with 0 Sunday, eg 12345)",
+                     "Channel map (device=mask, comma separated; * for all other devices)"]
+                ))
             else:
                 print("Device cannot be configured (" + str(device.device_type) + ")")
-                return
+                return None
         elif opt == 7:
             # Set lock state
-            self._print_output(
-                self.exec_lock_state(device, self.user_select_lock_state())
-            )
+            return self.exec_lock_state(device, self.user_select_lock_state())
         elif opt == 8:
             # Set listen devices
             print("Enter devices, one per line. Ctrl+C to abort, no devices for listen to all:")
@@ -112,14 +124,73 @@ class Config:
                     break
                 else:
                     devices.append(d)
-            self._print_output(
-                self.exec_listen_devices(device, devices)
-            )
+            return self.exec_listen_devices(device, devices)
         elif opt == 9:
             # Set stats server
-            self._print_output(
-                self.exec_stats_server(device, self.get_values(["Stats server address", "Stats server port"]))
-            )
+            return self.exec_stats_server(device, self.get_values(["Stats server address", "Stats server port"]))
+        elif opt == 11:
+            # Set OTA server
+            return self.exec_ota_server(device, self.get_values(
+                ["OTA server host (blank for the build default)", "OTA server port", "OTA path (eg /dosa-ota/)"]
+            ))
+
+    def _send_config(self, device, aux):
+        """
+        Send a single config item (ConfigItem marker followed by its data), or add it to the batch being built.
+        """
+        if self.batch is not None:
+            self.batch.append(bytes(aux))
+            return True
+
+        return self.comms.send(self.comms.build_payload(dosa.Messages.CONFIG_SETTING, aux), tgt=device.address,
+                               wait_for_ack=True)
+
+    @staticmethod
+    def build_batch(items):
+        """
+        Encode config items, each a ConfigItem marker followed by its data, as a single BATCH item.
+
+        The device validates the whole batch before applying any of it, then saves once.
+        """
+        aux = bytearray(struct.pack("<B", Config.BATCH))
+        for item in items:
+            aux += struct.pack("<BH", item[0], len(item) - 1)
+            aux += item[1:]
+
+        return aux
+
+    def exec_batch(self, device, items):
+        if not items:
+            return False
+
+        aux = self.build_batch(items)
+        if len(aux) > self.MAX_BATCH_SIZE:
+            print("Batch too large (" + str(len(aux)) + " bytes), send fewer settings")
+            return False
+
+        print("Sending " + str(len(items)) + " settings..")
+        return self.comms.send(self.comms.build_payload(dosa.Messages.CONFIG_SETTING, aux), tgt=device.address,
+                               wait_for_ack=True)
+
+    def user_build_batch(self, device):
+        """
+        Prompt for any number of settings, returning them as a list of config items to send as one batch.
+        """
+        self.batch = []
+        try:
+            while True:
+                print("Add a setting to the batch, blank to send:")
+                opt = self.user_select_opt(device.device_type == DeviceType.UNKNOWN, batch=True)
+                if opt is None:
+                    break
+
+                if self.exec_setting(device, opt) is False:
+                    print("Setting not added")
+                print()
+
+            return self.batch
+        finally:
+            self.batch = None
 
     @staticmethod
     def _print_output(out):
@@ -163,8 +234,7 @@ class Config:
         aux = bytearray()
         aux[0:1] = struct.pack("<B", 0)
         aux[1:] = values[0].encode()
-        return self.comms.send(self.comms.build_payload(dosa.Messages.CONFIG_SETTING, aux), tgt=device.address,
-                               wait_for_ack=True)
+        return self._send_config(device, aux)
 
     def exec_device_name(self, device, values):
         if values is None:
@@ -177,8 +247,7 @@ class Config:
         aux = bytearray()
         aux[0:1] = struct.pack("<B", 1)
         aux[1:] = values[0].encode()
-        return self.comms.send(self.comms.build_payload(dosa.Messages.CONFIG_SETTING, aux), tgt=device.address,
-                               wait_for_ack=True)
+        return self._send_config(device, aux)
 
     def exec_wifi_ap(self, device, values):
         aux = bytearray()
@@ -191,8 +260,7 @@ class Config:
             print("Sending new wifi details..", end="")
             aux[1:] = (values[0] + "\n" + values[1]).encode()
 
-        return self.comms.send(self.comms.build_payload(dosa.Messages.CONFIG_SETTING, aux), tgt=device.address,
-                               wait_for_ack=True)
+        return self._send_config(device, aux)
 
     def exec_sensor_calibration(self, device, values):
         aux = bytearray()
@@ -209,8 +277,7 @@ class Config:
                 print("Malformed calibration data, aborting")
                 return False
 
-        return self.comms.send(self.comms.build_payload(dosa.Messages.CONFIG_SETTING, aux), tgt=device.address,
-                               wait_for_ack=True)
+        return self._send_config(device, aux)
 
     def exec_door_calibration(self, device, values):
         aux = bytearray()
@@ -224,12 +291,17 @@ class Config:
                 aux[3:7] = struct.pack("<L", int(values[1]))  # Open-wait time (ms)
                 aux[7:11] = struct.pack("<L", int(values[2]))  # Cool-down (ms)
                 aux[11:15] = struct.pack("<L", int(values[3]))  # Close ticks
+                aux[15:19] = struct.pack("<f", float(values[4]))  # PID Kp
+                aux[19:23] = struct.pack("<f", float(values[5]))  # PID Ki
+                aux[23:27] = struct.pack("<f", float(values[6]))  # PID Kd
+                aux[27:29] = struct.pack("<H", int(values[7]))  # Max speed
+                aux[29:33] = struct.pack("<L", int(values[8]))  # Acceleration
+                aux[33:34] = struct.pack("<B", int(values[9]))  # Profile
             except ValueError:
                 print("Malformed calibration data, aborting")
                 return False
 
-        return self.comms.send(self.comms.build_payload(dosa.Messages.CONFIG_SETTING, aux), tgt=device.address,
-                               wait_for_ack=True)
+        return self._send_config(device, aux)
 
     def exec_ranging_calibration(self, device, values):
         aux = bytearray()
@@ -242,12 +314,14 @@ class Config:
                 aux[1:3] = struct.pack("<H", int(values[0]))  # Trigger threshold
                 aux[3:5] = struct.pack("<H", int(values[1]))  # Fixed calibration
                 aux[5:9] = struct.pack("<f", float(values[2]))  # Trigger coefficient
+                aux[9:10] = struct.pack("<B", int(values[3]))  # Median window
+                aux[10:14] = struct.pack("<f", float(values[4]))  # Process noise
+                aux[14:18] = struct.pack("<f", float(values[5]))  # Measurement noise
             except ValueError:
                 print("Malformed calibration data, aborting")
                 return False
 
-        return self.comms.send(self.comms.build_payload(dosa.Messages.CONFIG_SETTING, aux), tgt=device.address,
-                               wait_for_ack=True)
+        return self._send_config(device, aux)
 
     def exec_relay_calibration(self, device, values):
         aux = bytearray()
@@ -258,12 +332,46 @@ class Config:
         else:
             try:
                 aux[1:5] = struct.pack("<L", int(values[0]))  # Relay activation time
+
+                if len(values[1]) > 0:
+                    schedule = self.parse_relay_schedule(values[3])
+                    aux += struct.pack("<BbB", int(values[1]), int(values[2] or 0), len(schedule))
+                    for entry in schedule:
+                        aux += struct.pack("<BBHH", *entry)
+                    aux += "\n".join(m.strip() for m in values[4].split(",") if m.strip()).encode()
             except ValueError:
                 print("Malformed relay settings, aborting")
                 return False
 
-        return self.comms.send(self.comms.build_payload(dosa.Messages.CONFIG_SETTING, aux), tgt=device.address,
-                               wait_for_ack=True)
+        return self._send_config(device, aux)
+
+    @staticmethod
+    def parse_relay_schedule(value):
+        """
+        Convert "channel:days:HH:MM-HH:MM" windows into (channel, days mask, start minute, end minute) tuples.
+        """
+        def to_minute(t):
+            hours, minutes = t.split(":")
+            return int(hours) * 60 + int(minutes)
+
+        schedule = []
+        for window in value.split(","):
+            window = window.strip()
+            if not window:
+                continue
+
+            channel, days, times = window.split(":", 2)
+            start, end = times.split("-")
+            mask = 0
+            for day in days:
+                mask |= 1 << int(day)
+
+            schedule.append((int(channel), mask, to_minute(start), to_minute(end)))
+
+        if len(schedule) > 8:
+            raise ValueError("Too many schedule windows")
+
+        return schedule
 
     def exec_lock_state(self, device, lock_state):
         aux = bytearray()
@@ -278,8 +386,7 @@ class Config:
                 print("Malformed lock data, aborting")
                 return False
 
-        return self.comms.send(self.comms.build_payload(dosa.Messages.CONFIG_SETTING, aux), tgt=device.address,
-                               wait_for_ack=True)
+        return self._send_config(device, aux)
 
     def exec_listen_devices(self, device, values):
         aux = bytearray()
@@ -290,8 +397,7 @@ class Config:
         else:
             print("Set listen mode to all devices..")
 
-        return self.comms.send(self.comms.build_payload(dosa.Messages.CONFIG_SETTING, aux), tgt=device.address,
-                               wait_for_ack=True)
+        return self._send_config(device, aux)
 
     def exec_stats_server(self, device, values):
         aux = bytearray()
@@ -307,8 +413,27 @@ class Config:
                 print("Malformed server settings, aborting")
                 return False
 
-        return self.comms.send(self.comms.build_payload(dosa.Messages.CONFIG_SETTING, aux), tgt=device.address,
-                               wait_for_ack=True)
+        return self._send_config(device, aux)
+
+    def exec_ota_server(self, device, values):
+        aux = bytearray()
+        aux[0:1] = struct.pack("<B", 11)
+
+        if values is None:
+            # Revert to the build default
+            aux[1:3] = struct.pack("<H", 0)
+            print("Reverting to the default OTA server..")
+        else:
+            try:
+                aux[1:3] = struct.pack("<H", int(values[1] or 0))  # Server port
+                aux[3:] = values[0].encode()  # Server host
+                if values[2]:
+                    aux += ("\n" + values[2]).encode()  # Server path
+            except ValueError:
+                print("Malformed server settings, aborting")
+                return False
+
+        return self._send_config(device, aux)
 
     @staticmethod
     def get_values(vals):
@@ -390,9 +515,10 @@ class Config:
                 print("Invalid device")
 
     @staticmethod
-    def user_select_opt(all_devices=False):
-        print("[1] Request debug dump")
-        print("[2] Order device into Bluetooth configuration mode")
+    def user_select_opt(all_devices=False, batch=False):
+        if not batch:
+            print("[1] Request debug dump")
+            print("[2] Order device into Bluetooth configuration mode")
         print("[3] Set device password")
         print("[4] N/A" if all_devices else "[4] Set device name")
         print("[5] Set wifi configuration")
@@ -400,6 +526,9 @@ class Config:
         print("[7] Set device lock")
         print("[8] Set listen devices")
         print("[9] Set stats server")
+        if not batch:
+            print("[10] Set several of the above at once")
+        print("[11] Set OTA server")
 
         while True:
             try:
@@ -410,7 +539,7 @@ class Config:
             if opt is None or opt == 0:
                 return None
 
-            if 0 < opt < 10:
+            if (2 < opt < 12 and opt != 10) or (not batch and 0 < opt < 12):
                 print()
                 return opt
             else:
@@ -27,6 +27,7 @@ class Messages:
     PLAY = b"pla"
     REQ_STAT = b"req"
     STATUS = b"sta"
+    JOURNAL = b"jnl"
 
 
 class Message:
@@ -83,6 +83,9 @@ class DeviceStatus:
 
 class StatusFormat:
     STATUS_ONLY = 0
+    RANGING = 1
+    WINCH_TELEMETRY = 2
+    JOURNAL = 3
     POWER_GRID = 100
 
 
@@ -0,0 +1,95 @@
+import dosa
+import struct
+import time
+
+
+class Journal:
+    """
+    Pages the event journal back from a device's FRAM.
+    """
+
+    PAGE_HEADER_FORMAT = "<BBLLLB"
+    PAGE_HEADER_SIZE = 15
+    RECORD_FORMAT = "<LLHBBL"
+    RECORD_SIZE = 16
+
+    EVENTS = {
+        1: "BOOT",
+        2: "TRIGGER",
+        3: "SECURITY",
+        4: "FAULT",
+        5: "LOCK",
+        6: "LINK",
+    }
+
+    def __init__(self, comms=None):
+        if comms is None:
+            comms = dosa.Comms()
+
+        self.comms = comms
+
+    @staticmethod
+    def parse_page(status):
+        """
+        Returns (state, version, oldest, next, resume, records) where records is a list of
+        (sequence, time ms, boot, event, detail).
+        """
+        state, version, oldest, nxt, resume, count = struct.unpack(Journal.PAGE_HEADER_FORMAT,
+                                                                   status[0:Journal.PAGE_HEADER_SIZE])
+        records = []
+        for i in range(count):
+            offset = Journal.PAGE_HEADER_SIZE + i * Journal.RECORD_SIZE
+            sequence, uptime, boot, event, _, detail = struct.unpack(Journal.RECORD_FORMAT,
+                                                                      status[offset:offset + Journal.RECORD_SIZE])
+            records.append((sequence, uptime, boot, event, detail))
+
+        return state, version, oldest, nxt, resume, records
+
+    @staticmethod
+    def format_record(record):
+        sequence, uptime, boot, event, detail = record
+        return "#" + str(sequence) + " boot " + str(boot) + " +" + "{:.3f}".format(uptime / 1000) + "s " + \
+            Journal.EVENTS.get(event, "EVENT " + str(event)) + " (" + str(detail) + ")"
+
+    def request_page(self, target, start, timeout=1.5, retries=3):
+        """
+        Request the page from sequence `start`, returning the parsed page or None if the device did not reply.
+        """
+        for _ in range(retries):
+            self.comms.send(self.comms.build_payload(dosa.Messages.JOURNAL, struct.pack("<L", start)), target)
+            start_time = time.perf_counter()
+
+            while time.perf_counter() - start_time < timeout:
+                msg = self.comms.receive(timeout=timeout)
+                if msg is None or msg.msg_code != dosa.Messages.STATUS or msg.addr[0] != target[0]:
+                    continue
+
+                status_format = struct.unpack("<H", msg.payload[27:29])[0]
+                if status_format == dosa.device.StatusFormat.JOURNAL:
+                    return self.parse_page(msg.payload[29:msg.payload_size])
+
+        return None
+
+    def run(self, target, start=0):
+        """
+        Print the journal of `target` from sequence `start`, a page at a time.
+        """
+        print("JOURNAL > " + target[0] + ":" + str(target[1]))
+
+        while True:
+            page = self.request_page(target, start)
+            if page is None:
+                print("No reply")
+                return
+
+            _, _, oldest, nxt, resume, records = page
+            if start == 0:
+                print("Holding records " + str(oldest) + " to " + str(nxt - 1))
+
+            for record in records:
+                print(self.format_record(record))
+
+            if resume >= nxt or resume == start:
+                return
+
+            start = resume
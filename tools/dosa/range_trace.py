@@ -0,0 +1,38 @@
+import struct
+
+
+class RangeTrace:
+    """
+    Decodes the trace packed into a ranging sensor's trigger map.
+    """
+
+    def __init__(self, trigger_map):
+        self.previous, self.current, self.velocity, self.version, count = struct.unpack("<HHhBB", trigger_map[0:8])
+        self.samples = []
+
+        if self.version == 0 or count == 0:
+            # Older firmware only sends the two distances
+            return
+
+        distance, age = struct.unpack("<HH", trigger_map[8:12])
+        time = -age
+        self.samples.append((time, distance))
+
+        for i in range(count - 1):
+            offset = 12 + i * 3
+            dt, delta = struct.unpack("<Bh", trigger_map[offset:offset + 3])
+            time += dt * 10
+            distance = (distance + delta) & 0xFFFF
+            self.samples.append((time, distance))
+
+    def __str__(self):
+        out = str(self.previous) + "mm -> " + str(self.current) + "mm"
+        if self.version > 0:
+            out += ", " + str(self.velocity) + "mm/s"
+        return out
+
+    def trace_str(self):
+        """
+        Samples as "time:distance" pairs, with time in ms relative to the trigger.
+        """
+        return " ".join(str(t) + ":" + str(d) for t, d in self.samples)
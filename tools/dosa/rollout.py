@@ -0,0 +1,179 @@
+import dosa
+import struct
+import time
+import zlib
+
+
+class Rollout:
+    """
+    Rolls an OTA update out across the fleet in waves, advancing only once every device of a wave has reported healthy.
+
+    Devices place themselves in a wave from the CRC-32 of their name and the target version (see ota_rollout.h), so
+    the same hash here predicts which devices each wave should bring back online.
+    """
+
+    DEFAULT_WAVES = [5, 25, 50, 100]
+
+    # Device types of the OTA-aware applications
+    OTA_DEVICE_TYPES = [
+        dosa.DeviceType.ALARM,
+        dosa.DeviceType.IR_PASSIVE,
+        dosa.DeviceType.IR_ACTIVE,
+        dosa.DeviceType.SONAR,
+        dosa.DeviceType.POWER_TOGGLE,
+        dosa.DeviceType.MOTOR,
+    ]
+
+    # Online messages carrying the version and device state
+    ONLINE_SIZE = 32
+
+    RESEND_INTERVAL = 3.0
+    RESEND_RETRIES = 3
+
+    def __init__(self, comms=None, version=0, waves=None, spread=120, timeout=300, soak=60):
+        if comms is None:
+            comms = dosa.Comms()
+
+        self.comms = comms
+        self.version = version
+        self.waves = waves if waves else Rollout.DEFAULT_WAVES
+        self.spread = spread
+        self.timeout = timeout
+        self.soak = soak
+
+        # Device name: address, of OTA-aware devices found by the scan
+        self.devices = {}
+
+    @staticmethod
+    def get_bucket(name, version):
+        return zlib.crc32(name.encode("utf-8") + struct.pack("<L", version)) % 100
+
+    @staticmethod
+    def build_request(wave, spread, version):
+        return struct.pack("<BHL", wave, spread, version)
+
+    @staticmethod
+    def parse_online(msg):
+        """
+        Returns (version, state) from an online message, or (None, None) if it came from a device predating them.
+        """
+        if msg.payload_size < Rollout.ONLINE_SIZE:
+            return None, None
+
+        return struct.unpack("<LB", msg.payload[27:32])
+
+    def scan(self, retries=8, timeout=0.2):
+        ping = self.comms.build_payload(dosa.Messages.PING)
+        self.devices = {}
+
+        for _ in range(retries):
+            self.comms.send(ping)
+            start_time = time.perf_counter()
+
+            while time.perf_counter() - start_time < timeout:
+                msg = self.comms.receive(timeout=timeout)
+                if msg is None or msg.msg_code != dosa.Messages.PONG:
+                    continue
+
+                if msg.payload[self.comms.BASE_PAYLOAD_SIZE] in Rollout.OTA_DEVICE_TYPES:
+                    self.devices[msg.device_name] = msg.addr
+
+    def get_wave_devices(self, wave):
+        return sorted([name for name in self.devices if self.get_bucket(name, self.version) < wave])
+
+    def run_wave(self, wave):
+        """
+        Request the wave and wait for each of its devices to come back online with the target version.
+
+        Returns the names of the devices that did not report healthy.
+        """
+        expected = self.get_wave_devices(wave)
+        print("WAVE " + str(wave) + "% > " + str(len(expected)) + " devices: " + ", ".join(expected))
+
+        request = self.build_request(wave, self.spread, self.version)
+        self.comms.send(self.comms.build_payload(dosa.Messages.OTA, request))
+
+        acked = set()
+        healthy = set()
+        failed = set()
+        resends = 0
+        last_send = time.perf_counter()
+        start_time = last_send
+
+        while time.perf_counter() - start_time < self.spread + self.timeout:
+            pending = [name for name in expected if name not in healthy and name not in failed]
+            if len(pending) == 0:
+                break
+
+            # Multicast is lossy, chase up any device that hasn't acknowledged the request
+            if time.perf_counter() - last_send > Rollout.RESEND_INTERVAL and resends < Rollout.RESEND_RETRIES:
+                for name in pending:
+                    if name not in acked:
+                        self.comms.send(self.comms.build_payload(dosa.Messages.OTA, request), self.devices[name])
+                resends += 1
+                last_send = time.perf_counter()
+
+            msg = self.comms.receive(timeout=0.5)
+            if msg is None or msg.device_name not in expected:
+                continue
+
+            if msg.msg_code == dosa.Messages.ACK:
+                acked.add(msg.device_name)
+            elif msg.msg_code == dosa.Messages.LOG:
+                level = struct.unpack("<B", msg.payload[27:28])[0]
+                if level >= dosa.LogLevel.ERROR:
+                    print("  " + msg.device_name + ": " + msg.payload[28:msg.payload_size].decode("utf-8"))
+            elif msg.msg_code == dosa.Messages.ONLINE:
+                version, state = self.parse_online(msg)
+                self.devices[msg.device_name] = msg.addr
+
+                # A device yet to update may simply have reconnected; it fails by timing out if it never does
+                if version is None or version < self.version:
+                    print("  " + msg.device_name + ": online, not yet updated (" + str(version) + ")")
+                elif state >= dosa.DeviceStatus.MAJOR_FAULT:
+                    print("  " + msg.device_name + ": v" + str(version) + " " + dosa.DeviceStatus.as_string(state))
+                    failed.add(msg.device_name)
+                else:
+                    print("  " + msg.device_name + ": v" + str(version) + " healthy")
+                    healthy.add(msg.device_name)
+
+        return [name for name in expected if name not in healthy]
+
+    def soak_wave(self, wave):
+        """
+        Watch a healthy wave for `soak` seconds; a device coming online again has restarted.
+
+        Returns the names of the devices that restarted.
+        """
+        if self.soak == 0:
+            return []
+
+        print("Soaking for " + str(self.soak) + "s..")
+        expected = self.get_wave_devices(wave)
+        restarted = set()
+        start_time = time.perf_counter()
+
+        while time.perf_counter() - start_time < self.soak:
+            msg = self.comms.receive(timeout=0.5)
+            if msg is not None and msg.msg_code == dosa.Messages.ONLINE and msg.device_name in expected:
+                print("  " + msg.device_name + ": restarted")
+                restarted.add(msg.device_name)
+
+        return sorted(restarted)
+
+    def run(self):
+        print("ROLLOUT > v" + str(self.version) + " in waves of " + ", ".join([str(w) + "%" for w in self.waves]))
+        self.scan()
+        print("Found " + str(len(self.devices)) + " OTA-aware devices")
+
+        for wave in self.waves:
+            unhealthy = self.run_wave(wave)
+            if len(unhealthy) == 0:
+                unhealthy = self.soak_wave(wave)
+
+            if len(unhealthy) > 0:
+                print("Halting rollout at " + str(wave) + "%, unhealthy: " + ", ".join(unhealthy))
+                return False
+
+        print("Rollout complete")
+        return True
@@ -222,9 +222,9 @@ class SecBot:
                 self.log(packet, " | SENSOR")
             elif trigger_type == 3:
                 # Ranging sensor, show distances
-                dist_prev = struct.unpack("<H", packet.payload[28:30])[0]
-                dist_new = struct.unpack("<H", packet.payload[30:32])[0]
-                self.log(packet, " | RANGE | " + str(dist_prev) + " | " + str(dist_new))
+                trace = dosa.RangeTrace(packet.payload[28:92])
+                self.log(packet, " | RANGE | " + str(trace.previous) + " | " + str(trace.current) + " | " +
+                         str(trace.velocity))
             elif trigger_type == 4:
                 # IR grid map - could log some data here, but probably too much for a single-line logfile
                 self.log(packet, " | MAP")
@@ -1,10 +1,11 @@
 import dosa
+import os
 import struct
 import time
 
 
 class Snoop:
-    def __init__(self, comms=None, ignore=False, ack=False, map=False, ignore_pings=False):
+    def __init__(self, comms=None, ignore=False, ack=False, map=False, ignore_pings=False, telemetry_dir=None):
         if comms is None:
             comms = dosa.Comms()
 
@@ -14,6 +15,8 @@ class Snoop:
         self.auto_ack = ack
         self.print_map = map
         self.ignore_pings = ignore_pings
+        self.telemetry_dir = telemetry_dir
+        self.telemetry = {}
 
     def run_snoop(self):
         while True:
@@ -35,10 +38,11 @@ class Snoop:
                 if self.print_map:
                     trigger_type = struct.unpack("<B", msg.payload[27:28])[0]
                     if trigger_type == 3:
-                        # Ranging sensor, show distances
-                        dist_prev = struct.unpack("<H", msg.payload[28:30])[0]
-                        dist_new = struct.unpack("<H", msg.payload[30:32])[0]
-                        aux += " // distance: " + str(dist_prev) + " -> " + str(dist_new)
+                        # Ranging sensor, show distances and the trace leading up to the trigger
+                        trace = dosa.RangeTrace(msg.payload[28:92])
+                        aux += " // distance: " + str(trace)
+                        if trace.samples:
+                            aux += "\n  trace: " + trace.trace_str()
                     elif trigger_type == 4:
                         # IR grid, display map
                         aux += "\n+--------+\n"
@@ -60,8 +64,27 @@ class Snoop:
             elif msg.msg_code == dosa.Messages.PLAY:
                 play = msg.payload[27:msg.payload_size].decode("utf-8")
                 aux = " // RUN PLAY: " + play
+            elif msg.msg_code == dosa.Messages.STATUS:
+                status_format = struct.unpack("<H", msg.payload[27:29])[0]
+                if status_format == dosa.device.StatusFormat.RANGING:
+                    state, baseline, lower, upper, coefficient, samples = struct.unpack(
+                        "<BHHHfL", msg.payload[29:44])
+                    aux = " // " + dosa.DeviceStatus.as_string(state) + ", baseline: " + str(baseline) + "mm (-" + \
+                          str(lower) + "/+" + str(upper) + "mm, " + str(samples) + " samples), coefficient: " + \
+                          "{:.3f}".format(coefficient)
+                elif status_format == dosa.device.StatusFormat.WINCH_TELEMETRY:
+                    aux = " // " + self.add_telemetry(msg.device_name, msg.payload[29:msg.payload_size])
+                elif status_format == dosa.device.StatusFormat.JOURNAL:
+                    _, _, oldest, nxt, _, records = dosa.Journal.parse_page(msg.payload[29:msg.payload_size])
+                    aux = " // JOURNAL " + str(len(records)) + " records, holding " + str(oldest) + " to " + \
+                          str(nxt - 1)
+                else:
+                    aux = " // STATUS FORMAT " + str(status_format)
             elif msg.msg_code == dosa.Messages.ONLINE:
+                version, state = dosa.Rollout.parse_online(msg)
                 aux = " // ONLINE"
+                if version is not None:
+                    aux += " v" + str(version) + ", " + dosa.DeviceStatus.as_string(state)
             elif msg.msg_code == dosa.Messages.BEGIN:
                 aux = " // BEGIN SEQUENCE"
             elif msg.msg_code == dosa.Messages.END:
@@ -81,6 +104,32 @@ class Snoop:
 
             self.last_msg_id = msg.msg_id
 
+    def add_telemetry(self, device_name, status):
+        """
+        Collect a door sequence telemetry chunk, saving the sequence as CSV once all chunks have arrived.
+        """
+        _, _, sequence, flags, index, chunks, interval, total, _, _ = dosa.WinchTelemetry.parse_header(status)
+        key = (device_name, sequence)
+
+        if key not in self.telemetry:
+            self.telemetry[key] = dosa.WinchTelemetry(sequence, flags, interval, total, chunks)
+
+        telemetry = self.telemetry[key]
+        telemetry.add_chunk(status)
+        out = "TELEMETRY " + str(index + 1) + "/" + str(chunks) + " of " + str(telemetry)
+
+        if telemetry.is_complete():
+            del self.telemetry[key]
+            if self.telemetry_dir is not None:
+                name = device_name.strip().replace(" ", "_")
+                filename = os.path.join(self.telemetry_dir, name + "-" + str(int(time.time())) + "-" + str(sequence) +
+                                        ".csv")
+                with open(filename, "w") as f:
+                    f.write(telemetry.to_csv())
+                out += ", saved to " + filename
+
+        return out
+
     @staticmethod
     def print_pixel(p):
         if p == 0:
@@ -0,0 +1,78 @@
+import struct
+
+
+class WinchTelemetry:
+    """
+    Reassembles a door sequence recording from its WINCH_TELEMETRY status message chunks.
+    """
+
+    HEADER_FORMAT = "<BBHBBBHHHB"
+    HEADER_SIZE = 14
+    SAMPLE_FORMAT = "<HBHHHH"
+    SAMPLE_SIZE = 11
+
+    FLAG_REWIND = 0x01
+    FLAG_CLOSED_LOOP = 0x02
+    FLAG_DECIMATED = 0x04
+
+    PHASES = {
+        2: "open",
+        4: "close",
+        6: "calibrate",
+        8: "rollback",
+    }
+
+    def __init__(self, sequence, flags, interval, total, chunks):
+        self.sequence = sequence
+        self.flags = flags
+        self.interval = interval
+        self.total = total
+        self.chunks = chunks
+        self.received = set()
+        self.samples = [None] * total
+
+    @staticmethod
+    def parse_header(status):
+        """
+        Returns (state, version, sequence, flags, chunk index, chunk count, interval, total, first, count).
+        """
+        return struct.unpack(WinchTelemetry.HEADER_FORMAT, status[0:WinchTelemetry.HEADER_SIZE])
+
+    def add_chunk(self, status):
+        _, _, _, _, index, _, _, _, first, count = self.parse_header(status)
+
+        for i in range(count):
+            offset = self.HEADER_SIZE + i * self.SAMPLE_SIZE
+            time, phase, ticks, speed, distance, current = struct.unpack(
+                self.SAMPLE_FORMAT, status[offset:offset + self.SAMPLE_SIZE])
+            if first + i < self.total:
+                self.samples[first + i] = (time * 10, phase, ticks, speed, distance, current)
+
+        self.received.add(index)
+
+    def is_complete(self):
+        return len(self.received) == self.chunks
+
+    def phase_name(self, phase):
+        return self.PHASES.get(phase, str(phase))
+
+    def __str__(self):
+        out = "sequence " + str(self.sequence) + ": " + str(self.total) + " samples @ " + str(self.interval) + "ms"
+        if self.flags & self.FLAG_REWIND:
+            out += ", rewind"
+        if self.flags & self.FLAG_CLOSED_LOOP:
+            out += ", closed-loop"
+        return out
+
+    def to_csv(self):
+        """
+        Samples as CSV, one row per sample with time in ms since the sequence began.
+        """
+        rows = ["time_ms,phase,ticks,speed_tps,sonar_mm,current_ma"]
+        for sample in self.samples:
+            if sample is None:
+                continue
+            time, phase, ticks, speed, distance, current = sample
+            rows.append(",".join([str(time), self.phase_name(phase), str(ticks), str(speed), str(distance),
+                                  str(current)]))
+        return "\n".join(rows) + "\n"